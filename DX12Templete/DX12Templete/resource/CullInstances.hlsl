@@ -0,0 +1,166 @@
+// Frustum and occlusion culling of every instance, mirrored on the CPU by src/IndirectCulling.cpp.
+// Survivors are appended to the indirect argument buffer a wave at a time and counted in drawCount,
+// which ExecuteIndirect reads as its command count.
+
+struct CullInstance
+{
+	float3 center;
+	uint objectIndex;
+	float3 extents;
+	uint indexCount;
+	uint startIndex;
+	int baseVertex;
+	uint2 pad;
+};
+
+struct IndirectCommand
+{
+	uint2 objectConstants;
+	uint indexCountPerInstance;
+	uint instanceCount;
+	uint startIndexLocation;
+	int baseVertexLocation;
+	uint startInstanceLocation;
+	uint pad;
+};
+
+struct HiZLevel
+{
+	uint width;
+	uint height;
+	uint offset;
+	uint pad;
+};
+
+cbuffer CullConstants : register(b0)
+{
+	float4x4 viewProj;
+	float4 frustumPlanes[6];
+	uint instanceCount;
+	uint hizLevelCount;
+	float screenWidth;
+	float screenHeight;
+	uint2 objectConstantsAddress;
+	uint objectConstantsStride;
+	uint tileSize;
+	HiZLevel hizLevels[16];
+}
+
+StructuredBuffer<CullInstance> instances : register(t0);
+StructuredBuffer<float> hiz : register(t1);
+RWStructuredBuffer<IndirectCommand> commands : register(u0);
+RWByteAddressBuffer drawCount : register(u1);
+
+static const float FLT_MAX = 3.402823466e+38f;
+
+bool IsInsideFrustum(float3 center, float3 extents)
+{
+	float radius = length(extents);
+	for (uint i = 0; i < 6; i++)
+	{
+		float4 plane = frustumPlanes[i];
+		float d = dot(plane.xyz, center) + plane.w;
+		if (d < -radius)
+		{
+			return false;
+		}
+		// The sphere straddles the plane; the box decides
+		if (d < radius && d + dot(abs(plane.xyz), extents) < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsOccluded(float3 center, float3 extents)
+{
+	if (hizLevelCount == 0)
+	{
+		return false;
+	}
+
+	float2 minScreen = FLT_MAX;
+	float2 maxScreen = -FLT_MAX;
+	float minZ = FLT_MAX;
+	for (uint corner = 0; corner < 8; corner++)
+	{
+		float3 p = center + extents * float3((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+		float4 clip = mul(float4(p, 1.0f), viewProj);
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			return false;
+		}
+		float invW = 1.0f / clip.w;
+		float2 screen = float2((clip.x * invW * 0.5f + 0.5f) * screenWidth, (0.5f - clip.y * invW * 0.5f) * screenHeight);
+		minScreen = min(minScreen, screen);
+		maxScreen = max(maxScreen, screen);
+		minZ = min(minZ, clip.z * invW);
+	}
+	if (any(maxScreen < 0.0f) || minScreen.x > screenWidth || minScreen.y > screenHeight)
+	{
+		return false;
+	}
+
+	int2 tileMin = max(int2(0, 0), int2(floor(minScreen))) / int(tileSize);
+	int2 tileMax = min(int2(screenWidth, screenHeight) - 1, int2(ceil(maxScreen))) / int(tileSize);
+
+	// Coarsest level where the rectangle spans at most 4x4 texels
+	uint level = 0;
+	while (any(tileMax - tileMin > 3) && level + 1 < hizLevelCount)
+	{
+		tileMin >>= 1;
+		tileMax >>= 1;
+		level++;
+	}
+
+	HiZLevel hizLevel = hizLevels[level];
+	for (int y = tileMin.y; y <= tileMax.y; y++)
+	{
+		for (int x = tileMin.x; x <= tileMax.x; x++)
+		{
+			if (hiz[hizLevel.offset + y * hizLevel.width + x] >= minZ)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	bool visible = false;
+	CullInstance instance = (CullInstance)0;
+	if (id.x < instanceCount)
+	{
+		instance = instances[id.x];
+		visible = IsInsideFrustum(instance.center, instance.extents) && !IsOccluded(instance.center, instance.extents);
+	}
+
+	// One atomic per wave instead of one per survivor
+	uint waveSurvivors = WaveActiveCountBits(visible);
+	uint base = 0;
+	if (WaveIsFirstLane() && waveSurvivors > 0)
+	{
+		drawCount.InterlockedAdd(0, waveSurvivors, base);
+	}
+	uint slot = WaveReadLaneFirst(base) + WavePrefixCountBits(visible);
+
+	if (visible)
+	{
+		uint offset = instance.objectIndex * objectConstantsStride;
+		uint low = objectConstantsAddress.x + offset;
+
+		IndirectCommand command;
+		command.objectConstants = uint2(low, objectConstantsAddress.y + (low < offset ? 1 : 0));
+		command.indexCountPerInstance = instance.indexCount;
+		command.instanceCount = 1;
+		command.startIndexLocation = instance.startIndex;
+		command.baseVertexLocation = instance.baseVertex;
+		command.startInstanceLocation = 0;
+		command.pad = 0;
+		commands[slot] = command;
+	}
+}
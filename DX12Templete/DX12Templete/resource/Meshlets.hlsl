@@ -0,0 +1,49 @@
+// Mesh shader path for meshlets built by src/MeshletBuilder.cpp. The CPU has already culled them
+// (src/ClusterCulling.cpp) and lists this object's survivors in visibleMeshlets; each group expands
+// one of them, a vertex and a triangle per thread.
+
+#include "ShaderConstants.hlsli"
+#include "SquareVertex.hlsli"
+
+struct Meshlet
+{
+	uint vertexOffset;
+	uint vertexCount;
+	uint triangleOffset;
+	uint triangleCount;
+};
+
+struct VSOutput
+{
+	float4 Position : SV_POSITION;
+	float4 Color : COLOR;
+	float2 TexCoord : TEXCOORD;
+};
+
+ByteAddressBuffer meshVertices : register(t0);            // the geometry buffer, SquareVertexElements
+StructuredBuffer<Meshlet> meshlets : register(t1);
+StructuredBuffer<uint> meshletVertices : register(t2);
+StructuredBuffer<uint> meshletTriangles : register(t3);   // three 8-bit local indices each
+StructuredBuffer<uint> visibleMeshlets : register(t4);
+
+[outputtopology("triangle")]
+[numthreads(128, 1, 1)]
+void main(uint thread : SV_GroupThreadID, uint group : SV_GroupID,
+	out vertices VSOutput outVertices[64], out indices uint3 outTriangles[124])
+{
+	Meshlet meshlet = meshlets[visibleMeshlets[group]];
+	SetMeshOutputCounts(meshlet.vertexCount, meshlet.triangleCount);
+
+	if (thread < meshlet.vertexCount)
+	{
+		SquareVertex vertex = LoadSquareVertex(meshVertices, baseVertex + meshletVertices[meshlet.vertexOffset + thread]);
+		outVertices[thread].Position = mul(vertex.position, worldViewProj);
+		outVertices[thread].Color = vertex.color;
+		outVertices[thread].TexCoord = vertex.position.xy * float2(0.5f, -0.5f) + 0.5f;
+	}
+	if (thread < meshlet.triangleCount)
+	{
+		uint packed = meshletTriangles[meshlet.triangleOffset + thread];
+		outTriangles[thread] = uint3(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff);
+	}
+}
@@ -2,9 +2,15 @@ struct VSOutput
 {
 	float4 Position : SV_POSITION;
 	float4 Color : COLOR;
+	float2 TexCoord : TEXCOORD;
 };
 
+// Block-compressed, loaded from Texture.dds; the sampler is static in the root signature. Finer mips
+// stream in and out, and the view's ResourceMinLODClamp keeps sampling to those resident.
+Texture2D squareTexture : register(t0);
+SamplerState squareSampler : register(s0);
+
 float4 main(VSOutput In) : SV_TARGET
 {
-	return In.Color;
+	return In.Color * squareTexture.Sample(squareSampler, In.TexCoord);
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+// Vertex pulling: no input layout, each vertex is fetched from the shared geometry buffer by index.
+// Draws leave BaseVertexLocation at 0 and ObjectConstants carries the mesh's first vertex, so
+// SV_VertexID is the value from the index buffer and meshes of any layout could share the pipeline.
+
+#include "ShaderConstants.hlsli"
+#include "SquareVertex.hlsli"
+
+struct VSOutput
+{
+	float4 Position: SV_POSITION;
+	float4 Color: COLOR;
+	float2 TexCoord: TEXCOORD;
+};
+
+ByteAddressBuffer geometryVertices : register(t0);
+
+VSOutput main(uint vertexId : SV_VertexID)
+{
+	SquareVertex vertex = LoadSquareVertex(geometryVertices, baseVertex + vertexId);
+	VSOutput result = (VSOutput)0;
+	result.Position = mul(vertex.position, worldViewProj);
+	result.Color = vertex.color;
+	result.TexCoord = vertex.position.xy * float2(0.5f, -0.5f) + 0.5f;
+	return result;
+}
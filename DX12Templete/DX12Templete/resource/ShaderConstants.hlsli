@@ -0,0 +1,16 @@
+// Constant buffer layouts shared by the graphics shaders, mirrored by src/ShaderConstants.h
+
+cbuffer FrameConstants : register(b0)
+{
+	float4x4 viewProj;
+	float4x4 view;
+	float4x4 proj;
+	float3 cameraPosition;
+}
+
+cbuffer ObjectConstants : register(b1)
+{
+	float4x4 worldViewProj;
+	float4x4 world;
+	uint baseVertex;    // first vertex in the geometry buffer, for shaders that fetch vertices themselves
+}
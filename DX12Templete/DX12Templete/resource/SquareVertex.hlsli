@@ -0,0 +1,60 @@
+// Generated by tools/VertexLayoutGen from src/SquareVertex.h; do not edit.
+// 12 bytes per vertex
+
+#ifndef VERTEX_LAYOUT_HELPERS
+#define VERTEX_LAYOUT_HELPERS
+
+float2 UnpackSnorm16x2(uint v)
+{
+	int2 s = int2(int(v << 16) >> 16, int(v) >> 16);
+	return max(float2(s) / 32767.0f, -1.0f);
+}
+
+float4 UnpackSnorm16x4(uint2 v)
+{
+	return float4(UnpackSnorm16x2(v.x), UnpackSnorm16x2(v.y));
+}
+
+float4 UnpackUnorm8x4(uint v)
+{
+	return float4(v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24) / 255.0f;
+}
+
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy -= (step(0.0f, n.xy) * 2.0f - 1.0f) * t;
+	return normalize(n);
+}
+
+#endif
+
+struct SquareVertexInput
+{
+	float4 position : POSITION;
+	float4 color : COLOR;
+};
+
+struct SquareVertex
+{
+	float4 position;
+	float4 color;
+};
+
+SquareVertex DecodeSquareVertex(SquareVertexInput input)
+{
+	SquareVertex result;
+	result.position = input.position;
+	result.color = input.color;
+	return result;
+}
+
+SquareVertex LoadSquareVertex(ByteAddressBuffer buffer, uint index)
+{
+	uint address = index * 12;
+	SquareVertex result;
+	result.position = UnpackSnorm16x4(buffer.Load2(address));
+	result.color = UnpackUnorm8x4(buffer.Load(address + 8));
+	return result;
+}
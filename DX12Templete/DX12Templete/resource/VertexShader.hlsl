@@ -1,27 +1,21 @@
-struct VSInput
-{
-	float4 Position: POSITION;
-	float4 Color: COLOR;
-};
+#include "ShaderConstants.hlsli"
+#include "SquareVertex.hlsli"
 
 struct VSOutput
 {
 	float4 Position: SV_POSITION;
 	float4 Color: COLOR;
+	float2 TexCoord: TEXCOORD;
 };
 
-cbuffer ShaderParameter : register(b0)
-{
-	float4x4 world;
-	float4x4 view;
-	float4x4 proj;
-}
-
-VSOutput main(VSInput In)
+VSOutput main(SquareVertexInput In)
 {
+	SquareVertex vertex = DecodeSquareVertex(In);
 	VSOutput result = (VSOutput)0;
-	float4x4 mtxWVP = mul(world, mul(view, proj));
-	result.Position = mul(In.Position, mtxWVP);
-	result.Color = In.Color;
-	return result;
+	// world * view * proj is concatenated on the CPU once per object, after the position decode
+	result.Position = mul(vertex.position, worldViewProj);
+	result.Color = vertex.color;
+	// The vertex format has no UVs; squares are flat in XY and the quantized position spans their bounds in [-1, 1]
+	result.TexCoord = vertex.position.xy * float2(0.5f, -0.5f) + 0.5f;
+	return result;
 }
@@ -0,0 +1,310 @@
+#include "AssetLoader.h"
+#include <algorithm>
+
+AssetLoader::AssetLoader(unsigned workerCount)
+{
+	mWorkers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		mWorkers.emplace_back(&AssetLoader::WorkerMain, this);
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Loads capture their owners, so none may still be running once the owner goes away
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWake.notify_all();
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+AssetHandle AssetLoader::Request(const std::string& key, const std::vector<AssetHandle>& dependencies, LoadFunction load,
+	UnloadFunction unload, AssetAffinity affinity)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	auto existing = mKeys.find(key);
+	if (existing != mKeys.end())
+	{
+		mNodes.Get(existing->second)->references++;
+		mStatistics.deduplicated++;
+		return existing->second;
+	}
+
+	Node node;
+	node.key = key;
+	node.load = std::move(load);
+	node.unload = std::move(unload);
+	node.affinity = affinity;
+	for (AssetHandle dependency : dependencies)
+	{
+		Node* required = mNodes.Get(dependency);
+		if (!required)
+		{
+			node.dependencyFailed = true;
+			continue;
+		}
+		required->references++;
+		node.dependencies.push_back(dependency);
+		if (required->state == AssetState::Failed)
+		{
+			node.dependencyFailed = true;
+		}
+		else if (!IsFinished(required->state))
+		{
+			node.unfinished++;
+		}
+	}
+
+	AssetHandle handle = mNodes.Create(std::move(node));
+	mKeys.emplace(key, handle);
+	mUnfinished++;
+	Node& created = *mNodes.Get(handle);
+	for (AssetHandle dependency : created.dependencies)
+	{
+		Node* required = mNodes.Get(dependency);
+		if (!IsFinished(required->state))
+		{
+			required->dependents.push_back(handle);
+		}
+	}
+	if (created.dependencyFailed && created.unfinished == 0)
+	{
+		Finish(handle, false, 0.0);
+	}
+	else if (created.unfinished == 0)
+	{
+		Enqueue(handle);
+	}
+	return handle;
+}
+
+void AssetLoader::AddRef(AssetHandle handle)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (Node* node = mNodes.Get(handle))
+	{
+		node->references++;
+	}
+}
+
+void AssetLoader::Release(AssetHandle handle)
+{
+	Node* node;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		node = mNodes.Get(handle);
+		if (!node || --node->references > 0)
+		{
+			return;
+		}
+	}
+	Wait(handle);
+
+	std::vector<AssetHandle> dependencies;
+	UnloadFunction unload;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		node = mNodes.Get(handle);
+		if (node->state == AssetState::Ready)
+		{
+			unload = std::move(node->unload);
+		}
+		dependencies = std::move(node->dependencies);
+		mKeys.erase(node->key);
+		mNodes.Destroy(handle);
+	}
+	if (unload)
+	{
+		unload();
+	}
+	// Dependents are released first, so dependencies unload after everything built on them
+	for (AssetHandle dependency : dependencies)
+	{
+		Release(dependency);
+	}
+}
+
+bool AssetLoader::Wait(AssetHandle handle)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		if (handle == InvalidAsset)
+		{
+			if (mUnfinished == 0)
+			{
+				return std::none_of(mNodes.begin(), mNodes.end(), [](const Node& node) { return node.state == AssetState::Failed; });
+			}
+		}
+		else
+		{
+			const Node* node = mNodes.Get(handle);
+			if (!node)
+			{
+				return false;
+			}
+			if (IsFinished(node->state))
+			{
+				return node->state == AssetState::Ready;
+			}
+		}
+
+		// Work here instead of sleeping, as JobSystem::ParallelFor does
+		AssetHandle ready;
+		if (TakeReady(mCallerQueue, &ready) || TakeReady(mWorkerQueue, &ready))
+		{
+			Run(lock, ready);
+			continue;
+		}
+		mProgress.wait(lock);
+	}
+}
+
+AssetState AssetLoader::GetState(AssetHandle handle) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	const Node* node = mNodes.Get(handle);
+	return node ? node->state : AssetState::Failed;
+}
+
+size_t AssetLoader::GetLoadCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNodes.Size();
+}
+
+AssetLoadStatistics AssetLoader::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	AssetLoadStatistics statistics = mStatistics;
+	statistics.wallSeconds = mStarted ? std::chrono::duration<double>(mLastFinish - mFirstStart).count() : 0.0;
+	return statistics;
+}
+
+void AssetLoader::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStatistics = AssetLoadStatistics();
+	mLastFinish = Clock::time_point();
+	mStarted = false;
+}
+
+void AssetLoader::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWake.wait(lock, [this] { return mStop || !mWorkerQueue.empty(); });
+		if (mStop)
+		{
+			return;
+		}
+		AssetHandle handle;
+		if (TakeReady(mWorkerQueue, &handle))
+		{
+			Run(lock, handle);
+		}
+	}
+}
+
+bool AssetLoader::TakeReady(std::deque<AssetHandle>& queue, AssetHandle* handle)
+{
+	if (queue.empty())
+	{
+		return false;
+	}
+	*handle = queue.front();
+	queue.pop_front();
+	return true;
+}
+
+void AssetLoader::Run(std::unique_lock<std::mutex>& lock, AssetHandle handle)
+{
+	// The node may move while the lock is down, so the function leaves it first
+	Node& node = *mNodes.Get(handle);
+	node.state = AssetState::Loading;
+	LoadFunction load = std::move(node.load);
+	Clock::time_point start = Clock::now();
+	if (!mStarted)
+	{
+		mFirstStart = start;
+		mStarted = true;
+	}
+
+	lock.unlock();
+	bool succeeded;
+	try
+	{
+		succeeded = load ? load() : true;
+	}
+	catch (...)
+	{
+		succeeded = false;
+	}
+	Clock::time_point end = Clock::now();
+	lock.lock();
+
+	mLastFinish = std::max(mLastFinish, end);
+	mStatistics.loads++;
+	Finish(handle, succeeded, std::chrono::duration<double>(end - start).count());
+}
+
+void AssetLoader::Finish(AssetHandle handle, bool succeeded, double seconds)
+{
+	Node& node = *mNodes.Get(handle);
+	double start = 0.0;
+	for (AssetHandle dependency : node.dependencies)
+	{
+		start = std::max(start, mNodes.Get(dependency)->pathSeconds);
+	}
+	node.state = succeeded ? AssetState::Ready : AssetState::Failed;
+	node.pathSeconds = start + seconds;
+	mStatistics.workSeconds += seconds;
+	mStatistics.criticalPathSeconds = std::max(mStatistics.criticalPathSeconds, node.pathSeconds);
+	mUnfinished--;
+
+	std::vector<AssetHandle> dependents = std::move(node.dependents);
+	for (AssetHandle dependent : dependents)
+	{
+		Node* waiting = mNodes.Get(dependent);
+		if (!waiting)
+		{
+			continue;
+		}
+		waiting->dependencyFailed |= !succeeded;
+		if (--waiting->unfinished > 0)
+		{
+			continue;
+		}
+		if (waiting->dependencyFailed)
+		{
+			Finish(dependent, false, 0.0);
+		}
+		else
+		{
+			Enqueue(dependent);
+		}
+	}
+	mProgress.notify_all();
+}
+
+void AssetLoader::Enqueue(AssetHandle handle)
+{
+	if (mNodes.Get(handle)->affinity == AssetAffinity::Caller)
+	{
+		mCallerQueue.push_back(handle);
+		mProgress.notify_all();
+	}
+	else
+	{
+		mWorkerQueue.push_back(handle);
+		mWake.notify_one();
+	}
+}
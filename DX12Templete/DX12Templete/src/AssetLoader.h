@@ -0,0 +1,124 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.h"
+#include "SlotMap.h"
+
+// Loads as a dependency graph: every load names the loads it needs, and runs on a worker as soon as
+// they have all succeeded, so independent work overlaps and start-up takes about as long as the
+// longest chain instead of the sum. Loads are keyed by name; requesting a key again returns the same
+// load with one more reference, and the last Release unloads it. Nothing here touches D3D.
+//
+// Request, Release and Wait belong to one thread, the one that owns the loader. Loads that must run
+// there, e.g. anything recording into the frame's command list, ask for AssetAffinity::Caller and run
+// inside Wait. A load that fails, throws or depends on a failed load fails, and so do its dependents.
+enum class AssetState : uint8_t
+{
+	Pending,
+	Loading,
+	Ready,
+	Failed,
+};
+
+enum class AssetAffinity : uint8_t
+{
+	Worker,
+	Caller,
+};
+
+struct AssetLoadStatistics
+{
+	size_t loads = 0;               // loads that ran
+	size_t deduplicated = 0;        // requests answered by an existing load
+	double workSeconds = 0.0;       // every load's duration added up
+	double criticalPathSeconds = 0.0; // the longest chain of dependent loads
+	double wallSeconds = 0.0;       // first start to last finish
+};
+
+using AssetHandle = SlotHandle;
+
+class AssetLoader
+{
+public:
+	using LoadFunction = std::function<bool()>;
+	using UnloadFunction = std::function<void()>;
+	static constexpr AssetHandle InvalidAsset = { UINT32_MAX, 0 };
+
+	explicit AssetLoader(unsigned workerCount = JobSystem::DefaultWorkerCount());
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// Each request holds a reference to its dependencies until it is released itself.
+	// unload runs on the owning thread, and only for loads that succeeded.
+	AssetHandle Request(const std::string& key, const std::vector<AssetHandle>& dependencies, LoadFunction load,
+		UnloadFunction unload = nullptr, AssetAffinity affinity = AssetAffinity::Worker);
+	void AddRef(AssetHandle handle);
+	// Waits for an unfinished load before unloading it
+	void Release(AssetHandle handle);
+
+	// Runs Caller loads, and helps with Worker ones, until the load is finished; with InvalidAsset,
+	// until every load is. Returns whether it, or every live load, succeeded.
+	bool Wait(AssetHandle handle = InvalidAsset);
+
+	AssetState GetState(AssetHandle handle) const;
+	size_t GetLoadCount() const;
+	unsigned GetWorkerCount() const { return unsigned(mWorkers.size()); }
+
+	// Since the last ResetStatistics
+	AssetLoadStatistics GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Node
+	{
+		std::string key;
+		std::vector<AssetHandle> dependencies;
+		std::vector<AssetHandle> dependents;
+		LoadFunction load;
+		UnloadFunction unload;
+		AssetAffinity affinity = AssetAffinity::Worker;
+		AssetState state = AssetState::Pending;
+		uint32_t references = 1;
+		uint32_t unfinished = 0;      // dependencies still pending or loading
+		bool dependencyFailed = false;
+		double pathSeconds = 0.0;     // longest chain of loads ending with this one
+	};
+
+	void WorkerMain();
+	bool TakeReady(std::deque<AssetHandle>& queue, AssetHandle* handle);
+	// Called and returns with mMutex held
+	void Run(std::unique_lock<std::mutex>& lock, AssetHandle handle);
+	void Finish(AssetHandle handle, bool succeeded, double seconds);
+	void Enqueue(AssetHandle handle);
+	bool IsFinished(AssetState state) const { return state == AssetState::Ready || state == AssetState::Failed; }
+
+	mutable std::mutex mMutex;
+	std::condition_variable mWake;      // workers: work or stop
+	std::condition_variable mProgress;  // owner: a load finished or Caller work arrived
+	std::vector<std::thread> mWorkers;
+	bool mStop = false;
+
+	SlotMap<Node> mNodes;
+	std::unordered_map<std::string, AssetHandle> mKeys;
+	std::deque<AssetHandle> mWorkerQueue;
+	std::deque<AssetHandle> mCallerQueue;
+	size_t mUnfinished = 0;
+
+	AssetLoadStatistics mStatistics;
+	Clock::time_point mFirstStart;
+	Clock::time_point mLastFinish;
+	bool mStarted = false;
+};
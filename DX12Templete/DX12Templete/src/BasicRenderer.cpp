@@ -167,13 +167,10 @@ void BasicRenderer::LoadAssets()
 
 void BasicRenderer::CreateRootSignature()
 {
-	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-	rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-	ComPtr<ID3DBlob> signature;
-	ComPtr<ID3DBlob> error;
-	ThrowIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
-	ThrowIfFailed(mDevice->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mRootSignature)));
+	// Shaders are compiled after the root signature here, so there is nothing to reflect yet
+	RootSignatureBuilder builder;
+	builder.SetFlags(D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	ThrowIfFailed(builder.Build(mDevice.Get(), &mRootSignature));
 }
 
 void BasicRenderer::CreateCommandList()
@@ -308,4 +305,5 @@ void BasicRenderer::Destroy()
 	WaitForGPU();
 
 	CloseHandle(mFenceEvent);
+	RootSignatureCache::Clear(mDevice.Get());
 }
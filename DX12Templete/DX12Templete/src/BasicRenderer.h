@@ -9,6 +9,7 @@
 #include "stddef.h"
 #include "d3dx12.h"
 #include "utility.h"
+#include "RootSignatureBuilder.h"
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "d3dcompiler.lib")
@@ -0,0 +1,850 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+typedef uint8_t Texel[4];
+
+size_t GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+const char* GetBlockFormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC5: return "BC5";
+	case BlockFormat::BC7: return "BC7";
+	}
+	return "unknown";
+}
+
+// Nearest palette entry for every texel over the first channels channels, ties to the lower index.
+// Returns the summed squared error.
+static uint32_t FitScalar(const Texel* texels, uint32_t channels, const Texel* palette, uint32_t paletteSize, uint8_t* indices)
+{
+	uint32_t error = 0;
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		uint32_t best = UINT32_MAX;
+		uint8_t bestIndex = 0;
+		for (uint32_t k = 0; k < paletteSize; k++)
+		{
+			uint32_t distance = 0;
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				int d = int(texels[i][c]) - int(palette[k][c]);
+				distance += uint32_t(d * d);
+			}
+			if (distance < best)
+			{
+				best = distance;
+				bestIndex = uint8_t(k);
+			}
+		}
+		indices[i] = bestIndex;
+		error += best;
+	}
+	return error;
+}
+
+#if BLOCK_SSE2
+
+// Four texels per step. Channel values, differences and their squares are small integers, which
+// floats hold exactly, so this finds exactly what FitScalar finds.
+static uint32_t FitSse2(const Texel* texels, uint32_t channels, const Texel* palette, uint32_t paletteSize, uint8_t* indices)
+{
+	const __m128i byteMask = _mm_set1_epi32(0xff);
+	__m128 values[4][4]; // [group][channel]
+	for (int g = 0; g < 4; g++)
+	{
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + g * 4));
+		values[g][0] = _mm_cvtepi32_ps(_mm_and_si128(packed, byteMask));
+		values[g][1] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 8), byteMask));
+		values[g][2] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 16), byteMask));
+		values[g][3] = _mm_cvtepi32_ps(_mm_srli_epi32(packed, 24));
+	}
+
+	__m128i total = _mm_setzero_si128();
+	for (int g = 0; g < 4; g++)
+	{
+		__m128 best = _mm_set1_ps(1e30f);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (uint32_t k = 0; k < paletteSize; k++)
+		{
+			__m128 distance = _mm_setzero_ps();
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				__m128 d = _mm_sub_ps(values[g][c], _mm_set1_ps(float(palette[k][c])));
+				distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+			}
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(distance, best);
+			bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(int(k))));
+		}
+		alignas(16) int32_t lanes[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+		for (int i = 0; i < 4; i++)
+		{
+			indices[g * 4 + i] = uint8_t(lanes[i]);
+		}
+		total = _mm_add_epi32(total, _mm_cvtps_epi32(best));
+	}
+	alignas(16) int32_t sums[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(sums), total);
+	return uint32_t(sums[0] + sums[1] + sums[2] + sums[3]);
+}
+
+#endif
+
+BlockCompressor::BlockCompressor()
+{
+	SetKernel(Kernel::Auto);
+}
+
+void BlockCompressor::SetKernel(Kernel kernel)
+{
+#if BLOCK_SSE2
+	if (kernel == Kernel::Auto)
+	{
+		kernel = Kernel::Sse2;
+	}
+#else
+	kernel = Kernel::Scalar;
+#endif
+	mKernel = kernel;
+	mFit = FitScalar;
+#if BLOCK_SSE2
+	if (kernel == Kernel::Sse2)
+	{
+		mFit = FitSse2;
+	}
+#endif
+}
+
+const char* BlockCompressor::GetKernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Auto: return "auto";
+	case Kernel::Scalar: return "scalar";
+	case Kernel::Sse2: return "SSE2";
+	}
+	return "unknown";
+}
+
+struct BitWriter
+{
+	uint8_t* data;
+	uint32_t position = 0;
+
+	void Write(uint32_t value, uint32_t bits)
+	{
+		for (uint32_t i = 0; i < bits; i++, position++)
+		{
+			data[position >> 3] |= uint8_t(((value >> i) & 1) << (position & 7));
+		}
+	}
+};
+
+struct BitReader
+{
+	const uint8_t* data;
+	uint32_t position = 0;
+
+	uint32_t Read(uint32_t bits)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < bits; i++, position++)
+		{
+			value |= uint32_t((data[position >> 3] >> (position & 7)) & 1) << i;
+		}
+		return value;
+	}
+};
+
+static inline float Clamp255(float value)
+{
+	return std::min(std::max(value, 0.0f), 255.0f);
+}
+
+// Mean and principal axis of the texels over the first channels channels. The covariance is summed
+// in integers; the axis is zero for a block of one colour.
+static void FitLine(const Texel* texels, uint32_t channels, float mean[4], float axis[4])
+{
+	int64_t sum[4] = {};
+	int64_t products[4][4] = {};
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		for (uint32_t a = 0; a < channels; a++)
+		{
+			sum[a] += texels[i][a];
+			for (uint32_t b = a; b < channels; b++)
+			{
+				products[a][b] += int64_t(texels[i][a]) * texels[i][b];
+			}
+		}
+	}
+	float covariance[4][4] = {};
+	for (uint32_t a = 0; a < channels; a++)
+	{
+		mean[a] = float(sum[a]) / BlockTexels;
+		for (uint32_t b = a; b < channels; b++)
+		{
+			covariance[a][b] = covariance[b][a] = float(int64_t(BlockTexels) * products[a][b] - sum[a] * sum[b]) / (BlockTexels * BlockTexels);
+		}
+	}
+
+	// Power iteration from the channel that varies most
+	uint32_t start = 0;
+	for (uint32_t c = 1; c < channels; c++)
+	{
+		if (covariance[c][c] > covariance[start][start])
+		{
+			start = c;
+		}
+	}
+	float vector[4] = {};
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		vector[c] = covariance[start][c];
+	}
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {};
+		float length = 0.0f;
+		for (uint32_t a = 0; a < channels; a++)
+		{
+			for (uint32_t b = 0; b < channels; b++)
+			{
+				next[a] += covariance[a][b] * vector[b];
+			}
+			length = std::max(length, std::fabs(next[a]));
+		}
+		if (length == 0.0f)
+		{
+			break;
+		}
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			vector[c] = next[c] / length;
+		}
+	}
+	float length = 0.0f;
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		length += vector[c] * vector[c];
+	}
+	length = std::sqrt(length);
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		axis[c] = (c < channels && length > 0.0f) ? vector[c] / length : 0.0f;
+	}
+}
+
+// The extremes of the texels projected onto the principal axis
+static void FitEndpoints(const Texel* texels, uint32_t channels, float first[4], float second[4])
+{
+	float mean[4] = {};
+	float axis[4] = {};
+	FitLine(texels, channels, mean, axis);
+	float low = 0.0f;
+	float high = 0.0f;
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		float t = 0.0f;
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			t += (texels[i][c] - mean[c]) * axis[c];
+		}
+		low = std::min(low, t);
+		high = std::max(high, t);
+	}
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		first[c] = Clamp255(mean[c] + low * axis[c]);
+		second[c] = Clamp255(mean[c] + high * axis[c]);
+	}
+}
+
+// Least-squares endpoints for texels that sit at weights[i] between them; false when every texel has
+// the same weight
+static bool SolveEndpoints(const Texel* texels, uint32_t channels, const float* weights, float first[4], float second[4])
+{
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float ax[4] = {};
+	float bx[4] = {};
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		float t = weights[i];
+		float s = 1.0f - t;
+		aa += s * s;
+		ab += s * t;
+		bb += t * t;
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			ax[c] += s * texels[i][c];
+			bx[c] += t * texels[i][c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+	{
+		return false;
+	}
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		first[c] = Clamp255((ax[c] * bb - bx[c] * ab) / determinant);
+		second[c] = Clamp255((bx[c] * aa - ax[c] * ab) / determinant);
+	}
+	return true;
+}
+
+// BC1 colour endpoints
+
+static uint16_t To565(const float color[4])
+{
+	uint32_t r = uint32_t(std::lround(color[0] * 31.0f / 255.0f));
+	uint32_t g = uint32_t(std::lround(color[1] * 63.0f / 255.0f));
+	uint32_t b = uint32_t(std::lround(color[2] * 31.0f / 255.0f));
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+static void Expand565(uint16_t packed, Texel out)
+{
+	uint32_t r = (packed >> 11) & 31;
+	uint32_t g = (packed >> 5) & 63;
+	uint32_t b = packed & 31;
+	out[0] = uint8_t((r << 3) | (r >> 2));
+	out[1] = uint8_t((g << 2) | (g >> 4));
+	out[2] = uint8_t((b << 3) | (b >> 2));
+	out[3] = 255;
+}
+
+// Palette of two endpoints as the decoder builds it: four colours, or three and transparent black
+static void ColorPalette(uint16_t first, uint16_t second, bool threeColor, Texel palette[4])
+{
+	Expand565(first, palette[0]);
+	Expand565(second, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		if (threeColor)
+		{
+			palette[2][c] = uint8_t((palette[0][c] + palette[1][c] + 1) / 2);
+			palette[3][c] = 0;
+		}
+		else
+		{
+			palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = threeColor ? 0 : 255;
+}
+
+struct ColorCandidate
+{
+	uint16_t first;
+	uint16_t second;
+	uint8_t indices[BlockTexels];
+	uint32_t error;
+};
+
+static void EvaluateColor(const Texel* texels, bool threeColor, BlockCompressor::FitFunction fit, ColorCandidate& candidate)
+{
+	Texel palette[4];
+	ColorPalette(candidate.first, candidate.second, threeColor, palette);
+	candidate.error = fit(texels, 3, palette, threeColor ? 3 : 4, candidate.indices);
+}
+
+// texels are the opaque texels, repeated to fill 16 when some are transparent (threeColor). Writes
+// the endpoints and 2-bit indices of the first 16 texels in order; the caller places transparent ones.
+static ColorCandidate FitColorBlock(const Texel* texels, bool threeColor, BlockCompressor::FitFunction fit)
+{
+	static const float FourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	static const float ThreeColorWeights[3] = { 0.0f, 1.0f, 0.5f };
+
+	float first[4];
+	float second[4];
+	FitEndpoints(texels, 3, first, second);
+	ColorCandidate best;
+	best.first = To565(second);
+	best.second = To565(first);
+	EvaluateColor(texels, threeColor, fit, best);
+
+	// Two rounds of least squares on the indices of the best fit so far
+	for (int iteration = 0; iteration < 2 && best.error > 0; iteration++)
+	{
+		float weights[BlockTexels];
+		for (size_t i = 0; i < BlockTexels; i++)
+		{
+			weights[i] = threeColor ? ThreeColorWeights[best.indices[i]] : FourColorWeights[best.indices[i]];
+		}
+		if (!SolveEndpoints(texels, 3, weights, first, second))
+		{
+			break;
+		}
+		ColorCandidate refined;
+		refined.first = To565(first);
+		refined.second = To565(second);
+		EvaluateColor(texels, threeColor, fit, refined);
+		if (refined.error >= best.error)
+		{
+			break;
+		}
+		best = refined;
+	}
+	return best;
+}
+
+static void WriteColorBlock(const ColorCandidate& candidate, bool threeColor, const bool* transparent, uint8_t* out)
+{
+	// The endpoint order selects the mode: first > second for four colours, first <= second for three
+	uint16_t first = candidate.first;
+	uint16_t second = candidate.second;
+	uint8_t remap[4] = { 0, 1, 2, 3 };
+	if (threeColor ? first > second : first < second)
+	{
+		std::swap(first, second);
+		remap[0] = 1;
+		remap[1] = 0;
+		if (!threeColor)
+		{
+			remap[2] = 3;
+			remap[3] = 2;
+		}
+	}
+	else if (!threeColor && first == second)
+	{
+		// Equal endpoints decode in three-colour mode, where every opaque entry is that colour
+		remap[1] = remap[2] = remap[3] = 0;
+	}
+
+	uint32_t bits = 0;
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		uint32_t index = (transparent && transparent[i]) ? 3 : remap[candidate.indices[i]];
+		bits |= index << (2 * i);
+	}
+	memcpy(out, &first, 2);
+	memcpy(out + 2, &second, 2);
+	memcpy(out + 4, &bits, 4);
+}
+
+static void EncodeBC1(const Texel* texels, bool punchThrough, BlockCompressor::FitFunction fit, uint8_t* out)
+{
+	bool transparent[BlockTexels] = {};
+	Texel opaque[BlockTexels];
+	size_t opaqueCount = 0;
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		transparent[i] = punchThrough && texels[i][3] < 128;
+		if (!transparent[i])
+		{
+			memcpy(opaque[opaqueCount++], texels[i], sizeof(Texel));
+		}
+	}
+	if (opaqueCount == 0)
+	{
+		// Both endpoints zero is three-colour mode; index 3 is transparent black
+		memset(out, 0, 4);
+		memset(out + 4, 0xff, 4);
+		return;
+	}
+	if (opaqueCount == BlockTexels)
+	{
+		WriteColorBlock(FitColorBlock(texels, false, fit), false, nullptr, out);
+		return;
+	}
+
+	for (size_t i = opaqueCount; i < BlockTexels; i++)
+	{
+		memcpy(opaque[i], opaque[i % opaqueCount], sizeof(Texel));
+	}
+	ColorCandidate candidate = FitColorBlock(opaque, true, fit);
+	// Back to block order; transparent texels are written as index 3 regardless
+	ColorCandidate placed = candidate;
+	for (size_t i = 0, next = 0; i < BlockTexels; i++)
+	{
+		placed.indices[i] = transparent[i] ? 0 : candidate.indices[next++];
+	}
+	WriteColorBlock(placed, true, transparent, out);
+}
+
+// BC4: one channel, two 8-bit endpoints and 3-bit indices
+
+static void SingleChannelPalette(uint8_t first, uint8_t second, Texel palette[8])
+{
+	memset(palette, 0, sizeof(Texel) * 8);
+	palette[0][0] = first;
+	palette[1][0] = second;
+	if (first > second)
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1][0] = uint8_t(((7 - i) * first + i * second + 3) / 7);
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1][0] = uint8_t(((5 - i) * first + i * second + 2) / 5);
+		}
+		palette[6][0] = 0;
+		palette[7][0] = 255;
+	}
+}
+
+static void EncodeSingleChannel(const uint8_t* values, size_t stride, BlockCompressor::FitFunction fit, uint8_t* out)
+{
+	Texel texels[BlockTexels] = {};
+	uint8_t low = 255;
+	uint8_t high = 0;
+	uint8_t innerLow = 255;
+	uint8_t innerHigh = 0;
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		uint8_t value = values[i * stride];
+		texels[i][0] = value;
+		low = std::min(low, value);
+		high = std::max(high, value);
+		if (value != 0 && value != 255)
+		{
+			innerLow = std::min(innerLow, value);
+			innerHigh = std::max(innerHigh, value);
+		}
+	}
+
+	Texel palette[8];
+	uint8_t indices[BlockTexels] = {};
+	uint8_t first = high;
+	uint8_t second = low;
+	uint32_t error = 0;
+	if (low != high)
+	{
+		// Eight steps between the extremes
+		SingleChannelPalette(first, second, palette);
+		error = fit(texels, 1, palette, 8, indices);
+	}
+
+	// Six steps between the inner values, with exact 0 and 255 on the side
+	if (error > 0 && (low == 0 || high == 255) && innerLow <= innerHigh)
+	{
+		uint8_t sixIndices[BlockTexels];
+		SingleChannelPalette(innerLow, innerHigh, palette);
+		uint32_t sixError = fit(texels, 1, palette, 8, sixIndices);
+		if (sixError < error)
+		{
+			first = innerLow;
+			second = innerHigh;
+			memcpy(indices, sixIndices, sizeof(indices));
+		}
+	}
+
+	out[0] = first;
+	out[1] = second;
+	uint64_t bits = 0;
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		bits |= uint64_t(indices[i]) << (3 * i);
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		out[2 + i] = uint8_t(bits >> (8 * i));
+	}
+}
+
+// BC7 mode 6
+
+static const uint8_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Endpoint
+{
+	uint8_t value[4]; // 7 bits per channel
+	uint8_t pbit;
+};
+
+// The 7-bit value and p-bit whose 8-bit expansion lies closest to color
+static Bc7Endpoint QuantizeBc7(const float color[4])
+{
+	Bc7Endpoint best = {};
+	float bestError = 1e30f;
+	for (uint8_t pbit = 0; pbit < 2; pbit++)
+	{
+		Bc7Endpoint candidate;
+		candidate.pbit = pbit;
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			long value = std::lround((color[c] - pbit) * 0.5f);
+			candidate.value[c] = uint8_t(std::min(std::max(value, 0L), 127L));
+			float d = float(candidate.value[c] * 2 + pbit) - color[c];
+			error += d * d;
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+static void Bc7Palette(const Bc7Endpoint& first, const Bc7Endpoint& second, Texel palette[16])
+{
+	for (int k = 0; k < 16; k++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			uint32_t a = first.value[c] * 2u + first.pbit;
+			uint32_t b = second.value[c] * 2u + second.pbit;
+			palette[k][c] = uint8_t(((64 - Bc7Weights4[k]) * a + Bc7Weights4[k] * b + 32) >> 6);
+		}
+	}
+}
+
+static void EncodeBC7(const Texel* texels, BlockCompressor::FitFunction fit, uint8_t* out)
+{
+	float firstColor[4];
+	float secondColor[4];
+	FitEndpoints(texels, 4, firstColor, secondColor);
+
+	Bc7Endpoint first = QuantizeBc7(firstColor);
+	Bc7Endpoint second = QuantizeBc7(secondColor);
+	Texel palette[16];
+	uint8_t indices[BlockTexels];
+	Bc7Palette(first, second, palette);
+	uint32_t error = fit(texels, 4, palette, 16, indices);
+
+	for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+	{
+		float weights[BlockTexels];
+		for (size_t i = 0; i < BlockTexels; i++)
+		{
+			weights[i] = Bc7Weights4[indices[i]] / 64.0f;
+		}
+		if (!SolveEndpoints(texels, 4, weights, firstColor, secondColor))
+		{
+			break;
+		}
+		Bc7Endpoint refinedFirst = QuantizeBc7(firstColor);
+		Bc7Endpoint refinedSecond = QuantizeBc7(secondColor);
+		uint8_t refinedIndices[BlockTexels];
+		Bc7Palette(refinedFirst, refinedSecond, palette);
+		uint32_t refinedError = fit(texels, 4, palette, 16, refinedIndices);
+		if (refinedError >= error)
+		{
+			break;
+		}
+		first = refinedFirst;
+		second = refinedSecond;
+		error = refinedError;
+		memcpy(indices, refinedIndices, sizeof(indices));
+	}
+
+	// The first texel's index drops its top bit, so it must be below 8. The weights are symmetric,
+	// so swapping the endpoints and mirroring the indices decodes to the same colours.
+	if (indices[0] >= 8)
+	{
+		std::swap(first, second);
+		for (uint8_t& index : indices)
+		{
+			index = uint8_t(15 - index);
+		}
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		writer.Write(first.value[c], 7);
+		writer.Write(second.value[c], 7);
+	}
+	writer.Write(first.pbit, 1);
+	writer.Write(second.pbit, 1);
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		writer.Write(indices[i], i == 0 ? 3 : 4);
+	}
+}
+
+void BlockCompressor::EncodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* out) const
+{
+	const Texel* block = reinterpret_cast<const Texel*>(texels);
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		EncodeBC1(block, true, mFit, out);
+		break;
+	case BlockFormat::BC3:
+		EncodeSingleChannel(texels + 3, 4, mFit, out);
+		EncodeBC1(block, false, mFit, out + 8);
+		break;
+	case BlockFormat::BC5:
+		EncodeSingleChannel(texels, 4, mFit, out);
+		EncodeSingleChannel(texels + 1, 4, mFit, out + 8);
+		break;
+	case BlockFormat::BC7:
+		EncodeBC7(block, mFit, out);
+		break;
+	}
+}
+
+void BlockCompressor::CompressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch,
+	uint8_t* out, JobSystem* jobs) const
+{
+	uint32_t blocksWide = GetBlockCount(width);
+	uint32_t blocksHigh = GetBlockCount(height);
+	size_t blockBytes = GetBlockBytes(format);
+
+	auto compress = [&](size_t begin, size_t end)
+	{
+		Texel texels[BlockTexels];
+		for (size_t by = begin; by < end; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksWide; bx++)
+			{
+				for (uint32_t y = 0; y < 4; y++)
+				{
+					const uint8_t* row = rgba + std::min<size_t>(by * 4 + y, height - 1) * pitch;
+					for (uint32_t x = 0; x < 4; x++)
+					{
+						memcpy(texels[y * 4 + x], row + std::min<size_t>(bx * 4 + x, width - 1) * 4, sizeof(Texel));
+					}
+				}
+				EncodeBlock(format, &texels[0][0], out + (by * blocksWide + bx) * blockBytes);
+			}
+		}
+	};
+	if (jobs)
+	{
+		jobs->ParallelFor(blocksHigh, RowsPerJob, compress);
+	}
+	else
+	{
+		compress(0, blocksHigh);
+	}
+}
+
+static void DecodeColorBlock(const uint8_t* block, bool alwaysFourColor, Texel* texels)
+{
+	uint16_t first;
+	uint16_t second;
+	uint32_t bits;
+	memcpy(&first, block, 2);
+	memcpy(&second, block + 2, 2);
+	memcpy(&bits, block + 4, 4);
+	Texel palette[4];
+	ColorPalette(first, second, !alwaysFourColor && first <= second, palette);
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		memcpy(texels[i], palette[(bits >> (2 * i)) & 3], sizeof(Texel));
+	}
+}
+
+static void DecodeSingleChannel(const uint8_t* block, uint8_t* values, size_t stride)
+{
+	Texel palette[8];
+	SingleChannelPalette(block[0], block[1], palette);
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		bits |= uint64_t(block[2 + i]) << (8 * i);
+	}
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		values[i * stride] = palette[(bits >> (3 * i)) & 7][0];
+	}
+}
+
+static bool DecodeBC7(const uint8_t* block, Texel* texels)
+{
+	BitReader reader{ block };
+	if (reader.Read(7) != (1 << 6))
+	{
+		return false;
+	}
+	Bc7Endpoint first;
+	Bc7Endpoint second;
+	for (int c = 0; c < 4; c++)
+	{
+		first.value[c] = uint8_t(reader.Read(7));
+		second.value[c] = uint8_t(reader.Read(7));
+	}
+	first.pbit = uint8_t(reader.Read(1));
+	second.pbit = uint8_t(reader.Read(1));
+	Texel palette[16];
+	Bc7Palette(first, second, palette);
+	for (size_t i = 0; i < BlockTexels; i++)
+	{
+		memcpy(texels[i], palette[reader.Read(i == 0 ? 3 : 4)], sizeof(Texel));
+	}
+	return true;
+}
+
+bool DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* texels)
+{
+	Texel* out = reinterpret_cast<Texel*>(texels);
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		DecodeColorBlock(block, false, out);
+		return true;
+	case BlockFormat::BC3:
+		DecodeColorBlock(block + 8, true, out);
+		DecodeSingleChannel(block, texels + 3, 4);
+		return true;
+	case BlockFormat::BC5:
+		DecodeSingleChannel(block, texels, 4);
+		DecodeSingleChannel(block + 8, texels + 1, 4);
+		for (size_t i = 0; i < BlockTexels; i++)
+		{
+			out[i][2] = 0;
+			out[i][3] = 255;
+		}
+		return true;
+	case BlockFormat::BC7:
+		return DecodeBC7(block, out);
+	}
+	return false;
+}
+
+bool DecompressImage(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba, size_t pitch)
+{
+	uint32_t blocksWide = GetBlockCount(width);
+	uint32_t blocksHigh = GetBlockCount(height);
+	size_t blockBytes = GetBlockBytes(format);
+	Texel texels[BlockTexels];
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			if (!DecodeBlock(format, blocks + (size_t(by) * blocksWide + bx) * blockBytes, &texels[0][0]))
+			{
+				return false;
+			}
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				uint8_t* row = rgba + size_t(by * 4 + y) * pitch;
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					memcpy(row + size_t(bx * 4 + x) * 4, texels[y * 4 + x], sizeof(Texel));
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "JobSystem.h"
+
+// Block-compressed texture formats: every 4x4 texel block is stored in a fixed number of bytes the
+// GPU samples directly, so textures stay a quarter (BC3, BC5, BC7) or an eighth (BC1) of their RGBA8
+// size in memory and bandwidth. Nothing here touches D3D or the file system.
+enum class BlockFormat
+{
+	BC1, // RGB with one bit of alpha, 8 bytes
+	BC3, // RGB plus a separate alpha channel, 16 bytes
+	BC5, // two independent channels (red, green), e.g. normal map XY, 16 bytes
+	BC7, // RGBA at higher quality, 16 bytes
+};
+
+static constexpr size_t BlockTexels = 16;
+
+size_t GetBlockBytes(BlockFormat format);
+const char* GetBlockFormatName(BlockFormat format);
+
+// Blocks needed to cover a width or height; partial blocks at the edge count as whole
+static inline uint32_t GetBlockCount(uint32_t texels)
+{
+	return texels == 0 ? 0 : (texels + 3) / 4;
+}
+
+// Encodes 4x4 RGBA8 blocks. Endpoints come from the principal axis of the block's colours and are
+// refined by least squares; every texel then takes the nearest palette entry. BC7 uses mode 6 only
+// (one subset, RGBA endpoints with per-endpoint p-bits and 4-bit indices), which has no partition
+// search to pay for and handles alpha and gradients well.
+//
+// The palette search is the hot loop and runs 4 texels per SSE2 instruction where available. Every
+// kernel computes on exact integer values, so they all write the same bytes.
+class BlockCompressor
+{
+public:
+	enum class Kernel
+	{
+		Auto,
+		Scalar,
+		Sse2,
+	};
+
+	// Rows of blocks per job in CompressImage
+	static constexpr size_t RowsPerJob = 4;
+
+	BlockCompressor();
+
+	// Forcing a kernel the CPU lacks falls back to the best supported one
+	void SetKernel(Kernel kernel);
+	Kernel GetKernel() const { return mKernel; }
+	static const char* GetKernelName(Kernel kernel);
+
+	// texels: 16 RGBA8 texels in rows; out receives GetBlockBytes(format) bytes. BC5 encodes red and green.
+	void EncodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* out) const;
+
+	// Compresses a width x height RGBA8 image with rows pitch bytes apart into rows of blocks, block
+	// rows tightly packed. Edge blocks repeat the last row and column. Splits rows across jobs when given.
+	void CompressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch,
+		uint8_t* out, JobSystem* jobs = nullptr) const;
+
+	typedef uint32_t(*FitFunction)(const uint8_t (*texels)[4], uint32_t channels, const uint8_t (*palette)[4],
+		uint32_t paletteSize, uint8_t* indices);
+
+private:
+	Kernel mKernel;
+	FitFunction mFit;
+};
+
+// Decodes one block into 16 RGBA8 texels. BC5 decodes to (red, green, 0, 255). The BC7 decoder only
+// handles mode 6, which is all BlockCompressor writes; other modes return false.
+bool DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* texels);
+
+// The inverse of CompressImage; false when a block does not decode
+bool DecompressImage(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba, size_t pitch);
@@ -0,0 +1,22 @@
+#include "Camera.h"
+
+Camera::Camera()
+{
+	SetLookAt(
+		XMVectorSet(0.0f, 0.0f, -2.0f, 0.0f), // Eye Position
+		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f),  // Focus Position
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)   // Eye Up
+	);
+	SetPerspective(XMConvertToRadians(45.0f), 1.0f, 0.1f, 100.0f);
+}
+
+void Camera::SetLookAt(FXMVECTOR eye, FXMVECTOR at, FXMVECTOR up)
+{
+	mEye = eye;
+	mViewMatrix = XMMatrixLookAtLH(eye, at, up);
+}
+
+void Camera::SetPerspective(float fovY, float aspect, float nearZ, float farZ)
+{
+	mProjMatrix = XMMatrixPerspectiveFovLH(fovY, aspect, nearZ, farZ);
+}
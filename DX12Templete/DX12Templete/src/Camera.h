@@ -0,0 +1,23 @@
+#pragma once
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+class Camera
+{
+public:
+	Camera();
+
+	void SetLookAt(FXMVECTOR eye, FXMVECTOR at, FXMVECTOR up);
+	void SetPerspective(float fovY, float aspect, float nearZ, float farZ);
+
+	const XMMATRIX& GetView() const { return mViewMatrix; }
+	const XMMATRIX& GetProj() const { return mProjMatrix; }
+	XMMATRIX GetViewProj() const { return XMMatrixMultiply(mViewMatrix, mProjMatrix); }
+	XMVECTOR GetPosition() const { return mEye; }
+
+private:
+	XMVECTOR mEye;
+	XMMATRIX mViewMatrix;
+	XMMATRIX mProjMatrix;
+};
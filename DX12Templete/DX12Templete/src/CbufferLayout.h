@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+// Compile-time check that a C++ mirror of an HLSL cbuffer puts every member where the HLSL packing
+// rules do: members pack into 16-byte registers in declaration order, a scalar or vector never
+// straddles two registers, and matrices, arrays and structures always start a new one.
+//
+//   static_assert(MatchesCbufferPacking({ CBUFFER_MEMBER(Foo, a), CBUFFER_MEMBER(Foo, b) }, sizeof(Foo)), "...");
+//
+// List the members the HLSL declares, in its order; C++-only padding is left out.
+
+// Placement of the HLSL type a C++ member type mirrors. Scalars and arrays of up to 16 bytes mirror
+// scalars and vectors; longer arrays mirror matrices or arrays; other classes mirror structures and
+// need a specialization when they mirror a vector (see ShaderConstants.h for the DirectXMath ones).
+template <typename T>
+struct CbufferPacking
+{
+	static constexpr bool startsRegister = !(std::is_arithmetic<T>::value || (std::is_array<T>::value && sizeof(T) <= 16));
+};
+
+struct CbufferMember
+{
+	size_t offset;
+	size_t size;
+	bool startsRegister;
+};
+
+#define CBUFFER_MEMBER(Struct, member) \
+	CbufferMember{ offsetof(Struct, member), sizeof(Struct::member), CbufferPacking<std::remove_cv_t<decltype(Struct::member)>>::startsRegister }
+
+template <size_t N>
+constexpr bool MatchesCbufferPacking(const CbufferMember (&members)[N], size_t structSize)
+{
+	size_t end = 0;
+	for (size_t i = 0; i < N; i++)
+	{
+		size_t expected = end;
+		bool straddles = expected / 16 != (expected + members[i].size - 1) / 16;
+		if (members[i].startsRegister || straddles)
+		{
+			expected = (expected + 15) & ~size_t(15);
+		}
+		// Each element of an HLSL array takes a whole register, so a C++ array only matches when its
+		// elements fill theirs
+		if (members[i].offset != expected || (members[i].startsRegister && members[i].size % 16 != 0))
+		{
+			return false;
+		}
+		end = expected + members[i].size;
+	}
+	return end <= structSize;
+}
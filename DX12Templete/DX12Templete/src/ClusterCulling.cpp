@@ -0,0 +1,113 @@
+#include "ClusterCulling.h"
+#include "MeshletBuilder.h"
+#include "SoftwareOcclusion.h"
+#include <algorithm>
+#include <cmath>
+
+static void TransformPoint(const float world[16], const float p[3], float out[3])
+{
+	for (int c = 0; c < 3; c++)
+	{
+		out[c] = p[0] * world[c] + p[1] * world[4 + c] + p[2] * world[8 + c] + world[12 + c];
+	}
+}
+
+size_t CullMeshlets(const MeshletMesh& mesh, size_t first, size_t count, const float world[16], const ClusterView& view,
+	uint32_t* visible, ClusterCullStats* stats)
+{
+	// Row lengths of the upper 3x3 are the scales along each local axis
+	float scale[3];
+	for (int r = 0; r < 3; r++)
+	{
+		scale[r] = std::sqrt(world[r * 4] * world[r * 4] + world[r * 4 + 1] * world[r * 4 + 1] + world[r * 4 + 2] * world[r * 4 + 2]);
+	}
+	float maxScale = std::max(scale[0], std::max(scale[1], scale[2]));
+	float minScale = std::min(scale[0], std::min(scale[1], scale[2]));
+	float determinant =
+		world[0] * (world[5] * world[10] - world[6] * world[9]) -
+		world[1] * (world[4] * world[10] - world[6] * world[8]) +
+		world[2] * (world[4] * world[9] - world[5] * world[8]);
+	bool coneUsable = view.backfaceCulling && determinant > 0.0f && maxScale - minScale <= maxScale * 1e-3f;
+
+	size_t kept = 0;
+	for (size_t i = first; i < first + count; i++)
+	{
+		const MeshletBounds& bounds = mesh.bounds[i];
+		float center[3];
+		TransformPoint(world, bounds.center, center);
+		float radius = bounds.radius * maxScale;
+
+		bool inside = true;
+		for (const auto& plane : view.frustum.planes)
+		{
+			if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] < -radius)
+			{
+				inside = false;
+				break;
+			}
+		}
+		if (!inside)
+		{
+			if (stats)
+			{
+				stats->frustum++;
+			}
+			continue;
+		}
+
+		if (coneUsable && bounds.coneCutoff < 1.0f)
+		{
+			float apex[3];
+			TransformPoint(world, bounds.coneApex, apex);
+			float axis[3];
+			for (int c = 0; c < 3; c++)
+			{
+				axis[c] = (bounds.coneAxis[0] * world[c] + bounds.coneAxis[1] * world[4 + c] + bounds.coneAxis[2] * world[8 + c]) / maxScale;
+			}
+			float toApex[3] = { apex[0] - view.eye[0], apex[1] - view.eye[1], apex[2] - view.eye[2] };
+			float distance = std::sqrt(toApex[0] * toApex[0] + toApex[1] * toApex[1] + toApex[2] * toApex[2]);
+			if (toApex[0] * axis[0] + toApex[1] * axis[1] + toApex[2] * axis[2] > bounds.coneCutoff * distance)
+			{
+				if (stats)
+				{
+					stats->backface++;
+				}
+				continue;
+			}
+		}
+
+		if (view.occlusion)
+		{
+			const float extents[3] = { radius, radius, radius };
+			if (view.occlusion->IsOccluded(center, extents))
+			{
+				if (stats)
+				{
+					stats->occluded++;
+				}
+				continue;
+			}
+		}
+
+		visible[kept++] = uint32_t(i);
+	}
+	return kept;
+}
+
+size_t CompactMeshletIndices(const MeshletMesh& mesh, const uint32_t* meshlets, size_t count, uint32_t* indices)
+{
+	size_t written = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Meshlet& meshlet = mesh.meshlets[meshlets[i]];
+		const uint32_t* vertices = &mesh.vertices[meshlet.vertexOffset];
+		const uint32_t* triangles = &mesh.triangles[meshlet.triangleOffset];
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			indices[written++] = vertices[MeshletCorner(triangles[t], 0)];
+			indices[written++] = vertices[MeshletCorner(triangles[t], 1)];
+			indices[written++] = vertices[MeshletCorner(triangles[t], 2)];
+		}
+	}
+	return written;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "FrustumCuller.h"
+#include <cstddef>
+#include <cstdint>
+
+struct MeshletMesh;
+class SoftwareOcclusion;
+
+// Meshlet visibility for one instance of a mesh. The visible list feeds either path: a mesh shader
+// runs one group per entry, and GPUs without mesh shaders draw the triangles CompactMeshletIndices
+// gathers from the same entries.
+struct ClusterView
+{
+	Frustum frustum;                              // world space
+	float eye[3];
+	bool backfaceCulling = false;                 // only valid when the pipeline culls back faces
+	const SoftwareOcclusion* occlusion = nullptr; // rasterized for this frame, or none
+};
+
+struct ClusterCullStats
+{
+	size_t frustum = 0;
+	size_t backface = 0;
+	size_t occluded = 0;
+};
+
+// world is row-major for row vectors (DirectXMath layout). Spheres grow with the largest axis scale;
+// the cone test is skipped under non-uniform scale or mirroring, which would bend the normals.
+// Tests meshlets first to first + count - 1, e.g. one LOD level, and writes the indices of the
+// survivors in ascending order. Returns their count.
+size_t CullMeshlets(const MeshletMesh& mesh, size_t first, size_t count, const float world[16], const ClusterView& view,
+	uint32_t* visible, ClusterCullStats* stats = nullptr);
+
+// Triangles of the listed meshlets as indices into the source vertex buffer. Returns the index count,
+// at most three per triangle of the listed meshlets.
+size_t CompactMeshletIndices(const MeshletMesh& mesh, const uint32_t* meshlets, size_t count, uint32_t* indices);
@@ -0,0 +1,162 @@
+#include "CompressedStream.h"
+#include "Lz4.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+using namespace CompressedStreamFormat;
+
+void CompressStream(const void* data, size_t size, std::vector<uint8_t>& stream, uint32_t chunkSize, JobSystem* jobs)
+{
+	chunkSize = chunkSize == 0 ? DefaultChunkSize : (chunkSize > MaxChunkSize ? MaxChunkSize : chunkSize);
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+
+	std::vector<std::vector<uint8_t>> compressed(chunkCount);
+	std::vector<Chunk> chunks(chunkCount);
+	auto compress = [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			size_t rawSize = std::min<size_t>(chunkSize, size - i * chunkSize);
+			compressed[i].resize(Lz4CompressBound(rawSize));
+			size_t compressedSize = Lz4Compress(bytes + i * chunkSize, rawSize, compressed[i].data(), compressed[i].size());
+			if (compressedSize == 0 || compressedSize >= rawSize)
+			{
+				compressed[i].assign(bytes + i * chunkSize, bytes + i * chunkSize + rawSize);
+				chunks[i].flags = StoredChunk;
+			}
+			else
+			{
+				compressed[i].resize(compressedSize);
+				chunks[i].flags = 0;
+			}
+			chunks[i].size = static_cast<uint32_t>(compressed[i].size());
+		}
+	};
+	if (jobs)
+	{
+		jobs->ParallelFor(chunkCount, 1, compress);
+	}
+	else
+	{
+		compress(0, chunkCount);
+	}
+
+	Header header = {};
+	header.magic = Magic;
+	header.version = Version;
+	header.chunkSize = chunkSize;
+	header.chunkCount = static_cast<uint32_t>(chunkCount);
+	header.rawSize = size;
+
+	uint64_t offset = sizeof(Header) + sizeof(Chunk) * chunkCount;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		chunks[i].offset = offset;
+		offset += chunks[i].size;
+	}
+	stream.assign(offset, 0);
+	memcpy(stream.data(), &header, sizeof(header));
+	if (chunkCount > 0)
+	{
+		memcpy(stream.data() + sizeof(Header), chunks.data(), sizeof(Chunk) * chunkCount);
+	}
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		memcpy(stream.data() + chunks[i].offset, compressed[i].data(), compressed[i].size());
+	}
+}
+
+bool ReadCompressedStream(const void* stream, size_t size, uint64_t* rawSize)
+{
+	if (size < sizeof(Header))
+	{
+		return false;
+	}
+	Header header;
+	memcpy(&header, stream, sizeof(header));
+	if (header.magic != Magic || header.version != Version || header.chunkSize == 0 || header.chunkSize > MaxChunkSize)
+	{
+		return false;
+	}
+	if (header.chunkCount != (header.rawSize + header.chunkSize - 1) / header.chunkSize ||
+		header.chunkCount > (size - sizeof(Header)) / sizeof(Chunk))
+	{
+		return false;
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(stream);
+	const uint64_t dataBegin = sizeof(Header) + uint64_t(sizeof(Chunk)) * header.chunkCount;
+	for (uint32_t i = 0; i < header.chunkCount; i++)
+	{
+		Chunk chunk;
+		memcpy(&chunk, bytes + sizeof(Header) + sizeof(Chunk) * i, sizeof(chunk));
+		uint64_t chunkRawSize = std::min<uint64_t>(header.chunkSize, header.rawSize - uint64_t(i) * header.chunkSize);
+		if (chunk.offset < dataBegin || chunk.offset > size || chunk.size > size - chunk.offset || (chunk.flags & ~uint32_t(StoredChunk)) != 0)
+		{
+			return false;
+		}
+		if ((chunk.flags & StoredChunk) ? chunk.size != chunkRawSize : chunk.size == 0)
+		{
+			return false;
+		}
+	}
+	*rawSize = header.rawSize;
+	return true;
+}
+
+bool DecompressStream(const void* stream, size_t size, void* destination, size_t destinationSize, JobSystem* jobs, bool writeCombined)
+{
+	uint64_t rawSize;
+	if (!ReadCompressedStream(stream, size, &rawSize) || rawSize != destinationSize)
+	{
+		return false;
+	}
+	Header header;
+	memcpy(&header, stream, sizeof(header));
+	const uint8_t* bytes = static_cast<const uint8_t*>(stream);
+	uint8_t* out = static_cast<uint8_t*>(destination);
+
+	std::atomic<bool> failed{ false };
+	auto decompress = [&](size_t begin, size_t end)
+	{
+		// Sized once per thread; chunks are small enough to stay in cache between decode and copy
+		thread_local std::vector<uint8_t> scratch;
+		for (size_t i = begin; i < end && !failed.load(std::memory_order_relaxed); i++)
+		{
+			Chunk chunk;
+			memcpy(&chunk, bytes + sizeof(Header) + sizeof(Chunk) * i, sizeof(chunk));
+			size_t chunkRawSize = static_cast<size_t>(std::min<uint64_t>(header.chunkSize, rawSize - uint64_t(i) * header.chunkSize));
+			uint8_t* target = out + i * size_t(header.chunkSize);
+			if (chunk.flags & StoredChunk)
+			{
+				memcpy(target, bytes + chunk.offset, chunkRawSize);
+				continue;
+			}
+			if (writeCombined)
+			{
+				scratch.resize(header.chunkSize);
+				if (!Lz4Decompress(bytes + chunk.offset, chunk.size, scratch.data(), chunkRawSize))
+				{
+					failed = true;
+					continue;
+				}
+				memcpy(target, scratch.data(), chunkRawSize);
+			}
+			else if (!Lz4Decompress(bytes + chunk.offset, chunk.size, target, chunkRawSize))
+			{
+				failed = true;
+			}
+		}
+	};
+	if (jobs)
+	{
+		jobs->ParallelFor(header.chunkCount, 1, decompress);
+	}
+	else
+	{
+		decompress(0, header.chunkCount);
+	}
+	return !failed;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "JobSystem.h"
+
+// On-disk layout of a compressed stream: the data cut into chunkSize pieces that are compressed on
+// their own, so they decompress in parallel and each lands straight at its place in the output.
+//
+//   Header
+//   Chunk[chunkCount]
+//   chunk data   in chunk order, each an LZ4 block or, when that would not be smaller, the raw bytes
+namespace CompressedStreamFormat
+{
+	static constexpr uint32_t Magic = 0x43345a4c; // "LZ4C"
+	static constexpr uint32_t Version = 1;
+	static constexpr uint32_t DefaultChunkSize = 64 * 1024;
+	static constexpr uint32_t MaxChunkSize = 4 * 1024 * 1024;
+
+	enum ChunkFlags : uint32_t
+	{
+		StoredChunk = 1,
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t chunkSize;  // every chunk but the last decompresses to this many bytes
+		uint32_t chunkCount;
+		uint64_t rawSize;
+	};
+
+	struct Chunk
+	{
+		uint64_t offset;  // from the start of the stream
+		uint32_t size;
+		uint32_t flags;
+	};
+
+	static_assert(sizeof(Header) == 24, "CompressedStreamFormat::Header layout changed");
+	static_assert(sizeof(Chunk) == 16, "CompressedStreamFormat::Chunk layout changed");
+}
+
+// Compresses on jobs when given one. The same data always gives the same stream.
+void CompressStream(const void* data, size_t size, std::vector<uint8_t>& stream,
+	uint32_t chunkSize = CompressedStreamFormat::DefaultChunkSize, JobSystem* jobs = nullptr);
+
+// Checks the header and the chunk table against size; rawSize receives the decompressed size
+bool ReadCompressedStream(const void* stream, size_t size, uint64_t* rawSize);
+
+// Decompresses into destinationSize bytes, which must be the stream's raw size, one chunk per job.
+// Fails without touching destination when the table is damaged, and partway through when a chunk is.
+// LZ4 reads back what it wrote, which is slow on write-combined memory such as a mapped upload heap;
+// with writeCombined each chunk decodes into a cached per-thread buffer and is copied out once.
+bool DecompressStream(const void* stream, size_t size, void* destination, size_t destinationSize,
+	JobSystem* jobs = nullptr, bool writeCombined = false);
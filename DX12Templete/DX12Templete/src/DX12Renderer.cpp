@@ -2,26 +2,514 @@
 #include "DX12Renderer.h"
 #include "utility.h"
 #include "dxcapi.use.h"
+#include <algorithm>
 
 ID3D12Device5Ptr DX12Renderer::mDevice = nullptr;
 ID3D12GraphicsCommandList4Ptr DX12Renderer::mCmdList = nullptr;
 
+static const uint32_t kQuadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+// Trilinear and repeating; baked into both graphics root signatures
+static const CD3DX12_STATIC_SAMPLER_DESC kSquareSampler(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR);
+
+// d3dx12.h predates mesh shaders, so their pipeline stream is spelled out: each subobject is its
+// type followed by its data, aligned to a pointer
+template <D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type, typename T>
+struct alignas(void*) PipelineSubobject
+{
+	D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = Type;
+	T value;
+};
+
+struct MeshPipelineStream
+{
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, ID3D12RootSignature*> rootSignature;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS, D3D12_SHADER_BYTECODE> ms;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, D3D12_SHADER_BYTECODE> ps;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, D3D12_RASTERIZER_DESC> rasterizer;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND, D3D12_BLEND_DESC> blend;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL, D3D12_DEPTH_STENCIL_DESC> depthStencil;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS, D3D12_RT_FORMAT_ARRAY> renderTargets;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC, DXGI_SAMPLE_DESC> sampleDesc;
+	PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK, UINT> sampleMask;
+};
+
 DX12Renderer::~DX12Renderer() {
-	if (mVertexShader.binaryPtr) {
-		free(mVertexShader.binaryPtr);
-	}
-	if (mPixelShader.binaryPtr) {
-		free(mPixelShader.binaryPtr);
-	}
 	Destroy();
 }
 
 void DX12Renderer::Update()
 {
-	for (int i = 0; i < mSquareList.size(); i++)
+	for (Square& square : mSquares)
+	{
+		square.update();
+	}
+	UpdateTextureStreaming();
+	UpdateConstants();
+	UpdateBounds();
+	CullObjects();
+}
+
+void DX12Renderer::UpdateBounds()
+{
+	// Only transforms rebuilt this frame can have moved
+	for (uint32_t index : mUpdatedTransforms)
+	{
+		const Square* square = index < mTransformOwners.size() ? mSquares.Get(mTransformOwners[index]) : nullptr;
+		if (!square)
+		{
+			continue;
+		}
+
+		const XMMATRIX& world = square->GetWorldMatrix();
+		XMVECTOR extents = XMLoadFloat3(&square->GetLocalExtents());
+
+		// The local box is centred on the origin, so the world box is centred on the translation
+		// with extents |M| * e taken row by row
+		XMVECTOR worldExtents = XMVectorMultiply(XMVectorAbs(world.r[0]), XMVectorSplatX(extents));
+		worldExtents = XMVectorMultiplyAdd(XMVectorAbs(world.r[1]), XMVectorSplatY(extents), worldExtents);
+		worldExtents = XMVectorMultiplyAdd(XMVectorAbs(world.r[2]), XMVectorSplatZ(extents), worldExtents);
+
+		if (index >= mWorldBounds.size())
+		{
+			mWorldBounds.resize(index + 1);
+		}
+		WorldBounds& bounds = mWorldBounds[index];
+		XMStoreFloat3(&bounds.center, world.r[3]);
+		XMStoreFloat3(&bounds.extents, worldExtents);
+		mOctree.Update(index, &bounds.center.x, XMVectorGetX(XMVector3Length(worldExtents)));
+	}
+	mUpdatedTransforms.clear();
+}
+
+void DX12Renderer::CullObjects()
+{
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, mCamera.GetViewProj());
+	Frustum frustum = Frustum::FromViewProj(&viewProj.m[0][0]);
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, mCamera.GetPosition());
+
+	if (mGpuCulling)
+	{
+		// The compute pass tests every object; the CPU only rasterizes the occluders nearest the camera
+		mCandidates.clear();
+		mOctree.QuerySphere(&eye.x, OccluderRadius, mCandidates);
+		auto distanceSq = [&](uint32_t transform)
+		{
+			const XMFLOAT3& center = mWorldBounds[transform].center;
+			return (center.x - eye.x) * (center.x - eye.x) + (center.y - eye.y) * (center.y - eye.y) + (center.z - eye.z) * (center.z - eye.z);
+		};
+		size_t occluders = std::min(mCandidates.size(), MaxOccluders);
+		std::nth_element(mCandidates.begin(), mCandidates.begin() + occluders, mCandidates.end(),
+			[&](uint32_t a, uint32_t b) { return distanceSq(a) < distanceSq(b); });
+
+		mOcclusion.Begin(&viewProj.m[0][0]);
+		for (size_t i = 0; i < occluders; i++)
+		{
+			AddOccluder(mCandidates[i]);
+		}
+		mOcclusion.Rasterize(&mJobs);
+		UpdateCullingInputs();
+		return;
+	}
+
+	mCandidates.clear();
+	mOctree.QueryFrustum(frustum, mCandidates);
+
+	mCullingBounds.Resize(mCandidates.size());
+	for (size_t i = 0; i < mCandidates.size(); i++)
 	{
-		mSquareList[i]->update();
+		const WorldBounds& bounds = mWorldBounds[mCandidates[i]];
+		mCullingBounds.Set(i, &bounds.center.x, &bounds.extents.x);
 	}
+	mCuller.Cull(frustum, mCullingBounds, &mJobs, mVisibleObjects);
+
+	// Occluders first, then test the rest against them
+	auto distanceSq = [&](uint32_t i)
+	{
+		float dx = mCullingBounds.CenterX()[i] - eye.x;
+		float dy = mCullingBounds.CenterY()[i] - eye.y;
+		float dz = mCullingBounds.CenterZ()[i] - eye.z;
+		return dx * dx + dy * dy + dz * dz;
+	};
+	size_t occluders = std::min(mVisibleObjects.size(), MaxOccluders);
+	std::nth_element(mVisibleObjects.begin(), mVisibleObjects.begin() + occluders, mVisibleObjects.end(),
+		[&](uint32_t a, uint32_t b) { return distanceSq(a) < distanceSq(b); });
+
+	mOcclusion.Begin(&viewProj.m[0][0]);
+	for (size_t i = 0; i < occluders; i++)
+	{
+		AddOccluder(mCandidates[mVisibleObjects[i]]);
+	}
+	mOcclusion.Rasterize(&mJobs);
+	size_t kept = mOcclusion.CullOccluded(mCullingBounds, mVisibleObjects.data() + occluders, mVisibleObjects.size() - occluders, &mJobs);
+	mVisibleObjects.resize(occluders + kept);
+
+	// Candidate positions back to transform indices
+	for (uint32_t& index : mVisibleObjects)
+	{
+		index = mCandidates[index];
+	}
+
+	CullClusters(frustum, eye);
+}
+
+void DX12Renderer::CullClusters(const Frustum& frustum, const XMFLOAT3& eye)
+{
+	ClusterView view;
+	view.frustum = frustum;
+	memcpy(view.eye, &eye, sizeof(view.eye));
+	view.backfaceCulling = false; // CreatePipelineObject draws both sides
+	view.occlusion = &mOcclusion;
+
+	// Pixels covered by one unit at distance one
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, mCamera.GetProj());
+	float projectionScale = proj._22 * mHeight * 0.5f;
+
+	mClusterDraws.clear();
+	mClusterData.clear();
+	for (uint32_t object : mVisibleObjects)
+	{
+		const Square& square = *mSquares.Get(mTransformOwners[object]);
+		const MeshletMesh& mesh = square.GetMeshlets();
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, square.GetWorldMatrix());
+
+		// Coarsest level whose error stays under MaxLodPixelError from the nearest point of the bounds
+		const WorldBounds& bounds = mWorldBounds[object];
+		XMVECTOR center = XMLoadFloat3(&bounds.center);
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&eye))))
+			- XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.extents)));
+		const XMMATRIX& worldMatrix = square.GetWorldMatrix();
+		XMVECTOR scale = XMVectorMax(XMVector3Length(worldMatrix.r[0]), XMVectorMax(XMVector3Length(worldMatrix.r[1]), XMVector3Length(worldMatrix.r[2])));
+		float worldScale = XMVectorGetX(scale);
+		const std::vector<MeshLod>& lods = square.GetLods();
+		size_t level = SelectLod(lods.data(), lods.size(), worldScale, std::max(distance, 0.0f), projectionScale, MaxLodPixelError);
+
+		size_t levelMeshlets = square.GetLodMeshletCount(level);
+		mVisibleMeshlets.resize(levelMeshlets);
+		size_t count = CullMeshlets(mesh, square.GetLodMeshletOffset(level), levelMeshlets, &world.m[0][0], view, mVisibleMeshlets.data());
+		if (count == 0)
+		{
+			continue;
+		}
+
+		ClusterDraw draw = { object, UINT32(mClusterData.size()), 0, UINT32(level) };
+		if (mMeshShaders)
+		{
+			mClusterData.insert(mClusterData.end(), mVisibleMeshlets.begin(), mVisibleMeshlets.begin() + count);
+			draw.count = UINT32(count);
+		}
+		else if (count == levelMeshlets)
+		{
+			draw.offset = OwnIndices;
+			draw.count = lods[level].indexCount;
+		}
+		else
+		{
+			mClusterData.resize(draw.offset + mesh.GetTriangleCount() * 3);
+			draw.count = UINT32(CompactMeshletIndices(mesh, mVisibleMeshlets.data(), count, &mClusterData[draw.offset]));
+			mClusterData.resize(draw.offset + draw.count);
+		}
+		mClusterDraws.push_back(draw);
+	}
+
+	UINT64 size = mClusterData.size() * sizeof(uint32_t);
+	if (size > mClusterUploadFrameSize)
+	{
+		// The GPU is idle here, as for the constant buffer
+		ThrowIfFailed(CreateClusterBuffer(std::max(size, mClusterUploadFrameSize * 2)));
+	}
+	if (size > 0)
+	{
+		memcpy(mClusterUploadData + mFrameIndex * mClusterUploadFrameSize, mClusterData.data(), size);
+	}
+}
+
+void DX12Renderer::DrawClusters(D3D12_GPU_VIRTUAL_ADDRESS objectAddress)
+{
+	D3D12_GPU_VIRTUAL_ADDRESS clusterAddress = mClusterUploadBuffer ?
+		mClusterUploadBuffer->GetGPUVirtualAddress() + mFrameIndex * mClusterUploadFrameSize : 0;
+
+	if (!mMeshShaders)
+	{
+		// Whole levels first from the geometry buffer PopulateCommandList bound, then the culled ones
+		// from this frame's compacted indices, so the index buffer changes at most once
+		bool compacted = false;
+		for (const ClusterDraw& draw : mClusterDraws)
+		{
+			if (draw.offset != OwnIndices)
+			{
+				compacted = true;
+				continue;
+			}
+			Square& square = *mSquares.Get(mTransformOwners[draw.object]);
+			BindConstants(mObjectConstantsSlot, objectAddress + draw.object * ObjectConstantsStride, mObjectConstants.empty() ? nullptr : &mObjectConstants[draw.object]);
+			square.draw(draw.count, square.GetLods()[draw.lod].indexOffset, GetBaseVertexLocation(square));
+		}
+		if (!compacted)
+		{
+			return;
+		}
+
+		// Compacted indices still count from the square's first vertex
+		D3D12_INDEX_BUFFER_VIEW indexBuffer = {};
+		indexBuffer.BufferLocation = clusterAddress;
+		indexBuffer.SizeInBytes = UINT(mClusterData.size() * sizeof(uint32_t));
+		indexBuffer.Format = DXGI_FORMAT_R32_UINT;
+		mCmdList->IASetIndexBuffer(&indexBuffer);
+		for (const ClusterDraw& draw : mClusterDraws)
+		{
+			if (draw.offset == OwnIndices)
+			{
+				continue;
+			}
+			const Square& square = *mSquares.Get(mTransformOwners[draw.object]);
+			BindConstants(mObjectConstantsSlot, objectAddress + draw.object * ObjectConstantsStride, mObjectConstants.empty() ? nullptr : &mObjectConstants[draw.object]);
+			mCmdList->DrawIndexedInstanced(draw.count, 1, draw.offset, GetBaseVertexLocation(square), 0);
+		}
+		return;
+	}
+
+	mCmdList->SetGraphicsRootSignature(mMeshRootSignature);
+	mCmdList->SetPipelineState(mMeshPipelineState);
+	// Same heap and offset as PopulateCommandList's table, checked by CreateMeshletPipeline
+	const RootSignatureLayout::Slot* texture = mMeshRootLayout.Find("squareTexture");
+	if (texture && mTextureDescriptorHeap)
+	{
+		mCmdList->SetGraphicsRootDescriptorTable(texture->rootIndex, mTextureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	}
+	UINT objectConstants = mMeshRootLayout.Find("ObjectConstants")->rootIndex;
+	UINT vertices = mMeshRootLayout.Find("meshVertices")->rootIndex;
+	UINT meshlets = mMeshRootLayout.Find("meshlets")->rootIndex;
+	UINT meshletVertices = mMeshRootLayout.Find("meshletVertices")->rootIndex;
+	UINT meshletTriangles = mMeshRootLayout.Find("meshletTriangles")->rootIndex;
+	UINT visibleMeshlets = mMeshRootLayout.Find("visibleMeshlets")->rootIndex;
+	// Meshlet vertex indices are offset by the base vertex in ObjectConstants
+	mCmdList->SetGraphicsRootShaderResourceView(vertices, mGeometry.GetVertexBufferView().BufferLocation);
+	for (const ClusterDraw& draw : mClusterDraws)
+	{
+		Square& square = *mSquares.Get(mTransformOwners[draw.object]);
+		mCmdList->SetGraphicsRootConstantBufferView(objectConstants, objectAddress + draw.object * ObjectConstantsStride);
+		mCmdList->SetGraphicsRootShaderResourceView(meshlets, square.GetMeshletAddress());
+		mCmdList->SetGraphicsRootShaderResourceView(meshletVertices, square.GetMeshletVertexAddress());
+		mCmdList->SetGraphicsRootShaderResourceView(meshletTriangles, square.GetMeshletTriangleAddress());
+		mCmdList->SetGraphicsRootShaderResourceView(visibleMeshlets, clusterAddress + draw.offset * sizeof(uint32_t));
+		mMeshCmdList->DispatchMesh(draw.count, 1, 1);
+	}
+}
+
+void DX12Renderer::AddOccluder(uint32_t transform)
+{
+	const Square* square = mSquares.Get(mTransformOwners[transform]);
+	const XMFLOAT3& extents = square->GetLocalExtents();
+	// A flat mesh fills the z = 0 face of its local box, as the square does. Anything with depth would
+	// need occluder geometry of its own, so it is only ever occluded.
+	if (extents.z != 0.0f)
+	{
+		return;
+	}
+	const float quad[12] =
+	{
+		-extents.x, -extents.y, 0.0f,
+		extents.x, -extents.y, 0.0f,
+		extents.x, extents.y, 0.0f,
+		-extents.x, extents.y, 0.0f,
+	};
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, square->GetWorldMatrix());
+	mOcclusion.AddOccluder(quad, 4, kQuadIndices, 6, &world.m[0][0]);
+}
+
+void DX12Renderer::UpdateCullingInputs()
+{
+	size_t hizSize = 0;
+	for (size_t level = 0; level < mOcclusion.GetHierarchyLevelCount(); level++)
+	{
+		int width;
+		int height;
+		mOcclusion.GetHierarchyLevel(level, width, height);
+		hizSize += size_t(width) * height;
+	}
+	if (mSquares.Size() > mCullInstanceCapacity || hizSize > mHiZCapacity)
+	{
+		// Same as the constant buffer: the GPU is idle here
+		ThrowIfFailed(CreateCullingBuffers(std::max(mSquares.Size(), mCullInstanceCapacity * 2)));
+	}
+
+	mCullInstances.resize(mSquares.Size());
+	for (size_t i = 0; i < mSquares.Size(); i++)
+	{
+		Square& square = mSquares[i];
+		UINT32 transform = square.GetTransform().index;
+		const WorldBounds& bounds = mWorldBounds[transform];
+		const GeometryRange& geometry = square.GetGeometry();
+
+		CullInstance& instance = mCullInstances[i];
+		memcpy(instance.center, &bounds.center, sizeof(instance.center));
+		memcpy(instance.extents, &bounds.extents, sizeof(instance.extents));
+		instance.objectIndex = transform;
+		instance.indexCount = square.GetIndexCount();
+		instance.startIndex = geometry.startIndex;
+		instance.baseVertex = GetBaseVertexLocation(square);
+		instance.pad[0] = 0;
+		instance.pad[1] = 0;
+	}
+	mCullInstanceCount = UINT(mCullInstances.size());
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, mCamera.GetViewProj());
+	D3D12_GPU_VIRTUAL_ADDRESS objectAddress = mConstantBuffer->GetGPUVirtualAddress() + mFrameIndex * mConstantBufferFrameSize +
+		AlignConstantBufferSize(sizeof(FrameConstants));
+	CullConstants constants;
+	StoreCullConstants(&viewProj.m[0][0], Frustum::FromViewProj(&viewProj.m[0][0]), mOcclusion,
+		objectAddress, UINT32(ObjectConstantsStride), mCullInstanceCount, &constants, mHiZ);
+
+	UINT8* frameData = mCullUploadData + mFrameIndex * mCullUploadFrameSize;
+	memcpy(frameData, &constants, sizeof(constants));
+	memset(frameData + sizeof(constants), 0, sizeof(UINT32));
+	UINT8* instanceData = frameData + AlignConstantBufferSize(sizeof(CullConstants));
+	memcpy(instanceData, mCullInstances.data(), mCullInstances.size() * sizeof(CullInstance));
+	memcpy(instanceData + mCullInstanceCapacity * sizeof(CullInstance), mHiZ.data(), mHiZ.size() * sizeof(float));
+}
+
+void DX12Renderer::RecordCulling()
+{
+	D3D12_GPU_VIRTUAL_ADDRESS frameAddress = mCullUploadBuffer->GetGPUVirtualAddress() + mFrameIndex * mCullUploadFrameSize;
+	D3D12_GPU_VIRTUAL_ADDRESS instanceAddress = frameAddress + AlignConstantBufferSize(sizeof(CullConstants));
+	D3D12_GPU_VIRTUAL_ADDRESS hizAddress = instanceAddress + mCullInstanceCapacity * sizeof(CullInstance);
+
+	// Reset the count from the zero stored after the constants
+	D3D12_RESOURCE_BARRIER toWrite[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndirectCount, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndirectCommands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+	};
+	mCmdList->ResourceBarrier(_countof(toWrite), toWrite);
+	mCmdList->CopyBufferRegion(mIndirectCount, 0, mCullUploadBuffer, mFrameIndex * mCullUploadFrameSize + sizeof(CullConstants), sizeof(UINT32));
+	D3D12_RESOURCE_BARRIER toUnordered = CD3DX12_RESOURCE_BARRIER::Transition(mIndirectCount, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	mCmdList->ResourceBarrier(1, &toUnordered);
+
+	ID3D12DescriptorHeap* heaps[] = { mCullDescriptorHeap.GetInterfacePtr() };
+	mCmdList->SetDescriptorHeaps(_countof(heaps), heaps);
+	mCmdList->SetComputeRootSignature(mCullRootSignature);
+	mCmdList->SetPipelineState(mCullPipelineState);
+	mCmdList->SetComputeRootConstantBufferView(mCullRootLayout.Find("CullConstants")->rootIndex, frameAddress);
+	mCmdList->SetComputeRootShaderResourceView(mCullRootLayout.Find("instances")->rootIndex, instanceAddress);
+	mCmdList->SetComputeRootShaderResourceView(mCullRootLayout.Find("hiz")->rootIndex, hizAddress);
+	mCmdList->SetComputeRootDescriptorTable(mCullRootLayout.Find("commands")->rootIndex, mCullDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	mCmdList->Dispatch((mCullInstanceCount + CullThreadGroupSize - 1) / CullThreadGroupSize, 1, 1);
+
+	D3D12_RESOURCE_BARRIER toIndirect[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndirectCount, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndirectCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+	};
+	mCmdList->ResourceBarrier(_countof(toIndirect), toIndirect);
+}
+
+SlotHandle DX12Renderer::SpawnSquare(TransformHandle parent)
+{
+	SlotHandle handle = mSquares.Create(&mTransforms, &mGeometry, parent);
+	Square* square = mSquares.Get(handle);
+	HRESULT hr = square->Initialize(mSquareMesh);
+	if (FAILED(hr))
+	{
+		// Nothing has seen it yet, so it can go at once
+		mSquares.Destroy(handle);
+		ThrowIfFailed(hr);
+	}
+
+	UINT32 transform = square->GetTransform().index;
+	if (transform >= mTransformOwners.size())
+	{
+		mTransformOwners.resize(transform + 1, SlotMap<Square>::InvalidHandle);
+	}
+	mTransformOwners[transform] = handle;
+	if (transform >= mObjectGeometry.size())
+	{
+		mObjectGeometry.resize(transform + 1);
+	}
+	mObjectGeometry[transform].decode = square->GetQuantization();
+	mObjectGeometry[transform].baseVertex = square->GetGeometry().baseVertex;
+	return handle;
+}
+
+void DX12Renderer::DespawnSquare(SlotHandle handle)
+{
+	Square* square = mSquares.Get(handle);
+	if (!square)
+	{
+		return;
+	}
+	TransformHandle transform = square->GetTransform();
+	GeometryRange geometry = square->GetGeometry();
+
+	// Children follow their parent, so they go with it; they sit after it in the store
+	for (UINT32 child = transform.index + 1; mTransforms.GetChildCount(transform) > 0 && child < mTransformOwners.size(); child++)
+	{
+		if (mTransforms.GetParent({ child }).index == transform.index)
+		{
+			DespawnSquare(mTransformOwners[child]);
+		}
+	}
+
+	// Only frames already submitted can reference it; the frame being built will not
+	mOctree.Remove(transform.index);
+	mTransformOwners[transform.index] = SlotMap<Square>::InvalidHandle;
+	mObjectGeometry[transform.index] = ObjectGeometry();
+	mTransforms.Destroy(transform);
+	mGeometry.RemoveAfter(geometry, mFrameFenceValue);
+	mSquares.DestroyAfter(handle, mFrameFenceValue);
+}
+
+void DX12Renderer::UpdateConstants()
+{
+	if (mTransforms.GetCount() > mConstantBufferCapacity)
+	{
+		// Update runs after Render waited on the frame fence, so the old buffer is idle
+		ThrowIfFailed(CreateConstantBuffer(std::max<size_t>(mTransforms.GetCount(), mConstantBufferCapacity * 2)));
+	}
+
+	UINT8* frameData = mConstantBufferData + mFrameIndex * mConstantBufferFrameSize;
+
+	StoreFrameConstants(mCamera.GetView(), mCamera.GetProj(), mCamera.GetPosition(), &mFrameConstants);
+	memcpy(frameData, &mFrameConstants, sizeof(mFrameConstants));
+
+	// Only transforms changed since last frame (and their children) are rebuilt; the world array feeds the WVP batch directly
+	mTransforms.UpdateWorldMatrices(&mUpdatedTransforms);
+
+	XMMATRIX viewProj = mCamera.GetViewProj();
+	mObjectGeometry.resize(mTransforms.GetCount());
+	if (mObjectConstantsSlot && mObjectConstantsSlot->kind == RootSignatureLayout::Kind::Constants)
+	{
+		mObjectConstants.resize(mTransforms.GetCount());
+		StoreObjectConstants(viewProj, mTransforms.GetWorldMatrices(), mObjectGeometry.data(), mTransforms.GetCount(), mObjectConstants.data(), sizeof(ObjectConstants));
+	}
+	else
+	{
+		StoreObjectConstants(viewProj, mTransforms.GetWorldMatrices(), mObjectGeometry.data(), mTransforms.GetCount(), frameData + AlignConstantBufferSize(sizeof(FrameConstants)), ObjectConstantsStride);
+	}
+}
+
+void DX12Renderer::BindConstants(const RootSignatureLayout::Slot* slot, D3D12_GPU_VIRTUAL_ADDRESS address, const void* data)
+{
+	if (!slot)
+	{
+		// Not referenced by any shader
+		return;
+	}
+	if (slot->kind == RootSignatureLayout::Kind::Constants)
+	{
+		mCmdList->SetGraphicsRoot32BitConstants(slot->rootIndex, slot->num32BitValues, data, 0);
+	}
+	else if (slot->kind == RootSignatureLayout::Kind::Descriptor)
+	{
+		mCmdList->SetGraphicsRootConstantBufferView(slot->rootIndex, address);
+	}
+	// Constant buffers only fall back to tables when the root signature is over budget, which two CBVs never are
 }
 
 void DX12Renderer::WaitForCommandQueue()
@@ -43,6 +531,7 @@ void DX12Renderer::Destroy()
 {
 	WaitForCommandQueue();
 	CloseHandle(mFenceEvent);
+	RootSignatureCache::Clear(mDevice);
 }
 
 // Render
@@ -55,6 +544,13 @@ void DX12Renderer::Render()
 	mCmdQueue->ExecuteCommandLists(1, &pCommandList);
 
 	WaitForCommandQueue();
+	mSquares.ReleaseRetired(mFrameFence->GetCompletedValue());
+	mGeometry.ReleaseRetired(mFrameFence->GetCompletedValue());
+	// The texture's mips have been copied by now, at the latest by this first frame
+	mTextureUpload = nullptr;
+	UINT64 completed = mFrameFence->GetCompletedValue();
+	mRetiredTextureMemory.erase(std::remove_if(mRetiredTextureMemory.begin(), mRetiredTextureMemory.end(),
+		[completed](const RetiredTextureMemory& memory) { return memory.fenceValue <= completed; }), mRetiredTextureMemory.end());
 
 	mCmdAllocator->Reset();
 	mCmdList->Reset(mCmdAllocator, mPipelineState);
@@ -68,6 +564,14 @@ void DX12Renderer::PopulateCommandList()
 {
 	float clearColor[4] = { 0.2f, 0.5f, 0.7f, 0.0f };
 
+	// Squares spawned since the last frame; WaitForCommandQueue signals mFrameFenceValue + 1 after this list
+	mGeometry.RecordUploads(mCmdList, mFrameFenceValue + 1);
+
+	if (mGpuCulling)
+	{
+		RecordCulling();
+	}
+
 	SetResourceBarrier(D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 	// _[^[Qbg̃NA.
@@ -76,15 +580,47 @@ void DX12Renderer::PopulateCommandList()
 	mCmdList->SetGraphicsRootSignature(mRootSignature);
 	mCmdList->SetPipelineState(mPipelineState);
 
+	// RecordCulling leaves its own heap bound
+	if (mSquareTextureSlot && mTextureDescriptorHeap)
+	{
+		ID3D12DescriptorHeap* heaps[] = { mTextureDescriptorHeap.GetInterfacePtr() };
+		mCmdList->SetDescriptorHeaps(_countof(heaps), heaps);
+		mCmdList->SetGraphicsRootDescriptorTable(mSquareTextureSlot->rootIndex, mTextureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	}
+
 	D3D12_RECT rect = { 0, 0, mWidth, mHeight };
 	mCmdList->RSSetViewports(1, &mViewPort);
 	mCmdList->RSSetScissorRects(1, &rect);
 
 	mCmdList->OMSetRenderTargets(1, &mRTVHandle[mFrameIndex], TRUE, nullptr);
 
-	for (int i = 0; i < mSquareList.size(); i++)
+	// Camera constants are bound once, each object only switches its b1 address
+	D3D12_GPU_VIRTUAL_ADDRESS frameAddress = mConstantBuffer->GetGPUVirtualAddress() + mFrameIndex * mConstantBufferFrameSize;
+	D3D12_GPU_VIRTUAL_ADDRESS objectAddress = frameAddress + AlignConstantBufferSize(sizeof(FrameConstants));
+	BindConstants(mFrameConstantsSlot, frameAddress, &mFrameConstants);
+
+	// One vertex and index buffer for every square; the views are fetched every frame as growing moves them
+	D3D12_VERTEX_BUFFER_VIEW vertexBuffer = mGeometry.GetVertexBufferView();
+	D3D12_INDEX_BUFFER_VIEW indexBuffer = mGeometry.GetIndexBufferView();
+	mCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	if (mVertexPulling)
 	{
-		mSquareList[i]->draw();
+		mCmdList->SetGraphicsRootShaderResourceView(mGeometryVerticesSlot->rootIndex, vertexBuffer.BufferLocation);
+	}
+	else
+	{
+		mCmdList->IASetVertexBuffers(0, 1, &vertexBuffer);
+	}
+	mCmdList->IASetIndexBuffer(&indexBuffer);
+
+	if (mGpuCulling)
+	{
+		// b1 and the draw ranges come from the command buffer the compute pass wrote
+		mCmdList->ExecuteIndirect(mCommandSignature, mCullInstanceCount, mIndirectCommands, 0, mIndirectCount, 0);
+	}
+	else
+	{
+		DrawClusters(objectAddress);
 	}
 
 	SetResourceBarrier(D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
@@ -135,8 +671,6 @@ void DX12Renderer::LoadPipeline()
 
 	CreateCommandList();
 
-	CreateRootSignature();
-
 	SetViewPort();
 
 	//CreateRayTracingPipelineStateObject();
@@ -271,29 +805,280 @@ HRESULT DX12Renderer::CreateRenderTargetView()
 
 HRESULT DX12Renderer::CreateRootSignature()
 {
-	HRESULT hr;
+	RootSignatureBuilder builder;
+	if (mVertexPulling)
+	{
+		builder.AddShader(ReflectShader(mPullShaderReflection).Get(), D3D12_SHADER_VISIBILITY_VERTEX);
+		// As meshVertices in CreateMeshletPipeline
+		builder.MarkStatic("geometryVertices");
+	}
+	else
+	{
+		builder.SetFlags(D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+		builder.AddShader(ReflectShader(mVertexShaderReflection).Get(), D3D12_SHADER_VISIBILITY_VERTEX);
+	}
+	builder.AddShader(ReflectShader(mPixelShaderReflection).Get(), D3D12_SHADER_VISIBILITY_PIXEL);
+	builder.AddStaticSampler("squareSampler", kSquareSampler);
+	HRESULT hr = builder.Build(mDevice, &mRootSignature, &mRootLayout);
+
+	mFrameConstantsSlot = mRootLayout.Find("FrameConstants");
+	mObjectConstantsSlot = mRootLayout.Find("ObjectConstants");
+	mGeometryVerticesSlot = mRootLayout.Find("geometryVertices");
+	mSquareTextureSlot = mRootLayout.Find("squareTexture");
+
+	// PopulateCommandList binds the geometry buffer as a root SRV; otherwise use the input assembler
+	if (mVertexPulling && (FAILED(hr) || !mGeometryVerticesSlot || mGeometryVerticesSlot->kind != RootSignatureLayout::Kind::Descriptor))
+	{
+		mVertexPulling = FALSE;
+		return CreateRootSignature();
+	}
+	return hr;
+}
+
+HRESULT DX12Renderer::CreateConstantBuffer(size_t objectCapacity)
+{
+	mConstantBufferCapacity = objectCapacity;
+	mConstantBufferFrameSize = AlignConstantBufferSize(sizeof(FrameConstants)) + ObjectConstantsStride * objectCapacity;
+
+	HRESULT hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(mConstantBufferFrameSize * FrameBufferCount),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mConstantBuffer)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Upload heaps may stay mapped for the lifetime of the resource
+	CD3DX12_RANGE range(0, 0);
+	return mConstantBuffer->Map(0, &range, reinterpret_cast<void**>(&mConstantBufferData));
+}
+
+HRESULT DX12Renderer::CreateCullingPipeline()
+{
+	RootSignatureBuilder builder;
+	builder.AddShader(ReflectShader(mCullShaderReflection).Get(), D3D12_SHADER_VISIBILITY_ALL);
+	HRESULT hr = builder.Build(mDevice, &mCullRootSignature, &mCullRootLayout);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	CD3DX12_DESCRIPTOR_RANGE cbv;
-	cbv.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0); // b0 WX^
+	// RecordCulling binds the inputs as root descriptors and both outputs through one table
+	const RootSignatureLayout::Slot* commands = mCullRootLayout.Find("commands");
+	const RootSignatureLayout::Slot* drawCount = mCullRootLayout.Find("drawCount");
+	for (const char* name : { "CullConstants", "instances", "hiz" })
+	{
+		const RootSignatureLayout::Slot* slot = mCullRootLayout.Find(name);
+		if (!slot || slot->kind != RootSignatureLayout::Kind::Descriptor)
+		{
+			return E_FAIL;
+		}
+	}
+	if (!commands || !drawCount || commands->kind != RootSignatureLayout::Kind::Table || drawCount->rootIndex != commands->rootIndex)
+	{
+		return E_FAIL;
+	}
 
-	CD3DX12_ROOT_PARAMETER rootParams;
-	rootParams.InitAsDescriptorTable(1, &cbv, D3D12_SHADER_VISIBILITY_VERTEX);
+	D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+	desc.pRootSignature = mCullRootSignature;
+	desc.CS = mCullShader;
+	hr = mDevice->CreateComputePipelineState(&desc, IID_PPV_ARGS(&mCullPipelineState));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	CD3DX12_ROOT_SIGNATURE_DESC  descmRootSignature{};
-	descmRootSignature.Init(
-		1,
-		&rootParams,
-		0,
+	// Matches IndirectDrawCommand; the vertex and index buffers are the shared ones bound before ExecuteIndirect
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[2] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	arguments[0].ConstantBufferView.RootParameterIndex = mObjectConstantsSlot->rootIndex;
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signature = {};
+	signature.ByteStride = sizeof(IndirectDrawCommand);
+	signature.NumArgumentDescs = _countof(arguments);
+	signature.pArgumentDescs = arguments;
+	return mDevice->CreateCommandSignature(&signature, mRootSignature, IID_PPV_ARGS(&mCommandSignature));
+}
+
+HRESULT DX12Renderer::CreateCullingBuffers(size_t instanceCapacity)
+{
+	size_t hizSize = 0;
+	for (size_t level = 0; level < mOcclusion.GetHierarchyLevelCount(); level++)
+	{
+		int width;
+		int height;
+		mOcclusion.GetHierarchyLevel(level, width, height);
+		hizSize += size_t(width) * height;
+	}
+	mCullInstanceCapacity = std::max<size_t>(instanceCapacity, 1);
+	mHiZCapacity = hizSize;
+	mCullUploadFrameSize = AlignConstantBufferSize(AlignConstantBufferSize(sizeof(CullConstants)) +
+		mCullInstanceCapacity * sizeof(CullInstance) + mHiZCapacity * sizeof(float));
+
+	HRESULT hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(mCullUploadFrameSize * FrameBufferCount),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
-		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
+		IID_PPV_ARGS(&mCullUploadBuffer)
 	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	CD3DX12_RANGE range(0, 0);
+	hr = mCullUploadBuffer->Map(0, &range, reinterpret_cast<void**>(&mCullUploadData));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	descmRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-	ComPtr<ID3DBlob> root_sig_blob, error_blob;
-	hr = D3D12SerializeRootSignature(&descmRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &root_sig_blob, &error_blob);
-	hr = mDevice->CreateRootSignature(0, root_sig_blob->GetBufferPointer(), root_sig_blob->GetBufferSize(), IID_PPV_ARGS(&mRootSignature));
+	// Written by the compute pass and read by ExecuteIndirect; one set is enough as frames never overlap
+	hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(mCullInstanceCapacity * sizeof(IndirectDrawCommand), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		nullptr,
+		IID_PPV_ARGS(&mIndirectCommands)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT32), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		nullptr,
+		IID_PPV_ARGS(&mIndirectCount)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	return hr;
+	if (!mCullDescriptorHeap)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.NumDescriptors = 2;
+		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+		hr = mDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mCullDescriptorHeap));
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+	UINT increment = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	D3D12_CPU_DESCRIPTOR_HANDLE heapStart = mCullDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+
+	D3D12_UNORDERED_ACCESS_VIEW_DESC commandsView = {};
+	commandsView.Format = DXGI_FORMAT_UNKNOWN;
+	commandsView.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+	commandsView.Buffer.NumElements = UINT(mCullInstanceCapacity);
+	commandsView.Buffer.StructureByteStride = sizeof(IndirectDrawCommand);
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = heapStart;
+	handle.ptr += mCullRootLayout.Find("commands")->tableOffset * increment;
+	mDevice->CreateUnorderedAccessView(mIndirectCommands, nullptr, &commandsView, handle);
+
+	D3D12_UNORDERED_ACCESS_VIEW_DESC countView = {};
+	countView.Format = DXGI_FORMAT_R32_TYPELESS;
+	countView.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+	countView.Buffer.NumElements = 1;
+	countView.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+	handle = heapStart;
+	handle.ptr += mCullRootLayout.Find("drawCount")->tableOffset * increment;
+	mDevice->CreateUnorderedAccessView(mIndirectCount, nullptr, &countView, handle);
+	return S_OK;
+}
+
+HRESULT DX12Renderer::CreateMeshletPipeline()
+{
+	D3D12_FEATURE_DATA_D3D12_OPTIONS7 options = {};
+	if (FAILED(mDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &options, sizeof(options))) ||
+		options.MeshShaderTier == D3D12_MESH_SHADER_TIER_NOT_SUPPORTED)
+	{
+		return E_NOTIMPL;
+	}
+	HRESULT hr = mCmdList->QueryInterface(IID_PPV_ARGS(&mMeshCmdList));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	RootSignatureBuilder builder;
+	builder.AddShader(ReflectShader(mMeshShaderReflection).Get(), D3D12_SHADER_VISIBILITY_MESH);
+	builder.AddShader(ReflectShader(mPixelShaderReflection).Get(), D3D12_SHADER_VISIBILITY_PIXEL);
+	builder.MarkStatic("meshVertices").MarkStatic("meshlets").MarkStatic("meshletVertices").MarkStatic("meshletTriangles");
+	builder.AddStaticSampler("squareSampler", kSquareSampler);
+	hr = builder.Build(mDevice, &mMeshRootSignature, &mMeshRootLayout);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// DrawClusters binds everything as root descriptors
+	for (const char* name : { "ObjectConstants", "meshVertices", "meshlets", "meshletVertices", "meshletTriangles", "visibleMeshlets" })
+	{
+		const RootSignatureLayout::Slot* slot = mMeshRootLayout.Find(name);
+		if (!slot || slot->kind != RootSignatureLayout::Kind::Descriptor)
+		{
+			return E_FAIL;
+		}
+	}
+	// The texture table is bound from the heap CreateTexture filled for the other root signature
+	const RootSignatureLayout::Slot* texture = mMeshRootLayout.Find("squareTexture");
+	if (texture && (!mSquareTextureSlot || texture->tableOffset != mSquareTextureSlot->tableOffset))
+	{
+		return E_FAIL;
+	}
+
+	// Same state as CreatePipelineObject
+	MeshPipelineStream stream;
+	stream.rootSignature.value = mMeshRootSignature;
+	stream.ms.value = mMeshShader;
+	stream.ps.value = mPixelShader;
+	stream.rasterizer.value = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	stream.rasterizer.value.CullMode = D3D12_CULL_MODE_NONE;
+	stream.blend.value = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	stream.depthStencil.value = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	stream.depthStencil.value.DepthEnable = FALSE;
+	stream.renderTargets.value = {};
+	stream.renderTargets.value.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	stream.renderTargets.value.NumRenderTargets = 1;
+	stream.sampleDesc.value = { 1, 0 };
+	stream.sampleMask.value = UINT_MAX;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(stream), &stream };
+	return mDevice->CreatePipelineState(&desc, IID_PPV_ARGS(&mMeshPipelineState));
+}
+
+HRESULT DX12Renderer::CreateClusterBuffer(UINT64 frameSize)
+{
+	mClusterUploadFrameSize = AlignConstantBufferSize(frameSize);
+	HRESULT hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(mClusterUploadFrameSize * FrameBufferCount),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mClusterUploadBuffer)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	CD3DX12_RANGE range(0, 0);
+	return mClusterUploadBuffer->Map(0, &range, reinterpret_cast<void**>(&mClusterUploadData));
 }
 
 void DX12Renderer::SetViewPort()
@@ -309,88 +1094,613 @@ void DX12Renderer::SetViewPort()
 // Assets
 BOOL DX12Renderer::LoadAssets() {
 
-	LoadVertexShader();
-	LoadPixelShader();
+	StopTextureStreaming();
+	for (AssetHandle handle : mAssetHandles)
+	{
+		mAssets.Release(handle);
+	}
+	mAssetHandles.clear();
+	mAssets.ResetStatistics();
+	mFiles.ResetStatistics();
+
+	mSquares.Clear();
+	mTransforms.Clear();
+	mOctree.Clear();
+	mTransformOwners.clear();
+	mCamera.SetPerspective(XMConvertToRadians(45.0f), (float)mWidth / (float)mHeight, 0.1f, 100.0f);
+	mOcclusion.SetResolution(OcclusionWidth, OcclusionWidth * mHeight / mWidth);
+
+	// Everything below reads through the file system: loose files next to the executable, shadowed by
+	// Assets.pak once AssetPack has bundled them, and the shader sources the ray tracing library falls
+	// back to, from the project directory the debugger starts in
+	mFiles.UnmountAll();
+	std::string executableDirectory = VirtualFileSystem::GetExecutableDirectory();
+	mFiles.MountDirectory("", executableDirectory);
+	mFiles.MountPack("", executableDirectory + "/Assets.pak");
+	mFiles.MountDirectory("resource", "resource");
+
+	// Each step names what it needs, so shaders, the square mesh and the geometry buffer load side by
+	// side and only the acceleration structures wait for the whole scene. Device calls are free-threaded;
+	// only the command list is not, so the step recording into it runs here.
+	AssetHandle archive = mAssets.Request("Shaders.pak", {}, [this]
+	{
+		// One mapping for every shader; loose .cso files are only a fallback for builds without Shaders.pak
+		mShaderArchive.Open(mFiles, "Shaders.pak");
+		return true;
+	});
+	AssetHandle vertexShader = RequestShader(archive, "VertexShader", &mVertexShader, &mVertexShaderReflection, TRUE);
+	AssetHandle pixelShader = RequestShader(archive, "PixelShader", &mPixelShader, &mPixelShaderReflection, TRUE);
+	// Optional: without it vertices go through the input assembler
+	AssetHandle pullShader = RequestShader(archive, "PullVertices", &mPullShader, &mPullShaderReflection, FALSE);
+	// Optional: without it objects are culled and drawn from the CPU
+	AssetHandle cullShader = RequestShader(archive, "CullInstances", &mCullShader, &mCullShaderReflection, FALSE);
+	// Optional: needs a GPU with mesh shaders too, otherwise meshlets are drawn through compacted index buffers
+	AssetHandle meshShader = RequestShader(archive, "Meshlets", &mMeshShader, &mMeshShaderReflection, FALSE);
+
+	AssetHandle rootSignature = mAssets.Request("RootSignature", { vertexShader, pixelShader, pullShader }, [this]
+	{
+		mVertexPulling = mPullShader.pShaderBytecode != nullptr;
+		return SUCCEEDED(CreateRootSignature());
+	});
+	AssetHandle pipeline = mAssets.Request("PipelineState", { rootSignature }, [this]
+	{
+		return SUCCEEDED(CreatePipelineObject());
+	});
+
+	AssetHandle squareMesh = mAssets.Request("Square.mesh", {}, [this]
+	{
+		LoadSquareMesh();
+		return true;
+	});
+	AssetHandle geometry = mAssets.Request("GeometryBuffer", {}, [this]
+	{
+		return SUCCEEDED(mGeometry.Create(mDevice, sizeof(PackedSquareVertex), InitialGeometryVertices, InitialGeometryIndices));
+	});
+	AssetHandle scene = mAssets.Request("Scene", { squareMesh, geometry }, [this]
+	{
+		SlotHandle centre = SpawnSquare();
+		// The side squares hang off the centre one and follow it when it moves
+		TransformHandle centreTransform = mSquares.Get(centre)->GetTransform();
+		mSquares.Get(SpawnSquare(centreTransform))->SetPositionX(-0.525f);
+		mSquares.Get(SpawnSquare(centreTransform))->SetPositionX(0.525f);
+		return SUCCEEDED(CreateConstantBuffer(mTransforms.GetCount()));
+	});
+
+	AssetHandle culling = mAssets.Request("CullingPipeline", { cullShader, rootSignature, scene }, [this]
+	{
+		mGpuCulling = mCullShader.pShaderBytecode && mObjectConstantsSlot &&
+			mObjectConstantsSlot->kind == RootSignatureLayout::Kind::Descriptor &&
+			SUCCEEDED(CreateCullingPipeline()) && SUCCEEDED(CreateCullingBuffers(mSquares.Size()));
+		return true;
+	});
+	AssetHandle meshlets = mAssets.Request("MeshletPipeline", { meshShader, pixelShader, rootSignature }, [this]
+	{
+		mMeshShaders = mMeshShader.pShaderBytecode && SUCCEEDED(CreateMeshletPipeline());
+		return true;
+	});
+	AssetHandle texture = mAssets.Request("Texture.dds", { rootSignature }, [this]
+	{
+		LoadTexture();
+		return SUCCEEDED(CreateTexture());
+	});
+	// The copies run with the acceleration structure builds, or ahead of the first frame's draws
+	AssetHandle textureUpload = mAssets.Request("TextureUpload", { texture }, [this]
+	{
+		RecordTextureUpload();
+		return true;
+	}, nullptr, AssetAffinity::Caller);
+	// The squares' meshes are staged on a worker; the copies are recorded here, ahead of the acceleration structure builds
+	AssetHandle geometryUpload = mAssets.Request("GeometryUpload", { scene }, [this]
+	{
+		mGeometry.RecordUploads(mCmdList, mFrameFenceValue + 1);
+		return true;
+	}, nullptr, AssetAffinity::Caller);
+	AssetHandle accelerationStructures = mAssets.Request("AccelerationStructures", { geometryUpload, pipeline }, [this]
+	{
+		InitializeAccelarationStructure();
+		return true;
+	}, nullptr, AssetAffinity::Caller);
+
+	mAssetHandles = { archive, vertexShader, pixelShader, pullShader, cullShader, meshShader, rootSignature, pipeline,
+		squareMesh, geometry, scene, culling, meshlets, texture, textureUpload, geometryUpload, accelerationStructures };
+	BOOL loaded = mAssets.Wait();
+
+	AssetLoadStatistics statistics = mAssets.GetStatistics();
+	char message[160];
+	sprintf_s(message, "LoadAssets: %zu loads, %.1f ms of work, critical path %.1f ms, took %.1f ms\n", statistics.loads,
+		statistics.workSeconds * 1e3, statistics.criticalPathSeconds * 1e3, statistics.wallSeconds * 1e3);
+	OutputDebugStringA(message);
+	FileReadStatistics reads = mFiles.GetStatistics();
+	sprintf_s(message, "LoadAssets: %zu files, %.2f MB from %.2f MB stored, %zu decompressed at %.0f MB/s\n", reads.reads,
+		reads.bytes / 1e6, reads.storedBytes / 1e6, reads.decompressedReads, reads.decompressedBytes / 1e6 / std::max(reads.decompressSeconds, 1e-9));
+	OutputDebugStringA(message);
+
+	// A failed step used to throw from LoadAssets; the graph reports it here instead
+	ThrowIfFailed(loaded ? S_OK : E_FAIL);
+	return loaded;
+}
 
-	CreatePipelineObject();
+AssetHandle DX12Renderer::RequestShader(AssetHandle archive, const char* name, D3D12_SHADER_BYTECODE* bytecode, D3D12_SHADER_BYTECODE* reflection, BOOL required)
+{
+	return mAssets.Request(std::string("shader:") + name, { archive }, [this, name, bytecode, reflection, required]
+	{
+		if (LoadShader(name, bytecode, reflection))
+		{
+			return true;
+		}
+		*bytecode = {};
+		return !required;
+	});
+}
 
-	mSquareList.clear();
-	mSquareList.push_back(new Square());
-	mSquareList.push_back(new Square());
-	mSquareList.push_back(new Square());
-	for (int i = 0; i < mSquareList.size(); i++)
+void DX12Renderer::LoadSquareMesh()
+{
+	if (mSquareAsset.Open(mFiles, "Square.mesh"))
 	{
-		mSquareList[i]->Initialize();
+		const MeshView& mesh = mSquareAsset.GetView();
+		if (MatchesVertexElements(mesh, SquareVertexElements, _countof(SquareVertexElements)) && mesh.indexSize == sizeof(uint16_t))
+		{
+			mSquareMesh = mesh;
+			return;
+		}
+		// Converted for another vertex format, or too big for the 16-bit geometry buffer
+		OutputDebugStringA("Square.mesh does not fit the square pipeline; using the built-in square\n");
+		mSquareAsset.Close();
 	}
-	mSquareList[1]->SetPositionX(-0.525f);
-	mSquareList[2]->SetPositionX(0.525f);
+	if (mDefaultSquare.lods.empty())
+	{
+		Square::BuildDefaultMesh(mDefaultSquare);
+	}
+	mSquareMesh = mDefaultSquare.GetView();
+}
 
-	InitializeAccelarationStructure();
-	
-	return TRUE;
+void DX12Renderer::LoadTexture()
+{
+	if (mTextureAsset.Open(mFiles, "Texture.dds"))
+	{
+		mTextureView = mTextureAsset.GetView();
+		return;
+	}
+	if (mDefaultTexture.mips.empty())
+	{
+		// White and light grey squares, faint enough for the vertex colours to show through
+		RgbaImage checker;
+		checker.width = 64;
+		checker.height = 64;
+		checker.pixels.resize(size_t(checker.width) * checker.height * 4);
+		for (uint32_t y = 0; y < checker.height; y++)
+		{
+			for (uint32_t x = 0; x < checker.width; x++)
+			{
+				uint8_t value = ((x / 8 + y / 8) & 1) ? 255 : 200;
+				uint8_t* texel = &checker.pixels[(size_t(y) * checker.width + x) * 4];
+				texel[0] = value;
+				texel[1] = value;
+				texel[2] = value;
+				texel[3] = 255;
+			}
+		}
+		BuildTextureData(checker, BlockFormat::BC1, false, 0, BlockCompressor(), mDefaultTexture);
+	}
+	mTextureView = mDefaultTexture.GetView();
 }
 
-BOOL DX12Renderer::LoadVertexShader()
+HRESULT DX12Renderer::CreateTexture()
 {
-	FILE* fpVS = nullptr;
-	std::wstring path = GetExecutionDirectory();
-	path += std::wstring(L"\\");
-	path += L"VertexShader.cso";
+	const TextureView& view = mTextureView;
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT(view.dxgiFormat), view.width, view.height, 1, UINT16(view.mipCount));
+	HRESULT hr = CreateStreamedTexture(desc);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	if (!mTextureStreaming)
+	{
+		hr = mDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&mTexture)
+		);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
 
-	char input[1024];
-	const wchar_t *inputw = path.c_str();
-	wcstombs(input, inputw, sizeof(wchar_t)*int(path.size()));
+	// The file packs block rows tightly; the copy wants each row at an aligned pitch. A streamed
+	// texture starts out with its tail only.
+	UINT firstMip = mTextureTailMip;
+	UINT uploadMips = view.mipCount - firstMip;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprints[DdsFormat::MaxMipCount];
+	UINT rowCounts[DdsFormat::MaxMipCount];
+	UINT64 uploadSize = 0;
+	mDevice->GetCopyableFootprints(&desc, firstMip, uploadMips, 0, footprints, rowCounts, nullptr, &uploadSize);
+	hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mTextureUpload)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	UINT8* upload = nullptr;
+	CD3DX12_RANGE range(0, 0);
+	hr = mTextureUpload->Map(0, &range, reinterpret_cast<void**>(&upload));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	for (UINT level = 0; level < uploadMips; level++)
+	{
+		const TextureMip& mip = view.mips[firstMip + level];
+		for (UINT row = 0; row < rowCounts[level]; row++)
+		{
+			memcpy(upload + footprints[level].Offset + UINT64(row) * footprints[level].Footprint.RowPitch,
+				mip.data + UINT64(row) * mip.rowPitch, mip.rowPitch);
+		}
+	}
+	mTextureUpload->Unmap(0, nullptr);
+
+	UINT offset = mSquareTextureSlot ? mSquareTextureSlot->tableOffset : 0;
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = offset + 1;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	hr = mDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mTextureDescriptorHeap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	CreateTextureView(mTextureStreaming ? mTextureStreamer.GetResidentMip(mStreamedTexture) : 0);
+	return S_OK;
+}
 
-	fopen_s(&fpVS, input, "rb");
-	if (!fpVS) {
+// The clamp keeps sampling off unmapped mips on every tiled resources tier, where a shader-side clamp
+// would need tier 2
+void DX12Renderer::CreateTextureView(UINT minMip)
+{
+	D3D12_RESOURCE_DESC desc = mTexture->GetDesc();
+	D3D12_SHADER_RESOURCE_VIEW_DESC textureView = {};
+	textureView.Format = desc.Format;
+	textureView.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	textureView.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	textureView.Texture2D.MipLevels = desc.MipLevels;
+	textureView.Texture2D.ResourceMinLODClamp = float(minMip);
+	UINT offset = mSquareTextureSlot ? mSquareTextureSlot->tableOffset : 0;
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = mTextureDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	handle.ptr += offset * mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	mDevice->CreateShaderResourceView(mTexture, &textureView, handle);
+	mTextureClampMip = minMip;
+}
+
+void DX12Renderer::RecordTextureUpload()
+{
+	D3D12_RESOURCE_DESC desc = mTexture->GetDesc();
+	UINT firstMip = mTextureTailMip;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprints[DdsFormat::MaxMipCount];
+	mDevice->GetCopyableFootprints(&desc, firstMip, desc.MipLevels - firstMip, 0, footprints, nullptr, nullptr, nullptr);
+	for (UINT level = 0; level < desc.MipLevels - firstMip; level++)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION destination(mTexture, firstMip + level);
+		CD3DX12_TEXTURE_COPY_LOCATION source(mTextureUpload, footprints[level]);
+		mCmdList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+	}
+	D3D12_RESOURCE_BARRIER toShader = CD3DX12_RESOURCE_BARRIER::Transition(mTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	mCmdList->ResourceBarrier(1, &toShader);
+}
+
+// Leaves mTexture to CreateTexture where the texture is better off committed
+HRESULT DX12Renderer::CreateStreamedTexture(const D3D12_RESOURCE_DESC& desc)
+{
+	mTextureStreaming = FALSE;
+	mTextureTailMip = 0;
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	if (FAILED(mDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))) ||
+		options.TiledResourcesTier == D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED || desc.MipLevels > TextureStreamer::MaxMips)
+	{
+		return S_OK;
+	}
+
+	ID3D12ResourcePtr texture;
+	HRESULT hr = mDevice->CreateReservedResource(&desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&texture));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	D3D12_PACKED_MIP_INFO packed = {};
+	D3D12_SUBRESOURCE_TILING tilings[DdsFormat::MaxMipCount] = {};
+	UINT tilingCount = desc.MipLevels;
+	mDevice->GetResourceTiling(texture, nullptr, &packed, nullptr, &tilingCount, 0, tilings);
+
+	// The tail is the packed mips, or the last mip where none are; a texture that is all tail has nothing to stream
+	UINT tailMip = packed.NumPackedMips > 0 ? packed.NumStandardMips : desc.MipLevels - 1u;
+	if (tailMip == 0)
+	{
+		return S_OK;
+	}
+	uint64_t mipBytes[TextureStreamer::MaxMips] = {};
+	UINT tailTiles = packed.NumTilesForPackedMips;
+	for (UINT mip = 0; mip < packed.NumStandardMips; mip++)
+	{
+		mTextureMipTiles[mip] = tilings[mip].WidthInTiles * tilings[mip].HeightInTiles * tilings[mip].DepthInTiles;
+		if (mip < tailMip)
+		{
+			mipBytes[mip] = UINT64(mTextureMipTiles[mip]) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+		}
+		else
+		{
+			tailTiles += mTextureMipTiles[mip];
+		}
+	}
+	mipBytes[tailMip] = UINT64(tailTiles) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+	CD3DX12_HEAP_DESC heapDesc(mipBytes[tailMip], D3D12_HEAP_TYPE_DEFAULT, 0, D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
+	hr = mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&mTextureTailHeap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	mTexture = texture;
+	mTextureStandardMips = packed.NumStandardMips;
+	mTexturePackedTiles = packed.NumTilesForPackedMips;
+	mTextureTailMip = tailMip;
+	UINT heapTile = 0;
+	for (UINT mip = tailMip; mip < mTextureStandardMips; mip++)
+	{
+		MapTextureTiles(mip, mTextureMipTiles[mip], mTextureTailHeap, heapTile);
+		heapTile += mTextureMipTiles[mip];
+	}
+	if (mTexturePackedTiles > 0)
+	{
+		MapTextureTiles(mTextureStandardMips, mTexturePackedTiles, mTextureTailHeap, heapTile);
+	}
+	mStreamedTexture = mTextureStreamer.Add(UINT(desc.Width), desc.Height, desc.MipLevels, tailMip, mipBytes);
+	mTextureStreaming = TRUE;
+	return S_OK;
+}
+
+// For the packed mips, mip is the first of them and tiles their total. Without a heap the tiles are unmapped.
+// Runs on the queue ahead of the next ExecuteCommandLists.
+void DX12Renderer::MapTextureTiles(UINT mip, UINT tiles, ID3D12Heap* heap, UINT heapTile)
+{
+	D3D12_TILED_RESOURCE_COORDINATE coordinate = { 0, 0, 0, mip };
+	D3D12_TILE_REGION_SIZE region = { tiles, FALSE, 0, 0, 0 };
+	D3D12_TILE_RANGE_FLAGS flags = heap ? D3D12_TILE_RANGE_FLAG_NONE : D3D12_TILE_RANGE_FLAG_NULL;
+	mCmdQueue->UpdateTileMappings(mTexture, 1, &coordinate, &region, heap, 1, &flags, &heapTile, &tiles, D3D12_TILE_MAPPING_FLAG_NONE);
+}
+
+// On a worker: a heap for the mip and its texels staged for the copy. Touching the mip's pages of
+// the mapped file is where it is actually read.
+BOOL DX12Renderer::LoadTextureMip(TextureMipLoad& load)
+{
+	CD3DX12_HEAP_DESC heapDesc(UINT64(mTextureMipTiles[load.mip]) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES, D3D12_HEAP_TYPE_DEFAULT, 0,
+		D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
+	if (FAILED(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&load.heap))))
+	{
 		return FALSE;
 	}
-	fseek(fpVS, 0, SEEK_END);
-	mVertexShader.size = ftell(fpVS);
-	rewind(fpVS);
-	mVertexShader.binaryPtr = malloc(mVertexShader.size);
-	fread(mVertexShader.binaryPtr, 1, mVertexShader.size, fpVS);
-	fclose(fpVS);
-	fpVS = nullptr;
 
+	D3D12_RESOURCE_DESC desc = mTexture->GetDesc();
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+	UINT rowCount = 0;
+	UINT64 uploadSize = 0;
+	mDevice->GetCopyableFootprints(&desc, load.mip, 1, 0, &footprint, &rowCount, nullptr, &uploadSize);
+	HRESULT hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&load.upload)
+	);
+	UINT8* upload = nullptr;
+	CD3DX12_RANGE range(0, 0);
+	if (FAILED(hr) || FAILED(load.upload->Map(0, &range, reinterpret_cast<void**>(&upload))))
+	{
+		return FALSE;
+	}
+	const TextureMip& mip = mTextureView.mips[load.mip];
+	for (UINT row = 0; row < rowCount; row++)
+	{
+		memcpy(upload + UINT64(row) * footprint.Footprint.RowPitch, mip.data + UINT64(row) * mip.rowPitch, mip.rowPitch);
+	}
+	load.upload->Unmap(0, nullptr);
 	return TRUE;
 }
 
-BOOL DX12Renderer::LoadPixelShader()
+void DX12Renderer::UpdateTextureStreaming()
 {
-	FILE* fpPS = nullptr;
+	if (!mTextureStreaming)
+	{
+		return;
+	}
 
-	std::wstring path = GetExecutionDirectory();
-	path += std::wstring(L"\\");
-	path += L"PixelShader.cso";
+	// Last frame's visible squares ask for the projected size of the texture's largest side, which
+	// spans each square's local bounds. The GPU culling pass keeps its survivors to itself, so there
+	// everything in the frustum asks.
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, mCamera.GetPosition());
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, mCamera.GetProj());
+	float projectionScale = proj._22 * mHeight * 0.5f;
+	const std::vector<uint32_t>* objects = &mVisibleObjects;
+	if (mGpuCulling)
+	{
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, mCamera.GetViewProj());
+		mStreamingObjects.clear();
+		mOctree.QueryFrustum(Frustum::FromViewProj(&viewProj.m[0][0]), mStreamingObjects);
+		objects = &mStreamingObjects;
+	}
+	for (uint32_t object : *objects)
+	{
+		const Square* square = object < mTransformOwners.size() ? mSquares.Get(mTransformOwners[object]) : nullptr;
+		if (!square)
+		{
+			continue;
+		}
+		const WorldBounds& bounds = mWorldBounds[object];
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&bounds.center), XMLoadFloat3(&eye))))
+			- XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.extents)));
+		const XMMATRIX& world = square->GetWorldMatrix();
+		float worldScale = XMVectorGetX(XMVectorMax(XMVector3Length(world.r[0]), XMVectorMax(XMVector3Length(world.r[1]), XMVector3Length(world.r[2]))));
+		const XMFLOAT3& extents = square->GetLocalExtents();
+		float span = 2.0f * std::max(extents.x, extents.y) * worldScale;
+		mTextureStreamer.RequestScreenSize(mStreamedTexture, span * projectionScale / std::max(distance, MinTextureDistance));
+	}
+
+	mTextureStreamLoads.clear();
+	mTextureStreamEvictions.clear();
+	mTextureStreamer.Update(mTextureStreamLoads, mTextureStreamEvictions);
+
+	// Earlier frames have finished with evicted mips, but their heaps wait for this one's unmapping
+	for (const TextureStreamEvent& eviction : mTextureStreamEvictions)
+	{
+		MapTextureTiles(eviction.mip, mTextureMipTiles[eviction.mip], nullptr, 0);
+		mRetiredTextureMemory.push_back({ mTextureMipHeaps[eviction.mip], nullptr, mFrameFenceValue + 1 });
+		mTextureMipHeaps[eviction.mip] = nullptr;
+	}
+	for (const TextureStreamEvent& request : mTextureStreamLoads)
+	{
+		// The streamer never has more loads in flight than there are slots
+		TextureMipLoad* load = std::find_if(std::begin(mTextureLoads), std::end(mTextureLoads),
+			[](const TextureMipLoad& slot) { return slot.asset == AssetLoader::InvalidAsset; });
+		load->mip = request.mip;
+		load->asset = mAssets.Request("Texture.dds:mip" + std::to_string(request.mip), {}, [this, load]
+		{
+			return LoadTextureMip(*load) != FALSE;
+		});
+		if (mAssets.GetWorkerCount() == 0)
+		{
+			mAssets.Wait(load->asset);
+		}
+	}
+
+	// Finished loads are copied ahead of this frame's draws, which the clamp then lets sample them
+	for (TextureMipLoad& load : mTextureLoads)
+	{
+		AssetState state = load.asset == AssetLoader::InvalidAsset ? AssetState::Pending : mAssets.GetState(load.asset);
+		if (state != AssetState::Ready && state != AssetState::Failed)
+		{
+			continue;
+		}
+		if (state == AssetState::Ready)
+		{
+			MapTextureTiles(load.mip, mTextureMipTiles[load.mip], load.heap, 0);
+			mTextureMipHeaps[load.mip] = load.heap;
+			D3D12_RESOURCE_DESC desc = mTexture->GetDesc();
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+			mDevice->GetCopyableFootprints(&desc, load.mip, 1, 0, &footprint, nullptr, nullptr, nullptr);
+			D3D12_RESOURCE_BARRIER toCopy = CD3DX12_RESOURCE_BARRIER::Transition(mTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST, load.mip);
+			mCmdList->ResourceBarrier(1, &toCopy);
+			CD3DX12_TEXTURE_COPY_LOCATION destination(mTexture, load.mip);
+			CD3DX12_TEXTURE_COPY_LOCATION source(load.upload, footprint);
+			mCmdList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+			D3D12_RESOURCE_BARRIER toShader = CD3DX12_RESOURCE_BARRIER::Transition(mTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, load.mip);
+			mCmdList->ResourceBarrier(1, &toShader);
+			mRetiredTextureMemory.push_back({ nullptr, load.upload, mFrameFenceValue + 1 });
+		}
+		mTextureStreamer.FinishLoad(mStreamedTexture, load.mip, state == AssetState::Ready);
+		mAssets.Release(load.asset);
+		load = TextureMipLoad();
+	}
+
+	// This frame's evictions are unmapped and its finished loads copied before its draws, so the view
+	// follows now. Render waited on the last frame, so nothing reads the descriptor meanwhile.
+	UINT residentMip = mTextureStreamer.GetResidentMip(mStreamedTexture);
+	if (residentMip != mTextureClampMip)
+	{
+		CreateTextureView(residentMip);
+	}
+}
+
+void DX12Renderer::StopTextureStreaming()
+{
+	// Release waits for loads still running
+	for (TextureMipLoad& load : mTextureLoads)
+	{
+		if (load.asset != AssetLoader::InvalidAsset)
+		{
+			mAssets.Release(load.asset);
+		}
+		load = TextureMipLoad();
+	}
+	mTextureStreamer.Clear();
+	mStreamedTexture = SlotMap<int>::InvalidHandle;
+	mTextureStreaming = FALSE;
+	mTextureTailMip = 0;
+	mTextureTailHeap = nullptr;
+	for (ID3D12HeapPtr& heap : mTextureMipHeaps)
+	{
+		heap = nullptr;
+	}
+}
 
-	char input[1024];
-	const wchar_t *inputw = path.c_str();
-	wcstombs(input, inputw, sizeof(wchar_t)*int(path.size()));
+BOOL DX12Renderer::LoadShader(const char* name, D3D12_SHADER_BYTECODE* bytecode, D3D12_SHADER_BYTECODE* reflection)
+{
+	if (mShaderArchive.IsOpen() && mShaderArchive.Find(name, bytecode)) {
+		// ShaderBuild strips reflection from the object and stores it beside it
+		std::string reflectionName = std::string(name) + ".refl";
+		if (!mShaderArchive.Find(reflectionName.c_str(), reflection)) {
+			*reflection = *bytecode;
+		}
+		return TRUE;
+	}
 
-	fopen_s(&fpPS, input, "rb");
-	if (!fpPS) {
+	FileView file;
+	if (!mFiles.Read(std::string(name) + ".cso", &file)) {
 		return FALSE;
 	}
-	fseek(fpPS, 0, SEEK_END);
-	mPixelShader.size = ftell(fpPS);
-	rewind(fpPS);
-	mPixelShader.binaryPtr = malloc(mPixelShader.size);
-	fread(mPixelShader.binaryPtr, 1, mPixelShader.size, fpPS);
-	fclose(fpPS);
-	fpPS = nullptr;
+	bytecode->pShaderBytecode = file.GetData();
+	bytecode->BytecodeLength = file.GetSize();
+	*reflection = *bytecode;
+	std::lock_guard<std::mutex> lock(mLooseShaderMutex);
+	mLooseShaderFiles.push_back(std::move(file));
 
 	return TRUE;
 }
 
+static constexpr DXGI_FORMAT ToDxgiFormat(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::R32G32B32_Float: return DXGI_FORMAT_R32G32B32_FLOAT;
+	case VertexFormat::R32G32B32A32_Float: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case VertexFormat::R16G16B16A16_Snorm: return DXGI_FORMAT_R16G16B16A16_SNORM;
+	case VertexFormat::R16G16_Snorm: return DXGI_FORMAT_R16G16_SNORM;
+	case VertexFormat::R8G8B8A8_Unorm: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+// Input elements as a compile-time constant, straight from a constexpr vertex description
+template <size_t N>
+static constexpr std::array<D3D12_INPUT_ELEMENT_DESC, N> MakeD3D12InputElements(const VertexElement (&elements)[N])
+{
+	std::array<VertexInputElement, N> layout = MakeInputElements(elements);
+	std::array<D3D12_INPUT_ELEMENT_DESC, N> out = {};
+	for (size_t i = 0; i < N; i++)
+	{
+		out[i] = { layout[i].semanticName, layout[i].semanticIndex, ToDxgiFormat(layout[i].format), 0, layout[i].offset,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+	}
+	return out;
+}
+
 HRESULT DX12Renderer::CreatePipelineObject()
 {
 	HRESULT hr;
 
-	D3D12_INPUT_ELEMENT_DESC desc_input_elements[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, Pos), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR",	  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, Color), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-	};
+	// Generated from the same description as the vertex buffer and resource/SquareVertex.hlsli
+	static constexpr auto desc_input_elements = MakeD3D12InputElements(SquareVertexElements);
 
 	D3D12_RASTERIZER_DESC rasterDesc = {};
 	rasterDesc.FillMode = D3D12_FILL_MODE_SOLID;
@@ -407,13 +1717,14 @@ HRESULT DX12Renderer::CreatePipelineObject()
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC descmPipelineState;
 	ZeroMemory(&descmPipelineState, sizeof(descmPipelineState));
-	descmPipelineState.VS.pShaderBytecode = mVertexShader.binaryPtr;
-	descmPipelineState.VS.BytecodeLength = mVertexShader.size;
-	descmPipelineState.PS.pShaderBytecode = mPixelShader.binaryPtr;
-	descmPipelineState.PS.BytecodeLength = mPixelShader.size;
+	descmPipelineState.VS = mVertexPulling ? mPullShader : mVertexShader;
+	descmPipelineState.PS = mPixelShader;
 	descmPipelineState.SampleDesc.Count = 1;
 	descmPipelineState.SampleMask = UINT_MAX;
-	descmPipelineState.InputLayout = { desc_input_elements, _countof(desc_input_elements) };
+	if (!mVertexPulling)
+	{
+		descmPipelineState.InputLayout = { desc_input_elements.data(), UINT(desc_input_elements.size()) };
+	}
 	descmPipelineState.pRootSignature = mRootSignature;
 	descmPipelineState.NumRenderTargets = 1;
 	descmPipelineState.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -428,9 +1739,9 @@ HRESULT DX12Renderer::CreatePipelineObject()
 
 void DX12Renderer::InitializeAccelarationStructure()
 {
-	for (int i = 0; i < mSquareList.size(); i++)
+	for (Square& square : mSquares)
 	{
-		mSquareList[i]->CreateAccelerationStructure();
+		square.CreateAccelerationStructure();
 	}
 
 	mCmdList->Close();
@@ -445,15 +1756,15 @@ void DX12Renderer::InitializeAccelarationStructure()
 
 	mFrameIndex = mSwapChain->GetCurrentBackBufferIndex();
 
-	for (int i = 0; i < mSquareList.size(); i++)
+	for (Square& square : mSquares)
 	{
-		mSquareList[i]->SetAccelerationStructures();
+		square.SetAccelerationStructures();
 	}
 }
 
 static dxc::DxcDllSupport gDxcDllHelper;
 // Ray Tracing
-ID3DBlobPtr compileLibrary(const WCHAR* filename, const WCHAR* targetString)
+ID3DBlobPtr compileLibrary(const FileView& source, const WCHAR* filename, const WCHAR* targetString)
 {
 	// Initialize the helper
 	gDxcDllHelper.Initialize();
@@ -462,19 +1773,9 @@ ID3DBlobPtr compileLibrary(const WCHAR* filename, const WCHAR* targetString)
 	gDxcDllHelper.CreateInstance(CLSID_DxcCompiler, &pCompiler);
 	gDxcDllHelper.CreateInstance(CLSID_DxcLibrary, &pLibrary);
 
-	// Open and read the file
-	std::ifstream shaderFile(filename);
-	if (shaderFile.good() == false)
-	{
-		return nullptr;
-	}
-	std::stringstream strStream;
-	strStream << shaderFile.rdbuf();
-	std::string shader = strStream.str();
-
-	// Create blob from the string
+	// The source stays mapped until the compile returns
 	IDxcBlobEncodingPtr pTextBlob;
-	pLibrary->CreateBlobWithEncodingFromPinned((LPBYTE)shader.c_str(), (uint32_t)shader.size(), 0, &pTextBlob);
+	pLibrary->CreateBlobWithEncodingFromPinned((LPBYTE)source.GetData(), (uint32_t)source.GetSize(), 0, &pTextBlob);
 
 	// Compile
 	IDxcOperationResultPtr pResult;
@@ -496,62 +1797,68 @@ ID3DBlobPtr compileLibrary(const WCHAR* filename, const WCHAR* targetString)
 	return pBlob;
 }
 
-ID3D12RootSignaturePtr createRootSignature(ID3D12Device5Ptr pDevice, const D3D12_ROOT_SIGNATURE_DESC& desc)
+ID3D12RootSignaturePtr createRootSignature(ID3D12Device5Ptr pDevice, const RootSignatureBuilder& builder)
 {
-	ID3DBlobPtr pSigBlob;
-	ID3DBlobPtr pErrorBlob;
-	HRESULT hr = D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, &pSigBlob, &pErrorBlob);
-	if (FAILED(hr))
+	ID3D12RootSignaturePtr pRootSig;
+	if (FAILED(builder.Build(pDevice, &pRootSig)))
 	{
 		return nullptr;
 	}
-	ID3D12RootSignaturePtr pRootSig;
-	pDevice->CreateRootSignature(0, pSigBlob->GetBufferPointer(), pSigBlob->GetBufferSize(), IID_PPV_ARGS(&pRootSig));
 	return pRootSig;
 }
 
-struct RootSignatureDesc
+// Library functions are reflected under their mangled names, e.g. "\01?rayGen@@YAXXZ"
+ID3D12FunctionReflection* findFunction(ID3D12LibraryReflection* pLibrary, const char* name)
 {
-	D3D12_ROOT_SIGNATURE_DESC desc = {};
-	std::vector<D3D12_DESCRIPTOR_RANGE> range;
-	std::vector<D3D12_ROOT_PARAMETER> rootParams;
-};
-
-RootSignatureDesc createRayGenRootDesc()
-{
-	// Create the root-signature
-	RootSignatureDesc desc;
-	desc.range.resize(2);
-	// gOutput
-	desc.range[0].BaseShaderRegister = 0;
-	desc.range[0].NumDescriptors = 1;
-	desc.range[0].RegisterSpace = 0;
-	desc.range[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-	desc.range[0].OffsetInDescriptorsFromTableStart = 0;
-
-	// gRtScene
-	desc.range[1].BaseShaderRegister = 0;
-	desc.range[1].NumDescriptors = 1;
-	desc.range[1].RegisterSpace = 0;
-	desc.range[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	desc.range[1].OffsetInDescriptorsFromTableStart = 1;
-
-	desc.rootParams.resize(1);
-	desc.rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-	desc.rootParams[0].DescriptorTable.NumDescriptorRanges = 2;
-	desc.rootParams[0].DescriptorTable.pDescriptorRanges = desc.range.data();
-
-	// Create the desc
-	desc.desc.NumParameters = 1;
-	desc.desc.pParameters = desc.rootParams.data();
-	desc.desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE;
+	if (pLibrary == nullptr)
+	{
+		return nullptr;
+	}
+	std::string mangled = std::string("?") + name + "@";
+	D3D12_LIBRARY_DESC libDesc;
+	pLibrary->GetDesc(&libDesc);
+	for (UINT i = 0; i < libDesc.FunctionCount; i++)
+	{
+		ID3D12FunctionReflection* pFunction = pLibrary->GetFunctionByIndex(INT(i));
+		D3D12_FUNCTION_DESC funcDesc;
+		pFunction->GetDesc(&funcDesc);
+		if (strcmp(funcDesc.Name, name) == 0 || strstr(funcDesc.Name, mangled.c_str()) != nullptr)
+		{
+			return pFunction;
+		}
+	}
+	return nullptr;
+}
 
+RootSignatureBuilder createRayGenRootDesc(ID3D12LibraryReflection* pLibrary)
+{
+	// gOutput and gRtScene, as the ray generation shader declares them
+	RootSignatureBuilder desc;
+	desc.SetFlags(D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE);
+	desc.AddFunction(findFunction(pLibrary, "rayGen"));
 	return desc;
 }
 
 struct DxilLibrary
 {
 	DxilLibrary(ID3DBlobPtr pBlob, const WCHAR* entryPoint[], uint32_t entryPointCount) : pShaderBlob(pBlob)
+	{
+		D3D12_SHADER_BYTECODE bytecode = {};
+		if (pBlob)
+		{
+			bytecode.pShaderBytecode = pBlob->GetBufferPointer();
+			bytecode.BytecodeLength = pBlob->GetBufferSize();
+		}
+		Init(bytecode, entryPoint, entryPointCount);
+	};
+
+	// Bytecode owned elsewhere, e.g. a view into the mapped shader archive
+	DxilLibrary(D3D12_SHADER_BYTECODE bytecode, const WCHAR* entryPoint[], uint32_t entryPointCount)
+	{
+		Init(bytecode, entryPoint, entryPointCount);
+	}
+
+	void Init(D3D12_SHADER_BYTECODE bytecode, const WCHAR* entryPoint[], uint32_t entryPointCount)
 	{
 		stateSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
 		stateSubobject.pDesc = &dxilLibDesc;
@@ -559,10 +1866,9 @@ struct DxilLibrary
 		dxilLibDesc = {};
 		exportDesc.resize(entryPointCount);
 		exportName.resize(entryPointCount);
-		if (pBlob)
+		if (bytecode.pShaderBytecode)
 		{
-			dxilLibDesc.DXILLibrary.pShaderBytecode = pBlob->GetBufferPointer();
-			dxilLibDesc.DXILLibrary.BytecodeLength = pBlob->GetBufferSize();
+			dxilLibDesc.DXILLibrary = bytecode;
 			dxilLibDesc.NumExports = entryPointCount;
 			dxilLibDesc.pExports = exportDesc.data();
 
@@ -574,7 +1880,7 @@ struct DxilLibrary
 				exportDesc[i].ExportToRename = nullptr;
 			}
 		}
-	};
+	}
 
 	DxilLibrary() : DxilLibrary(nullptr, nullptr, 0) {}
 
@@ -590,11 +1896,24 @@ static const WCHAR* kMissShader = L"miss";
 static const WCHAR* kClosestHitShader = L"closesthit";
 static const WCHAR* kHitGroup = L"closesthit";
 
-DxilLibrary createDxilLibrary()
+DxilLibrary createDxilLibrary(const ShaderArchive& archive, const VirtualFileSystem& files)
 {
-	// Compile the shader
-	ID3DBlobPtr pDxilLib = compileLibrary(L"..\\DX12Templete\\resource\\RayShaders.hlsl", L"lib_6_3");
 	const WCHAR* entryPoints[] = { kRayGenShader, kMissShader, kClosestHitShader };
+
+	// Prefer the library built offline by ShaderBuild
+	D3D12_SHADER_BYTECODE bytecode;
+	if (archive.IsOpen() && archive.Find("RayShaders", &bytecode))
+	{
+		return DxilLibrary(bytecode, entryPoints, arraysize(entryPoints));
+	}
+
+	// Compile the shader
+	ID3DBlobPtr pDxilLib;
+	FileView source;
+	if (files.Read("resource/RayShaders.hlsl", &source))
+	{
+		pDxilLib = compileLibrary(source, L"RayShaders.hlsl", L"lib_6_3");
+	}
 	return DxilLibrary(pDxilLib, entryPoints, arraysize(entryPoints));
 }
 
@@ -634,7 +1953,7 @@ struct ExportAssociation
 
 struct LocalRootSignature
 {
-	LocalRootSignature(ID3D12Device5Ptr pDevice, const D3D12_ROOT_SIGNATURE_DESC& desc)
+	LocalRootSignature(ID3D12Device5Ptr pDevice, const RootSignatureBuilder& desc)
 	{
 		pRootSig = createRootSignature(pDevice, desc);
 		pInterface = pRootSig.GetInterfacePtr();
@@ -648,7 +1967,7 @@ struct LocalRootSignature
 
 struct GlobalRootSignature
 {
-	GlobalRootSignature(ID3D12Device5Ptr pDevice, const D3D12_ROOT_SIGNATURE_DESC& desc)
+	GlobalRootSignature(ID3D12Device5Ptr pDevice, const RootSignatureBuilder& desc)
 	{
 		pRootSig = createRootSignature(pDevice, desc);
 		pInterface = pRootSig.GetInterfacePtr();
@@ -695,14 +2014,19 @@ void DX12Renderer::CreateRayTracingPipelineStateObject()
 	uint32_t index = 0;
 
 	// Create the DXIL library
-	DxilLibrary dxilLib = createDxilLibrary();
+	DxilLibrary dxilLib = createDxilLibrary(mShaderArchive, mFiles);
 	subobjects[index++] = dxilLib.stateSubobject; // 0 Library
 
 	HitProgram hitProgram(nullptr, kClosestHitShader, kHitGroup);
 	subobjects[index++] = hitProgram.subObject; // 1 Hit Group
 
+	// Reflection comes from ShaderBuild's .refl blob, or from the runtime-compiled library itself
+	D3D12_SHADER_BYTECODE libraryReflection = dxilLib.dxilLibDesc.DXILLibrary;
+	mShaderArchive.Find("RayShaders.refl", &libraryReflection);
+	ComPtr<ID3D12LibraryReflection> pLibraryReflection = ReflectLibrary(libraryReflection);
+
 	// Create the ray-gen root-signature and association
-	LocalRootSignature rgsRootSignature(mDevice, createRayGenRootDesc().desc);
+	LocalRootSignature rgsRootSignature(mDevice, createRayGenRootDesc(pLibraryReflection.Get()));
 	subobjects[index] = rgsRootSignature.subobject; // 2 RayGen Root Sig
 
 	uint32_t rgsRootIndex = index++; // 2
@@ -710,8 +2034,8 @@ void DX12Renderer::CreateRayTracingPipelineStateObject()
 	subobjects[index++] = rgsRootAssociation.subobject; // 3 Associate Root Sig to RGS
 
 	// Create the miss- and hit-programs root-signature and association
-	D3D12_ROOT_SIGNATURE_DESC emptyDesc = {};
-	emptyDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE;
+	RootSignatureBuilder emptyDesc;
+	emptyDesc.SetFlags(D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE);
 	LocalRootSignature hitMissRootSignature(mDevice, emptyDesc);
 	subobjects[index] = hitMissRootSignature.subobject; // 4 Root Sig to be shared between Miss and CHS
 
@@ -734,7 +2058,7 @@ void DX12Renderer::CreateRayTracingPipelineStateObject()
 	subobjects[index++] = config.subobject; // 8
 
 	// Create the global root signature and store the empty signature
-	GlobalRootSignature root(mDevice, {});
+	GlobalRootSignature root(mDevice, RootSignatureBuilder());
 	mRayTraceRootSignature = root.pRootSig;
 	subobjects[index++] = root.subobject; // 9
 
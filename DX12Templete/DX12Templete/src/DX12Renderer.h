@@ -11,6 +11,27 @@
 #include "stddef.h"
 #include "d3dx12.h"
 #include "Square.h"
+#include "GeometryBuffer.h"
+#include "ShaderArchive.h"
+#include "MeshAsset.h"
+#include "TextureAsset.h"
+#include "TextureStreamer.h"
+#include "ShaderReflection.h"
+#include "RootSignatureBuilder.h"
+#include "ShaderConstants.h"
+#include "Camera.h"
+#include "TransformStore.h"
+#include "SlotMap.h"
+#include "JobSystem.h"
+#include "AssetLoader.h"
+#include "VirtualFileSystem.h"
+#include "FrustumCuller.h"
+#include "LooseOctree.h"
+#include "SoftwareOcclusion.h"
+#include "IndirectCulling.h"
+#include "MeshletBuilder.h"
+#include "ClusterCulling.h"
+#include "SquareVertex.h"
 #include "dxcapi.use.h"
 
 #pragma comment(lib, "d3d12.lib")
@@ -24,6 +45,7 @@ using namespace Microsoft::WRL;
 #define MAKE_SMART_COM_PTR(_a) _COM_SMARTPTR_TYPEDEF(_a, __uuidof(_a))
 MAKE_SMART_COM_PTR(ID3D12Device5);
 MAKE_SMART_COM_PTR(ID3D12GraphicsCommandList4);
+MAKE_SMART_COM_PTR(ID3D12GraphicsCommandList6);
 MAKE_SMART_COM_PTR(ID3D12CommandQueue);
 MAKE_SMART_COM_PTR(IDXGISwapChain3);
 MAKE_SMART_COM_PTR(IDXGIFactory4);
@@ -32,10 +54,12 @@ MAKE_SMART_COM_PTR(ID3D12Fence1);
 MAKE_SMART_COM_PTR(ID3D12CommandAllocator);
 MAKE_SMART_COM_PTR(ID3D12Resource);
 MAKE_SMART_COM_PTR(ID3D12DescriptorHeap);
+MAKE_SMART_COM_PTR(ID3D12Heap);
 MAKE_SMART_COM_PTR(ID3D12Debug);
 MAKE_SMART_COM_PTR(ID3D12PipelineState);
 MAKE_SMART_COM_PTR(ID3D12StateObject);
 MAKE_SMART_COM_PTR(ID3D12RootSignature);
+MAKE_SMART_COM_PTR(ID3D12CommandSignature);
 MAKE_SMART_COM_PTR(ID3DBlob);
 MAKE_SMART_COM_PTR(IDxcCompiler);
 MAKE_SMART_COM_PTR(IDxcLibrary);
@@ -43,14 +67,10 @@ MAKE_SMART_COM_PTR(IDxcBlobEncoding);
 MAKE_SMART_COM_PTR(IDxcOperationResult);
 
 class DX12Renderer {
-
-	struct Vertex {
-		XMFLOAT3 Pos;
-		XMFLOAT4 Color;
-	};
 public:
 	static constexpr int FrameBufferCount = 2;
 	static constexpr UINT GpuWaitTimeout = (10 * 1000);
+	static constexpr UINT64 DefaultTextureBudget = 64ull << 20;
 
 public:
 	DX12Renderer() {};
@@ -60,6 +80,14 @@ public:
 	void Render();
 	void Destroy();
 
+	// Objects can be added and removed between frames; removal is deferred until the GPU is done with them
+	SlotHandle SpawnSquare(TransformHandle parent = TransformStore::NoParent);
+	// Also despawns the squares parented to it
+	void DespawnSquare(SlotHandle handle);
+
+	// Texture memory the streamed mips may take, the resident tail included; applies from the next Update
+	void SetTextureBudget(UINT64 bytes) { mTextureStreamer.SetBudget(bytes); }
+
 	static ID3D12Device5Ptr GetDevice() { return mDevice; }
 	static ID3D12GraphicsCommandList4Ptr GetCmdList() { return mCmdList; }
 private:
@@ -71,7 +99,7 @@ private:
 
 	HANDLE  mFenceEvent;
 	ID3D12Fence1Ptr mFrameFence;
-	UINT64 mFrameFenceValue;
+	UINT64 mFrameFenceValue = 0;
 
 	ID3D12CommandAllocatorPtr mCmdAllocator;
 	IDXGIFactory4Ptr mFactory;
@@ -85,10 +113,22 @@ private:
 	D3D12_CPU_DESCRIPTOR_HANDLE mRTVHandle[FrameBufferCount];
 
 	ID3D12RootSignaturePtr mRootSignature;
+	RootSignatureLayout mRootLayout;
 	ID3D12PipelineStatePtr mPipelineState;
 
 	D3D12_VIEWPORT mViewPort;
 
+	// Constants: one region per frame buffer holding FrameConstants followed by ObjectConstants
+	// for every transform, persistently mapped and rewritten in a single pass per frame
+	Camera mCamera;
+	ID3D12ResourcePtr mConstantBuffer;
+	UINT8* mConstantBufferData = nullptr;
+	UINT64 mConstantBufferFrameSize = 0;
+	size_t mConstantBufferCapacity = 0; // objects per frame region
+	FrameConstants mFrameConstants;
+	std::vector<ObjectConstants> mObjectConstants; // only filled when b1 is placed as root constants
+	const RootSignatureLayout::Slot* mFrameConstantsSlot = nullptr;
+	const RootSignatureLayout::Slot* mObjectConstantsSlot = nullptr;
 
 	void LoadPipeline();
 	void CreateDebugInterface();
@@ -99,6 +139,20 @@ private:
 	HRESULT CreateRootSignature();
 	HRESULT CreatePipelineObject();
 	HRESULT CreateCommandList();
+	HRESULT CreateConstantBuffer(size_t objectCapacity);
+	void UpdateConstants();
+	void UpdateBounds();
+	void CullObjects();
+	void AddOccluder(uint32_t transform);
+	HRESULT CreateCullingPipeline();
+	HRESULT CreateCullingBuffers(size_t instanceCapacity);
+	void UpdateCullingInputs();
+	void RecordCulling();
+	void CullClusters(const Frustum& frustum, const XMFLOAT3& eye);
+	HRESULT CreateMeshletPipeline();
+	HRESULT CreateClusterBuffer(UINT64 frameSize);
+	void DrawClusters(D3D12_GPU_VIRTUAL_ADDRESS objectAddress);
+	void BindConstants(const RootSignatureLayout::Slot* slot, D3D12_GPU_VIRTUAL_ADDRESS address, const void* data);
 	HRESULT CreateRenderTargetView();
 	void SetViewPort();
 	void PopulateCommandList();
@@ -114,16 +168,178 @@ private:
 private:
 	BOOL    LoadAssets();
 	
-	std::vector<Square*> mSquareList;
+	SlotMap<Square> mSquares;
+	TransformStore mTransforms;
 
-	// Shader
-	struct ShaderObject {
-		void* binaryPtr;
-		int   size;
+	// Every square's vertices and indices, bound once per frame; draws pick theirs by base vertex
+	// and start index. Starts at room for a few hundred squares and doubles from there.
+	static constexpr UINT InitialGeometryVertices = 1024;
+	static constexpr UINT InitialGeometryIndices = 4096;
+	GeometryBuffer mGeometry;
+
+	// What every square is made of: Square.mesh next to the executable when it is there and in the
+	// pipeline's vertex format, otherwise the built-in square. Stays mapped for squares spawned later.
+	MeshAsset mSquareAsset;
+	MeshData mDefaultSquare;
+	MeshView mSquareMesh;
+	void LoadSquareMesh();
+
+	// The squares' texture, likewise Texture.dds when it is there, otherwise a built-in checker. The SRV
+	// has a shader-visible heap of its own, with squareTexture at its offset in the pixel shader table.
+	TextureAsset mTextureAsset;
+	TextureData mDefaultTexture;
+	TextureView mTextureView;
+	ID3D12ResourcePtr mTexture;
+	ID3D12ResourcePtr mTextureUpload; // released once the first frame has copied it
+	ID3D12DescriptorHeapPtr mTextureDescriptorHeap;
+	const RootSignatureLayout::Slot* mSquareTextureSlot = nullptr;
+	void LoadTexture();
+	HRESULT CreateTexture();
+	void RecordTextureUpload();
+
+	// Mip streaming. Where the GPU has tiled resources the texture is reserved and only its tail, the
+	// mips packed below one tile, is backed from the start. Each finer mip gets a heap of its own once
+	// the texture's projected size on screen asks for it, and gives it back when it is no longer seen
+	// or the budget runs short. Sampling is clamped to the finest resident mip through FrameConstants.
+	// Elsewhere, or when the whole texture fits the tail, it stays committed with every mip.
+	struct TextureMipLoad
+	{
+		AssetHandle asset = AssetLoader::InvalidAsset;
+		UINT mip = 0;
+		ID3D12HeapPtr heap;
+		ID3D12ResourcePtr upload;
+	};
+	struct RetiredTextureMemory
+	{
+		ID3D12HeapPtr heap;
+		ID3D12ResourcePtr upload;
+		UINT64 fenceValue;
 	};
-	ShaderObject mVertexShader;
-	ShaderObject mPixelShader;
+	BOOL mTextureStreaming = FALSE;
+	TextureStreamer mTextureStreamer{ DefaultTextureBudget };
+	SlotHandle mStreamedTexture = SlotMap<int>::InvalidHandle;
+	UINT mTextureTailMip = 0;      // first mip backed by mTextureTailHeap
+	UINT mTextureClampMip = 0;     // ResourceMinLODClamp of the texture's view
+	UINT mTextureStandardMips = 0; // mips with tiles of their own; the rest are packed
+	UINT mTexturePackedTiles = 0;
+	UINT mTextureMipTiles[DdsFormat::MaxMipCount] = {};
+	ID3D12HeapPtr mTextureTailHeap;
+	ID3D12HeapPtr mTextureMipHeaps[DdsFormat::MaxMipCount];
+	TextureMipLoad mTextureLoads[TextureStreamer::DefaultMaxLoadsInFlight];
+	std::vector<RetiredTextureMemory> mRetiredTextureMemory;
+	std::vector<TextureStreamEvent> mTextureStreamLoads;
+	std::vector<TextureStreamEvent> mTextureStreamEvictions;
+	std::vector<uint32_t> mStreamingObjects;
+	static constexpr float MinTextureDistance = 0.1f; // the near plane
+	HRESULT CreateStreamedTexture(const D3D12_RESOURCE_DESC& desc);
+	void CreateTextureView(UINT minMip);
+	void MapTextureTiles(UINT mip, UINT tiles, ID3D12Heap* heap, UINT heapTile);
+	BOOL LoadTextureMip(TextureMipLoad& load);
+	void UpdateTextureStreaming();
+	void StopTextureStreaming();
+
+	// With PullVertices the vertex shader reads the geometry buffer itself and the pipeline has no
+	// input layout. The base vertex then comes from ObjectConstants instead of the draw.
+	BOOL mVertexPulling = FALSE;
+	const RootSignatureLayout::Slot* mGeometryVerticesSlot = nullptr;
+	INT GetBaseVertexLocation(const Square& square) const { return mVertexPulling ? 0 : INT(square.GetGeometry().baseVertex); }
+
+	// Visibility. Objects are keyed by transform index everywhere below: the octree narrows the
+	// scene to candidates near the frustum, the SIMD culler tests their boxes exactly.
+	struct WorldBounds
+	{
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+	};
+	static constexpr float SceneCenter[3] = { 0.0f, 0.0f, 0.0f };
+	static constexpr float SceneHalfSize = 256.0f;
+
+	std::vector<SlotHandle> mTransformOwners;
+	std::vector<ObjectGeometry> mObjectGeometry; // per transform, identity decode where no square owns it
+	std::vector<uint32_t> mUpdatedTransforms;
+	std::vector<WorldBounds> mWorldBounds;
+	LooseOctree mOctree{ SceneCenter, SceneHalfSize };
+	JobSystem mJobs;
+	FrustumCuller mCuller;
+	CullingBounds mCullingBounds;
+	std::vector<uint32_t> mCandidates;
+	std::vector<uint32_t> mVisibleObjects;
+
+	// The nearest visible squares are rasterized on the CPU and hide whatever is behind them
+	static constexpr size_t MaxOccluders = 16;
+	static constexpr int OcclusionWidth = 256;
+	static constexpr float OccluderRadius = 20.0f; // GPU culling only picks occluders this close to the camera
+	SoftwareOcclusion mOcclusion;
+
+	// GPU-driven drawing: a compute pass culls every instance and writes one indirect draw per
+	// survivor, so the CPU records the same few commands however many objects there are.
+	// Needs b1 as a root CBV, which the command signature rebinds per draw.
+	BOOL mGpuCulling = FALSE;
+	ID3D12RootSignaturePtr mCullRootSignature;
+	RootSignatureLayout mCullRootLayout;
+	ID3D12PipelineStatePtr mCullPipelineState;
+	ID3D12CommandSignaturePtr mCommandSignature;
+	ID3D12DescriptorHeapPtr mCullDescriptorHeap;
+	// Per frame buffer: CullConstants and a zero for the count reset, then instances, then the occlusion pyramid
+	ID3D12ResourcePtr mCullUploadBuffer;
+	UINT8* mCullUploadData = nullptr;
+	UINT64 mCullUploadFrameSize = 0;
+	size_t mCullInstanceCapacity = 0;
+	size_t mHiZCapacity = 0;
+	UINT mCullInstanceCount = 0;
+	ID3D12ResourcePtr mIndirectCommands;
+	ID3D12ResourcePtr mIndirectCount;
+	std::vector<CullInstance> mCullInstances;
+	std::vector<float> mHiZ;
+
+	// Meshlets of the objects the CPU keeps are culled one by one against the same frustum and
+	// occlusion buffer. A mesh shader expands the survivors where the GPU supports it; elsewhere their
+	// triangles are gathered into a per-frame index buffer. Cone culling stays off while the pipeline
+	// draws both sides of every triangle. Each object first picks the LOD level whose simplification
+	// error covers at most MaxLodPixelError pixels, and only that level's meshlets are culled.
+	struct ClusterDraw
+	{
+		uint32_t object;  // transform index
+		uint32_t offset;  // first entry in mClusterData, or OwnIndices
+		uint32_t count;   // meshlets with mesh shaders, indices without
+		uint32_t lod;
+	};
+	static constexpr float MaxLodPixelError = 1.0f;
+	static constexpr uint32_t OwnIndices = UINT32_MAX; // nothing culled, draw the level from the geometry buffer
+	BOOL mMeshShaders = FALSE;
+	ID3D12GraphicsCommandList6Ptr mMeshCmdList;
+	ID3D12RootSignaturePtr mMeshRootSignature;
+	RootSignatureLayout mMeshRootLayout;
+	ID3D12PipelineStatePtr mMeshPipelineState;
+	ID3D12ResourcePtr mClusterUploadBuffer;
+	UINT8* mClusterUploadData = nullptr;
+	UINT64 mClusterUploadFrameSize = 0;
+	std::vector<ClusterDraw> mClusterDraws;
+	std::vector<uint32_t> mClusterData;
+	std::vector<uint32_t> mVisibleMeshlets;
+
+	// Every file the renderer reads; declared before the loader, whose loads read through it
+	VirtualFileSystem mFiles;
+
+	// LoadAssets builds everything as one load graph; the handles keep it alive
+	AssetLoader mAssets;
+	std::vector<AssetHandle> mAssetHandles;
+	AssetHandle RequestShader(AssetHandle archive, const char* name, D3D12_SHADER_BYTECODE* bytecode, D3D12_SHADER_BYTECODE* reflection, BOOL required);
+
+	// Shader
+	ShaderArchive mShaderArchive;
+	std::mutex mLooseShaderMutex; // shaders load in parallel
+	std::vector<FileView> mLooseShaderFiles;
+	D3D12_SHADER_BYTECODE mVertexShader;
+	D3D12_SHADER_BYTECODE mPixelShader;
+	D3D12_SHADER_BYTECODE mVertexShaderReflection;
+	D3D12_SHADER_BYTECODE mPullShader = {};
+	D3D12_SHADER_BYTECODE mPullShaderReflection = {};
+	D3D12_SHADER_BYTECODE mPixelShaderReflection;
+	D3D12_SHADER_BYTECODE mCullShader = {};
+	D3D12_SHADER_BYTECODE mCullShaderReflection = {};
+	D3D12_SHADER_BYTECODE mMeshShader = {};
+	D3D12_SHADER_BYTECODE mMeshShaderReflection = {};
 
-	BOOL	LoadVertexShader();
-	BOOL	LoadPixelShader();
+	BOOL	LoadShader(const char* name, D3D12_SHADER_BYTECODE* bytecode, D3D12_SHADER_BYTECODE* reflection);
 };
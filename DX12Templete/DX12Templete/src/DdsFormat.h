@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+
+// The parts of the DirectDraw Surface container the texture pipeline uses: a 2D texture with its mip
+// chain, written by tools/TextureCompress and read by ReadDdsTexture. Textures are always written
+// with the DX10 extension header, which carries the DXGI format; the legacy FourCC codes for BC1, BC3
+// and BC5 are read too, so files from other tools load as well.
+//
+//   Magic
+//   Header
+//   HeaderDxt10   when the pixel format's FourCC is Dx10
+//   mips          largest first, each tightly packed block rows
+namespace DdsFormat
+{
+	static constexpr uint32_t Magic = 0x20534444; // "DDS "
+
+	static constexpr uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+	static constexpr uint32_t Dx10 = FourCC('D', 'X', '1', '0');
+	static constexpr uint32_t Dxt1 = FourCC('D', 'X', 'T', '1');
+	static constexpr uint32_t Dxt5 = FourCC('D', 'X', 'T', '5');
+	static constexpr uint32_t Ati2 = FourCC('A', 'T', 'I', '2');
+	static constexpr uint32_t Bc5u = FourCC('B', 'C', '5', 'U');
+
+	enum HeaderFlags : uint32_t
+	{
+		CapsFlag = 0x1,
+		HeightFlag = 0x2,
+		WidthFlag = 0x4,
+		PixelFormatFlag = 0x1000,
+		MipCountFlag = 0x20000,
+		LinearSizeFlag = 0x80000,
+		DepthFlag = 0x800000,
+	};
+
+	enum PixelFormatFlags : uint32_t
+	{
+		FourCCFlag = 0x4,
+	};
+
+	enum Caps : uint32_t
+	{
+		ComplexCaps = 0x8,
+		TextureCaps = 0x1000,
+		MipMapCaps = 0x400000,
+	};
+
+	// DXGI_FORMAT values of the formats the pipeline writes
+	enum DxgiFormat : uint32_t
+	{
+		DxgiUnknown = 0,
+		DxgiBC1Unorm = 71,
+		DxgiBC1UnormSrgb = 72,
+		DxgiBC3Unorm = 77,
+		DxgiBC3UnormSrgb = 78,
+		DxgiBC5Unorm = 83,
+		DxgiBC7Unorm = 98,
+		DxgiBC7UnormSrgb = 99,
+	};
+
+	static constexpr uint32_t Texture2DDimension = 3; // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+	static constexpr uint32_t MaxMipCount = 16;       // 32768 texels on a side
+
+	struct PixelFormat
+	{
+		uint32_t size;      // 32
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t masks[4];
+	};
+
+	struct Header
+	{
+		uint32_t size;      // 124
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t linearSize; // bytes in the largest mip
+		uint32_t depth;
+		uint32_t mipCount;
+		uint32_t reserved[11];
+		PixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct HeaderDxt10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlags;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(PixelFormat) == 32, "DdsFormat::PixelFormat layout changed");
+	static_assert(sizeof(Header) == 124, "DdsFormat::Header layout changed");
+	static_assert(sizeof(HeaderDxt10) == 20, "DdsFormat::HeaderDxt10 layout changed");
+}
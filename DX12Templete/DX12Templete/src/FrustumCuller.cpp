@@ -0,0 +1,357 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC exposes every intrinsic regardless of /arch; GCC and Clang need per-function targets
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CULL_TARGET(features)
+#else
+#define CULL_TARGET(features) __attribute__((target(features)))
+#endif
+
+Frustum Frustum::FromViewProj(const float m[16])
+{
+	// Row vectors: clip = p * M, so each clip component is a column of M
+	float column[4][4];
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			column[c][r] = m[r * 4 + c];
+		}
+	}
+
+	Frustum frustum;
+	for (int i = 0; i < 4; i++)
+	{
+		frustum.planes[0][i] = column[3][i] + column[0][i]; // left
+		frustum.planes[1][i] = column[3][i] - column[0][i]; // right
+		frustum.planes[2][i] = column[3][i] + column[1][i]; // bottom
+		frustum.planes[3][i] = column[3][i] - column[1][i]; // top
+		frustum.planes[4][i] = column[2][i];                // near, z >= 0
+		frustum.planes[5][i] = column[3][i] - column[2][i]; // far
+	}
+	for (auto& plane : frustum.planes)
+	{
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (float& value : plane)
+		{
+			value /= length;
+		}
+	}
+	return frustum;
+}
+
+void CullingBounds::Resize(size_t count)
+{
+	mCount = count;
+	mCenterX.resize(count);
+	mCenterY.resize(count);
+	mCenterZ.resize(count);
+	mRadius.resize(count);
+	mExtentX.resize(count);
+	mExtentY.resize(count);
+	mExtentZ.resize(count);
+}
+
+void CullingBounds::Set(size_t index, const float center[3], const float extents[3])
+{
+	mCenterX[index] = center[0];
+	mCenterY[index] = center[1];
+	mCenterZ[index] = center[2];
+	mExtentX[index] = extents[0];
+	mExtentY[index] = extents[1];
+	mExtentZ[index] = extents[2];
+	mRadius[index] = std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]);
+}
+
+static size_t CullScalar(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* out)
+{
+	size_t count = 0;
+	for (size_t i = begin; i < end; i++)
+	{
+		float cx = bounds.CenterX()[i];
+		float cy = bounds.CenterY()[i];
+		float cz = bounds.CenterZ()[i];
+		float r = bounds.Radius()[i];
+
+		bool visible = true;
+		for (const auto& plane : frustum.planes)
+		{
+			float d = plane[0] * cx + plane[1] * cy + plane[2] * cz + plane[3];
+			if (d < -r)
+			{
+				visible = false;
+				break;
+			}
+			if (d < r)
+			{
+				// The sphere straddles the plane; the box is never larger, so it decides
+				float projected = std::fabs(plane[0]) * bounds.ExtentX()[i] + std::fabs(plane[1]) * bounds.ExtentY()[i] + std::fabs(plane[2]) * bounds.ExtentZ()[i];
+				if (d + projected < 0.0f)
+				{
+					visible = false;
+					break;
+				}
+			}
+		}
+		if (visible)
+		{
+			out[count++] = uint32_t(i);
+		}
+	}
+	return count;
+}
+
+#if CULL_X86
+
+static inline unsigned CountTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return unsigned(index);
+#else
+	return unsigned(__builtin_ctz(mask));
+#endif
+}
+
+static inline size_t WriteIndices(uint32_t mask, size_t base, uint32_t* out)
+{
+	size_t count = 0;
+	while (mask)
+	{
+		out[count++] = uint32_t(base + CountTrailingZeros(mask));
+		mask &= mask - 1;
+	}
+	return count;
+}
+
+CULL_TARGET("avx2")
+static size_t CullAvx2(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* out)
+{
+	__m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++)
+	{
+		nx[p] = _mm256_set1_ps(frustum.planes[p][0]);
+		ny[p] = _mm256_set1_ps(frustum.planes[p][1]);
+		nz[p] = _mm256_set1_ps(frustum.planes[p][2]);
+		nw[p] = _mm256_set1_ps(frustum.planes[p][3]);
+		ax[p] = _mm256_set1_ps(std::fabs(frustum.planes[p][0]));
+		ay[p] = _mm256_set1_ps(std::fabs(frustum.planes[p][1]));
+		az[p] = _mm256_set1_ps(std::fabs(frustum.planes[p][2]));
+	}
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t count = 0;
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(bounds.CenterX() + i);
+		__m256 cy = _mm256_loadu_ps(bounds.CenterY() + i);
+		__m256 cz = _mm256_loadu_ps(bounds.CenterZ() + i);
+		__m256 r = _mm256_loadu_ps(bounds.Radius() + i);
+		__m256 negR = _mm256_sub_ps(zero, r);
+
+		__m256 d[6];
+		__m256 outside = zero;
+		__m256 straddle = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			d[p] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz[p], cz), nw[p]));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(d[p], negR, _CMP_LT_OQ));
+			straddle = _mm256_or_ps(straddle, _mm256_cmp_ps(d[p], r, _CMP_LT_OQ));
+		}
+
+		uint32_t outsideMask = uint32_t(_mm256_movemask_ps(outside));
+		if (uint32_t(_mm256_movemask_ps(straddle)) & ~outsideMask)
+		{
+			// Only groups with an object on a plane pay for the box test
+			__m256 ex = _mm256_loadu_ps(bounds.ExtentX() + i);
+			__m256 ey = _mm256_loadu_ps(bounds.ExtentY() + i);
+			__m256 ez = _mm256_loadu_ps(bounds.ExtentZ() + i);
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 projected = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d[p], projected), zero, _CMP_LT_OQ));
+			}
+			outsideMask = uint32_t(_mm256_movemask_ps(outside));
+		}
+
+		count += WriteIndices(~outsideMask & 0xffu, i, out + count);
+	}
+	return count + CullScalar(frustum, bounds, i, end, out + count);
+}
+
+CULL_TARGET("avx512f")
+static size_t CullAvx512(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* out)
+{
+	__m512 nx[6], ny[6], nz[6], nw[6];
+	for (int p = 0; p < 6; p++)
+	{
+		nx[p] = _mm512_set1_ps(frustum.planes[p][0]);
+		ny[p] = _mm512_set1_ps(frustum.planes[p][1]);
+		nz[p] = _mm512_set1_ps(frustum.planes[p][2]);
+		nw[p] = _mm512_set1_ps(frustum.planes[p][3]);
+	}
+	const __m512 zero = _mm512_setzero_ps();
+
+	size_t count = 0;
+	size_t i = begin;
+	for (; i + 16 <= end; i += 16)
+	{
+		__m512 cx = _mm512_loadu_ps(bounds.CenterX() + i);
+		__m512 cy = _mm512_loadu_ps(bounds.CenterY() + i);
+		__m512 cz = _mm512_loadu_ps(bounds.CenterZ() + i);
+		__m512 r = _mm512_loadu_ps(bounds.Radius() + i);
+		__m512 negR = _mm512_sub_ps(zero, r);
+
+		__m512 d[6];
+		__mmask16 outside = 0;
+		__mmask16 straddle = 0;
+		for (int p = 0; p < 6; p++)
+		{
+			d[p] = _mm512_fmadd_ps(nx[p], cx, _mm512_fmadd_ps(ny[p], cy, _mm512_fmadd_ps(nz[p], cz, nw[p])));
+			outside |= _mm512_cmp_ps_mask(d[p], negR, _CMP_LT_OQ);
+			straddle |= _mm512_cmp_ps_mask(d[p], r, _CMP_LT_OQ);
+		}
+
+		if (straddle & ~outside)
+		{
+			__m512 ex = _mm512_loadu_ps(bounds.ExtentX() + i);
+			__m512 ey = _mm512_loadu_ps(bounds.ExtentY() + i);
+			__m512 ez = _mm512_loadu_ps(bounds.ExtentZ() + i);
+			for (int p = 0; p < 6; p++)
+			{
+				__m512 projected = _mm512_fmadd_ps(_mm512_abs_ps(nx[p]), ex, _mm512_fmadd_ps(_mm512_abs_ps(ny[p]), ey, _mm512_mul_ps(_mm512_abs_ps(nz[p]), ez)));
+				outside |= _mm512_cmp_ps_mask(_mm512_add_ps(d[p], projected), zero, _CMP_LT_OQ);
+			}
+		}
+
+		count += WriteIndices(uint32_t(~outside) & 0xffffu, i, out + count);
+	}
+	return count + CullScalar(frustum, bounds, i, end, out + count);
+}
+
+static void DetectKernels(bool& avx2, bool& avx512)
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool ymmState = (xcr0 & 0x6) == 0x6;
+	bool zmmState = (xcr0 & 0xe6) == 0xe6;
+	avx2 = false;
+	avx512 = false;
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = ymmState && (info[1] & (1 << 5)) != 0;
+		avx512 = zmmState && (info[1] & (1 << 16)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	avx2 = __builtin_cpu_supports("avx2") != 0;
+	avx512 = __builtin_cpu_supports("avx512f") != 0;
+#endif
+}
+
+#endif
+
+FrustumCuller::FrustumCuller()
+{
+	SetKernel(Kernel::Auto);
+}
+
+void FrustumCuller::SetKernel(Kernel kernel)
+{
+	bool avx2 = false;
+	bool avx512 = false;
+#if CULL_X86
+	DetectKernels(avx2, avx512);
+#endif
+	if (kernel == Kernel::Auto || (kernel == Kernel::Avx512 && !avx512))
+	{
+		kernel = avx512 ? Kernel::Avx512 : Kernel::Avx2;
+	}
+	if (kernel == Kernel::Avx2 && !avx2)
+	{
+		kernel = Kernel::Scalar;
+	}
+
+	mKernel = kernel;
+	mFunction = CullScalar;
+#if CULL_X86
+	if (kernel == Kernel::Avx2)
+	{
+		mFunction = CullAvx2;
+	}
+	else if (kernel == Kernel::Avx512)
+	{
+		mFunction = CullAvx512;
+	}
+#endif
+}
+
+const char* FrustumCuller::GetKernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Scalar: return "scalar";
+	case Kernel::Avx2: return "avx2";
+	case Kernel::Avx512: return "avx512";
+	default: return "auto";
+	}
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, const CullingBounds& bounds, JobSystem* jobs, std::vector<uint32_t>& visible)
+{
+	size_t count = bounds.GetCount();
+	visible.resize(count);
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	// Each chunk writes its survivors at its own offset, then the chunks are packed down in order
+	size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+	mChunkCounts.assign(chunkCount, 0);
+	KernelFunction function = mFunction;
+	auto cullChunks = [&](size_t begin, size_t end)
+	{
+		for (size_t offset = begin; offset < end; offset += ChunkSize)
+		{
+			size_t last = offset + ChunkSize < end ? offset + ChunkSize : end;
+			mChunkCounts[offset / ChunkSize] = function(frustum, bounds, offset, last, visible.data() + offset);
+		}
+	};
+	if (jobs)
+	{
+		jobs->ParallelFor(count, ChunkSize, cullChunks);
+	}
+	else
+	{
+		cullChunks(0, count);
+	}
+
+	size_t written = mChunkCounts[0];
+	for (size_t chunk = 1; chunk < chunkCount; chunk++)
+	{
+		memmove(visible.data() + written, visible.data() + chunk * ChunkSize, mChunkCounts[chunk] * sizeof(uint32_t));
+		written += mChunkCounts[chunk];
+	}
+	visible.resize(written);
+	return written;
+}
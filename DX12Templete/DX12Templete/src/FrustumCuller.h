@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Six normalized planes, inside where dot(n, p) + w >= 0
+struct Frustum
+{
+	float planes[6][4];
+
+	// m is a row-major view-projection matrix for row vectors (DirectXMath layout, clip z in [0, 1])
+	static Frustum FromViewProj(const float m[16]);
+};
+
+// World-space bounds as structure of arrays: a sphere for the cheap test and an AABB
+// (centre shared with the sphere) to refine objects the sphere says straddle a plane
+class CullingBounds
+{
+public:
+	void Resize(size_t count);
+	size_t GetCount() const { return mCount; }
+
+	void Set(size_t index, const float center[3], const float extents[3]);
+
+	const float* CenterX() const { return mCenterX.data(); }
+	const float* CenterY() const { return mCenterY.data(); }
+	const float* CenterZ() const { return mCenterZ.data(); }
+	const float* Radius() const { return mRadius.data(); }
+	const float* ExtentX() const { return mExtentX.data(); }
+	const float* ExtentY() const { return mExtentY.data(); }
+	const float* ExtentZ() const { return mExtentZ.data(); }
+
+private:
+	size_t mCount = 0;
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mRadius;
+	std::vector<float> mExtentX;
+	std::vector<float> mExtentY;
+	std::vector<float> mExtentZ;
+};
+
+// Tests 16 (AVX-512), 8 (AVX2) or 1 object per step, picked from the CPU at runtime,
+// and splits large inputs across a JobSystem
+class FrustumCuller
+{
+public:
+	enum class Kernel
+	{
+		Auto,
+		Scalar,
+		Avx2,
+		Avx512,
+	};
+
+	static constexpr size_t ChunkSize = 16384;
+
+	FrustumCuller();
+
+	// Forcing a kernel the CPU lacks falls back to the best supported one
+	void SetKernel(Kernel kernel);
+	Kernel GetKernel() const { return mKernel; }
+	static const char* GetKernelName(Kernel kernel);
+
+	// Fills visible with the indices of objects inside the frustum, in ascending order
+	size_t Cull(const Frustum& frustum, const CullingBounds& bounds, JobSystem* jobs, std::vector<uint32_t>& visible);
+
+private:
+	typedef size_t(*KernelFunction)(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* out);
+
+	Kernel mKernel;
+	KernelFunction mFunction;
+	std::vector<size_t> mChunkCounts;
+};
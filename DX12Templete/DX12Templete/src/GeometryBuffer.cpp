@@ -0,0 +1,330 @@
+#include "GeometryBuffer.h"
+#include "d3dx12.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+
+static constexpr UINT64 MinRingSize = 64 << 10;
+static constexpr UINT64 RingAlignment = 16;
+
+static UINT64 AlignRing(UINT64 size)
+{
+	return (size + RingAlignment - 1) & ~(RingAlignment - 1);
+}
+
+HRESULT GeometryBuffer::Create(ID3D12Device5Ptr device, UINT vertexStride, UINT vertexCapacity, UINT indexCapacity)
+{
+	// A reload replaces the buffers; they still go through the fence like any other
+	for (Pool* pool : { &mVertices, &mIndices })
+	{
+		if (pool->buffer)
+		{
+			mReplaced.push_back(pool->buffer);
+		}
+		if (pool->growSource)
+		{
+			mReplaced.push_back(pool->growSource);
+		}
+	}
+
+	mDevice = device;
+	mVertices = Pool();
+	mIndices = Pool();
+	mVertices.elementSize = vertexStride;
+	mIndices.elementSize = sizeof(uint16_t);
+	// Drawn through the input assembler, and read as raw buffers by the pulling, mesh and ray tracing paths
+	mVertices.readState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	mIndices.readState = D3D12_RESOURCE_STATE_INDEX_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	mRetired.clear();
+
+	HRESULT hr = Resize(mVertices, std::max<UINT>(vertexCapacity, 1));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	hr = Resize(mIndices, std::max<UINT>(indexCapacity, 1));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	return ResizeRing(std::max(UINT64(vertexCapacity) * vertexStride + UINT64(indexCapacity) * sizeof(uint16_t), MinRingSize));
+}
+
+HRESULT GeometryBuffer::Add(const void* vertices, UINT vertexCount, const uint16_t* indices, UINT indexCount, GeometryRange* out)
+{
+	if (vertexCount == 0 || indexCount == 0 || !FitsIndex16(vertexCount))
+	{
+		return E_INVALIDARG;
+	}
+
+	GeometryRange range;
+	range.vertexCount = vertexCount;
+	range.indexCount = indexCount;
+	HRESULT hr = Reserve(mVertices, vertexCount, &range.baseVertex);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	hr = Reserve(mIndices, indexCount, &range.startIndex);
+	if (FAILED(hr))
+	{
+		mVertices.allocator.Free(range.baseVertex, vertexCount);
+		return hr;
+	}
+
+	hr = Stage(mVertices, range.baseVertex, vertices, vertexCount);
+	if (SUCCEEDED(hr))
+	{
+		hr = Stage(mIndices, range.startIndex, indices, indexCount);
+	}
+	if (FAILED(hr))
+	{
+		// A staged vertex copy still lands, but only in a range that is free again
+		mVertices.allocator.Free(range.baseVertex, vertexCount);
+		mIndices.allocator.Free(range.startIndex, indexCount);
+		return hr;
+	}
+	*out = range;
+	return S_OK;
+}
+
+void GeometryBuffer::RecordUploads(ID3D12GraphicsCommandList* cmdList, uint64_t fenceValue)
+{
+	RecordCopies(cmdList, mVertices);
+	RecordCopies(cmdList, mIndices);
+
+	// Everything the copies read, and every buffer an earlier list may still draw from, waits for the fence
+	for (ID3D12ResourcePtr& buffer : mReplaced)
+	{
+		mRetiredBuffers.emplace_back(buffer, fenceValue);
+	}
+	mReplaced.clear();
+	UINT64 recordedHead = mRingFences.empty() ? mRingTail : mRingFences.back().first;
+	if (mRingHead != recordedHead)
+	{
+		mRingFences.emplace_back(mRingHead, fenceValue);
+	}
+}
+
+void GeometryBuffer::RecordCopies(ID3D12GraphicsCommandList* cmdList, Pool& pool)
+{
+	// A new buffer still has to leave COPY_DEST, even with nothing to copy
+	if (!pool.growSource && pool.uploads.empty() && pool.state == pool.readState)
+	{
+		return;
+	}
+
+	D3D12_RESOURCE_BARRIER toCopy[2];
+	UINT barrierCount = 0;
+	if (pool.state != D3D12_RESOURCE_STATE_COPY_DEST)
+	{
+		toCopy[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(pool.buffer, pool.state, D3D12_RESOURCE_STATE_COPY_DEST);
+	}
+	if (pool.growSource && pool.growSourceState != D3D12_RESOURCE_STATE_COPY_SOURCE)
+	{
+		toCopy[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(pool.growSource, pool.growSourceState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	}
+	if (barrierCount > 0)
+	{
+		cmdList->ResourceBarrier(barrierCount, toCopy);
+	}
+
+	// The old contents first, so the meshes staged since land on top
+	if (pool.growSource)
+	{
+		cmdList->CopyBufferRegion(pool.buffer, 0, pool.growSource, 0, pool.growBytes);
+		mReplaced.push_back(pool.growSource);
+		pool.growSource = nullptr;
+	}
+	for (const Upload& upload : pool.uploads)
+	{
+		cmdList->CopyBufferRegion(pool.buffer, upload.destinationOffset, upload.source, upload.sourceOffset, upload.size);
+	}
+	pool.uploads.clear();
+
+	D3D12_RESOURCE_BARRIER toRead = CD3DX12_RESOURCE_BARRIER::Transition(pool.buffer, D3D12_RESOURCE_STATE_COPY_DEST, pool.readState);
+	cmdList->ResourceBarrier(1, &toRead);
+	pool.state = pool.readState;
+}
+
+void GeometryBuffer::RemoveAfter(const GeometryRange& range, uint64_t fenceValue)
+{
+	mRetired.emplace_back(range, fenceValue);
+}
+
+void GeometryBuffer::ReleaseRetired(uint64_t completedFenceValue)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < mRetired.size(); i++)
+	{
+		if (mRetired[i].second > completedFenceValue)
+		{
+			mRetired[kept++] = mRetired[i];
+			continue;
+		}
+		const GeometryRange& range = mRetired[i].first;
+		mVertices.allocator.Free(range.baseVertex, range.vertexCount);
+		mIndices.allocator.Free(range.startIndex, range.indexCount);
+	}
+	mRetired.resize(kept);
+
+	mRetiredBuffers.erase(std::remove_if(mRetiredBuffers.begin(), mRetiredBuffers.end(),
+		[completedFenceValue](const std::pair<ID3D12ResourcePtr, uint64_t>& buffer) { return buffer.second <= completedFenceValue; }), mRetiredBuffers.end());
+
+	size_t done = 0;
+	while (done < mRingFences.size() && mRingFences[done].second <= completedFenceValue)
+	{
+		mRingTail = mRingFences[done].first;
+		done++;
+	}
+	mRingFences.erase(mRingFences.begin(), mRingFences.begin() + done);
+}
+
+void GeometryBuffer::Clear()
+{
+	mVertices.allocator.Reset(mVertices.allocator.GetCapacity());
+	mIndices.allocator.Reset(mIndices.allocator.GetCapacity());
+	// Staged meshes are dropped with their ranges; the ring space comes back with the next fence
+	mVertices.uploads.clear();
+	mIndices.uploads.clear();
+	mRetired.clear();
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryBuffer::GetVertexBufferView() const
+{
+	D3D12_VERTEX_BUFFER_VIEW view = {};
+	view.BufferLocation = mVertices.buffer->GetGPUVirtualAddress();
+	view.StrideInBytes = mVertices.elementSize;
+	view.SizeInBytes = mVertices.allocator.GetCapacity() * mVertices.elementSize;
+	return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryBuffer::GetIndexBufferView() const
+{
+	D3D12_INDEX_BUFFER_VIEW view = {};
+	view.BufferLocation = mIndices.buffer->GetGPUVirtualAddress();
+	view.SizeInBytes = mIndices.allocator.GetCapacity() * mIndices.elementSize;
+	view.Format = DXGI_FORMAT_R16_UINT;
+	return view;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS GeometryBuffer::GetVertexAddress(const GeometryRange& range) const
+{
+	return mVertices.buffer->GetGPUVirtualAddress() + UINT64(range.baseVertex) * mVertices.elementSize;
+}
+
+HRESULT GeometryBuffer::Resize(Pool& pool, UINT capacity)
+{
+	ID3D12ResourcePtr buffer;
+	HRESULT hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(UINT64(capacity) * pool.elementSize),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&buffer)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Live ranges keep their offsets, so the GeometryRange every mesh holds stays valid. The GPU copies
+	// them from the last buffer it filled; one grown into since never held more than the staged uploads.
+	if (pool.buffer)
+	{
+		if (!pool.growSource)
+		{
+			pool.growSource = pool.buffer;
+			pool.growSourceState = pool.state;
+			pool.growBytes = UINT64(pool.allocator.GetCapacity()) * pool.elementSize;
+		}
+		else
+		{
+			mReplaced.push_back(pool.buffer);
+		}
+	}
+	pool.buffer = buffer;
+	pool.state = D3D12_RESOURCE_STATE_COPY_DEST;
+	pool.allocator.Grow(capacity);
+	return S_OK;
+}
+
+HRESULT GeometryBuffer::Reserve(Pool& pool, UINT count, uint32_t* offset)
+{
+	*offset = pool.allocator.Allocate(count);
+	if (*offset != RangeAllocator::InvalidOffset)
+	{
+		return S_OK;
+	}
+	UINT capacity = pool.allocator.GetCapacity();
+	HRESULT hr = Resize(pool, std::max(capacity * 2, capacity + count));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	*offset = pool.allocator.Allocate(count);
+	return *offset != RangeAllocator::InvalidOffset ? S_OK : E_OUTOFMEMORY;
+}
+
+HRESULT GeometryBuffer::Stage(Pool& pool, uint32_t offset, const void* data, UINT count)
+{
+	UINT64 size = UINT64(count) * pool.elementSize;
+	UINT64 space = AlignRing(size);
+	// Allocations never wrap; the end of the ring is skipped when this one does not fit there
+	UINT64 start = mRingHead % mRingCapacity;
+	UINT64 skip = start + space > mRingCapacity ? mRingCapacity - start : 0;
+	if (mRingHead + skip + space - mRingTail > mRingCapacity)
+	{
+		HRESULT hr = ResizeRing(std::max(mRingCapacity * 2, space));
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+		skip = 0;
+	}
+	mRingHead += skip;
+	UINT64 ringOffset = mRingHead % mRingCapacity;
+	memcpy(mRingData + ringOffset, data, size_t(size));
+	mRingHead += space;
+	pool.uploads.push_back({ mRing, ringOffset, UINT64(offset) * pool.elementSize, size });
+	return S_OK;
+}
+
+HRESULT GeometryBuffer::ResizeRing(UINT64 capacity)
+{
+	capacity = AlignRing(capacity);
+	ID3D12ResourcePtr ring;
+	HRESULT hr = mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(capacity),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&ring)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	UINT8* data;
+	CD3DX12_RANGE range(0, 0);
+	hr = ring->Map(0, &range, reinterpret_cast<void**>(&data));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Staged copies keep the old ring alive until they are recorded, and the fence after that
+	if (mRing)
+	{
+		mReplaced.push_back(mRing);
+	}
+	mRing = ring;
+	mRingData = data;
+	mRingCapacity = capacity;
+	mRingHead = 0;
+	mRingTail = 0;
+	mRingFences.clear();
+	return S_OK;
+}
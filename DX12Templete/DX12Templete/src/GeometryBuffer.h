@@ -0,0 +1,101 @@
+#pragma once
+#include <Windows.h>
+#include <d3d12.h>
+#include <comdef.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "RangeAllocator.h"
+
+#define MAKE_SMART_COM_PTR(_a) _COM_SMARTPTR_TYPEDEF(_a, __uuidof(_a))
+MAKE_SMART_COM_PTR(ID3D12Device5);
+MAKE_SMART_COM_PTR(ID3D12Resource);
+
+// Where a mesh lives in a GeometryBuffer. Its indices count from its own first vertex, so draws pass
+// baseVertex as BaseVertexLocation and add startIndex to StartIndexLocation.
+struct GeometryRange
+{
+	uint32_t baseVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t startIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+// One vertex buffer and one 16-bit index buffer shared by every static mesh of a vertex format, so
+// the input assembler is bound once per frame instead of once per draw. Both live in default memory
+// and double when full. Add copies meshes into a persistently mapped upload ring, and RecordUploads
+// later copies them across on the GPU together with the old contents of any buffer that grew.
+//
+// Meshes the GPU may still be drawing are removed with RemoveAfter; their ranges are only reused
+// once ReleaseRetired sees the fence value, as with SlotMap. Replaced buffers and used ring space
+// are released the same way.
+class GeometryBuffer
+{
+public:
+	HRESULT Create(ID3D12Device5Ptr device, UINT vertexStride, UINT vertexCapacity, UINT indexCapacity);
+
+	// Stages the mesh for the next RecordUploads; the source may be freed on return. Fails with
+	// E_INVALIDARG when it has more vertices than 16-bit indices address; such meshes have to be
+	// split first. Growing replaces the buffers, so callers fetch views and addresses again afterwards.
+	// Touches no command list, so it may run on any one thread at a time.
+	HRESULT Add(const void* vertices, UINT vertexCount, const uint16_t* indices, UINT indexCount, GeometryRange* out);
+	// Records the staged copies ahead of anything in the list that reads the buffers, and leaves them
+	// readable. fenceValue is the one signalled once the list has run.
+	void RecordUploads(ID3D12GraphicsCommandList* cmdList, uint64_t fenceValue);
+	void RemoveAfter(const GeometryRange& range, uint64_t fenceValue);
+	void ReleaseRetired(uint64_t completedFenceValue);
+	void Clear();
+
+	D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const;
+	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const;
+	// First vertex of a mesh, for raw buffer reads and acceleration structure builds
+	D3D12_GPU_VIRTUAL_ADDRESS GetVertexAddress(const GeometryRange& range) const;
+	UINT GetVertexStride() const { return mVertices.elementSize; }
+
+private:
+	// A staged copy from the upload ring
+	struct Upload
+	{
+		ID3D12ResourcePtr source;
+		UINT64 sourceOffset;
+		UINT64 destinationOffset;
+		UINT64 size;
+	};
+
+	struct Pool
+	{
+		RangeAllocator allocator;
+		ID3D12ResourcePtr buffer;
+		D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COPY_DEST;
+		D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_COMMON;
+		UINT elementSize = 0;
+		// The last buffer the GPU holds the contents of, when it has grown since; its first growBytes
+		// are copied into the new buffer ahead of the uploads
+		ID3D12ResourcePtr growSource;
+		D3D12_RESOURCE_STATES growSourceState = D3D12_RESOURCE_STATE_COMMON;
+		UINT64 growBytes = 0;
+		std::vector<Upload> uploads;
+	};
+
+	HRESULT Resize(Pool& pool, UINT capacity);
+	HRESULT Reserve(Pool& pool, UINT count, uint32_t* offset);
+	HRESULT Stage(Pool& pool, uint32_t offset, const void* data, UINT count);
+	HRESULT ResizeRing(UINT64 capacity);
+	void RecordCopies(ID3D12GraphicsCommandList* cmdList, Pool& pool);
+
+	ID3D12Device5Ptr mDevice;
+	Pool mVertices;
+	Pool mIndices;
+	std::vector<std::pair<GeometryRange, uint64_t>> mRetired;
+
+	// Upload ring; head and tail count bytes ever allocated and released, so head - tail is in use
+	ID3D12ResourcePtr mRing;
+	UINT8* mRingData = nullptr;
+	UINT64 mRingCapacity = 0;
+	UINT64 mRingHead = 0;
+	UINT64 mRingTail = 0;
+	std::vector<std::pair<UINT64, uint64_t>> mRingFences; // ring head as of each RecordUploads
+	// Buffers no list reads any more once their fence value is reached
+	std::vector<ID3D12ResourcePtr> mReplaced;
+	std::vector<std::pair<ID3D12ResourcePtr, uint64_t>> mRetiredBuffers;
+};
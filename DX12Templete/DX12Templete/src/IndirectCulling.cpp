@@ -0,0 +1,166 @@
+#include "IndirectCulling.h"
+#include "FrustumCuller.h"
+#include "SoftwareOcclusion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void StoreCullConstants(const float viewProj[16], const Frustum& frustum, const SoftwareOcclusion& occlusion,
+	uint64_t objectConstantsAddress, uint32_t objectConstantsStride, uint32_t instanceCount,
+	CullConstants* out, std::vector<float>& hiz)
+{
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out->viewProj[c * 4 + r] = viewProj[r * 4 + c];
+		}
+	}
+	memcpy(out->frustumPlanes, frustum.planes, sizeof(out->frustumPlanes));
+	out->instanceCount = instanceCount;
+	out->screenWidth = float(occlusion.GetWidth());
+	out->screenHeight = float(occlusion.GetHeight());
+	out->objectConstantsAddress[0] = uint32_t(objectConstantsAddress);
+	out->objectConstantsAddress[1] = uint32_t(objectConstantsAddress >> 32);
+	out->objectConstantsStride = objectConstantsStride;
+	out->tileSize = SoftwareOcclusion::TileSize;
+
+	hiz.clear();
+	out->hizLevelCount = uint32_t(std::min<size_t>(occlusion.GetHierarchyLevelCount(), MaxHiZLevels));
+	for (uint32_t level = 0; level < out->hizLevelCount; level++)
+	{
+		int width;
+		int height;
+		const float* depth = occlusion.GetHierarchyLevel(level, width, height);
+		out->hizLevels[level] = { uint32_t(width), uint32_t(height), uint32_t(hiz.size()), 0 };
+		hiz.insert(hiz.end(), depth, depth + size_t(width) * height);
+	}
+}
+
+// FrustumCuller's scalar test
+static bool IsInsideFrustum(const CullConstants& constants, const CullInstance& instance)
+{
+	float radius = std::sqrt(instance.extents[0] * instance.extents[0] + instance.extents[1] * instance.extents[1] + instance.extents[2] * instance.extents[2]);
+	for (const auto& plane : constants.frustumPlanes)
+	{
+		float d = plane[0] * instance.center[0] + plane[1] * instance.center[1] + plane[2] * instance.center[2] + plane[3];
+		if (d < -radius)
+		{
+			return false;
+		}
+		if (d < radius)
+		{
+			float projected = std::fabs(plane[0]) * instance.extents[0] + std::fabs(plane[1]) * instance.extents[1] + std::fabs(plane[2]) * instance.extents[2];
+			if (d + projected < 0.0f)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// SoftwareOcclusion::IsOccluded over the flattened pyramid
+static bool IsOccluded(const CullConstants& constants, const CullInstance& instance, const float* hiz)
+{
+	if (constants.hizLevelCount == 0)
+	{
+		return false;
+	}
+
+	float minX = INFINITY;
+	float minY = INFINITY;
+	float maxX = -INFINITY;
+	float maxY = -INFINITY;
+	float minZ = INFINITY;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float p[3] =
+		{
+			instance.center[0] + ((corner & 1) ? instance.extents[0] : -instance.extents[0]),
+			instance.center[1] + ((corner & 2) ? instance.extents[1] : -instance.extents[1]),
+			instance.center[2] + ((corner & 4) ? instance.extents[2] : -instance.extents[2]),
+		};
+		float clip[4];
+		for (int c = 0; c < 4; c++)
+		{
+			const float* row = &constants.viewProj[c * 4];
+			clip[c] = p[0] * row[0] + p[1] * row[1] + p[2] * row[2] + row[3];
+		}
+		if (clip[2] < 0.0f || clip[3] <= 0.0f)
+		{
+			return false;
+		}
+		float invW = 1.0f / clip[3];
+		float x = (clip[0] * invW * 0.5f + 0.5f) * constants.screenWidth;
+		float y = (0.5f - clip[1] * invW * 0.5f) * constants.screenHeight;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip[2] * invW);
+	}
+
+	int width = int(constants.screenWidth);
+	int height = int(constants.screenHeight);
+	int tileSize = int(constants.tileSize);
+	int tileMinX = std::max(0, int(std::floor(minX))) / tileSize;
+	int tileMinY = std::max(0, int(std::floor(minY))) / tileSize;
+	int tileMaxX = std::min(width - 1, int(std::ceil(maxX))) / tileSize;
+	int tileMaxY = std::min(height - 1, int(std::ceil(maxY))) / tileSize;
+	if (maxX < 0.0f || maxY < 0.0f || minX > float(width) || minY > float(height))
+	{
+		return false;
+	}
+
+	uint32_t level = 0;
+	while ((tileMaxX - tileMinX > 3 || tileMaxY - tileMinY > 3) && level + 1 < constants.hizLevelCount)
+	{
+		tileMinX >>= 1;
+		tileMinY >>= 1;
+		tileMaxX >>= 1;
+		tileMaxY >>= 1;
+		level++;
+	}
+
+	const HiZLevel& hizLevel = constants.hizLevels[level];
+	for (int y = tileMinY; y <= tileMaxY; y++)
+	{
+		for (int x = tileMinX; x <= tileMaxX; x++)
+		{
+			if (hiz[hizLevel.offset + y * hizLevel.width + x] >= minZ)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+size_t CullInstancesReference(const CullConstants& constants, const CullInstance* instances, const float* hiz, IndirectDrawCommand* out)
+{
+	size_t count = 0;
+	for (uint32_t i = 0; i < constants.instanceCount; i++)
+	{
+		const CullInstance& instance = instances[i];
+		if (!IsInsideFrustum(constants, instance) || IsOccluded(constants, instance, hiz))
+		{
+			continue;
+		}
+
+		// 64-bit address arithmetic in 32-bit halves, as the shader does it
+		uint32_t offset = instance.objectIndex * constants.objectConstantsStride;
+		uint32_t low = constants.objectConstantsAddress[0] + offset;
+		uint32_t high = constants.objectConstantsAddress[1] + (low < offset ? 1 : 0);
+
+		IndirectDrawCommand& command = out[count++];
+		command.objectConstants = uint64_t(low) | (uint64_t(high) << 32);
+		command.indexCountPerInstance = instance.indexCount;
+		command.instanceCount = 1;
+		command.startIndexLocation = instance.startIndex;
+		command.baseVertexLocation = instance.baseVertex;
+		command.startInstanceLocation = 0;
+		command.pad = 0;
+	}
+	return count;
+}
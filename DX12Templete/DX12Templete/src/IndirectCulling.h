@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CbufferLayout.h"
+
+struct Frustum;
+class SoftwareOcclusion;
+
+// CPU mirrors of the buffers used by resource/CullInstances.hlsl, plus a reference implementation
+// of the shader. The compute pass reads one CullInstance per object, tests it against the frustum
+// and the occlusion pyramid, and appends an IndirectDrawCommand for every survivor.
+// Matrices are stored transposed for HLSL's default column-major packing.
+
+static constexpr uint32_t CullThreadGroupSize = 64;
+static constexpr uint32_t MaxHiZLevels = 16;
+
+struct CullInstance
+{
+	float center[3];
+	uint32_t objectIndex;   // selects the ObjectConstants the draw binds
+	float extents[3];
+	uint32_t indexCount;
+	uint32_t startIndex;    // where the object's indices and vertices live in the shared geometry buffer
+	int32_t baseVertex;
+	uint32_t pad[2];
+};
+static_assert(sizeof(CullInstance) == 48, "CullInstance must match the HLSL structure");
+
+// Laid out as the command signature expects: root CBV, then DrawIndexed. The vertex and index
+// buffers are the shared ones, bound once before ExecuteIndirect.
+struct IndirectDrawCommand
+{
+	uint64_t objectConstants;
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+	uint32_t pad;
+};
+static_assert(sizeof(IndirectDrawCommand) == 32, "IndirectDrawCommand must match the HLSL structure");
+
+struct HiZLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t offset;        // first texel in the flattened pyramid
+	uint32_t pad;
+};
+
+// b0 of CullInstances.hlsl
+struct CullConstants
+{
+	float viewProj[16];
+	float frustumPlanes[6][4];
+	uint32_t instanceCount;
+	uint32_t hizLevelCount;
+	float screenWidth;
+	float screenHeight;
+	uint32_t objectConstantsAddress[2];
+	uint32_t objectConstantsStride;
+	uint32_t tileSize;
+	HiZLevel hizLevels[MaxHiZLevels];
+};
+static_assert(sizeof(CullConstants) == 448, "CullConstants must match the HLSL cbuffer");
+static_assert(MatchesCbufferPacking({
+	CBUFFER_MEMBER(CullConstants, viewProj),
+	CBUFFER_MEMBER(CullConstants, frustumPlanes),
+	CBUFFER_MEMBER(CullConstants, instanceCount),
+	CBUFFER_MEMBER(CullConstants, hizLevelCount),
+	CBUFFER_MEMBER(CullConstants, screenWidth),
+	CBUFFER_MEMBER(CullConstants, screenHeight),
+	CBUFFER_MEMBER(CullConstants, objectConstantsAddress),
+	CBUFFER_MEMBER(CullConstants, objectConstantsStride),
+	CBUFFER_MEMBER(CullConstants, tileSize),
+	CBUFFER_MEMBER(CullConstants, hizLevels),
+	}, sizeof(CullConstants)), "CullConstants does not match the HLSL cbuffer packing");
+
+// viewProj is row-major for row vectors (DirectXMath layout); the occlusion pyramid is flattened into hiz
+void StoreCullConstants(const float viewProj[16], const Frustum& frustum, const SoftwareOcclusion& occlusion,
+	uint64_t objectConstantsAddress, uint32_t objectConstantsStride, uint32_t instanceCount,
+	CullConstants* out, std::vector<float>& hiz);
+
+// Same tests as the shader, compacted in instance order. The GPU appends a wave at a time, so its
+// commands are the same set in a different order. Returns the number of commands written.
+size_t CullInstancesReference(const CullConstants& constants, const CullInstance* instances, const float* hiz, IndirectDrawCommand* out);
@@ -0,0 +1,102 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+unsigned JobSystem::DefaultWorkerCount()
+{
+	// The calling thread takes part in every loop, so leave one core for it
+	unsigned cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 0;
+}
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	mWorkers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		mWorkers.emplace_back(&JobSystem::WorkerMain, this);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWake.notify_all();
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	grain = std::max<size_t>(grain, 1);
+	size_t chunkCount = (count + grain - 1) / grain;
+	if (chunkCount <= 1 || mWorkers.empty())
+	{
+		if (count > 0)
+		{
+			fn(0, count);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFunction = &fn;
+		mCount = count;
+		mGrain = grain;
+		mChunkCount = chunkCount;
+		mNextChunk.store(0);
+		mPending = unsigned(mWorkers.size());
+		mGeneration++;
+	}
+	mWake.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDone.wait(lock, [this] { return mPending == 0; });
+	mFunction = nullptr;
+}
+
+void JobSystem::RunChunks()
+{
+	for (;;)
+	{
+		size_t chunk = mNextChunk.fetch_add(1);
+		if (chunk >= mChunkCount)
+		{
+			return;
+		}
+		size_t begin = chunk * mGrain;
+		size_t end = std::min(begin + mGrain, mCount);
+		(*mFunction)(begin, end);
+	}
+}
+
+void JobSystem::WorkerMain()
+{
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWake.wait(lock, [&] { return mStop || mGeneration != seen; });
+		if (mStop)
+		{
+			return;
+		}
+		seen = mGeneration;
+
+		lock.unlock();
+		RunChunks();
+		lock.lock();
+
+		if (--mPending == 0)
+		{
+			mDone.notify_one();
+		}
+	}
+}
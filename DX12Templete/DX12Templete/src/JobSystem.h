@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads for data-parallel loops over arrays.
+// ParallelFor is meant to be called from one thread at a time (the frame thread), which
+// also works on the loop instead of sleeping.
+class JobSystem
+{
+public:
+	static unsigned DefaultWorkerCount();
+
+	explicit JobSystem(unsigned workerCount = DefaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned GetWorkerCount() const { return unsigned(mWorkers.size()); }
+
+	// Calls fn(begin, end) over [0, count) in chunks of grain and returns once every chunk ran
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+	void WorkerMain();
+	void RunChunks();
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+	uint64_t mGeneration = 0;
+	unsigned mPending = 0;
+	bool mStop = false;
+
+	const std::function<void(size_t, size_t)>* mFunction = nullptr;
+	size_t mCount = 0;
+	size_t mGrain = 0;
+	size_t mChunkCount = 0;
+	std::atomic<size_t> mNextChunk{ 0 };
+};
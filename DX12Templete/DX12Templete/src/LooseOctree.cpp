@@ -0,0 +1,391 @@
+#include "LooseOctree.h"
+#include <algorithm>
+#include <cmath>
+
+static uint64_t PackCell(int level, uint32_t x, uint32_t y, uint32_t z)
+{
+	return (uint64_t(level) << 48) | (uint64_t(x) << 32) | (uint64_t(y) << 16) | uint64_t(z);
+}
+
+LooseOctree::LooseOctree(const float center[3], float halfSize, int maxDepth)
+{
+	mRootCenter[0] = center[0];
+	mRootCenter[1] = center[1];
+	mRootCenter[2] = center[2];
+	mRootHalfSize = halfSize;
+	mMaxDepth = std::min(std::max(maxDepth, 0), MaxDepthLimit);
+	Clear();
+}
+
+void LooseOctree::Clear()
+{
+	mNodes.clear();
+	mFreeNodes.clear();
+	mObjects.clear();
+	mObjectCells.clear();
+	mObjectCount = 0;
+	AllocateNode(-1, mRootCenter, mRootHalfSize * 2.0f);
+}
+
+int32_t LooseOctree::AllocateNode(int32_t parent, const float center[3], float looseHalfSize)
+{
+	int32_t index;
+	if (!mFreeNodes.empty())
+	{
+		index = mFreeNodes.back();
+		mFreeNodes.pop_back();
+	}
+	else
+	{
+		index = int32_t(mNodes.size());
+		mNodes.emplace_back();
+	}
+
+	Node& node = mNodes[index];
+	node.center[0] = center[0];
+	node.center[1] = center[1];
+	node.center[2] = center[2];
+	node.looseHalfSize = looseHalfSize;
+	node.parent = parent;
+	std::fill(std::begin(node.children), std::end(node.children), -1);
+	node.subtreeCount = 0;
+	node.entries.clear();
+	return index;
+}
+
+void LooseOctree::ChooseCell(const float center[3], float radius, int& level, uint32_t& x, uint32_t& y, uint32_t& z) const
+{
+	// Deepest level whose cell half size is at least the radius
+	level = mMaxDepth;
+	if (radius > 0.0f)
+	{
+		level = std::min(mMaxDepth, std::max(0, int(std::floor(std::log2(mRootHalfSize / radius)))));
+	}
+
+	float minimum[3];
+	uint32_t cell[3];
+	uint32_t cells = 1u << level;
+	float cellSize = (2.0f * mRootHalfSize) / float(cells);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		minimum[axis] = mRootCenter[axis] - mRootHalfSize;
+		float offset = (center[axis] - minimum[axis]) / cellSize;
+		if (offset < 0.0f || offset >= float(cells))
+		{
+			// Outside the root cell: only the unbounded root can hold it
+			level = 0;
+			x = y = z = 0;
+			return;
+		}
+		cell[axis] = uint32_t(offset);
+	}
+	x = cell[0];
+	y = cell[1];
+	z = cell[2];
+}
+
+int32_t LooseOctree::FindOrCreateNode(int level, uint32_t x, uint32_t y, uint32_t z)
+{
+	int32_t node = 0;
+	for (int depth = 0; depth < level; depth++)
+	{
+		int shift = level - 1 - depth;
+		int octant = int((x >> shift) & 1) | (int((y >> shift) & 1) << 1) | (int((z >> shift) & 1) << 2);
+		int32_t child = mNodes[node].children[octant];
+		if (child < 0)
+		{
+			float childHalf = mNodes[node].looseHalfSize * 0.25f; // cell half of the child
+			float center[3] =
+			{
+				mNodes[node].center[0] + ((octant & 1) ? childHalf : -childHalf),
+				mNodes[node].center[1] + ((octant & 2) ? childHalf : -childHalf),
+				mNodes[node].center[2] + ((octant & 4) ? childHalf : -childHalf),
+			};
+			child = AllocateNode(node, center, childHalf * 2.0f);
+			mNodes[node].children[octant] = child;
+		}
+		node = child;
+	}
+	return node;
+}
+
+void LooseOctree::Update(uint32_t id, const float center[3], float radius)
+{
+	int level;
+	uint32_t x, y, z;
+	ChooseCell(center, radius, level, x, y, z);
+	uint64_t cell = PackCell(level, x, y, z);
+
+	if (id >= mObjects.size())
+	{
+		mObjects.resize(id + 1, { -1, 0 });
+		mObjectCells.resize(id + 1, 0);
+	}
+
+	ObjectRecord& record = mObjects[id];
+	if (record.node >= 0 && mObjectCells[id] == cell)
+	{
+		Entry& entry = mNodes[record.node].entries[record.entry];
+		entry.center[0] = center[0];
+		entry.center[1] = center[1];
+		entry.center[2] = center[2];
+		entry.radius = radius;
+		return;
+	}
+	if (record.node >= 0)
+	{
+		RemoveEntry(id);
+	}
+
+	int32_t node = FindOrCreateNode(level, x, y, z);
+	Entry entry = { { center[0], center[1], center[2] }, radius, id };
+	mObjects[id] = { node, uint32_t(mNodes[node].entries.size()) };
+	mObjectCells[id] = cell;
+	mNodes[node].entries.push_back(entry);
+	for (int32_t n = node; n >= 0; n = mNodes[n].parent)
+	{
+		mNodes[n].subtreeCount++;
+	}
+	mObjectCount++;
+}
+
+void LooseOctree::Remove(uint32_t id)
+{
+	if (Contains(id))
+	{
+		RemoveEntry(id);
+	}
+}
+
+void LooseOctree::RemoveEntry(uint32_t id)
+{
+	ObjectRecord record = mObjects[id];
+	std::vector<Entry>& entries = mNodes[record.node].entries;
+	if (record.entry != entries.size() - 1)
+	{
+		entries[record.entry] = entries.back();
+		mObjects[entries[record.entry].id].entry = record.entry;
+	}
+	entries.pop_back();
+	mObjects[id].node = -1;
+	mObjectCount--;
+
+	// Unlink subtrees that became empty so queries never descend into them
+	for (int32_t n = record.node; n >= 0;)
+	{
+		int32_t parent = mNodes[n].parent;
+		if (--mNodes[n].subtreeCount == 0 && parent >= 0)
+		{
+			int32_t* children = mNodes[parent].children;
+			std::replace(children, children + 8, n, -1);
+			mFreeNodes.push_back(n);
+		}
+		n = parent;
+	}
+}
+
+void LooseOctree::AddSubtree(int32_t node, std::vector<uint32_t>& out) const
+{
+	int32_t stack[8 * MaxDepthLimit + 1];
+	int top = 0;
+	stack[top++] = node;
+	while (top > 0)
+	{
+		const Node& current = mNodes[stack[--top]];
+		for (const Entry& entry : current.entries)
+		{
+			out.push_back(entry.id);
+		}
+		for (int32_t child : current.children)
+		{
+			if (child >= 0)
+			{
+				stack[top++] = child;
+			}
+		}
+	}
+}
+
+void LooseOctree::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+	int32_t stack[8 * MaxDepthLimit + 1];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		int32_t index = stack[--top];
+		const Node& node = mNodes[index];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+
+		bool inside = index != 0;
+		if (index != 0)
+		{
+			bool outside = false;
+			for (const auto& plane : frustum.planes)
+			{
+				float d = plane[0] * node.center[0] + plane[1] * node.center[1] + plane[2] * node.center[2] + plane[3];
+				float r = (std::fabs(plane[0]) + std::fabs(plane[1]) + std::fabs(plane[2])) * node.looseHalfSize;
+				if (d + r < 0.0f)
+				{
+					outside = true;
+					break;
+				}
+				inside = inside && d - r >= 0.0f;
+			}
+			if (outside)
+			{
+				continue;
+			}
+			if (inside)
+			{
+				AddSubtree(index, out);
+				continue;
+			}
+		}
+
+		for (const Entry& entry : node.entries)
+		{
+			bool visible = true;
+			for (const auto& plane : frustum.planes)
+			{
+				if (plane[0] * entry.center[0] + plane[1] * entry.center[1] + plane[2] * entry.center[2] + plane[3] < -entry.radius)
+				{
+					visible = false;
+					break;
+				}
+			}
+			if (visible)
+			{
+				out.push_back(entry.id);
+			}
+		}
+		for (int32_t child : node.children)
+		{
+			if (child >= 0)
+			{
+				stack[top++] = child;
+			}
+		}
+	}
+}
+
+void LooseOctree::QuerySphere(const float center[3], float radius, std::vector<uint32_t>& out) const
+{
+	int32_t stack[8 * MaxDepthLimit + 1];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		int32_t index = stack[--top];
+		const Node& node = mNodes[index];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+		if (index != 0)
+		{
+			// Squared distance from the sphere centre to the node box
+			float distance = 0.0f;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float offset = std::fabs(center[axis] - node.center[axis]) - node.looseHalfSize;
+				if (offset > 0.0f)
+				{
+					distance += offset * offset;
+				}
+			}
+			if (distance > radius * radius)
+			{
+				continue;
+			}
+		}
+
+		for (const Entry& entry : node.entries)
+		{
+			float dx = entry.center[0] - center[0];
+			float dy = entry.center[1] - center[1];
+			float dz = entry.center[2] - center[2];
+			float reach = entry.radius + radius;
+			if (dx * dx + dy * dy + dz * dz <= reach * reach)
+			{
+				out.push_back(entry.id);
+			}
+		}
+		for (int32_t child : node.children)
+		{
+			if (child >= 0)
+			{
+				stack[top++] = child;
+			}
+		}
+	}
+}
+
+void LooseOctree::QueryRay(const float origin[3], const float direction[3], float maxDistance, std::vector<uint32_t>& out) const
+{
+	float inverse[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		inverse[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : INFINITY;
+	}
+	float lengthSq = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+
+	int32_t stack[8 * MaxDepthLimit + 1];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		int32_t index = stack[--top];
+		const Node& node = mNodes[index];
+		if (node.subtreeCount == 0)
+		{
+			continue;
+		}
+		if (index != 0)
+		{
+			// Slab test against the loose box
+			float tMin = 0.0f;
+			float tMax = maxDistance;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (node.center[axis] - node.looseHalfSize - origin[axis]) * inverse[axis];
+				float t1 = (node.center[axis] + node.looseHalfSize - origin[axis]) * inverse[axis];
+				if (t0 > t1)
+				{
+					std::swap(t0, t1);
+				}
+				tMin = std::max(tMin, t0);
+				tMax = std::min(tMax, t1);
+			}
+			if (tMin > tMax)
+			{
+				continue;
+			}
+		}
+
+		for (const Entry& entry : node.entries)
+		{
+			// Closest approach of the segment to the sphere centre
+			float toCenter[3] = { entry.center[0] - origin[0], entry.center[1] - origin[1], entry.center[2] - origin[2] };
+			float t = (toCenter[0] * direction[0] + toCenter[1] * direction[1] + toCenter[2] * direction[2]) / lengthSq;
+			t = std::min(std::max(t, 0.0f), maxDistance);
+			float dx = toCenter[0] - direction[0] * t;
+			float dy = toCenter[1] - direction[1] * t;
+			float dz = toCenter[2] - direction[2] * t;
+			if (dx * dx + dy * dy + dz * dz <= entry.radius * entry.radius)
+			{
+				out.push_back(entry.id);
+			}
+		}
+		for (int32_t child : node.children)
+		{
+			if (child >= 0)
+			{
+				stack[top++] = child;
+			}
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FrustumCuller.h"
+
+// Broad-phase index over bounding spheres keyed by caller-chosen ids (dense small integers).
+//
+// Every node's bounds are twice the size of its cell, so an object is placed by its size and centre
+// alone: it goes to the deepest level whose cell half size still covers its radius, in the cell that
+// contains its centre. Insert and move therefore never test against neighbours and cost one walk
+// down the tree at most; a move inside the same cell only rewrites the stored sphere.
+// Nodes live in one array and keep their objects contiguous, so queries scan memory linearly
+// once they reach a node. Objects outside the root cell stay in the root, which queries never reject.
+class LooseOctree
+{
+public:
+	static constexpr int MaxDepthLimit = 16;
+
+	LooseOctree(const float center[3], float halfSize, int maxDepth = 8);
+
+	// Inserts the object, or moves it if the id is already present
+	void Update(uint32_t id, const float center[3], float radius);
+	void Remove(uint32_t id);
+	void Clear();
+	bool Contains(uint32_t id) const { return id < mObjects.size() && mObjects[id].node >= 0; }
+	size_t GetObjectCount() const { return mObjectCount; }
+
+	// Ids whose sphere may intersect the volume; objects in nodes fully inside are added without tests
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void QuerySphere(const float center[3], float radius, std::vector<uint32_t>& out) const;
+	void QueryRay(const float origin[3], const float direction[3], float maxDistance, std::vector<uint32_t>& out) const;
+
+private:
+	struct Entry
+	{
+		float center[3];
+		float radius;
+		uint32_t id;
+	};
+
+	struct Node
+	{
+		float center[3];
+		float looseHalfSize;
+		int32_t parent;
+		int32_t children[8];
+		uint32_t subtreeCount; // objects in this node and below; empty subtrees are unlinked
+		std::vector<Entry> entries;
+	};
+
+	struct ObjectRecord
+	{
+		int32_t node;
+		uint32_t entry;
+	};
+
+	int32_t FindOrCreateNode(int level, uint32_t x, uint32_t y, uint32_t z);
+	int32_t AllocateNode(int32_t parent, const float center[3], float looseHalfSize);
+	void ChooseCell(const float center[3], float radius, int& level, uint32_t& x, uint32_t& y, uint32_t& z) const;
+	void RemoveEntry(uint32_t id);
+	void AddSubtree(int32_t node, std::vector<uint32_t>& out) const;
+
+	float mRootCenter[3];
+	float mRootHalfSize;
+	int mMaxDepth;
+	size_t mObjectCount = 0;
+
+	std::vector<Node> mNodes;
+	std::vector<int32_t> mFreeNodes;
+	std::vector<ObjectRecord> mObjects;
+	// Cell each object was placed in, to detect moves that stay in place
+	std::vector<uint64_t> mObjectCells;
+};
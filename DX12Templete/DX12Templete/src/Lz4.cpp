@@ -0,0 +1,237 @@
+#include "Lz4.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static constexpr size_t MinMatch = 4;
+static constexpr size_t LastLiterals = 5;   // a block ends with at least this many literals
+static constexpr size_t MatchFindLimit = 12; // and its last match starts at least this far from the end
+static constexpr size_t MaxOffset = 65535;
+static constexpr unsigned HashLog = 14;
+static constexpr size_t WildCopy = 16;
+
+static inline uint32_t Read32(const uint8_t* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint32_t Hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HashLog);
+}
+
+// Writes length - base in LZ4's 255-continued form after a token nibble of 15
+static inline uint8_t* WriteLength(uint8_t* out, size_t length)
+{
+	while (length >= 255)
+	{
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = static_cast<uint8_t>(length);
+	return out;
+}
+
+static inline size_t LengthBytes(size_t length)
+{
+	return length >= 15 ? (length - 15) / 255 + 1 : 0;
+}
+
+static uint8_t* WriteSequence(uint8_t* out, const uint8_t* outEnd, const uint8_t* literals, size_t literalLength,
+	size_t offset, size_t matchLength)
+{
+	size_t needed = 1 + LengthBytes(literalLength) + literalLength + (matchLength ? 2 + LengthBytes(matchLength - MinMatch) : 0);
+	if (needed > size_t(outEnd - out))
+	{
+		return nullptr;
+	}
+	uint8_t* token = out++;
+	*token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+	if (literalLength >= 15)
+	{
+		out = WriteLength(out, literalLength - 15);
+	}
+	memcpy(out, literals, literalLength);
+	out += literalLength;
+	if (matchLength == 0)
+	{
+		return out;
+	}
+	*out++ = static_cast<uint8_t>(offset);
+	*out++ = static_cast<uint8_t>(offset >> 8);
+	size_t code = matchLength - MinMatch;
+	*token |= static_cast<uint8_t>(code >= 15 ? 15 : code);
+	if (code >= 15)
+	{
+		out = WriteLength(out, code - 15);
+	}
+	return out;
+}
+
+size_t Lz4Compress(const void* source, size_t sourceSize, void* destination, size_t capacity)
+{
+	const uint8_t* in = static_cast<const uint8_t*>(source);
+	uint8_t* out = static_cast<uint8_t*>(destination);
+	const uint8_t* outEnd = out + capacity;
+	size_t anchor = 0;
+
+	if (sourceSize > MatchFindLimit)
+	{
+		// Positions of the last few 4-byte sequences by hash. A stale or colliding entry costs one
+		// compare, so the table is never cleared beyond its first use.
+		std::vector<uint32_t> table(size_t(1) << HashLog, 0);
+		const size_t matchLimit = sourceSize - LastLiterals;
+		const size_t searchLimit = sourceSize - MatchFindLimit;
+		size_t position = 1;
+		table[Hash(Read32(in))] = 0;
+		while (position < searchLimit)
+		{
+			uint32_t sequence = Read32(in + position);
+			uint32_t& slot = table[Hash(sequence)];
+			size_t candidate = slot;
+			slot = static_cast<uint32_t>(position);
+			if (candidate >= position || position - candidate > MaxOffset || Read32(in + candidate) != sequence)
+			{
+				// Skip faster through data that does not compress
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			while (position > anchor && candidate > 0 && in[position - 1] == in[candidate - 1])
+			{
+				position--;
+				candidate--;
+			}
+			size_t length = MinMatch;
+			while (position + length < matchLimit && in[candidate + length] == in[position + length])
+			{
+				length++;
+			}
+
+			out = WriteSequence(out, outEnd, in + anchor, position - anchor, position - candidate, length);
+			if (!out)
+			{
+				return 0;
+			}
+			position += length;
+			anchor = position;
+			if (position < searchLimit)
+			{
+				table[Hash(Read32(in + position - 2))] = static_cast<uint32_t>(position - 2);
+			}
+		}
+	}
+
+	out = WriteSequence(out, outEnd, in + anchor, sourceSize - anchor, 0, 0);
+	return out ? size_t(out - static_cast<uint8_t*>(destination)) : 0;
+}
+
+// Reads a 255-continued length; false when it runs off the input or would overflow
+static inline bool ReadLength(const uint8_t*& in, const uint8_t* inEnd, size_t& length)
+{
+	uint8_t byte;
+	do
+	{
+		if (in >= inEnd)
+		{
+			return false;
+		}
+		byte = *in++;
+		length += byte;
+		if (length > (SIZE_MAX >> 2))
+		{
+			return false;
+		}
+	} while (byte == 255);
+	return true;
+}
+
+bool Lz4Decompress(const void* source, size_t sourceSize, void* destination, size_t destinationSize)
+{
+	const uint8_t* in = static_cast<const uint8_t*>(source);
+	const uint8_t* inEnd = in + sourceSize;
+	uint8_t* out = static_cast<uint8_t*>(destination);
+	uint8_t* const outBegin = out;
+	uint8_t* const outEnd = out + destinationSize;
+
+	for (;;)
+	{
+		if (in >= inEnd)
+		{
+			return false;
+		}
+		uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, inEnd, literalLength))
+		{
+			return false;
+		}
+		if (literalLength > size_t(inEnd - in) || literalLength > size_t(outEnd - out))
+		{
+			return false;
+		}
+		// Short runs copy a fixed 16 bytes when both buffers have room to spare; the overrun is
+		// overwritten by what follows
+		if (literalLength <= WildCopy && size_t(inEnd - in) >= WildCopy && size_t(outEnd - out) >= WildCopy)
+		{
+			memcpy(out, in, WildCopy);
+		}
+		else
+		{
+			memcpy(out, in, literalLength);
+		}
+		in += literalLength;
+		out += literalLength;
+
+		// The last sequence has no match
+		if (in == inEnd)
+		{
+			return out == outEnd;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+		size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > size_t(out - outBegin))
+		{
+			return false;
+		}
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (matchLength > size_t(outEnd - out))
+		{
+			return false;
+		}
+
+		const uint8_t* match = out - offset;
+		if (offset >= WildCopy && size_t(outEnd - out) >= matchLength + WildCopy)
+		{
+			for (size_t copied = 0; copied < matchLength; copied += WildCopy)
+			{
+				memcpy(out + copied, match + copied, WildCopy);
+			}
+			out += matchLength;
+		}
+		else
+		{
+			// Overlapping: the pattern doubles with every copy, and no copy overlaps its source
+			uint8_t* end = out + matchLength;
+			while (out < end)
+			{
+				size_t length = std::min<size_t>(size_t(end - out), size_t(out - match));
+				memcpy(out, match, length);
+				out += length;
+			}
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), so blocks are
+// interchangeable with the reference library. Greedy single-probe matching trades a little ratio for
+// compression speed; decompression is what loading pays for, and it runs at memory speed.
+
+// Largest compressed size of size bytes, for incompressible input
+inline size_t Lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+// Returns the compressed size, or 0 when it does not fit in capacity
+size_t Lz4Compress(const void* source, size_t sourceSize, void* destination, size_t capacity);
+
+// Decodes a whole block that must expand to exactly destinationSize bytes. Damaged input fails
+// instead of reading or writing out of bounds. Matches read back from destination, so it should be
+// ordinary cached memory; see CompressedStream for write-combined targets.
+bool Lz4Decompress(const void* source, size_t sourceSize, void* destination, size_t destinationSize);
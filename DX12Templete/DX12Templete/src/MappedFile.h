@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The view stays valid until Close() or destruction.
+// Paths are UTF-8 on every platform. Empty files cannot be mapped, so opening them fails.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return mData != nullptr; }
+	const void* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+private:
+#ifdef _WIN32
+	void* mFile = reinterpret_cast<void*>(-1); // INVALID_HANDLE_VALUE
+	void* mMapping = nullptr;
+#endif
+	const void* mData = nullptr;
+	size_t mSize = 0;
+};
+
+#ifdef _WIN32
+// UTF-8 <-> UTF-16 for the wide Win32 file APIs
+std::wstring WidenUtf8(const std::string& text);
+std::string NarrowUtf8(const std::wstring& text);
+#endif
@@ -0,0 +1,23 @@
+#include "MeshAsset.h"
+
+BOOL MeshAsset::Open(const VirtualFileSystem& files, const std::string& name)
+{
+	Close();
+
+	if (!files.Read(name, &mFile))
+	{
+		return FALSE;
+	}
+	if (!ReadMeshAsset(mFile.GetData(), mFile.GetSize(), &mView))
+	{
+		Close();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void MeshAsset::Close()
+{
+	mFile.Reset();
+	mView = MeshView();
+}
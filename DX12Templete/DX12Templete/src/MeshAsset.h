@@ -0,0 +1,22 @@
+#pragma once
+#include "stddef.h"
+#include "VirtualFileSystem.h"
+#include "MeshData.h"
+
+// A .mesh file, mapped once, loose or from a pack. The view points straight into the mapping, so the asset must stay open
+// while anything still reads it; meshes copy their vertices and indices into the geometry buffer.
+class MeshAsset
+{
+public:
+	MeshAsset() {}
+	~MeshAsset() { Close(); }
+
+	BOOL Open(const VirtualFileSystem& files, const std::string& name);
+	void Close();
+
+	BOOL IsOpen() const { return mFile.IsValid(); }
+	const MeshView& GetView() const { return mView; }
+private:
+	FileView mFile;
+	MeshView mView;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of a mesh asset (.mesh), written by tools/MeshConvert and mapped by MeshAsset.
+// Everything the renderer builds from a mesh is baked in: the encoded vertices, every LOD level's
+// indices, the meshlets of each level and the bounds, so loading is a mapping plus a few checks.
+//
+//   Header
+//   streams   each starting on a StreamAlignment boundary, in Stream order
+namespace MeshAssetFormat
+{
+	static constexpr uint32_t Magic = 0x4853454d; // "MESH"
+	static constexpr uint32_t Version = 1;
+	static constexpr uint32_t StreamAlignment = 64;
+	static constexpr uint32_t MaxVertexElements = 8;
+
+	enum Stream : uint32_t
+	{
+		VertexStream,            // vertexCount * vertexStride bytes, encoded with the header's elements
+		IndexStream,             // indexCount * indexSize bytes, every LOD level one after another
+		LodStream,               // MeshLod[lodCount]
+		LodMeshletOffsetStream,  // uint32_t[lodCount + 1]: each level's first meshlet, then the end
+		MeshletStream,           // Meshlet[meshletCount]
+		MeshletBoundsStream,     // MeshletBounds[meshletCount]
+		MeshletVertexStream,     // uint32_t[meshletVertexCount]
+		MeshletTriangleStream,   // uint32_t[meshletTriangleCount]
+		StreamCount
+	};
+
+	struct StreamRange
+	{
+		uint64_t offset;  // from the start of the file
+		uint64_t size;
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexCount;
+		uint32_t vertexStride;
+		uint32_t indexCount;
+		uint32_t indexSize;           // 2 or 4
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint32_t meshletVertexCount;
+		uint32_t meshletTriangleCount;
+		uint32_t elementCount;
+		uint8_t  elements[MaxVertexElements][2]; // VertexSemantic, VertexEncoding
+		float    boundsCenter[3];     // local AABB of the decoded positions
+		float    boundsExtents[3];
+		float    quantizationScale[3];
+		float    quantizationBias[3];
+		uint32_t pad;
+		StreamRange streams[StreamCount];
+		uint64_t fileSize;
+	};
+
+	static_assert(sizeof(StreamRange) == 16, "MeshAssetFormat::StreamRange layout changed");
+	static_assert(sizeof(Header) == 248, "MeshAssetFormat::Header layout changed");
+
+	static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
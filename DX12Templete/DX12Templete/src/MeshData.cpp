@@ -0,0 +1,330 @@
+#include "MeshData.h"
+#include "MeshAssetFormat.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace MeshAssetFormat;
+
+// Header::elements holds them byte for byte
+static_assert(sizeof(VertexElement) == 2, "VertexElement no longer matches MeshAssetFormat::Header::elements");
+
+MeshView MeshData::GetView() const
+{
+	MeshView view;
+	view.elements = elements.data();
+	view.elementCount = uint32_t(elements.size());
+	view.vertices = vertices.data();
+	view.vertexCount = vertexCount;
+	view.vertexStride = vertexStride;
+	view.indices = indices.data();
+	view.indexCount = indexCount;
+	view.indexSize = indexSize;
+	view.lods = lods.data();
+	view.lodCount = uint32_t(lods.size());
+	view.lodMeshletOffsets = lodMeshletOffsets.data();
+	view.meshlets = meshlets.meshlets.data();
+	view.meshletBounds = meshlets.bounds.data();
+	view.meshletCount = uint32_t(meshlets.meshlets.size());
+	view.meshletVertices = meshlets.vertices.data();
+	view.meshletVertexCount = uint32_t(meshlets.vertices.size());
+	view.meshletTriangles = meshlets.triangles.data();
+	view.meshletTriangleCount = uint32_t(meshlets.triangles.size());
+	view.quantization = quantization;
+	memcpy(view.boundsCenter, boundsCenter, sizeof(boundsCenter));
+	memcpy(view.boundsExtents, boundsExtents, sizeof(boundsExtents));
+	return view;
+}
+
+bool BuildMeshData(const SourceVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+	const VertexElement* elements, size_t elementCount, const LodSettings& settings, MeshData& out,
+	MeshBuildStatistics* statistics)
+{
+	out = MeshData();
+	if (vertexCount == 0 || indexCount == 0 || indexCount % 3 != 0 || vertexCount > UINT32_MAX)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		if (indices[i] >= vertexCount)
+		{
+			return false;
+		}
+	}
+
+	// Coarser levels reuse the vertices and follow level 0 in the index buffer. Colour counts towards
+	// the simplification error, so gradients survive as long as the shape does.
+	static const float colorWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	SimplifyVertices simplify;
+	simplify.positions = vertices[0].position;
+	simplify.positionStride = sizeof(SourceVertex);
+	simplify.count = vertexCount;
+	simplify.attributes = vertices[0].color;
+	simplify.attributeStride = sizeof(SourceVertex);
+	simplify.attributeCount = 4;
+	simplify.attributeWeights = colorWeights;
+	std::vector<uint32_t> lodIndices;
+	BuildLodChain(simplify, indices, indexCount, settings, out.lods, lodIndices);
+
+	// Each level in vertex cache order, then the vertices in the order the levels first use them
+	MeshBuildStatistics stats;
+	stats.before = AnalyzeVertexCache(lodIndices.data(), indexCount, vertexCount);
+	for (const MeshLod& lod : out.lods)
+	{
+		OptimizeVertexCache(&lodIndices[lod.indexOffset], &lodIndices[lod.indexOffset], lod.indexCount, vertexCount);
+	}
+	stats.after = AnalyzeVertexCache(lodIndices.data(), indexCount, vertexCount);
+	std::vector<uint32_t> remap;
+	size_t usedVertices = OptimizeVertexFetch(lodIndices.data(), lodIndices.size(), vertexCount, remap);
+	std::vector<SourceVertex> ordered(usedVertices);
+	RemapVertices(ordered.data(), vertices, vertexCount, sizeof(SourceVertex), remap.data());
+	stats.unusedVertices = vertexCount - usedVertices;
+
+	float lower[3] = { ordered[0].position[0], ordered[0].position[1], ordered[0].position[2] };
+	float upper[3] = { lower[0], lower[1], lower[2] };
+	for (const SourceVertex& vertex : ordered)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			lower[a] = std::min(lower[a], vertex.position[a]);
+			upper[a] = std::max(upper[a], vertex.position[a]);
+		}
+	}
+	for (int a = 0; a < 3; a++)
+	{
+		out.boundsCenter[a] = (lower[a] + upper[a]) * 0.5f;
+		out.boundsExtents[a] = (upper[a] - lower[a]) * 0.5f;
+	}
+
+	// Quantized to the bounds; the renderer folds the decode into the object's matrices
+	VertexLayout layout(elements, elementCount);
+	out.elements.assign(elements, elements + elementCount);
+	out.vertexCount = uint32_t(usedVertices);
+	out.vertexStride = layout.GetStride();
+	out.quantization = layout.ComputeQuantization(ordered.data(), ordered.size());
+	out.vertices.resize(size_t(out.vertexCount) * out.vertexStride);
+	layout.Encode(ordered.data(), ordered.size(), out.quantization, out.vertices.data());
+
+	out.indexCount = uint32_t(lodIndices.size());
+	if (FitsIndex16(usedVertices))
+	{
+		out.indexSize = sizeof(uint16_t);
+		out.indices.resize(lodIndices.size() * sizeof(uint16_t));
+		PackIndices16(lodIndices.data(), lodIndices.size(), reinterpret_cast<uint16_t*>(out.indices.data()));
+	}
+	else
+	{
+		out.indexSize = sizeof(uint32_t);
+		out.indices.resize(lodIndices.size() * sizeof(uint32_t));
+		memcpy(out.indices.data(), lodIndices.data(), out.indices.size());
+	}
+
+	MeshletMesh levelMeshlets;
+	for (const MeshLod& lod : out.lods)
+	{
+		BuildMeshlets(ordered.data(), sizeof(SourceVertex), ordered.size(), &lodIndices[lod.indexOffset], lod.indexCount, levelMeshlets);
+		out.lodMeshletOffsets.push_back(uint32_t(out.meshlets.meshlets.size()));
+		AppendMeshlets(out.meshlets, levelMeshlets);
+	}
+	out.lodMeshletOffsets.push_back(uint32_t(out.meshlets.meshlets.size()));
+
+	if (statistics)
+	{
+		*statistics = stats;
+	}
+	return true;
+}
+
+void WriteMeshAsset(const MeshView& mesh, std::vector<uint8_t>& image)
+{
+	const void* data[StreamCount] =
+	{
+		mesh.vertices, mesh.indices, mesh.lods, mesh.lodMeshletOffsets,
+		mesh.meshlets, mesh.meshletBounds, mesh.meshletVertices, mesh.meshletTriangles,
+	};
+	const uint64_t sizes[StreamCount] =
+	{
+		uint64_t(mesh.vertexCount) * mesh.vertexStride,
+		uint64_t(mesh.indexCount) * mesh.indexSize,
+		uint64_t(mesh.lodCount) * sizeof(MeshLod),
+		uint64_t(mesh.lodCount + 1) * sizeof(uint32_t),
+		uint64_t(mesh.meshletCount) * sizeof(Meshlet),
+		uint64_t(mesh.meshletCount) * sizeof(MeshletBounds),
+		uint64_t(mesh.meshletVertexCount) * sizeof(uint32_t),
+		uint64_t(mesh.meshletTriangleCount) * sizeof(uint32_t),
+	};
+
+	Header header = {};
+	header.magic = Magic;
+	header.version = Version;
+	header.vertexCount = mesh.vertexCount;
+	header.vertexStride = mesh.vertexStride;
+	header.indexCount = mesh.indexCount;
+	header.indexSize = mesh.indexSize;
+	header.lodCount = mesh.lodCount;
+	header.meshletCount = mesh.meshletCount;
+	header.meshletVertexCount = mesh.meshletVertexCount;
+	header.meshletTriangleCount = mesh.meshletTriangleCount;
+	header.elementCount = std::min(mesh.elementCount, MaxVertexElements);
+	for (uint32_t i = 0; i < header.elementCount; i++)
+	{
+		header.elements[i][0] = uint8_t(mesh.elements[i].semantic);
+		header.elements[i][1] = uint8_t(mesh.elements[i].encoding);
+	}
+	memcpy(header.boundsCenter, mesh.boundsCenter, sizeof(header.boundsCenter));
+	memcpy(header.boundsExtents, mesh.boundsExtents, sizeof(header.boundsExtents));
+	memcpy(header.quantizationScale, mesh.quantization.scale, sizeof(header.quantizationScale));
+	memcpy(header.quantizationBias, mesh.quantization.bias, sizeof(header.quantizationBias));
+
+	uint64_t offset = AlignUp(sizeof(Header), StreamAlignment);
+	for (uint32_t s = 0; s < StreamCount; s++)
+	{
+		header.streams[s].offset = offset;
+		header.streams[s].size = sizes[s];
+		offset = AlignUp(offset + sizes[s], StreamAlignment);
+	}
+	header.fileSize = offset;
+
+	// Padding stays zero so the same mesh always writes the same bytes
+	image.assign(size_t(header.fileSize), 0);
+	memcpy(image.data(), &header, sizeof(header));
+	for (uint32_t s = 0; s < StreamCount; s++)
+	{
+		if (sizes[s] > 0)
+		{
+			memcpy(image.data() + header.streams[s].offset, data[s], size_t(sizes[s]));
+		}
+	}
+}
+
+static bool IsValidElement(uint8_t semantic, uint8_t encoding)
+{
+	return semantic <= uint8_t(VertexSemantic::Color) && encoding <= uint8_t(VertexEncoding::Unorm8x4);
+}
+
+bool ReadMeshAsset(const void* data, size_t size, MeshView* out)
+{
+	const uint8_t* base = static_cast<const uint8_t*>(data);
+	if (size < sizeof(Header) || reinterpret_cast<uintptr_t>(base) % StreamAlignment != 0)
+	{
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(base);
+	if (header->magic != Magic || header->version != Version || header->fileSize != size)
+	{
+		return false;
+	}
+	if (header->elementCount == 0 || header->elementCount > MaxVertexElements ||
+		(header->indexSize != 2 && header->indexSize != 4) ||
+		header->vertexCount == 0 || header->indexCount == 0 || header->lodCount == 0)
+	{
+		return false;
+	}
+	uint32_t stride = 0;
+	for (uint32_t i = 0; i < header->elementCount; i++)
+	{
+		if (!IsValidElement(header->elements[i][0], header->elements[i][1]))
+		{
+			return false;
+		}
+		stride += GetEncodingSize(VertexEncoding(header->elements[i][1]));
+	}
+	if (stride != header->vertexStride)
+	{
+		return false;
+	}
+
+	const uint64_t sizes[StreamCount] =
+	{
+		uint64_t(header->vertexCount) * header->vertexStride,
+		uint64_t(header->indexCount) * header->indexSize,
+		uint64_t(header->lodCount) * sizeof(MeshLod),
+		(uint64_t(header->lodCount) + 1) * sizeof(uint32_t),
+		uint64_t(header->meshletCount) * sizeof(Meshlet),
+		uint64_t(header->meshletCount) * sizeof(MeshletBounds),
+		uint64_t(header->meshletVertexCount) * sizeof(uint32_t),
+		uint64_t(header->meshletTriangleCount) * sizeof(uint32_t),
+	};
+	for (uint32_t s = 0; s < StreamCount; s++)
+	{
+		const StreamRange& stream = header->streams[s];
+		if (stream.size != sizes[s] || stream.offset % StreamAlignment != 0 || stream.offset < sizeof(Header) ||
+			stream.offset > size || stream.size > size - stream.offset)
+		{
+			return false;
+		}
+	}
+
+	MeshView view;
+	view.elements = reinterpret_cast<const VertexElement*>(header->elements);
+	view.elementCount = header->elementCount;
+	view.vertices = base + header->streams[VertexStream].offset;
+	view.vertexCount = header->vertexCount;
+	view.vertexStride = header->vertexStride;
+	view.indices = base + header->streams[IndexStream].offset;
+	view.indexCount = header->indexCount;
+	view.indexSize = header->indexSize;
+	view.lods = reinterpret_cast<const MeshLod*>(base + header->streams[LodStream].offset);
+	view.lodCount = header->lodCount;
+	view.lodMeshletOffsets = reinterpret_cast<const uint32_t*>(base + header->streams[LodMeshletOffsetStream].offset);
+	view.meshlets = reinterpret_cast<const Meshlet*>(base + header->streams[MeshletStream].offset);
+	view.meshletBounds = reinterpret_cast<const MeshletBounds*>(base + header->streams[MeshletBoundsStream].offset);
+	view.meshletCount = header->meshletCount;
+	view.meshletVertices = reinterpret_cast<const uint32_t*>(base + header->streams[MeshletVertexStream].offset);
+	view.meshletVertexCount = header->meshletVertexCount;
+	view.meshletTriangles = reinterpret_cast<const uint32_t*>(base + header->streams[MeshletTriangleStream].offset);
+	view.meshletTriangleCount = header->meshletTriangleCount;
+	memcpy(view.quantization.scale, header->quantizationScale, sizeof(view.quantization.scale));
+	memcpy(view.quantization.bias, header->quantizationBias, sizeof(view.quantization.bias));
+	memcpy(view.boundsCenter, header->boundsCenter, sizeof(view.boundsCenter));
+	memcpy(view.boundsExtents, header->boundsExtents, sizeof(view.boundsExtents));
+
+	// The tables index the other streams; one bad entry would send the renderer outside them
+	for (uint32_t i = 0; i < view.lodCount; i++)
+	{
+		if (view.lods[i].indexCount % 3 != 0 || uint64_t(view.lods[i].indexOffset) + view.lods[i].indexCount > view.indexCount)
+		{
+			return false;
+		}
+	}
+	if (view.lodMeshletOffsets[0] != 0 || view.lodMeshletOffsets[view.lodCount] != view.meshletCount)
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < view.lodCount; i++)
+	{
+		if (view.lodMeshletOffsets[i] > view.lodMeshletOffsets[i + 1])
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < view.meshletCount; i++)
+	{
+		const Meshlet& meshlet = view.meshlets[i];
+		if (meshlet.vertexCount > MaxMeshletVertices || meshlet.triangleCount > MaxMeshletTriangles ||
+			uint64_t(meshlet.vertexOffset) + meshlet.vertexCount > view.meshletVertexCount ||
+			uint64_t(meshlet.triangleOffset) + meshlet.triangleCount > view.meshletTriangleCount)
+		{
+			return false;
+		}
+	}
+
+	*out = view;
+	return true;
+}
+
+bool MatchesVertexElements(const MeshView& mesh, const VertexElement* elements, size_t count)
+{
+	if (mesh.elementCount != count)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		if (mesh.elements[i].semantic != elements[i].semantic || mesh.elements[i].encoding != elements[i].encoding)
+		{
+			return false;
+		}
+	}
+	return true;
+}
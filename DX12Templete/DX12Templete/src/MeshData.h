@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "VertexLayout.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+
+// A mesh the way the renderer consumes it: encoded vertices, the indices of every LOD level, the
+// meshlets of every level and the bounds. BuildMeshData produces it from source triangles, offline in
+// tools/MeshConvert or at load time for built-in shapes; WriteMeshAsset and ReadMeshAsset move it to
+// and from the .mesh container of MeshAssetFormat.h. Nothing here touches D3D or the file system.
+
+// Borrowed arrays, e.g. straight out of a mapped .mesh file or out of a MeshData
+struct MeshView
+{
+	const VertexElement* elements = nullptr;
+	uint32_t elementCount = 0;
+	const void* vertices = nullptr;
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	const void* indices = nullptr;           // every level, relative to the first vertex
+	uint32_t indexCount = 0;
+	uint32_t indexSize = 0;                  // 2 or 4
+	const MeshLod* lods = nullptr;
+	uint32_t lodCount = 0;
+	const uint32_t* lodMeshletOffsets = nullptr; // lodCount + 1
+	const Meshlet* meshlets = nullptr;
+	const MeshletBounds* meshletBounds = nullptr;
+	uint32_t meshletCount = 0;
+	const uint32_t* meshletVertices = nullptr;
+	uint32_t meshletVertexCount = 0;
+	const uint32_t* meshletTriangles = nullptr;
+	uint32_t meshletTriangleCount = 0;
+	VertexQuantization quantization;
+	float boundsCenter[3] = {};
+	float boundsExtents[3] = {};
+};
+
+struct MeshData
+{
+	std::vector<VertexElement> elements;
+	std::vector<uint8_t> vertices;
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	std::vector<uint8_t> indices;
+	uint32_t indexCount = 0;
+	uint32_t indexSize = 0;
+	std::vector<MeshLod> lods;
+	std::vector<uint32_t> lodMeshletOffsets;
+	MeshletMesh meshlets;
+	VertexQuantization quantization;
+	float boundsCenter[3] = {};
+	float boundsExtents[3] = {};
+
+	MeshView GetView() const;
+};
+
+struct MeshBuildStatistics
+{
+	VertexCacheStatistics before;  // level 0 as given
+	VertexCacheStatistics after;   // level 0 after OptimizeVertexCache
+	size_t unusedVertices = 0;     // dropped by OptimizeVertexFetch
+};
+
+// Builds the LOD chain (colour counts towards the error), orders every level for the vertex cache and
+// the vertices for fetch, encodes them with the layout, and splits every level into meshlets.
+// Indices are 16-bit when the vertices allow it. Returns false for empty input or out-of-range indices.
+bool BuildMeshData(const SourceVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+	const VertexElement* elements, size_t elementCount, const LodSettings& settings, MeshData& out,
+	MeshBuildStatistics* statistics = nullptr);
+
+// Serializes the view into a .mesh image
+void WriteMeshAsset(const MeshView& mesh, std::vector<uint8_t>& image);
+
+// Points the view into a .mesh image without copying. Checks the header, that every stream lies in
+// the image where its counts say, and that the LOD and meshlet tables stay inside the arrays they
+// index; vertex indices themselves are trusted, as the converter wrote them. data must be aligned
+// to StreamAlignment, which a file mapping is.
+bool ReadMeshAsset(const void* data, size_t size, MeshView* out);
+
+// True when the vertices are encoded with exactly these elements, e.g. the ones a pipeline was built for
+bool MatchesVertexElements(const MeshView& mesh, const VertexElement* elements, size_t count);
@@ -0,0 +1,174 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+{
+	// A vertex is cached while fewer than cacheSize misses happened since its own
+	std::vector<size_t> missedAt(vertexCount, 0);
+	std::vector<uint8_t> referenced(vertexCount, 0);
+	VertexCacheStatistics statistics;
+	size_t referencedCount = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t v = indices[i];
+		if (!referenced[v])
+		{
+			referenced[v] = 1;
+			referencedCount++;
+		}
+		if (missedAt[v] == 0 || statistics.transformed + 1 - missedAt[v] > cacheSize)
+		{
+			statistics.transformed++;
+			missedAt[v] = statistics.transformed;
+		}
+	}
+	statistics.acmr = indexCount ? float(statistics.transformed) / float(indexCount / 3) : 0.0f;
+	statistics.atvr = referencedCount ? float(statistics.transformed) / float(referencedCount) : 0.0f;
+	return statistics;
+}
+
+void OptimizeVertexCache(uint32_t* out, const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	std::vector<uint32_t> source(indices, indices + triangleCount * 3);
+
+	// Triangles around each vertex, and how many of them are still to be emitted
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t v : source)
+	{
+		adjacencyOffsets[v + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> adjacency(source.size());
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < source.size(); i++)
+		{
+			adjacency[cursor[source[i]]++] = uint32_t(i / 3);
+		}
+	}
+
+	// cacheTime is the timestamp at which a vertex last entered the cache
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	size_t timestamp = cacheSize + 1;
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	size_t written = 0;
+	size_t scan = 0;
+
+	auto nextUnfinished = [&]() -> uint32_t
+	{
+		// Recently touched vertices first, then whatever is left in index order
+		while (!deadEnd.empty())
+		{
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+			{
+				return v;
+			}
+		}
+		while (scan < vertexCount)
+		{
+			if (liveTriangles[scan] > 0)
+			{
+				return uint32_t(scan);
+			}
+			scan++;
+		}
+		return UnusedVertex;
+	};
+
+	uint32_t fan = nextUnfinished();
+	while (fan != UnusedVertex)
+	{
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; a++)
+		{
+			uint32_t t = adjacency[a];
+			if (emitted[t])
+			{
+				continue;
+			}
+			emitted[t] = 1;
+			for (int c = 0; c < 3; c++)
+			{
+				uint32_t v = source[t * 3 + c];
+				out[written++] = v;
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (timestamp - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = timestamp++;
+				}
+			}
+		}
+
+		// The candidate that has been cached longest and will still be cached after fanning out,
+		// estimating two new vertices per remaining triangle
+		uint32_t best = UnusedVertex;
+		size_t bestPriority = 0;
+		for (uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+			size_t age = timestamp - cacheTime[v];
+			size_t priority = age + 2 * liveTriangles[v] <= cacheSize ? age + 1 : 1;
+			if (priority > bestPriority)
+			{
+				best = v;
+				bestPriority = priority;
+			}
+		}
+		fan = best != UnusedVertex ? best : nextUnfinished();
+	}
+}
+
+size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+	remap.assign(vertexCount, UnusedVertex);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t& slot = remap[indices[i]];
+		if (slot == UnusedVertex)
+		{
+			slot = next++;
+		}
+		indices[i] = slot;
+	}
+	return next;
+}
+
+void RemapVertices(void* out, const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap)
+{
+	const uint8_t* source = static_cast<const uint8_t*>(vertices);
+	uint8_t* destination = static_cast<uint8_t*>(out);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != UnusedVertex)
+		{
+			std::copy(source + v * vertexSize, source + (v + 1) * vertexSize, destination + remap[v] * vertexSize);
+		}
+	}
+}
+
+void PackIndices16(const uint32_t* indices, size_t indexCount, uint16_t* out)
+{
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		out[i] = uint16_t(indices[i]);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Orders indexed triangle lists for the GPU: triangles for the post-transform vertex cache, then
+// vertices in the order those triangles first use them so fetches walk the vertex buffer forwards.
+
+static constexpr size_t DefaultVertexCacheSize = 16;
+
+struct VertexCacheStatistics
+{
+	size_t transformed = 0;  // cache misses
+	float acmr = 0.0f;       // misses per triangle: 3 without reuse, about 0.5 at best on a large grid
+	float atvr = 0.0f;       // misses per referenced vertex: 1 is ideal
+};
+
+// Replays the indices through a FIFO cache of cacheSize entries
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	size_t cacheSize = DefaultVertexCacheSize);
+
+// Reorders triangles with Tipsify (Sander, Nehab and Barczak 2007): fans around one vertex at a time
+// and moves on to a neighbour that is still in the cache. Linear time, and it does not assume an exact
+// cache size, so the order holds up on hardware whose cache differs. out may alias indices.
+void OptimizeVertexCache(uint32_t* out, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	size_t cacheSize = DefaultVertexCacheSize);
+
+// Renumbers vertices in order of first use and rewrites indices in place. remap receives the new
+// index of every old vertex, or UnusedVertex; returns how many vertices are used.
+static constexpr uint32_t UnusedVertex = UINT32_MAX;
+size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+
+// Moves each vertex of vertexSize bytes to its remapped slot and drops unused ones.
+// out holds as many vertices as OptimizeVertexFetch returned and must not alias vertices.
+void RemapVertices(void* out, const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap);
+
+// Triangle lists without strip cuts can use every 16-bit value
+inline bool FitsIndex16(size_t vertexCount) { return vertexCount <= 0x10000; }
+void PackIndices16(const uint32_t* indices, size_t indexCount, uint16_t* out);
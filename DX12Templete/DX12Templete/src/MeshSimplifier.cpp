@@ -0,0 +1,655 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Open border edges also get a plane through them, perpendicular to their triangle, this much stronger
+// than the surface, so borders hold their shape
+static const double BorderWeight = 10.0;
+
+// Collapses may turn a triangle by at most about 75 degrees
+static const double MinNormalDot = 0.25;
+
+// error(p) = p'Ap + 2b'p + c for the symmetric A
+struct Quadric
+{
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+
+// One attribute channel: error(p, s) = sum of w (g.p + d - s)^2 over the triangles, where g and d
+// reproduce the channel linearly across each triangle
+struct AttributeQuadric
+{
+	double gg[6];
+	double gd[3];
+	double g[3];
+	double dd;
+	double d;
+	double w;
+};
+
+enum VertexKind : uint8_t
+{
+	Manifold,
+	Border,     // on exactly one open boundary loop
+	Locked,     // attribute seam or non-manifold; never moves
+};
+
+struct Collapse
+{
+	uint32_t from;
+	uint32_t to;
+	float error;
+};
+
+static void AddPlane(Quadric& q, const double n[3], double d, double w)
+{
+	q.a00 += w * n[0] * n[0];
+	q.a01 += w * n[0] * n[1];
+	q.a02 += w * n[0] * n[2];
+	q.a11 += w * n[1] * n[1];
+	q.a12 += w * n[1] * n[2];
+	q.a22 += w * n[2] * n[2];
+	q.b0 += w * n[0] * d;
+	q.b1 += w * n[1] * d;
+	q.b2 += w * n[2] * d;
+	q.c += w * d * d;
+	q.w += w;
+}
+
+static void Accumulate(Quadric& q, const Quadric& other)
+{
+	q.a00 += other.a00;
+	q.a01 += other.a01;
+	q.a02 += other.a02;
+	q.a11 += other.a11;
+	q.a12 += other.a12;
+	q.a22 += other.a22;
+	q.b0 += other.b0;
+	q.b1 += other.b1;
+	q.b2 += other.b2;
+	q.c += other.c;
+	q.w += other.w;
+}
+
+static double Evaluate(const Quadric& q, const double p[3])
+{
+	double x = p[0];
+	double y = p[1];
+	double z = p[2];
+	return q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+		2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+		2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+}
+
+static void AddGradient(AttributeQuadric& q, const double g[3], double d, double w)
+{
+	q.gg[0] += w * g[0] * g[0];
+	q.gg[1] += w * g[0] * g[1];
+	q.gg[2] += w * g[0] * g[2];
+	q.gg[3] += w * g[1] * g[1];
+	q.gg[4] += w * g[1] * g[2];
+	q.gg[5] += w * g[2] * g[2];
+	for (int a = 0; a < 3; a++)
+	{
+		q.gd[a] += w * g[a] * d;
+		q.g[a] += w * g[a];
+	}
+	q.dd += w * d * d;
+	q.d += w * d;
+	q.w += w;
+}
+
+static void Accumulate(AttributeQuadric& q, const AttributeQuadric& other)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		q.gg[i] += other.gg[i];
+	}
+	for (int a = 0; a < 3; a++)
+	{
+		q.gd[a] += other.gd[a];
+		q.g[a] += other.g[a];
+	}
+	q.dd += other.dd;
+	q.d += other.d;
+	q.w += other.w;
+}
+
+static double Evaluate(const AttributeQuadric& q, const double p[3], double s)
+{
+	double x = p[0];
+	double y = p[1];
+	double z = p[2];
+	double quadratic = q.gg[0] * x * x + q.gg[3] * y * y + q.gg[5] * z * z +
+		2.0 * (q.gg[1] * x * y + q.gg[2] * x * z + q.gg[4] * y * z);
+	double linear = 2.0 * (q.gd[0] * x + q.gd[1] * y + q.gd[2] * z) - 2.0 * s * (q.g[0] * x + q.g[1] * y + q.g[2] * z);
+	return quadratic + linear + q.dd - 2.0 * s * q.d + s * s * q.w;
+}
+
+static void Cross(const double a[3], const double b[3], double out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double Dot(const double a[3], const double b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+class Simplifier
+{
+public:
+	Simplifier(const SimplifyVertices& vertices, const uint32_t* indices, size_t indexCount)
+		: mVertices(vertices), mIndices(indices, indices + indexCount - indexCount % 3)
+	{
+		mAttributeCount = std::min(vertices.attributeCount, MaxSimplifyAttributes);
+		mPositions.resize(vertices.count * 3);
+		for (size_t v = 0; v < vertices.count; v++)
+		{
+			const float* p = reinterpret_cast<const float*>(static_cast<const uint8_t*>(vertices.positions) + vertices.positionStride * v);
+			mPositions[v * 3] = p[0];
+			mPositions[v * 3 + 1] = p[1];
+			mPositions[v * 3 + 2] = p[2];
+		}
+		mRemap.resize(vertices.count);
+		for (size_t v = 0; v < vertices.count; v++)
+		{
+			mRemap[v] = uint32_t(v);
+		}
+		mTouched.resize(vertices.count);
+		Classify();
+		ComputeQuadrics();
+	}
+
+	size_t Run(size_t targetIndexCount, float maxError, uint32_t* out, float* error)
+	{
+		size_t targetTriangles = targetIndexCount / 3;
+		size_t triangles = mIndices.size() / 3;
+		float worst = 0.0f;
+		std::vector<Collapse> candidates;
+
+		while (triangles > targetTriangles)
+		{
+			BuildAdjacency();
+			candidates.clear();
+			for (size_t t = 0; t < triangles; t++)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					uint32_t a = mIndices[t * 3 + e];
+					uint32_t b = mIndices[t * 3 + (e + 1) % 3];
+					for (int direction = 0; direction < 2; direction++)
+					{
+						uint32_t from = direction ? b : a;
+						uint32_t to = direction ? a : b;
+						if (CanMove(from, to))
+						{
+							float cost = Cost(from, to);
+							if (cost <= maxError)
+							{
+								candidates.push_back({ from, to, cost });
+							}
+						}
+					}
+				}
+			}
+			if (candidates.empty())
+			{
+				break;
+			}
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			// Each collapse removes about two triangles. Taking only collapses close to the cheapest ones
+			// needed keeps a pass from spending error the target does not call for.
+			size_t needed = std::min(candidates.size(), (triangles - targetTriangles) / 2 + 1);
+			float passLimit = candidates[needed - 1].error * 1.5f;
+
+			size_t collapses = 0;
+			std::fill(mTouched.begin(), mTouched.end(), uint8_t(0));
+			for (size_t i = 0; i < candidates.size() && triangles > targetTriangles; i++)
+			{
+				const Collapse& collapse = candidates[i];
+				if (collapse.error > passLimit)
+				{
+					// If everything cheap was refused, the pass may dig deeper rather than give up
+					if (collapses > 0)
+					{
+						break;
+					}
+					passLimit = collapse.error * 1.5f;
+				}
+				if (mTouched[collapse.from] || mTouched[collapse.to])
+				{
+					continue;
+				}
+				size_t removed;
+				if (!IsCollapseValid(collapse.from, collapse.to, removed))
+				{
+					continue;
+				}
+				Apply(collapse.from, collapse.to);
+				triangles -= removed;
+				worst = std::max(worst, collapse.error);
+				collapses++;
+			}
+			if (collapses == 0)
+			{
+				break;
+			}
+			triangles = Compact();
+		}
+
+		std::copy(mIndices.begin(), mIndices.begin() + triangles * 3, out);
+		if (error)
+		{
+			*error = worst;
+		}
+		return triangles * 3;
+	}
+
+private:
+	const double* Position(uint32_t v) const { return &mPositions[v * 3]; }
+
+	float Attribute(uint32_t v, size_t channel) const
+	{
+		const float* a = reinterpret_cast<const float*>(static_cast<const uint8_t*>(mVertices.attributes) + mVertices.attributeStride * v);
+		return a[channel];
+	}
+
+	void Classify()
+	{
+		mKind.assign(mVertices.count, Manifold);
+		mBorderNext.assign(mVertices.count, ~0u);
+		mBorderPrev.assign(mVertices.count, ~0u);
+
+		// Several vertices at one position split an attribute; moving one of them would tear the seam open
+		struct PositionHash
+		{
+			size_t operator()(const std::array<uint32_t, 3>& p) const { return p[0] * 73856093u ^ p[1] * 19349663u ^ p[2] * 83492791u; }
+		};
+		std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> positions;
+		for (uint32_t index : mIndices)
+		{
+			const float* p = reinterpret_cast<const float*>(static_cast<const uint8_t*>(mVertices.positions) + mVertices.positionStride * index);
+			std::array<uint32_t, 3> key;
+			memcpy(key.data(), p, sizeof(key));
+			auto inserted = positions.emplace(key, index);
+			if (!inserted.second && inserted.first->second != index)
+			{
+				mKind[index] = Locked;
+				mKind[inserted.first->second] = Locked;
+			}
+		}
+
+		// An edge without its twin is open; an edge used twice the same way is non-manifold
+		std::unordered_map<uint64_t, uint32_t> edges;
+		auto key = [](uint32_t a, uint32_t b) { return (uint64_t(a) << 32) | b; };
+		for (size_t t = 0; t < mIndices.size(); t += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				edges[key(mIndices[t + e], mIndices[t + (e + 1) % 3])]++;
+			}
+		}
+		std::vector<uint8_t> openOut(mVertices.count, 0);
+		std::vector<uint8_t> openIn(mVertices.count, 0);
+		for (const auto& edge : edges)
+		{
+			uint32_t a = uint32_t(edge.first >> 32);
+			uint32_t b = uint32_t(edge.first);
+			if (edge.second > 1)
+			{
+				mKind[a] = Locked;
+				mKind[b] = Locked;
+			}
+			if (edges.find(key(b, a)) == edges.end())
+			{
+				openOut[a] = uint8_t(std::min(openOut[a] + 1, 2));
+				openIn[b] = uint8_t(std::min(openIn[b] + 1, 2));
+				mBorderNext[a] = b;
+				mBorderPrev[b] = a;
+			}
+		}
+		for (size_t v = 0; v < mVertices.count; v++)
+		{
+			if (mKind[v] == Locked || (openOut[v] == 0 && openIn[v] == 0))
+			{
+				continue;
+			}
+			mKind[v] = (openOut[v] == 1 && openIn[v] == 1) ? Border : Locked;
+		}
+	}
+
+	void ComputeQuadrics()
+	{
+		mQuadrics.assign(mVertices.count, Quadric{});
+		mAttributeQuadrics.assign(mVertices.count * mAttributeCount, AttributeQuadric{});
+		for (size_t t = 0; t < mIndices.size(); t += 3)
+		{
+			const uint32_t* corners = &mIndices[t];
+			const double* p0 = Position(corners[0]);
+			const double* p1 = Position(corners[1]);
+			const double* p2 = Position(corners[2]);
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			double n[3];
+			Cross(e1, e2, n);
+			double length = std::sqrt(Dot(n, n));
+			if (length == 0.0)
+			{
+				continue;
+			}
+			for (int a = 0; a < 3; a++)
+			{
+				n[a] /= length;
+			}
+			double area = length * 0.5;
+			double d = -Dot(n, p0);
+			for (int c = 0; c < 3; c++)
+			{
+				AddPlane(mQuadrics[corners[c]], n, d, area);
+			}
+
+			// Gradient g in the triangle's plane with g.e1 = s1 - s0 and g.e2 = s2 - s0
+			double e11 = Dot(e1, e1);
+			double e12 = Dot(e1, e2);
+			double e22 = Dot(e2, e2);
+			double determinant = e11 * e22 - e12 * e12;
+			for (size_t channel = 0; channel < mAttributeCount && determinant > 0.0; channel++)
+			{
+				double weight = mVertices.attributeWeights ? mVertices.attributeWeights[channel] : 1.0;
+				double s0 = Attribute(corners[0], channel);
+				double ds1 = Attribute(corners[1], channel) - s0;
+				double ds2 = Attribute(corners[2], channel) - s0;
+				double alpha = (ds1 * e22 - ds2 * e12) / determinant;
+				double beta = (ds2 * e11 - ds1 * e12) / determinant;
+				double g[3] = { alpha * e1[0] + beta * e2[0], alpha * e1[1] + beta * e2[1], alpha * e1[2] + beta * e2[2] };
+				double gd = s0 - Dot(g, p0);
+				for (int c = 0; c < 3; c++)
+				{
+					AddGradient(mAttributeQuadrics[corners[c] * mAttributeCount + channel], g, gd, area * weight * weight);
+				}
+			}
+
+			for (int e = 0; e < 3; e++)
+			{
+				uint32_t a = corners[e];
+				uint32_t b = corners[(e + 1) % 3];
+				if (mBorderNext[a] != b)
+				{
+					continue;
+				}
+				const double* pa = Position(a);
+				const double* pb = Position(b);
+				double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+				double m[3];
+				Cross(edge, n, m);
+				double mLength = std::sqrt(Dot(m, m));
+				if (mLength == 0.0)
+				{
+					continue;
+				}
+				for (int i = 0; i < 3; i++)
+				{
+					m[i] /= mLength;
+				}
+				double weight = Dot(edge, edge) * BorderWeight;
+				AddPlane(mQuadrics[a], m, -Dot(m, pa), weight);
+				AddPlane(mQuadrics[b], m, -Dot(m, pa), weight);
+			}
+		}
+	}
+
+	void BuildAdjacency()
+	{
+		mAdjacencyOffsets.assign(mVertices.count + 1, 0);
+		for (uint32_t index : mIndices)
+		{
+			mAdjacencyOffsets[index + 1]++;
+		}
+		for (size_t v = 0; v < mVertices.count; v++)
+		{
+			mAdjacencyOffsets[v + 1] += mAdjacencyOffsets[v];
+		}
+		mAdjacency.resize(mIndices.size());
+		std::vector<uint32_t> cursor(mAdjacencyOffsets.begin(), mAdjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < mIndices.size(); i++)
+		{
+			mAdjacency[cursor[mIndices[i]]++] = uint32_t(i / 3);
+		}
+	}
+
+	bool CanMove(uint32_t from, uint32_t to) const
+	{
+		switch (mKind[from])
+		{
+		case Manifold:
+			return true;
+		case Border:
+			return (mBorderNext[from] == to || mBorderPrev[from] == to) && mKind[to] != Manifold;
+		default:
+			return false;
+		}
+	}
+
+	// Error of moving from onto to, in position units
+	float Cost(uint32_t from, uint32_t to) const
+	{
+		const Quadric& q = mQuadrics[from];
+		if (q.w <= 0.0)
+		{
+			return 0.0f;
+		}
+		const double* p = Position(to);
+		double cost = Evaluate(q, p);
+		for (size_t channel = 0; channel < mAttributeCount; channel++)
+		{
+			cost += Evaluate(mAttributeQuadrics[from * mAttributeCount + channel], p, Attribute(to, channel));
+		}
+		return float(std::sqrt(std::max(cost, 0.0) / q.w));
+	}
+
+	// No triangle may flip, and the edge's endpoints may share no neighbours besides the triangles on
+	// the edge, or the surface would pinch
+	bool IsCollapseValid(uint32_t from, uint32_t to, size_t& removed)
+	{
+		removed = 0;
+		mFromNeighbours.clear();
+		const double* target = Position(to);
+		for (uint32_t a = mAdjacencyOffsets[from]; a < mAdjacencyOffsets[from + 1]; a++)
+		{
+			uint32_t corners[3];
+			if (!GetTriangle(mAdjacency[a], corners))
+			{
+				continue;
+			}
+			if (corners[0] == to || corners[1] == to || corners[2] == to)
+			{
+				removed++;
+				continue;
+			}
+			int self = corners[0] == from ? 0 : (corners[1] == from ? 1 : 2);
+			const double* p[3] = { Position(corners[0]), Position(corners[1]), Position(corners[2]) };
+			double before[3];
+			double after[3];
+			double e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			double e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			Cross(e1, e2, before);
+			p[self] = target;
+			double f1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			double f2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			Cross(f1, f2, after);
+			if (Dot(before, after) <= MinNormalDot * std::sqrt(Dot(before, before) * Dot(after, after)))
+			{
+				return false;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				if (corners[c] != from)
+				{
+					mFromNeighbours.push_back(corners[c]);
+				}
+			}
+		}
+
+		size_t shared = 0;
+		std::sort(mFromNeighbours.begin(), mFromNeighbours.end());
+		mFromNeighbours.erase(std::unique(mFromNeighbours.begin(), mFromNeighbours.end()), mFromNeighbours.end());
+		mToNeighbours.clear();
+		for (uint32_t a = mAdjacencyOffsets[to]; a < mAdjacencyOffsets[to + 1]; a++)
+		{
+			uint32_t corners[3];
+			if (!GetTriangle(mAdjacency[a], corners))
+			{
+				continue;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				if (corners[c] != to && corners[c] != from)
+				{
+					mToNeighbours.push_back(corners[c]);
+				}
+			}
+		}
+		std::sort(mToNeighbours.begin(), mToNeighbours.end());
+		mToNeighbours.erase(std::unique(mToNeighbours.begin(), mToNeighbours.end()), mToNeighbours.end());
+		for (uint32_t v : mToNeighbours)
+		{
+			shared += std::binary_search(mFromNeighbours.begin(), mFromNeighbours.end(), v) ? 1 : 0;
+		}
+		return removed > 0 && shared == removed;
+	}
+
+	// Corners after this pass's collapses; false once the triangle has collapsed
+	bool GetTriangle(uint32_t triangle, uint32_t corners[3]) const
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			corners[c] = mRemap[mIndices[triangle * 3 + c]];
+		}
+		return corners[0] != corners[1] && corners[1] != corners[2] && corners[0] != corners[2];
+	}
+
+	void Apply(uint32_t from, uint32_t to)
+	{
+		mRemap[from] = to;
+		mTouched[from] = 1;
+		mTouched[to] = 1;
+		Accumulate(mQuadrics[to], mQuadrics[from]);
+		for (size_t channel = 0; channel < mAttributeCount; channel++)
+		{
+			Accumulate(mAttributeQuadrics[to * mAttributeCount + channel], mAttributeQuadrics[from * mAttributeCount + channel]);
+		}
+		if (mKind[from] == Border)
+		{
+			// Splice from out of its loop
+			if (mBorderNext[from] == to)
+			{
+				uint32_t previous = mBorderPrev[from];
+				mBorderPrev[to] = previous;
+				mBorderNext[previous] = to;
+			}
+			else
+			{
+				uint32_t next = mBorderNext[from];
+				mBorderNext[to] = next;
+				mBorderPrev[next] = to;
+			}
+		}
+	}
+
+	size_t Compact()
+	{
+		size_t written = 0;
+		for (size_t t = 0; t < mIndices.size() / 3; t++)
+		{
+			uint32_t corners[3];
+			if (GetTriangle(uint32_t(t), corners))
+			{
+				std::copy(corners, corners + 3, &mIndices[written * 3]);
+				written++;
+			}
+		}
+		mIndices.resize(written * 3);
+		for (size_t v = 0; v < mVertices.count; v++)
+		{
+			mRemap[v] = uint32_t(v);
+		}
+		return written;
+	}
+
+	const SimplifyVertices& mVertices;
+	size_t mAttributeCount;
+	std::vector<uint32_t> mIndices;
+	std::vector<double> mPositions;
+	std::vector<VertexKind> mKind;
+	std::vector<uint32_t> mBorderNext;
+	std::vector<uint32_t> mBorderPrev;
+	std::vector<Quadric> mQuadrics;
+	std::vector<AttributeQuadric> mAttributeQuadrics;
+	std::vector<uint32_t> mRemap;
+	std::vector<uint8_t> mTouched;
+	std::vector<uint32_t> mAdjacencyOffsets;
+	std::vector<uint32_t> mAdjacency;
+	std::vector<uint32_t> mFromNeighbours;
+	std::vector<uint32_t> mToNeighbours;
+};
+
+size_t SimplifyMesh(const SimplifyVertices& vertices, const uint32_t* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, uint32_t* out, float* error)
+{
+	Simplifier simplifier(vertices, indices, indexCount);
+	return simplifier.Run(targetIndexCount, maxError, out, error);
+}
+
+void BuildLodChain(const SimplifyVertices& vertices, const uint32_t* indices, size_t indexCount, const LodSettings& settings,
+	std::vector<MeshLod>& lods, std::vector<uint32_t>& lodIndices)
+{
+	lods.clear();
+	lodIndices.assign(indices, indices + indexCount);
+	lods.push_back({ 0, uint32_t(indexCount), 0.0f });
+
+	std::vector<uint32_t> simplified;
+	while (lods.size() < settings.maxLevels)
+	{
+		MeshLod previous = lods.back();
+		if (previous.indexCount / 3 <= settings.minTriangles)
+		{
+			break;
+		}
+		size_t target = size_t(previous.indexCount / 3 * settings.reduction) * 3;
+
+		// Each level starts from the last, so their errors add up
+		simplified.resize(previous.indexCount);
+		float error = 0.0f;
+		size_t count = SimplifyMesh(vertices, &lodIndices[previous.indexOffset], previous.indexCount, target,
+			settings.maxError - previous.error, simplified.data(), &error);
+
+		// A level that barely differs from the last costs memory and buys nothing
+		if (count == 0 || count * 10 > size_t(previous.indexCount) * 9)
+		{
+			break;
+		}
+		lods.push_back({ uint32_t(lodIndices.size()), uint32_t(count), previous.error + error });
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.begin() + count);
+	}
+}
+
+size_t SelectLod(const MeshLod* lods, size_t lodCount, float worldScale, float distance, float projectionScale, float maxPixelError)
+{
+	float pixelsPerUnit = projectionScale * worldScale / std::max(distance, 1e-6f);
+	size_t level = 0;
+	for (size_t i = 1; i < lodCount && lods[i].error * pixelsPerUnit <= maxPixelError; i++)
+	{
+		level = i;
+	}
+	return level;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric simplification by edge collapse, and the LOD chains built from it.
+//
+// Every vertex carries the quadric of the planes around it, plus one attribute quadric per attribute
+// channel measuring how far the channel drifts from the linear gradient across each triangle. An edge
+// collapse moves one vertex onto a neighbour, so no new vertices are made and every level indexes the
+// original vertex buffer. Open borders only collapse along themselves and vertices on attribute seams
+// (several vertices at one position) are kept, so neither opens cracks. Collapses that would flip a
+// triangle or pinch the surface are refused.
+
+static constexpr size_t MaxSimplifyAttributes = 8;
+
+struct SimplifyVertices
+{
+	const void* positions = nullptr;    // 3 floats per vertex
+	size_t positionStride = 0;
+	size_t count = 0;
+	const void* attributes = nullptr;   // attributeCount floats per vertex, e.g. a colour; optional
+	size_t attributeStride = 0;
+	size_t attributeCount = 0;
+	const float* attributeWeights = nullptr; // scales each channel's error into position units; 1 if null
+};
+
+// Writes at most indexCount indices to out and returns how many, aiming for targetIndexCount without
+// any collapse costing more than maxError. error (optional) receives the largest error introduced,
+// in position units.
+size_t SimplifyMesh(const SimplifyVertices& vertices, const uint32_t* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, uint32_t* out, float* error = nullptr);
+
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;        // object-space deviation from level 0, which is the source mesh with error 0
+};
+
+struct LodSettings
+{
+	size_t maxLevels = 5;
+	float reduction = 0.5f;       // each level aims for this fraction of the previous level's triangles
+	float maxError = 1e30f;       // no level deviates further from the source than this
+	size_t minTriangles = 8;      // stop once a level gets this small
+};
+
+// Level 0 is the source; each further level simplifies the previous one and stops early when the
+// simplifier can no longer make real progress. All levels are appended to lodIndices.
+void BuildLodChain(const SimplifyVertices& vertices, const uint32_t* indices, size_t indexCount, const LodSettings& settings,
+	std::vector<MeshLod>& lods, std::vector<uint32_t>& lodIndices);
+
+// Coarsest level whose error, seen at distance, covers at most maxPixelError pixels.
+// worldScale is the instance's largest axis scale and projectionScale the pixels one unit covers at
+// distance one: proj._22 times half the viewport height.
+size_t SelectLod(const MeshLod* lods, size_t lodCount, float worldScale, float distance, float projectionScale, float maxPixelError);
@@ -0,0 +1,299 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+static const uint8_t Absent = 0xff;
+
+static const float* GetPosition(const void* positions, size_t stride, uint32_t index)
+{
+	return reinterpret_cast<const float*>(static_cast<const uint8_t*>(positions) + stride * index);
+}
+
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Vertices of the triangle not yet in the meshlet; repeated corners of degenerate triangles count once
+static int CountNewVertices(const uint32_t* corners, const std::vector<uint8_t>& local)
+{
+	int count = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		bool repeated = (c > 0 && corners[c] == corners[0]) || (c > 1 && corners[c] == corners[1]);
+		if (local[corners[c]] == Absent && !repeated)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+static void ComputeBounds(const void* positions, size_t stride, const MeshletMesh& mesh, const Meshlet& meshlet, MeshletBounds& bounds)
+{
+	const uint32_t* vertices = &mesh.vertices[meshlet.vertexOffset];
+	const uint32_t* triangles = &mesh.triangles[meshlet.triangleOffset];
+
+	// Sphere around the box centre
+	float minP[3] = { INFINITY, INFINITY, INFINITY };
+	float maxP[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const float* p = GetPosition(positions, stride, vertices[i]);
+		for (int a = 0; a < 3; a++)
+		{
+			minP[a] = std::min(minP[a], p[a]);
+			maxP[a] = std::max(maxP[a], p[a]);
+		}
+	}
+	float radiusSq = 0.0f;
+	for (int a = 0; a < 3; a++)
+	{
+		bounds.center[a] = (minP[a] + maxP[a]) * 0.5f;
+	}
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const float* p = GetPosition(positions, stride, vertices[i]);
+		float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+		radiusSq = std::max(radiusSq, Dot(d, d));
+	}
+	bounds.radius = std::sqrt(radiusSq);
+	bounds.pad = 0.0f;
+
+	// Cone around the mean of the unit normals; degenerate triangles are never rasterized and are skipped
+	float normals[MaxMeshletTriangles][3];
+	const float* origins[MaxMeshletTriangles];
+	size_t normalCount = 0;
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+	{
+		const float* p0 = GetPosition(positions, stride, vertices[MeshletCorner(triangles[t], 0)]);
+		const float* p1 = GetPosition(positions, stride, vertices[MeshletCorner(triangles[t], 1)]);
+		const float* p2 = GetPosition(positions, stride, vertices[MeshletCorner(triangles[t], 2)]);
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float* n = normals[normalCount];
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		float length = std::sqrt(Dot(n, n));
+		if (length == 0.0f)
+		{
+			continue;
+		}
+		for (int a = 0; a < 3; a++)
+		{
+			n[a] /= length;
+			axis[a] += n[a];
+		}
+		origins[normalCount++] = p0;
+	}
+
+	float axisLength = std::sqrt(Dot(axis, axis));
+	float minDot = 1.0f;
+	if (axisLength > 0.0f)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			axis[a] /= axisLength;
+		}
+		for (size_t i = 0; i < normalCount; i++)
+		{
+			minDot = std::min(minDot, Dot(normals[i], axis));
+		}
+	}
+	std::copy(axis, axis + 3, bounds.coneAxis);
+	std::copy(bounds.center, bounds.center + 3, bounds.coneApex);
+
+	// Wider than about 84 degrees the cone would only cull from directly behind
+	if (normalCount == 0 || axisLength == 0.0f || minDot <= 0.1f)
+	{
+		bounds.coneCutoff = 1.0f;
+		return;
+	}
+
+	// Back the apex off along the axis until it is behind every triangle's plane; then any eye whose
+	// direction to the apex is within 90 degrees minus the cone's half angle of the axis sees only back faces
+	float maxT = 0.0f;
+	for (size_t i = 0; i < normalCount; i++)
+	{
+		float toCenter[3] = { bounds.center[0] - origins[i][0], bounds.center[1] - origins[i][1], bounds.center[2] - origins[i][2] };
+		maxT = std::max(maxT, Dot(toCenter, normals[i]) / Dot(axis, normals[i]));
+	}
+	for (int a = 0; a < 3; a++)
+	{
+		bounds.coneApex[a] = bounds.center[a] - axis[a] * maxT;
+	}
+	bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void BuildMeshlets(const void* positions, size_t positionStride, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, MeshletMesh& out,
+	size_t maxVertices, size_t maxTriangles)
+{
+	out.meshlets.clear();
+	out.bounds.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+	maxVertices = std::min(std::max<size_t>(maxVertices, 3), MaxMeshletVertices);
+	maxTriangles = std::min(std::max<size_t>(maxTriangles, 1), MaxMeshletTriangles);
+	size_t triangleCount = indexCount / 3;
+
+	// Triangles around each vertex, and how many of them are still unused
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			adjacency[cursor[indices[i]]++] = uint32_t(i / 3);
+		}
+	}
+
+	std::vector<uint8_t> used(triangleCount, 0);
+	std::vector<uint8_t> local(vertexCount, Absent);
+	Meshlet meshlet = {};
+	float boxMin[3];
+	float boxMax[3];
+
+	auto finish = [&]()
+	{
+		if (meshlet.triangleCount == 0)
+		{
+			return;
+		}
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			local[out.vertices[meshlet.vertexOffset + i]] = Absent;
+		}
+		MeshletBounds bounds;
+		ComputeBounds(positions, positionStride, out, meshlet, bounds);
+		out.meshlets.push_back(meshlet);
+		out.bounds.push_back(bounds);
+		meshlet = { uint32_t(out.vertices.size()), 0, uint32_t(out.triangles.size()), 0 };
+	};
+
+	auto add = [&](size_t triangle)
+	{
+		const uint32_t* corners = &indices[triangle * 3];
+		uint32_t packed = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t v = corners[c];
+			if (local[v] == Absent)
+			{
+				local[v] = uint8_t(meshlet.vertexCount++);
+				out.vertices.push_back(v);
+				const float* p = GetPosition(positions, positionStride, v);
+				for (int a = 0; a < 3; a++)
+				{
+					boxMin[a] = meshlet.vertexCount == 1 ? p[a] : std::min(boxMin[a], p[a]);
+					boxMax[a] = meshlet.vertexCount == 1 ? p[a] : std::max(boxMax[a], p[a]);
+				}
+			}
+			liveTriangles[v]--;
+			packed |= uint32_t(local[v]) << (c * 8);
+		}
+		out.triangles.push_back(packed);
+		meshlet.triangleCount++;
+		used[triangle] = 1;
+	};
+
+	size_t seed = 0;
+	for (size_t remaining = triangleCount; remaining > 0; remaining--)
+	{
+		// Connected triangle adding the fewest vertices
+		size_t best = triangleCount;
+		int bestNew = 4;
+		for (uint32_t i = 0; i < meshlet.vertexCount && bestNew > 0; i++)
+		{
+			uint32_t v = out.vertices[meshlet.vertexOffset + i];
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+			for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+			{
+				uint32_t t = adjacency[a];
+				if (used[t])
+				{
+					continue;
+				}
+				int added = CountNewVertices(&indices[t * 3], local);
+				if (added < bestNew && meshlet.vertexCount + added <= maxVertices)
+				{
+					best = t;
+					bestNew = added;
+					if (added == 0)
+					{
+						break;
+					}
+				}
+			}
+		}
+
+		if (best == triangleCount)
+		{
+			// Nothing connected fits. The next triangle in index order joins only if it is close by,
+			// otherwise it starts a new meshlet.
+			while (used[seed])
+			{
+				seed++;
+			}
+			best = seed;
+			if (meshlet.triangleCount > 0)
+			{
+				const uint32_t* corners = &indices[best * 3];
+				bool nearby = meshlet.vertexCount + CountNewVertices(corners, local) <= maxVertices;
+				for (int c = 0; c < 3 && nearby; c++)
+				{
+					const float* p = GetPosition(positions, positionStride, corners[c]);
+					for (int a = 0; a < 3; a++)
+					{
+						float margin = (boxMax[a] - boxMin[a]) * 0.5f;
+						nearby = nearby && p[a] >= boxMin[a] - margin && p[a] <= boxMax[a] + margin;
+					}
+				}
+				if (!nearby)
+				{
+					finish();
+				}
+			}
+		}
+
+		add(best);
+		if (meshlet.triangleCount == maxTriangles)
+		{
+			finish();
+		}
+	}
+	finish();
+}
+
+void AppendMeshlets(MeshletMesh& mesh, const MeshletMesh& part)
+{
+	uint32_t vertexOffset = uint32_t(mesh.vertices.size());
+	uint32_t triangleOffset = uint32_t(mesh.triangles.size());
+	for (Meshlet meshlet : part.meshlets)
+	{
+		meshlet.vertexOffset += vertexOffset;
+		meshlet.triangleOffset += triangleOffset;
+		mesh.meshlets.push_back(meshlet);
+	}
+	mesh.bounds.insert(mesh.bounds.end(), part.bounds.begin(), part.bounds.end());
+	mesh.vertices.insert(mesh.vertices.end(), part.vertices.begin(), part.vertices.end());
+	mesh.triangles.insert(mesh.triangles.end(), part.triangles.begin(), part.triangles.end());
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits an indexed triangle list into meshlets: small clusters of at most 64 vertices and 124
+// triangles that a mesh shader group can process at once and that are small enough to cull one by one.
+
+static constexpr size_t MaxMeshletVertices = 64;
+static constexpr size_t MaxMeshletTriangles = 124;
+
+// Mirrored by resource/Meshlets.hlsl
+struct Meshlet
+{
+	uint32_t vertexOffset;    // first entry in MeshletMesh::vertices
+	uint32_t vertexCount;
+	uint32_t triangleOffset;  // first entry in MeshletMesh::triangles
+	uint32_t triangleCount;
+};
+static_assert(sizeof(Meshlet) == 16, "Meshlet must match the HLSL structure");
+
+// Object-space bounds. The normal cone holds every triangle normal of the meshlet; seen from any point
+// where dot(normalize(coneApex - eye), coneAxis) > coneCutoff all of them face away.
+// Front faces are clockwise, as in the default D3D rasterizer state.
+struct MeshletBounds
+{
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneCutoff;         // 1 when the normals spread too far for the cone to ever cull
+	float coneAxis[3];
+	float pad;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	std::vector<uint32_t> vertices;   // indices into the source vertex buffer
+	std::vector<uint32_t> triangles;  // three local vertex indices per triangle, 8 bits each
+
+	size_t GetTriangleCount() const { return triangles.size(); }
+};
+
+// Local corner c (0-2) of a packed triangle
+inline uint32_t MeshletCorner(uint32_t triangle, int c) { return (triangle >> (c * 8)) & 0xff; }
+
+// Grows each meshlet from a seed triangle through shared vertices, preferring triangles that add the
+// fewest new vertices, so clusters stay compact and their bounds tight. When nothing connected fits,
+// the next unused triangle in index order seeds the following meshlet.
+// positions are 3 floats at positionStride bytes apart; limits may be lowered but not raised.
+void BuildMeshlets(const void* positions, size_t positionStride, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, MeshletMesh& out,
+	size_t maxVertices = MaxMeshletVertices, size_t maxTriangles = MaxMeshletTriangles);
+
+// Appends the meshlets of part to mesh, e.g. one LOD level after another; part's meshlets keep their
+// order and become a contiguous range of mesh.meshlets.
+void AppendMeshlets(MeshletMesh& mesh, const MeshletMesh& part);
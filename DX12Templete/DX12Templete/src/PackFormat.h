@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// On-disk layout of an asset pack (.pak), written by tools/AssetPack and mounted by VirtualFileSystem.
+// Many small files in one mapping: a lookup is a binary search over path hashes instead of a file
+// system call, and every stored file is a view into the one mapping. Large files may be compressed,
+// trading a parallel decompression for the disk reads it saves.
+//
+//   Header
+//   Entry[entryCount]   sorted by (hash, path)
+//   paths               UTF-8, not terminated, as VirtualFileSystem::NormalizePath leaves them
+//   files               each starting on a DataAlignment boundary
+namespace PackFormat
+{
+	static constexpr uint32_t Magic = 0x4b415056; // "VPAK"
+	static constexpr uint32_t Version = 2;
+	static constexpr uint32_t DataAlignment = 64;
+
+	enum EntryFlags : uint32_t
+	{
+		CompressedEntry = 1,  // stored as a CompressedStream that decompresses to size bytes
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t dataAlignment;
+		uint64_t entryOffset;
+		uint64_t pathOffset;
+		uint64_t pathSize;
+		uint64_t fileSize;
+	};
+
+	struct Entry
+	{
+		uint64_t hash;        // HashPath of the path
+		uint64_t offset;      // from the start of the file
+		uint64_t storedSize;  // bytes at offset
+		uint64_t size;        // bytes a read returns
+		uint32_t pathOffset;  // from Header::pathOffset
+		uint32_t pathLength;
+		uint32_t flags;
+		uint32_t pad;
+	};
+
+	static_assert(sizeof(Header) == 48, "PackFormat::Header layout changed");
+	static_assert(sizeof(Entry) == 48, "PackFormat::Entry layout changed");
+
+	static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// 64-bit FNV-1a
+	static inline uint64_t HashPath(const char* path, size_t length)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= static_cast<uint8_t>(path[i]);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	// Entry order: by hash, then by path for the rare collision
+	static inline int ComparePath(uint64_t hashA, const char* pathA, size_t lengthA, uint64_t hashB, const char* pathB, size_t lengthB)
+	{
+		if (hashA != hashB)
+		{
+			return hashA < hashB ? -1 : 1;
+		}
+		int cmp = memcmp(pathA, pathB, lengthA < lengthB ? lengthA : lengthB);
+		if (cmp != 0)
+		{
+			return cmp;
+		}
+		return lengthA == lengthB ? 0 : (lengthA < lengthB ? -1 : 1);
+	}
+}
@@ -0,0 +1,90 @@
+#include "RangeAllocator.h"
+
+uint32_t RangeAllocator::Allocate(uint32_t count)
+{
+	if (count == 0)
+	{
+		return InvalidOffset;
+	}
+	// Smallest free range that fits, lowest offset among equals
+	auto best = mBySize.lower_bound({ count, 0 });
+	if (best == mBySize.end())
+	{
+		return InvalidOffset;
+	}
+	uint32_t offset = best->second;
+	uint32_t size = best->first;
+	Erase(mByOffset.find(offset));
+	if (size > count)
+	{
+		Insert(offset + count, size - count);
+	}
+	mUsed += count;
+	return offset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	mUsed -= count;
+
+	auto next = mByOffset.lower_bound(offset);
+	if (next != mByOffset.end() && offset + count == next->first)
+	{
+		count += next->second;
+		Erase(next);
+	}
+	auto previous = mByOffset.lower_bound(offset);
+	if (previous != mByOffset.begin())
+	{
+		--previous;
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			count += previous->second;
+			Erase(previous);
+		}
+	}
+	Insert(offset, count);
+}
+
+void RangeAllocator::Grow(uint32_t capacity)
+{
+	if (capacity <= mCapacity)
+	{
+		return;
+	}
+	// Handing the new tail to Free merges it with a free range ending at the old capacity
+	uint32_t added = capacity - mCapacity;
+	uint32_t offset = mCapacity;
+	mCapacity = capacity;
+	mUsed += added;
+	Free(offset, added);
+}
+
+void RangeAllocator::Reset(uint32_t capacity)
+{
+	mCapacity = capacity;
+	mUsed = 0;
+	mByOffset.clear();
+	mBySize.clear();
+	if (capacity > 0)
+	{
+		Insert(0, capacity);
+	}
+}
+
+void RangeAllocator::Insert(uint32_t offset, uint32_t count)
+{
+	mByOffset.emplace(offset, count);
+	mBySize.emplace(count, offset);
+}
+
+void RangeAllocator::Erase(std::map<uint32_t, uint32_t>::iterator range)
+{
+	mBySize.erase({ range->second, range->first });
+	mByOffset.erase(range);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+// Suballocates [0, capacity) in element units, e.g. vertices or indices of one big buffer.
+// Allocation is best fit, so small meshes fill the holes other small meshes left behind, and freed
+// ranges merge with free neighbours. Nothing here touches D3D; GeometryBuffer owns the memory.
+class RangeAllocator
+{
+public:
+	static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+	explicit RangeAllocator(uint32_t capacity = 0) { Reset(capacity); }
+
+	// InvalidOffset when no free range is large enough; zero-sized ranges are never handed out
+	uint32_t Allocate(uint32_t count);
+	void Free(uint32_t offset, uint32_t count);
+	// Adds free space at the end, merging with a free tail
+	void Grow(uint32_t capacity);
+	// Forgets every allocation
+	void Reset(uint32_t capacity);
+
+	uint32_t GetCapacity() const { return mCapacity; }
+	uint32_t GetUsed() const { return mUsed; }
+	uint32_t GetLargestFree() const { return mBySize.empty() ? 0 : mBySize.rbegin()->first; }
+	size_t GetFreeRangeCount() const { return mByOffset.size(); }
+
+private:
+	void Insert(uint32_t offset, uint32_t count);
+	void Erase(std::map<uint32_t, uint32_t>::iterator range);
+
+	uint32_t mCapacity = 0;
+	uint32_t mUsed = 0;
+	std::map<uint32_t, uint32_t> mByOffset;          // free ranges: offset -> count
+	std::set<std::pair<uint32_t, uint32_t>> mBySize; // the same ranges as (count, offset)
+};
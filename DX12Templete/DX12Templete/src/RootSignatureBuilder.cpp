@@ -0,0 +1,410 @@
+#include "RootSignatureBuilder.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <wrl/client.h>
+
+using Microsoft::WRL::ComPtr;
+
+enum StageBit
+{
+	StageVertex = 1 << 0,
+	StageHull = 1 << 1,
+	StageDomain = 1 << 2,
+	StageGeometry = 1 << 3,
+	StagePixel = 1 << 4,
+	StageAmplification = 1 << 5,
+	StageMesh = 1 << 6,
+	StageAll = 1 << 7,
+};
+
+static UINT StageBitFromVisibility(D3D12_SHADER_VISIBILITY visibility)
+{
+	switch (visibility)
+	{
+	case D3D12_SHADER_VISIBILITY_VERTEX: return StageVertex;
+	case D3D12_SHADER_VISIBILITY_HULL: return StageHull;
+	case D3D12_SHADER_VISIBILITY_DOMAIN: return StageDomain;
+	case D3D12_SHADER_VISIBILITY_GEOMETRY: return StageGeometry;
+	case D3D12_SHADER_VISIBILITY_PIXEL: return StagePixel;
+	case D3D12_SHADER_VISIBILITY_AMPLIFICATION: return StageAmplification;
+	case D3D12_SHADER_VISIBILITY_MESH: return StageMesh;
+	default: return StageAll;
+	}
+}
+
+static BOOL GetRangeType(D3D_SHADER_INPUT_TYPE type, D3D12_DESCRIPTOR_RANGE_TYPE* rangeType)
+{
+	switch (type)
+	{
+	case D3D_SIT_CBUFFER:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+		return TRUE;
+	case D3D_SIT_TBUFFER:
+	case D3D_SIT_TEXTURE:
+	case D3D_SIT_STRUCTURED:
+	case D3D_SIT_BYTEADDRESS:
+	case D3D_SIT_RTACCELERATIONSTRUCTURE:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		return TRUE;
+	case D3D_SIT_SAMPLER:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+		return TRUE;
+	case D3D_SIT_UAV_RWTYPED:
+	case D3D_SIT_UAV_RWSTRUCTURED:
+	case D3D_SIT_UAV_RWBYTEADDRESS:
+	case D3D_SIT_UAV_APPEND_STRUCTURED:
+	case D3D_SIT_UAV_CONSUME_STRUCTURED:
+	case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		*rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+RootSignatureBuilder& RootSignatureBuilder::AddShader(ID3D12ShaderReflection* reflection, D3D12_SHADER_VISIBILITY visibility)
+{
+	mStageMask |= StageBitFromVisibility(visibility);
+	if (reflection)
+	{
+		D3D12_SHADER_DESC desc;
+		reflection->GetDesc(&desc);
+		AddBindings(reflection, desc.BoundResources, visibility);
+	}
+	return *this;
+}
+
+RootSignatureBuilder& RootSignatureBuilder::AddFunction(ID3D12FunctionReflection* reflection)
+{
+	mStageMask |= StageAll;
+	if (reflection)
+	{
+		D3D12_FUNCTION_DESC desc;
+		reflection->GetDesc(&desc);
+		AddBindings(reflection, desc.BoundResources, D3D12_SHADER_VISIBILITY_ALL);
+	}
+	return *this;
+}
+
+template <class Reflection>
+void RootSignatureBuilder::AddBindings(Reflection* reflection, UINT boundResources, D3D12_SHADER_VISIBILITY visibility)
+{
+	for (UINT i = 0; i < boundResources; i++)
+	{
+		D3D12_SHADER_INPUT_BIND_DESC bind;
+		reflection->GetResourceBindingDesc(i, &bind);
+
+		Binding binding = {};
+		if (!GetRangeType(bind.Type, &binding.rangeType))
+		{
+			continue;
+		}
+		binding.name = bind.Name;
+		binding.type = bind.Type;
+		binding.shaderRegister = bind.BindPoint;
+		binding.space = bind.Space;
+		binding.count = bind.BindCount;
+		binding.visibility = visibility;
+		if (bind.Type == D3D_SIT_CBUFFER)
+		{
+			D3D12_SHADER_BUFFER_DESC cbDesc = {};
+			reflection->GetConstantBufferByName(bind.Name)->GetDesc(&cbDesc);
+			binding.size = cbDesc.Size;
+		}
+
+		// The same register seen from another stage widens the visibility
+		auto existing = std::find_if(mBindings.begin(), mBindings.end(), [&](const Binding& b) {
+			return b.rangeType == binding.rangeType && b.shaderRegister == binding.shaderRegister && b.space == binding.space;
+		});
+		if (existing == mBindings.end())
+		{
+			mBindings.push_back(binding);
+		}
+		else if (existing->visibility != visibility)
+		{
+			existing->visibility = D3D12_SHADER_VISIBILITY_ALL;
+		}
+	}
+}
+
+RootSignatureBuilder& RootSignatureBuilder::MarkStatic(const char* name)
+{
+	mStatic.push_back(name);
+	return *this;
+}
+
+RootSignatureBuilder& RootSignatureBuilder::AddStaticSampler(const char* name, const D3D12_STATIC_SAMPLER_DESC& desc)
+{
+	mStaticSamplers.push_back({ name, desc });
+	return *this;
+}
+
+BOOL RootSignatureBuilder::IsMarked(const std::vector<std::string>& names, const std::string& name) const
+{
+	return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+HRESULT RootSignatureBuilder::Build(ID3D12Device* device, ID3D12RootSignature** ppRootSignature, RootSignatureLayout* layout) const
+{
+	using Kind = RootSignatureLayout::Kind;
+
+	// Deterministic order so that equal inputs serialize to equal blobs
+	std::vector<Binding> bindings = mBindings;
+	std::sort(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b) {
+		if (a.rangeType != b.rangeType) return a.rangeType < b.rangeType;
+		if ((a.count == 0) != (b.count == 0)) return b.count == 0; // unbounded ranges last
+		if (a.space != b.space) return a.space < b.space;
+		return a.shaderRegister < b.shaderRegister;
+	});
+
+	// Static samplers cost nothing at the root and need no heap
+	std::vector<D3D12_STATIC_SAMPLER_DESC> staticSamplers;
+	bindings.erase(std::remove_if(bindings.begin(), bindings.end(), [&](const Binding& b) {
+		auto found = std::find_if(mStaticSamplers.begin(), mStaticSamplers.end(), [&](const std::pair<std::string, D3D12_STATIC_SAMPLER_DESC>& s) {
+			return s.first == b.name;
+		});
+		if (b.rangeType != D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER || found == mStaticSamplers.end())
+		{
+			return false;
+		}
+		D3D12_STATIC_SAMPLER_DESC sampler = found->second;
+		sampler.ShaderRegister = b.shaderRegister;
+		sampler.RegisterSpace = b.space;
+		sampler.ShaderVisibility = b.visibility;
+		staticSamplers.push_back(sampler);
+		return true;
+	}), bindings.end());
+
+	std::vector<Kind> kinds(bindings.size());
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const Binding& b = bindings[i];
+		BOOL rootBuffer = b.type == D3D_SIT_CBUFFER || b.type == D3D_SIT_STRUCTURED ||
+			b.type == D3D_SIT_BYTEADDRESS || b.type == D3D_SIT_RTACCELERATIONSTRUCTURE;
+		if (b.type == D3D_SIT_CBUFFER && b.count == 1 && b.size / 4 <= mRootConstantLimit)
+		{
+			kinds[i] = Kind::Constants;
+		}
+		else if (rootBuffer && b.count == 1)
+		{
+			kinds[i] = Kind::Descriptor;
+		}
+		else
+		{
+			kinds[i] = Kind::Table;
+		}
+	}
+
+	// Tables cost one DWORD per visibility and heap type, root descriptors two, constants their size
+	auto rootCost = [&]() {
+		UINT cost = 0;
+		std::vector<std::pair<D3D12_SHADER_VISIBILITY, BOOL>> tables;
+		for (size_t i = 0; i < bindings.size(); i++)
+		{
+			if (kinds[i] == Kind::Constants)
+			{
+				cost += bindings[i].size / 4;
+			}
+			else if (kinds[i] == Kind::Descriptor)
+			{
+				cost += 2;
+			}
+			else
+			{
+				auto key = std::make_pair(bindings[i].visibility, BOOL(bindings[i].rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER));
+				if (std::find(tables.begin(), tables.end(), key) == tables.end())
+				{
+					tables.push_back(key);
+					cost += 1;
+				}
+			}
+		}
+		return cost;
+	};
+	for (Kind demote : { Kind::Constants, Kind::Descriptor })
+	{
+		for (size_t i = 0; i < bindings.size() && rootCost() > MaxRootCost; i++)
+		{
+			if (kinds[i] == demote)
+			{
+				kinds[i] = (demote == Kind::Constants) ? Kind::Descriptor : Kind::Table;
+			}
+		}
+	}
+
+	RootSignatureLayout result;
+	std::vector<CD3DX12_ROOT_PARAMETER1> params;
+
+	// Frequently changing root arguments first
+	for (Kind kind : { Kind::Constants, Kind::Descriptor })
+	{
+		for (size_t i = 0; i < bindings.size(); i++)
+		{
+			if (kinds[i] != kind)
+			{
+				continue;
+			}
+			const Binding& b = bindings[i];
+			CD3DX12_ROOT_PARAMETER1 param;
+			if (kind == Kind::Constants)
+			{
+				param.InitAsConstants(b.size / 4, b.shaderRegister, b.space, b.visibility);
+			}
+			else
+			{
+				D3D12_ROOT_DESCRIPTOR_FLAGS flags = IsMarked(mStatic, b.name) ?
+					D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC : D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+				if (b.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV)
+				{
+					param.InitAsConstantBufferView(b.shaderRegister, b.space, flags, b.visibility);
+				}
+				else
+				{
+					param.InitAsShaderResourceView(b.shaderRegister, b.space, flags, b.visibility);
+				}
+			}
+			result.slots.push_back({ b.name, kind, UINT(params.size()), 0, kind == Kind::Constants ? b.size / 4 : 0 });
+			params.push_back(param);
+		}
+	}
+
+	// One table per visibility for CBV/SRV/UAV and one for samplers
+	std::vector<std::vector<CD3DX12_DESCRIPTOR_RANGE1>> tableRanges;
+	std::vector<std::pair<D3D12_SHADER_VISIBILITY, BOOL>> tableKeys;
+	std::vector<std::pair<size_t, UINT>> tableSlots; // binding, table index
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		if (kinds[i] != Kind::Table)
+		{
+			continue;
+		}
+		const Binding& b = bindings[i];
+		auto key = std::make_pair(b.visibility, BOOL(b.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER));
+		UINT table = UINT(std::find(tableKeys.begin(), tableKeys.end(), key) - tableKeys.begin());
+		if (table == tableKeys.size())
+		{
+			tableKeys.push_back(key);
+			tableRanges.emplace_back();
+		}
+
+		// Samplers have no data flags
+		D3D12_DESCRIPTOR_RANGE_FLAGS flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+		if (b.rangeType != D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
+		{
+			if (IsMarked(mStatic, b.name))
+			{
+				flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
+			}
+			else if (b.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_UAV)
+			{
+				flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+			}
+			else
+			{
+				flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+			}
+		}
+
+		UINT offset = 0;
+		for (const auto& range : tableRanges[table])
+		{
+			offset += range.NumDescriptors;
+		}
+		UINT count = b.count == 0 ? UINT_MAX : b.count;
+		tableRanges[table].emplace_back(b.rangeType, count, b.shaderRegister, b.space, flags, offset);
+		tableSlots.push_back({ i, table });
+	}
+	UINT firstTable = UINT(params.size());
+	for (size_t t = 0; t < tableRanges.size(); t++)
+	{
+		CD3DX12_ROOT_PARAMETER1 param;
+		param.InitAsDescriptorTable(UINT(tableRanges[t].size()), tableRanges[t].data(), tableKeys[t].first);
+		params.push_back(param);
+	}
+	for (const auto& tableSlot : tableSlots)
+	{
+		const Binding& b = bindings[tableSlot.first];
+		const auto& ranges = tableRanges[tableSlot.second];
+		auto range = std::find_if(ranges.begin(), ranges.end(), [&](const CD3DX12_DESCRIPTOR_RANGE1& r) {
+			return r.RangeType == b.rangeType && r.BaseShaderRegister == b.shaderRegister && r.RegisterSpace == b.space;
+		});
+		result.slots.push_back({ b.name, Kind::Table, firstTable + tableSlot.second, range->OffsetInDescriptorsFromTableStart, 0 });
+	}
+
+	// Graphics signatures deny root access to stages that have no shader
+	D3D12_ROOT_SIGNATURE_FLAGS flags = mFlags;
+	if (mStageMask != 0 && !(mStageMask & StageAll) && !(flags & D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE))
+	{
+		if (!(mStageMask & StageVertex)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS;
+		if (!(mStageMask & StageHull)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
+		if (!(mStageMask & StageDomain)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS;
+		if (!(mStageMask & StageGeometry)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+		if (!(mStageMask & StagePixel)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
+		// Runtimes that predate mesh shaders reject these flags; they also cannot answer OPTIONS7
+		D3D12_FEATURE_DATA_D3D12_OPTIONS7 options = {};
+		if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &options, sizeof(options))))
+		{
+			if (!(mStageMask & StageAmplification)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS;
+			if (!(mStageMask & StageMesh)) flags |= D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS;
+		}
+	}
+
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE feature = { D3D_ROOT_SIGNATURE_VERSION_1_1 };
+	if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &feature, sizeof(feature))))
+	{
+		feature.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	}
+
+	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC desc;
+	desc.Init_1_1(UINT(params.size()), params.data(), UINT(staticSamplers.size()), staticSamplers.data(), flags);
+
+	ComPtr<ID3DBlob> blob;
+	ComPtr<ID3DBlob> error;
+	HRESULT hr = D3DX12SerializeVersionedRootSignature(&desc, feature.HighestVersion, &blob, &error);
+	if (FAILED(hr))
+	{
+		if (error)
+		{
+			OutputDebugStringA(static_cast<const char*>(error->GetBufferPointer()));
+		}
+		return hr;
+	}
+
+	hr = RootSignatureCache::GetOrCreate(device, blob.Get(), ppRootSignature);
+	if (SUCCEEDED(hr) && layout)
+	{
+		*layout = std::move(result);
+	}
+	return hr;
+}
+
+static std::mutex gRootSignatureCacheMutex;
+// Per device, so one device's signatures are never handed to another and can be dropped with it
+static std::unordered_map<ID3D12Device*, std::unordered_map<std::string, ComPtr<ID3D12RootSignature>>> gRootSignatureCache;
+
+HRESULT RootSignatureCache::GetOrCreate(ID3D12Device* device, ID3DBlob* blob, ID3D12RootSignature** ppRootSignature)
+{
+	std::string key(static_cast<const char*>(blob->GetBufferPointer()), blob->GetBufferSize());
+
+	std::lock_guard<std::mutex> lock(gRootSignatureCacheMutex);
+	auto& signatures = gRootSignatureCache[device];
+	auto found = signatures.find(key);
+	if (found == signatures.end())
+	{
+		ComPtr<ID3D12RootSignature> rootSignature;
+		HRESULT hr = device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+		found = signatures.emplace(key, rootSignature).first;
+	}
+	return found->second.CopyTo(ppRootSignature);
+}
+
+void RootSignatureCache::Clear(ID3D12Device* device)
+{
+	std::lock_guard<std::mutex> lock(gRootSignatureCacheMutex);
+	gRootSignatureCache.erase(device);
+}
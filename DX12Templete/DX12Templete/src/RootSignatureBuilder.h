@@ -0,0 +1,104 @@
+#pragma once
+#include <d3d12.h>
+#include <d3d12shader.h>
+#include "stddef.h"
+#include "d3dx12.h"
+
+// Where each shader binding ended up in a generated root signature
+struct RootSignatureLayout
+{
+	enum class Kind
+	{
+		Constants,
+		Descriptor,
+		Table,
+	};
+
+	struct Slot
+	{
+		std::string name;
+		Kind kind;
+		UINT rootIndex;
+		UINT tableOffset;   // descriptors from the table start, Table only
+		UINT num32BitValues; // Constants only
+	};
+
+	std::vector<Slot> slots;
+
+	// -1 when the binding was stripped from every shader
+	int GetRootIndex(const char* name) const
+	{
+		const Slot* slot = Find(name);
+		return slot ? int(slot->rootIndex) : -1;
+	}
+	const Slot* Find(const char* name) const
+	{
+		for (const auto& slot : slots)
+		{
+			if (slot.name == name)
+			{
+				return &slot;
+			}
+		}
+		return nullptr;
+	}
+};
+
+// Derives a version 1.1 root signature from shader reflection.
+//   - constant buffers up to the root constant limit become root constants
+//   - other constant buffers and raw/structured/acceleration structure SRVs become root descriptors
+//   - everything else goes into one descriptor table per visibility (samplers into their own table)
+//   - samplers given a fixed description with AddStaticSampler are baked into the signature instead
+// Reflection cannot tell how often data changes, so callers mark bindings whose contents never change
+// after upload (DATA_STATIC).
+// Identical signatures are created once per device and shared.
+class RootSignatureBuilder
+{
+public:
+	static constexpr UINT DefaultRootConstantLimit = 16; // DWORDs per constant buffer
+	static constexpr UINT MaxRootCost = 64;              // DWORDs, D3D12 limit
+
+	RootSignatureBuilder& AddShader(ID3D12ShaderReflection* reflection, D3D12_SHADER_VISIBILITY visibility);
+	RootSignatureBuilder& AddFunction(ID3D12FunctionReflection* reflection);
+	RootSignatureBuilder& SetFlags(D3D12_ROOT_SIGNATURE_FLAGS flags) { mFlags = flags; return *this; }
+	RootSignatureBuilder& SetRootConstantLimit(UINT dwords) { mRootConstantLimit = dwords; return *this; }
+	RootSignatureBuilder& MarkStatic(const char* name);
+	// Register, space and visibility come from reflection; a sampler no shader uses is left out
+	RootSignatureBuilder& AddStaticSampler(const char* name, const D3D12_STATIC_SAMPLER_DESC& desc);
+
+	HRESULT Build(ID3D12Device* device, ID3D12RootSignature** ppRootSignature, RootSignatureLayout* layout = nullptr) const;
+
+private:
+	struct Binding
+	{
+		std::string name;
+		D3D_SHADER_INPUT_TYPE type;
+		D3D12_DESCRIPTOR_RANGE_TYPE rangeType;
+		UINT shaderRegister;
+		UINT space;
+		UINT count;
+		UINT size;  // constant buffers, bytes
+		D3D12_SHADER_VISIBILITY visibility;
+	};
+
+	template <class Reflection>
+	void AddBindings(Reflection* reflection, UINT boundResources, D3D12_SHADER_VISIBILITY visibility);
+
+	BOOL IsMarked(const std::vector<std::string>& names, const std::string& name) const;
+
+	std::vector<Binding> mBindings;
+	std::vector<std::string> mStatic;
+	std::vector<std::pair<std::string, D3D12_STATIC_SAMPLER_DESC>> mStaticSamplers;
+	D3D12_ROOT_SIGNATURE_FLAGS mFlags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+	UINT mRootConstantLimit = DefaultRootConstantLimit;
+	UINT mStageMask = 0;
+};
+
+// Serialized root signature blobs mapped to the objects created from them, per device.
+// Each renderer clears its device's entries on teardown, before it releases the device.
+class RootSignatureCache
+{
+public:
+	static HRESULT GetOrCreate(ID3D12Device* device, ID3DBlob* blob, ID3D12RootSignature** ppRootSignature);
+	static void Clear(ID3D12Device* device);
+};
@@ -0,0 +1,85 @@
+#include "ShaderArchive.h"
+
+using namespace ShaderArchiveFormat;
+
+BOOL ShaderArchive::Open(const VirtualFileSystem& files, const std::string& name)
+{
+	Close();
+
+	if (!files.Read(name, &mFile))
+	{
+		return FALSE;
+	}
+
+	const uint8_t* base = static_cast<const uint8_t*>(mFile.GetData());
+	const size_t fileSize = mFile.GetSize();
+	if (fileSize < sizeof(Header))
+	{
+		Close();
+		return FALSE;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(base);
+	if (header->magic != Magic || header->version != Version)
+	{
+		Close();
+		return FALSE;
+	}
+
+	// Subtracted rather than added, so a huge offset cannot wrap past the check
+	if (header->entryOffset % alignof(Entry) != 0 || header->entryOffset > fileSize ||
+		header->entryCount > (fileSize - header->entryOffset) / sizeof(Entry))
+	{
+		Close();
+		return FALSE;
+	}
+
+	const Entry* entries = reinterpret_cast<const Entry*>(base + header->entryOffset);
+	for (uint32_t i = 0; i < header->entryCount; i++)
+	{
+		if (entries[i].offset > fileSize || entries[i].size > fileSize - entries[i].offset)
+		{
+			Close();
+			return FALSE;
+		}
+	}
+
+	mEntries = entries;
+	mEntryCount = header->entryCount;
+	return TRUE;
+}
+
+void ShaderArchive::Close()
+{
+	mFile.Reset();
+	mEntries = nullptr;
+	mEntryCount = 0;
+}
+
+BOOL ShaderArchive::Find(const char* name, D3D12_SHADER_BYTECODE* bytecode) const
+{
+	// Entries are sorted by name by the packer
+	UINT lo = 0;
+	UINT hi = mEntryCount;
+	while (lo < hi)
+	{
+		UINT mid = (lo + hi) / 2;
+		int cmp = CompareName(mEntries[mid], name);
+		if (cmp == 0)
+		{
+			const uint8_t* base = static_cast<const uint8_t*>(mFile.GetData());
+			bytecode->pShaderBytecode = base + mEntries[mid].offset;
+			bytecode->BytecodeLength = static_cast<SIZE_T>(mEntries[mid].size);
+			return TRUE;
+		}
+		if (cmp < 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return FALSE;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <d3d12.h>
+#include "stddef.h"
+#include "VirtualFileSystem.h"
+#include "ShaderArchiveFormat.h"
+
+// Packed shader archive, mapped once. Lookups return views straight into the mapping,
+// so the archive must outlive every pipeline created from its bytecode. It may sit loose or in a pack.
+class ShaderArchive
+{
+public:
+	ShaderArchive() {}
+	~ShaderArchive() { Close(); }
+
+	BOOL Open(const VirtualFileSystem& files, const std::string& name);
+	void Close();
+
+	BOOL IsOpen() const { return mFile.IsValid(); }
+	BOOL Find(const char* name, D3D12_SHADER_BYTECODE* bytecode) const;
+	UINT GetEntryCount() const { return mEntryCount; }
+private:
+	FileView mFile;
+	const ShaderArchiveFormat::Entry* mEntries = nullptr;
+	UINT mEntryCount = 0;
+};
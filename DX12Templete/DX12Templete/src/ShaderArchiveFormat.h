@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// On-disk layout of a packed shader archive (Shaders.pak).
+// Shared by the runtime loader and the offline packer, so it must stay free of platform headers.
+//
+//   ShaderArchiveHeader
+//   ShaderArchiveEntry[entryCount]   sorted by name
+//   blobs                            each starting on a BlobAlignment boundary
+namespace ShaderArchiveFormat
+{
+	static constexpr uint32_t Magic = 0x41535844; // "DXSA"
+	static constexpr uint32_t Version = 1;
+	static constexpr uint32_t BlobAlignment = 64;
+	static constexpr uint32_t MaxNameLength = 64;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t blobAlignment;
+		uint64_t entryOffset;
+		uint64_t dataOffset;
+	};
+
+	struct Entry
+	{
+		char     name[MaxNameLength];
+		uint64_t offset;  // from the start of the file
+		uint64_t size;
+	};
+
+	static_assert(sizeof(Header) == 32, "ShaderArchiveFormat::Header layout changed");
+	static_assert(sizeof(Entry) == 80, "ShaderArchiveFormat::Entry layout changed");
+
+	static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	static inline int CompareName(const Entry& entry, const char* name)
+	{
+		return strncmp(entry.name, name, MaxNameLength);
+	}
+}
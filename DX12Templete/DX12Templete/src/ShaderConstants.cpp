@@ -0,0 +1,38 @@
+#include "ShaderConstants.h"
+
+using namespace DirectX;
+
+void StoreFrameConstants(FXMMATRIX view, CXMMATRIX proj, FXMVECTOR cameraPosition, FrameConstants* out)
+{
+	XMStoreFloat4x4(&out->viewProj, XMMatrixTranspose(XMMatrixMultiply(view, proj)));
+	XMStoreFloat4x4(&out->view, XMMatrixTranspose(view));
+	XMStoreFloat4x4(&out->proj, XMMatrixTranspose(proj));
+	XMStoreFloat3(&out->cameraPosition, cameraPosition);
+	out->pad = 0.0f;
+}
+
+void StoreObjectConstants(FXMMATRIX viewProj, const XMMATRIX* worlds, const ObjectGeometry* geometry,
+	size_t count, void* out, size_t stride)
+{
+	unsigned char* dst = static_cast<unsigned char*>(out);
+	for (size_t i = 0; i < count; i++, dst += stride)
+	{
+		// Upload heaps are write-combined, fill each object front to back and never read it back
+		ObjectConstants* constants = reinterpret_cast<ObjectConstants*>(dst);
+		// diag(scale) then bias, applied before world: scale the rows and move the origin
+		const VertexQuantization& decode = geometry[i].decode;
+		XMMATRIX world;
+		world.r[0] = XMVectorScale(worlds[i].r[0], decode.scale[0]);
+		world.r[1] = XMVectorScale(worlds[i].r[1], decode.scale[1]);
+		world.r[2] = XMVectorScale(worlds[i].r[2], decode.scale[2]);
+		world.r[3] = XMVectorMultiplyAdd(XMVectorReplicate(decode.bias[0]), worlds[i].r[0],
+			XMVectorMultiplyAdd(XMVectorReplicate(decode.bias[1]), worlds[i].r[1],
+			XMVectorMultiplyAdd(XMVectorReplicate(decode.bias[2]), worlds[i].r[2], worlds[i].r[3])));
+		XMStoreFloat4x4(&constants->worldViewProj, XMMatrixTranspose(XMMatrixMultiply(world, viewProj)));
+		XMStoreFloat4x4(&constants->world, XMMatrixTranspose(world));
+		constants->baseVertex = geometry[i].baseVertex;
+		constants->pad[0] = 0;
+		constants->pad[1] = 0;
+		constants->pad[2] = 0;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include "CbufferLayout.h"
+#include "VertexLayout.h"
+
+// CPU mirrors of the constant buffers in resource/ShaderConstants.hlsli.
+// Matrices are stored transposed for HLSL's default column-major packing.
+
+// DirectXMath vectors mirror HLSL vectors, not structures
+template <> struct CbufferPacking<DirectX::XMFLOAT2> { static constexpr bool startsRegister = false; };
+template <> struct CbufferPacking<DirectX::XMFLOAT3> { static constexpr bool startsRegister = false; };
+template <> struct CbufferPacking<DirectX::XMFLOAT4> { static constexpr bool startsRegister = false; };
+
+// b0, written once per frame
+struct FrameConstants
+{
+	DirectX::XMFLOAT4X4 viewProj;
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 proj;
+	DirectX::XMFLOAT3 cameraPosition;
+	float pad;
+};
+static_assert(MatchesCbufferPacking({
+	CBUFFER_MEMBER(FrameConstants, viewProj),
+	CBUFFER_MEMBER(FrameConstants, view),
+	CBUFFER_MEMBER(FrameConstants, proj),
+	CBUFFER_MEMBER(FrameConstants, cameraPosition),
+	}, sizeof(FrameConstants)), "FrameConstants does not match the HLSL cbuffer");
+
+// b1, one per drawn object. Both matrices start from the mesh's quantized positions.
+struct ObjectConstants
+{
+	DirectX::XMFLOAT4X4 worldViewProj;
+	DirectX::XMFLOAT4X4 world;
+	uint32_t baseVertex; // for shaders that fetch vertices from the geometry buffer themselves
+	uint32_t pad[3];
+};
+static_assert(MatchesCbufferPacking({
+	CBUFFER_MEMBER(ObjectConstants, worldViewProj),
+	CBUFFER_MEMBER(ObjectConstants, world),
+	CBUFFER_MEMBER(ObjectConstants, baseVertex),
+	}, sizeof(ObjectConstants)), "ObjectConstants does not match the HLSL cbuffer");
+
+// What the object constants need from the mesh an object draws
+struct ObjectGeometry
+{
+	VertexQuantization decode;
+	uint32_t baseVertex = 0;
+};
+
+// Root constant buffer views must start on a 256 byte boundary
+static constexpr size_t ConstantBufferAlignment = 256;
+static constexpr size_t AlignConstantBufferSize(size_t size)
+{
+	return (size + ConstantBufferAlignment - 1) & ~(ConstantBufferAlignment - 1);
+}
+static constexpr size_t ObjectConstantsStride = AlignConstantBufferSize(sizeof(ObjectConstants));
+
+void StoreFrameConstants(DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj, DirectX::FXMVECTOR cameraPosition, FrameConstants* out);
+
+// Writes the constants of count objects, stride bytes apart, with each object's position decode
+// folded in front of its world matrix.
+// viewProj stays in registers for the whole batch, so each object costs one matrix multiply and two transposes.
+void StoreObjectConstants(DirectX::FXMMATRIX viewProj, const DirectX::XMMATRIX* worlds, const ObjectGeometry* geometry,
+	size_t count, void* out, size_t stride);
@@ -0,0 +1,75 @@
+#include "ShaderReflection.h"
+#include <d3dcompiler.h>
+#include "dxcapi.use.h"
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+using Microsoft::WRL::ComPtr;
+
+static dxc::DxcDllSupport gDxcReflectionDll;
+
+static constexpr UINT32 MakeFourCC(char a, char b, char c, char d)
+{
+	return UINT32(a) | (UINT32(b) << 8) | (UINT32(c) << 16) | (UINT32(d) << 24);
+}
+static constexpr UINT32 kPartDxil = MakeFourCC('D', 'X', 'I', 'L');
+static constexpr UINT32 kPartReflection = MakeFourCC('S', 'T', 'A', 'T');
+
+static HRESULT ReflectDxil(const D3D12_SHADER_BYTECODE& data, REFIID riid, void** ppReflection)
+{
+	HRESULT hr = gDxcReflectionDll.Initialize();
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	ComPtr<IDxcLibrary> library;
+	ComPtr<IDxcContainerReflection> container;
+	ComPtr<IDxcBlobEncoding> blob;
+	gDxcReflectionDll.CreateInstance(CLSID_DxcLibrary, library.GetAddressOf());
+	gDxcReflectionDll.CreateInstance(CLSID_DxcContainerReflection, container.GetAddressOf());
+	if (!library || !container)
+	{
+		return E_FAIL;
+	}
+
+	hr = library->CreateBlobWithEncodingFromPinned((LPBYTE)data.pShaderBytecode, (UINT32)data.BytecodeLength, 0, &blob);
+	if (SUCCEEDED(hr))
+	{
+		hr = container->Load(blob.Get());
+	}
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Full objects carry the DXIL part, stripped reflection blobs only the statistics part
+	UINT32 partIndex;
+	if (FAILED(container->FindFirstPartKind(kPartDxil, &partIndex)))
+	{
+		hr = container->FindFirstPartKind(kPartReflection, &partIndex);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+	return container->GetPartReflection(partIndex, riid, ppReflection);
+}
+
+ComPtr<ID3D12ShaderReflection> ReflectShader(const D3D12_SHADER_BYTECODE& reflectionData)
+{
+	ComPtr<ID3D12ShaderReflection> reflection;
+	if (FAILED(ReflectDxil(reflectionData, IID_PPV_ARGS(&reflection))))
+	{
+		// Shader model 5 objects from FxCompile
+		D3DReflect(reflectionData.pShaderBytecode, reflectionData.BytecodeLength, IID_PPV_ARGS(&reflection));
+	}
+	return reflection;
+}
+
+ComPtr<ID3D12LibraryReflection> ReflectLibrary(const D3D12_SHADER_BYTECODE& reflectionData)
+{
+	ComPtr<ID3D12LibraryReflection> reflection;
+	ReflectDxil(reflectionData, IID_PPV_ARGS(&reflection));
+	return reflection;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <d3d12.h>
+#include <d3d12shader.h>
+#include <wrl/client.h>
+#include "stddef.h"
+
+// Reflection for DXIL (through dxcompiler) and DXBC (through d3dcompiler) shader containers.
+// The data may be the shader object itself or a reflection-only blob written by ShaderBuild.
+Microsoft::WRL::ComPtr<ID3D12ShaderReflection> ReflectShader(const D3D12_SHADER_BYTECODE& reflectionData);
+Microsoft::WRL::ComPtr<ID3D12LibraryReflection> ReflectLibrary(const D3D12_SHADER_BYTECODE& reflectionData);
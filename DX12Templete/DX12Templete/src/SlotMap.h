@@ -0,0 +1,156 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Reference to an object in a SlotMap. The generation is bumped every time a slot is freed,
+// so handles to destroyed objects fail lookups instead of aliasing whatever reuses the slot.
+struct SlotHandle
+{
+	uint32_t index;
+	uint32_t generation;
+
+	bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Pool with O(1) create, lookup and destroy and densely packed storage for iteration.
+// Objects live in a contiguous array; destroying one moves the last object into its place.
+//
+// Objects the GPU may still be reading are retired with DestroyAfter: the handle is invalidated and
+// the object leaves the dense array immediately, but it is only released once
+// ReleaseRetired sees the fence value it was retired with.
+template <class T>
+class SlotMap
+{
+public:
+	static constexpr SlotHandle InvalidHandle = { UINT32_MAX, 0 };
+
+	template <class... Args>
+	SlotHandle Create(Args&&... args)
+	{
+		uint32_t index;
+		if (mFreeHead != UINT32_MAX)
+		{
+			index = mFreeHead;
+			mFreeHead = mSlots[index].dense;
+		}
+		else
+		{
+			index = uint32_t(mSlots.size());
+			mSlots.push_back({ 0, 0 });
+		}
+
+		mSlots[index].dense = uint32_t(mDense.size());
+		mDense.emplace_back(std::forward<Args>(args)...);
+		mDenseToSlot.push_back(index);
+		return { index, mSlots[index].generation };
+	}
+
+	void Destroy(SlotHandle handle)
+	{
+		if (!IsValid(handle))
+		{
+			return;
+		}
+		RemoveDense(handle);
+	}
+
+	// Keeps the object alive until the GPU has passed fenceValue
+	void DestroyAfter(SlotHandle handle, uint64_t fenceValue)
+	{
+		if (!IsValid(handle))
+		{
+			return;
+		}
+		mRetired.emplace_back(std::move(mDense[mSlots[handle.index].dense]), fenceValue);
+		RemoveDense(handle);
+	}
+
+	// Releases retired objects whose fence value has completed
+	void ReleaseRetired(uint64_t completedFenceValue)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < mRetired.size(); i++)
+		{
+			if (mRetired[i].second > completedFenceValue)
+			{
+				if (kept != i)
+				{
+					mRetired[kept] = std::move(mRetired[i]);
+				}
+				kept++;
+			}
+		}
+		mRetired.erase(mRetired.begin() + kept, mRetired.end());
+	}
+
+	void Clear()
+	{
+		mSlots.clear();
+		mDense.clear();
+		mDenseToSlot.clear();
+		mRetired.clear();
+		mFreeHead = UINT32_MAX;
+	}
+
+	bool IsValid(SlotHandle handle) const
+	{
+		return handle.index < mSlots.size() && mSlots[handle.index].generation == handle.generation;
+	}
+
+	T* Get(SlotHandle handle)
+	{
+		return IsValid(handle) ? &mDense[mSlots[handle.index].dense] : nullptr;
+	}
+	const T* Get(SlotHandle handle) const
+	{
+		return IsValid(handle) ? &mDense[mSlots[handle.index].dense] : nullptr;
+	}
+
+	// Dense iteration; order changes when objects are destroyed
+	size_t Size() const { return mDense.size(); }
+	T& operator[](size_t denseIndex) { return mDense[denseIndex]; }
+	const T& operator[](size_t denseIndex) const { return mDense[denseIndex]; }
+	SlotHandle GetHandle(size_t denseIndex) const
+	{
+		uint32_t index = mDenseToSlot[denseIndex];
+		return { index, mSlots[index].generation };
+	}
+	typename std::vector<T>::iterator begin() { return mDense.begin(); }
+	typename std::vector<T>::iterator end() { return mDense.end(); }
+	typename std::vector<T>::const_iterator begin() const { return mDense.begin(); }
+	typename std::vector<T>::const_iterator end() const { return mDense.end(); }
+
+private:
+	struct Slot
+	{
+		uint32_t dense;      // index into mDense, or the next free slot while free
+		uint32_t generation;
+	};
+
+	void RemoveDense(SlotHandle handle)
+	{
+		uint32_t dense = mSlots[handle.index].dense;
+		uint32_t last = uint32_t(mDense.size() - 1);
+		if (dense != last)
+		{
+			mDense[dense] = std::move(mDense[last]);
+			mDenseToSlot[dense] = mDenseToSlot[last];
+			mSlots[mDenseToSlot[dense]].dense = dense;
+		}
+		mDense.pop_back();
+		mDenseToSlot.pop_back();
+
+		mSlots[handle.index].generation++;
+		mSlots[handle.index].dense = mFreeHead;
+		mFreeHead = handle.index;
+	}
+
+	std::vector<Slot> mSlots;
+	std::vector<T> mDense;
+	std::vector<uint32_t> mDenseToSlot;
+	std::vector<std::pair<T, uint64_t>> mRetired;
+	uint32_t mFreeHead = UINT32_MAX;
+};
@@ -0,0 +1,430 @@
+#include "SoftwareOcclusion.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const uint64_t FullMask = ~uint64_t(0);
+
+// Bits lo..hi of one tile row
+static inline uint64_t RowBits(int lo, int hi)
+{
+	return lo > hi ? 0 : uint64_t((0xffu >> (7 - (hi - lo))) << lo);
+}
+
+// Coverage of the tile whose first pixel centre is (x0, y0). Row r holds bits 8r..8r+7.
+// For each row the edges bound the covered pixels to a span [lo, hi], so the work is per row, not per pixel.
+static uint64_t CoverageMask(const float edgeA[3], const float edgeB[3], const float edgeC[3], float x0, float y0)
+{
+	uint64_t mask = 0;
+#if OCCLUSION_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 rowOffsets[2] = { _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f) };
+	for (int half = 0; half < 2; half++)
+	{
+		__m128 y = _mm_add_ps(_mm_set1_ps(y0), rowOffsets[half]);
+		__m128 lo = zero;
+		__m128 hi = _mm_set1_ps(float(SoftwareOcclusion::TileSize - 1));
+		for (int e = 0; e < 3; e++)
+		{
+			// Edge value at the first pixel of each row; pixel i is covered while a * i + v >= 0
+			__m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeB[e]), y), _mm_set1_ps(edgeA[e] * x0 + edgeC[e]));
+			if (edgeA[e] > 0.0f)
+			{
+				lo = _mm_max_ps(lo, _mm_div_ps(_mm_sub_ps(zero, v), _mm_set1_ps(edgeA[e])));
+			}
+			else if (edgeA[e] < 0.0f)
+			{
+				hi = _mm_min_ps(hi, _mm_div_ps(_mm_sub_ps(zero, v), _mm_set1_ps(edgeA[e])));
+			}
+			else
+			{
+				lo = _mm_max_ps(lo, _mm_and_ps(_mm_cmplt_ps(v, zero), _mm_set1_ps(8.0f)));
+			}
+		}
+
+		// ceil(lo) with lo in [0, 8] and floor(hi) with hi in [-1, 7], using truncation only
+		lo = _mm_min_ps(lo, _mm_set1_ps(8.0f));
+		__m128i loInt = _mm_cvttps_epi32(lo);
+		loInt = _mm_sub_epi32(loInt, _mm_castps_si128(_mm_cmpgt_ps(lo, _mm_cvtepi32_ps(loInt))));
+		hi = _mm_max_ps(hi, _mm_set1_ps(-1.0f));
+		__m128i hiInt = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(hi, _mm_set1_ps(1.0f))), _mm_set1_epi32(1));
+
+		alignas(16) int32_t loRows[4];
+		alignas(16) int32_t hiRows[4];
+		_mm_store_si128((__m128i*)loRows, loInt);
+		_mm_store_si128((__m128i*)hiRows, hiInt);
+		for (int r = 0; r < 4; r++)
+		{
+			mask |= RowBits(loRows[r], hiRows[r]) << ((half * 4 + r) * 8);
+		}
+	}
+#else
+	for (int r = 0; r < SoftwareOcclusion::TileSize; r++)
+	{
+		float y = y0 + float(r);
+		float lo = 0.0f;
+		float hi = float(SoftwareOcclusion::TileSize - 1);
+		for (int e = 0; e < 3; e++)
+		{
+			float v = edgeB[e] * y + (edgeA[e] * x0 + edgeC[e]);
+			if (edgeA[e] > 0.0f)
+			{
+				lo = std::max(lo, -v / edgeA[e]);
+			}
+			else if (edgeA[e] < 0.0f)
+			{
+				hi = std::min(hi, -v / edgeA[e]);
+			}
+			else if (v < 0.0f)
+			{
+				lo = 8.0f;
+			}
+		}
+		mask |= RowBits(int(std::ceil(std::min(lo, 8.0f))), int(std::floor(std::max(hi, -1.0f)))) << (r * 8);
+	}
+#endif
+	return mask;
+}
+
+SoftwareOcclusion::SoftwareOcclusion(int width, int height)
+{
+	SetResolution(width, height);
+	for (int i = 0; i < 16; i++)
+	{
+		mViewProj[i] = (i % 5) == 0 ? 1.0f : 0.0f;
+	}
+}
+
+void SoftwareOcclusion::SetResolution(int width, int height)
+{
+	mTilesX = std::max(1, (width + TileSize - 1) / TileSize);
+	mTilesY = std::max(1, (height + TileSize - 1) / TileSize);
+	mWidth = mTilesX * TileSize;
+	mHeight = mTilesY * TileSize;
+	mTiles.assign(size_t(mTilesX) * mTilesY, { 0, 1.0f, 1.0f });
+	mBins.assign(mTilesY, {});
+
+	mHierarchy.clear();
+	int levelWidth = mTilesX;
+	int levelHeight = mTilesY;
+	for (;;)
+	{
+		mHierarchy.push_back({ levelWidth, levelHeight, std::vector<float>(size_t(levelWidth) * levelHeight, 1.0f) });
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void SoftwareOcclusion::Begin(const float viewProj[16])
+{
+	memcpy(mViewProj, viewProj, sizeof(mViewProj));
+	std::fill(mTiles.begin(), mTiles.end(), Tile{ 0, 1.0f, 1.0f });
+	mTriangles.clear();
+	for (std::vector<uint32_t>& bin : mBins)
+	{
+		bin.clear();
+	}
+}
+
+void SoftwareOcclusion::AddOccluder(const float* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const float world[16])
+{
+	// Object to clip in one matrix: row vectors, so world comes first
+	float m[16];
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m[r * 4 + c] = world[r * 4 + 0] * mViewProj[0 * 4 + c] + world[r * 4 + 1] * mViewProj[1 * 4 + c] +
+				world[r * 4 + 2] * mViewProj[2 * 4 + c] + world[r * 4 + 3] * mViewProj[3 * 4 + c];
+		}
+	}
+
+	mClip.resize(vertexCount * 4);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* p = positions + i * 3;
+		for (int c = 0; c < 4; c++)
+		{
+			mClip[i * 4 + c] = p[0] * m[0 * 4 + c] + p[1] * m[1 * 4 + c] + p[2] * m[2 * 4 + c] + m[3 * 4 + c];
+		}
+	}
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		bool clipped = false;
+		for (int v = 0; v < 3; v++)
+		{
+			const float* clip = &mClip[size_t(indices[i + v]) * 4];
+			if (clip[2] < 0.0f || clip[3] <= 0.0f)
+			{
+				clipped = true;
+				break;
+			}
+			float invW = 1.0f / clip[3];
+			x[v] = (clip[0] * invW * 0.5f + 0.5f) * float(mWidth);
+			y[v] = (0.5f - clip[1] * invW * 0.5f) * float(mHeight);
+			z[v] = clip[2] * invW;
+		}
+		if (clipped)
+		{
+			continue;
+		}
+
+		// Pixel centres inside the bounding box, clamped to the screen
+		int minX = std::max(0, int(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f)));
+		int maxX = std::min(mWidth - 1, int(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f)));
+		int minY = std::max(0, int(std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f)));
+		int maxY = std::min(mHeight - 1, int(std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f)));
+		if (minX > maxX || minY > maxY)
+		{
+			continue;
+		}
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area == 0.0f)
+		{
+			continue;
+		}
+		// Both windings are occluders; flip the edges so the inside is positive
+		float sign = area > 0.0f ? 1.0f : -1.0f;
+
+		Triangle triangle;
+		for (int e = 0; e < 3; e++)
+		{
+			int a = e;
+			int b = (e + 1) % 3;
+			triangle.edgeA[e] = sign * (y[a] - y[b]);
+			triangle.edgeB[e] = sign * (x[b] - x[a]);
+			triangle.edgeC[e] = sign * (x[a] * y[b] - x[b] * y[a]);
+		}
+		triangle.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		triangle.depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+		triangle.depthC = z[0] - triangle.depthA * x[0] - triangle.depthB * y[0];
+		triangle.zMax = std::max({ z[0], z[1], z[2] });
+		triangle.tileMinX = minX / TileSize;
+		triangle.tileMaxX = maxX / TileSize;
+		triangle.tileMinY = minY / TileSize;
+		triangle.tileMaxY = maxY / TileSize;
+
+		uint32_t index = uint32_t(mTriangles.size());
+		mTriangles.push_back(triangle);
+		for (int tileY = triangle.tileMinY; tileY <= triangle.tileMaxY; tileY++)
+		{
+			mBins[tileY].push_back(index);
+		}
+	}
+}
+
+void SoftwareOcclusion::UpdateTile(Tile& tile, uint64_t mask, float z)
+{
+	if (z >= tile.zFar)
+	{
+		return;
+	}
+	// A triangle nearer the reference than the working layer would only push the working
+	// layer back; start a new working layer from it instead
+	if (tile.mask != 0 && z - tile.zWork > tile.zFar - z)
+	{
+		tile.mask = 0;
+	}
+	tile.zWork = tile.mask != 0 ? std::max(tile.zWork, z) : z;
+	tile.mask |= mask;
+	if (tile.mask == FullMask)
+	{
+		tile.zFar = std::min(tile.zFar, tile.zWork);
+		tile.mask = 0;
+	}
+}
+
+void SoftwareOcclusion::RasterizeTileRow(int tileY)
+{
+	float y0 = float(tileY * TileSize) + 0.5f;
+	float y1 = y0 + float(TileSize - 1);
+	for (uint32_t index : mBins[tileY])
+	{
+		const Triangle& triangle = mTriangles[index];
+		for (int tileX = triangle.tileMinX; tileX <= triangle.tileMaxX; tileX++)
+		{
+			float x0 = float(tileX * TileSize) + 0.5f;
+			float x1 = x0 + float(TileSize - 1);
+			uint64_t mask = CoverageMask(triangle.edgeA, triangle.edgeB, triangle.edgeC, x0, y0);
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			// The depth plane is largest at a corner of the tile's pixel centres; past the
+			// triangle it extrapolates, so it is also capped by the farthest vertex
+			float zx = std::max(triangle.depthA * x0, triangle.depthA * x1);
+			float zy = std::max(triangle.depthB * y0, triangle.depthB * y1);
+			float z = std::min(triangle.zMax, zx + zy + triangle.depthC);
+
+			UpdateTile(mTiles[tileY * mTilesX + tileX], mask, z);
+		}
+	}
+}
+
+void SoftwareOcclusion::BuildHierarchy()
+{
+	Level& base = mHierarchy[0];
+	for (size_t i = 0; i < mTiles.size(); i++)
+	{
+		base.depth[i] = mTiles[i].zFar;
+	}
+	for (size_t level = 1; level < mHierarchy.size(); level++)
+	{
+		const Level& source = mHierarchy[level - 1];
+		Level& target = mHierarchy[level];
+		for (int y = 0; y < target.height; y++)
+		{
+			int sy0 = y * 2;
+			int sy1 = std::min(sy0 + 1, source.height - 1);
+			for (int x = 0; x < target.width; x++)
+			{
+				int sx0 = x * 2;
+				int sx1 = std::min(sx0 + 1, source.width - 1);
+				target.depth[y * target.width + x] = std::max(
+					std::max(source.depth[sy0 * source.width + sx0], source.depth[sy0 * source.width + sx1]),
+					std::max(source.depth[sy1 * source.width + sx0], source.depth[sy1 * source.width + sx1]));
+			}
+		}
+	}
+}
+
+void SoftwareOcclusion::Rasterize(JobSystem* jobs)
+{
+	if (jobs && !mTriangles.empty())
+	{
+		jobs->ParallelFor(size_t(mTilesY), 1, [this](size_t begin, size_t end)
+		{
+			for (size_t tileY = begin; tileY < end; tileY++)
+			{
+				RasterizeTileRow(int(tileY));
+			}
+		});
+	}
+	else
+	{
+		for (int tileY = 0; tileY < mTilesY; tileY++)
+		{
+			RasterizeTileRow(tileY);
+		}
+	}
+	BuildHierarchy();
+}
+
+bool SoftwareOcclusion::IsOccluded(const float center[3], const float extents[3]) const
+{
+	float minX = INFINITY;
+	float minY = INFINITY;
+	float maxX = -INFINITY;
+	float maxY = -INFINITY;
+	float minZ = INFINITY;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float p[3] =
+		{
+			center[0] + ((corner & 1) ? extents[0] : -extents[0]),
+			center[1] + ((corner & 2) ? extents[1] : -extents[1]),
+			center[2] + ((corner & 4) ? extents[2] : -extents[2]),
+		};
+		float clip[4];
+		for (int c = 0; c < 4; c++)
+		{
+			clip[c] = p[0] * mViewProj[0 * 4 + c] + p[1] * mViewProj[1 * 4 + c] + p[2] * mViewProj[2 * 4 + c] + mViewProj[3 * 4 + c];
+		}
+		if (clip[2] < 0.0f || clip[3] <= 0.0f)
+		{
+			return false;
+		}
+		float invW = 1.0f / clip[3];
+		float x = (clip[0] * invW * 0.5f + 0.5f) * float(mWidth);
+		float y = (0.5f - clip[1] * invW * 0.5f) * float(mHeight);
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip[2] * invW);
+	}
+
+	// Every pixel the box rectangle touches, in tiles
+	int tileMinX = std::max(0, int(std::floor(minX))) / TileSize;
+	int tileMinY = std::max(0, int(std::floor(minY))) / TileSize;
+	int tileMaxX = std::min(mWidth - 1, int(std::ceil(maxX))) / TileSize;
+	int tileMaxY = std::min(mHeight - 1, int(std::ceil(maxY))) / TileSize;
+	if (maxX < 0.0f || maxY < 0.0f || minX > float(mWidth) || minY > float(mHeight))
+	{
+		return false;
+	}
+
+	// Coarsest level where the rectangle spans at most 4x4 texels
+	size_t level = 0;
+	while ((tileMaxX - tileMinX > 3 || tileMaxY - tileMinY > 3) && level + 1 < mHierarchy.size())
+	{
+		tileMinX >>= 1;
+		tileMinY >>= 1;
+		tileMaxX >>= 1;
+		tileMaxY >>= 1;
+		level++;
+	}
+
+	const Level& hierarchy = mHierarchy[level];
+	for (int y = tileMinY; y <= tileMaxY; y++)
+	{
+		for (int x = tileMinX; x <= tileMaxX; x++)
+		{
+			if (hierarchy.depth[y * hierarchy.width + x] >= minZ)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+size_t SoftwareOcclusion::CullOccluded(const CullingBounds& bounds, uint32_t* indices, size_t count, JobSystem* jobs)
+{
+	mOccluded.resize(count);
+	auto test = [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t index = indices[i];
+			float center[3] = { bounds.CenterX()[index], bounds.CenterY()[index], bounds.CenterZ()[index] };
+			float extents[3] = { bounds.ExtentX()[index], bounds.ExtentY()[index], bounds.ExtentZ()[index] };
+			mOccluded[i] = IsOccluded(center, extents) ? 1 : 0;
+		}
+	};
+	if (jobs)
+	{
+		jobs->ParallelFor(count, 1024, test);
+	}
+	else
+	{
+		test(0, count);
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!mOccluded[i])
+		{
+			indices[kept++] = indices[i];
+		}
+	}
+	return kept;
+}
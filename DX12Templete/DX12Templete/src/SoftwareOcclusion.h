@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CullingBounds;
+class JobSystem;
+
+// Masked software occlusion culling on the CPU.
+//
+// Occluder triangles are rasterized into a low-resolution buffer of 8x8 pixel tiles. A tile keeps
+// no per-pixel depth: it keeps a reference depth that is known to cover the whole tile and a working
+// layer made of a 64-bit coverage mask (one bit per pixel) and the farthest depth merged into it.
+// When the mask fills up the working layer becomes the new reference. Coverage is computed a row at
+// a time from the edge equations, several rows per SIMD instruction, and each tile row is rasterized
+// by one job so no tile is shared between threads.
+// Occludees are tested as boxes against a max-depth pyramid built over the tiles.
+// Depth is D3D clip depth (0 near, 1 far) and the matrices use the DirectXMath row-vector layout.
+class SoftwareOcclusion
+{
+public:
+	static constexpr int TileSize = 8;
+
+	SoftwareOcclusion(int width = 256, int height = 128);
+
+	// Rounded up to whole tiles
+	void SetResolution(int width, int height);
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+
+	// Clears the buffer and the occluder list for a new frame
+	void Begin(const float viewProj[16]);
+
+	// Triangles in object space (3 floats per position) placed by a world matrix.
+	// Triangles crossing the near plane are dropped, which only loses occlusion.
+	void AddOccluder(const float* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const float world[16]);
+	size_t GetTriangleCount() const { return mTriangles.size(); }
+
+	// Rasterizes everything added since Begin and builds the depth pyramid
+	void Rasterize(JobSystem* jobs);
+
+	// True if the world-space box is hidden behind the occluders; boxes crossing the near plane never are
+	bool IsOccluded(const float center[3], const float extents[3]) const;
+
+	// Removes occluded entries from indices[0, count), which index into bounds, keeping their order.
+	// Returns the number left.
+	size_t CullOccluded(const CullingBounds& bounds, uint32_t* indices, size_t count, JobSystem* jobs);
+
+	// Reference depth of a tile, for debugging
+	float GetTileDepth(int tileX, int tileY) const { return mTiles[tileY * mTilesX + tileX].zFar; }
+
+	// Depth pyramid built by Rasterize; level 0 has one texel per tile and each texel above is the farthest of the 2x2 below
+	size_t GetHierarchyLevelCount() const { return mHierarchy.size(); }
+	const float* GetHierarchyLevel(size_t level, int& width, int& height) const
+	{
+		width = mHierarchy[level].width;
+		height = mHierarchy[level].height;
+		return mHierarchy[level].depth.data();
+	}
+
+private:
+	struct Tile
+	{
+		uint64_t mask;
+		float zWork;
+		float zFar;
+	};
+
+	// Screen-space setup; edges are oriented so covered pixels have edge values >= 0
+	struct Triangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depthA;
+		float depthB;
+		float depthC;
+		float zMax;
+		int tileMinX;
+		int tileMaxX;
+		int tileMinY;
+		int tileMaxY;
+	};
+
+	struct Level
+	{
+		int width;
+		int height;
+		std::vector<float> depth;
+	};
+
+	// Merges a triangle covering mask into the tile; z is its farthest depth inside the tile
+	static void UpdateTile(Tile& tile, uint64_t mask, float z);
+	void RasterizeTileRow(int tileY);
+	void BuildHierarchy();
+
+	int mWidth = 0;
+	int mHeight = 0;
+	int mTilesX = 0;
+	int mTilesY = 0;
+	float mViewProj[16];
+
+	std::vector<Tile> mTiles;
+	std::vector<Triangle> mTriangles;
+	std::vector<std::vector<uint32_t>> mBins; // triangles touching each tile row
+	std::vector<Level> mHierarchy;            // level 0 is the reference depth per tile
+	std::vector<float> mClip;
+	std::vector<uint8_t> mOccluded;
+};
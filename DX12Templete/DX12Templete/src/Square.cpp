@@ -1,71 +1,66 @@
 #include "Square.h"
 #include "DX12Renderer.h"
 
-void Square::Initialize()
+void Square::BuildDefaultMesh(MeshData& out)
 {
-	ID3D12Device5Ptr mDevice = DX12Renderer::GetDevice();
-
-	mRotate = Rotate();
-	mPos = XMVECTORF32();
-
-	HRESULT hr;
-	UINT count = 3;
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc{
-	  D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-	  count,
-	  D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
-	  0
-	};
-	hr = mDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_heapSrvCbv));
-	if (FAILED(hr)) {
-		return;
-	}
-	m_srvcbvDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-
 	//  _
 	const float k = 0.25;
-	Vertex vertices_array[] = {
-		{ { -k, -k, 0.0f }, { 1.0f, 0.0f,0.0f,1.0f} },
-		{ { -k,  k, 0.0f }, { 0.0f, 1.0f,0.0f,1.0f} },
-		{ {  k,  k, 0.0f }, { 0.0f, 0.0f,1.0f,1.0f} },
-		{ {  k, -k, 0.0f }, { 0.0f, 1.0f,1.0f,1.0f} },
+	SourceVertex vertices_array[] = {
+		{ { -k, -k, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f,0.0f,1.0f} },
+		{ { -k,  k, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f,0.0f,1.0f} },
+		{ {  k,  k, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f,1.0f,1.0f} },
+		{ {  k, -k, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f,1.0f,1.0f} },
 	};
 	uint32_t indices[] = {
 		0, 1, 2,
 		3, 0, 2
 	};
 
-	mVertexBuffer = CreateBuffer(sizeof(vertices_array), vertices_array);
-	mIndexBuffer = CreateBuffer(sizeof(indices), indices);
-	mIndexCount = _countof(indices);
-	mVertexCount = _countof(vertices_array);
-
-	UINT bufferSize = sizeof(ShaderParameters) + 255 & ~255;
-	mConstantBuffer = CreateBuffer(bufferSize, nullptr);
-
-	mWorldMtrix = XMMatrixIdentity();
-
-	mViewMatrix = XMMatrixLookAtLH(
-		XMVectorSet(0.0f, 0.0f, -2.0f, 0.0f), // Eye Position
-		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f),  // Eye Direction
-		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)   // Eye Up
-	);
-
-	mProjMatrix = XMMatrixPerspectiveFovLH(
-		XMConvertToRadians(45.0f),
-		720 / 480,
-		0.1f,
-		100.0f
-	);
+	// The same steps tools/MeshConvert takes offline
+	MeshBuildStatistics statistics;
+	BuildMeshData(vertices_array, _countof(vertices_array), indices, _countof(indices),
+		SquareVertexElements, _countof(SquareVertexElements), LodSettings(), out, &statistics);
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE handleCBV(m_heapSrvCbv->GetCPUDescriptorHandleForHeapStart(), ConstantBufferDescriptorBase, m_srvcbvDescriptorSize);
-	m_cbViews = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_heapSrvCbv->GetGPUDescriptorHandleForHeapStart(), ConstantBufferDescriptorBase, m_srvcbvDescriptorSize);
+	char message[128];
+	sprintf_s(message, "Square: ACMR %.3f -> %.3f over %u vertices\n", statistics.before.acmr, statistics.after.acmr, out.vertexCount);
+	OutputDebugStringA(message);
+}
 
-	D3D12_CONSTANT_BUFFER_VIEW_DESC cbDesc{};
-	cbDesc.BufferLocation = mConstantBuffer->GetGPUVirtualAddress();
-	cbDesc.SizeInBytes = bufferSize;
-	mDevice->CreateConstantBufferView(&cbDesc, handleCBV);
+HRESULT Square::Initialize(const MeshView& mesh)
+{
+	// The shared index buffer is 16-bit; indices count from this square's base vertex
+	if (mesh.indexSize != sizeof(uint16_t))
+	{
+		return E_INVALIDARG;
+	}
+	HRESULT hr = mGeometryBuffer->Add(mesh.vertices, mesh.vertexCount, static_cast<const uint16_t*>(mesh.indices), mesh.indexCount, &mGeometry);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	// Nothing below can fail, so a failed square never holds a transform
+	mRotate = Rotate();
+	mTransform = mTransforms->Create(mParent);
+	mIndexCount = mesh.lods[0].indexCount;
+	mVertexCount = mesh.vertexCount;
+	mQuantization = mesh.quantization;
+	// UpdateBounds centres the local box on the origin, so it has to reach the far side of the bounds
+	mLocalExtents = XMFLOAT3(
+		fabsf(mesh.boundsCenter[0]) + mesh.boundsExtents[0],
+		fabsf(mesh.boundsCenter[1]) + mesh.boundsExtents[1],
+		fabsf(mesh.boundsCenter[2]) + mesh.boundsExtents[2]);
+
+	// Culling walks the meshlets on the CPU, so they are kept here as well as on the GPU
+	mLods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+	mLodMeshletOffsets.assign(mesh.lodMeshletOffsets, mesh.lodMeshletOffsets + mesh.lodCount + 1);
+	mMeshlets.meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+	mMeshlets.bounds.assign(mesh.meshletBounds, mesh.meshletBounds + mesh.meshletCount);
+	mMeshlets.vertices.assign(mesh.meshletVertices, mesh.meshletVertices + mesh.meshletVertexCount);
+	mMeshlets.triangles.assign(mesh.meshletTriangles, mesh.meshletTriangles + mesh.meshletTriangleCount);
+	mMeshletBuffer = CreateBuffer(UINT(mesh.meshletCount * sizeof(Meshlet)), mesh.meshlets);
+	mMeshletVertexBuffer = CreateBuffer(UINT(mesh.meshletVertexCount * sizeof(uint32_t)), mesh.meshletVertices);
+	mMeshletTriangleBuffer = CreateBuffer(UINT(mesh.meshletTriangleCount * sizeof(uint32_t)), mesh.meshletTriangles);
+	return S_OK;
 }
 
 void Square::update()
@@ -74,22 +69,15 @@ void Square::update()
 
 void Square::draw()
 {
-	ID3D12GraphicsCommandList4Ptr mCmdList = DX12Renderer::GetCmdList();
-
-	SetConstantBuffer();
-
-	D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view = CreateVertexBufferView();
-	D3D12_INDEX_BUFFER_VIEW index_buffer_view = CreateIndexBufferView();
-
-	ID3D12DescriptorHeap* heaps[] = { m_heapSrvCbv };
-	mCmdList->SetDescriptorHeaps(_countof(heaps), heaps);
-	mCmdList->SetGraphicsRootDescriptorTable(0, m_cbViews);
+	draw(mIndexCount, 0, INT(mGeometry.baseVertex));
+}
 
-	mCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+void Square::draw(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	ID3D12GraphicsCommandList4Ptr mCmdList = DX12Renderer::GetCmdList();
 
-	mCmdList->IASetVertexBuffers(0, 1, &vertex_buffer_view);
-	mCmdList->IASetIndexBuffer(&index_buffer_view);
-	mCmdList->DrawIndexedInstanced(mIndexCount, 1, 0, 0, 0);
+	// Constants and the input assembler are bound by the renderer, which owns the buffers
+	mCmdList->DrawIndexedInstanced(indexCount, 1, mGeometry.startIndex + startIndex, baseVertex, 0);
 }
 
 
@@ -121,63 +109,28 @@ ID3D12Resource1Ptr Square::CreateBuffer(UINT bufferSize, const void* initialData
 	return buffer;
 }
 
-void Square::SetConstantBuffer()
-{
-	ShaderParameters shaderParams;
-	XMStoreFloat4x4(&shaderParams.mtxWorld, XMMatrixTranspose(mWorldMtrix));
-	XMStoreFloat4x4(&shaderParams.mtxView, XMMatrixTranspose(mViewMatrix));
-	XMStoreFloat4x4(&shaderParams.mtxProj, XMMatrixTranspose(mProjMatrix));
-
-	auto& constantBuffer = mConstantBuffer;
-	{
-		void* p;
-		CD3DX12_RANGE range(0, 0);
-		constantBuffer->Map(0, &range, &p);
-		memcpy(p, &shaderParams, sizeof(shaderParams));
-		constantBuffer->Unmap(0, nullptr);
-	}
-}
-
-D3D12_VERTEX_BUFFER_VIEW Square::CreateVertexBufferView()
-{
-	D3D12_VERTEX_BUFFER_VIEW    vertex_buffer_view{};
-	vertex_buffer_view.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
-	vertex_buffer_view.StrideInBytes = sizeof(Vertex);
-	vertex_buffer_view.SizeInBytes = sizeof(Vertex) * mVertexCount;
-	return vertex_buffer_view;
-}
-
-D3D12_INDEX_BUFFER_VIEW Square::CreateIndexBufferView()
-{
-	D3D12_INDEX_BUFFER_VIEW   index_buffer_view{};
-	index_buffer_view.BufferLocation = mIndexBuffer->GetGPUVirtualAddress();
-	index_buffer_view.SizeInBytes = sizeof(uint32_t) * mIndexCount;
-	index_buffer_view.Format = DXGI_FORMAT_R32_UINT;
-	return index_buffer_view;
-}
-
 void Square::SetRotateY(float rad)
 {
 	mRotate.y += rad;
-
-	mWorldMtrix = XMMatrixRotationAxis(
-		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), XMConvertToRadians(mRotate.y));
+	UpdateRotation();
 }
 
 void Square::SetRotateX(float rad)
 {
 	mRotate.x += rad;
-
-	mWorldMtrix = XMMatrixRotationAxis(
-		XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMConvertToRadians(mRotate.x));
+	UpdateRotation();
 }
 
 void Square::SetRotateZ(float rad)
 {
 	mRotate.z += rad;
+	UpdateRotation();
+}
 
-	mWorldMtrix = XMMatrixRotationAxis(
-		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMConvertToRadians(mRotate.z));
+void Square::UpdateRotation()
+{
+	mTransforms->SetRotation(mTransform, XMQuaternionRotationRollPitchYaw(
+		XMConvertToRadians(mRotate.x), XMConvertToRadians(mRotate.y), XMConvertToRadians(mRotate.z)));
 }
 
 // Acceleration Structure
@@ -201,13 +154,13 @@ ID3D12ResourcePtr createBuffer(ID3D12Device5Ptr pDevice, uint64_t size, D3D12_RE
 	return pBuffer;
 }
 
-AccelerationStructureBuffers Square::createBottomLevelAS(ID3D12Device5Ptr pDevice, ID3D12GraphicsCommandList4Ptr pCmdList, ID3D12Resource1Ptr pVB)
+AccelerationStructureBuffers Square::createBottomLevelAS(ID3D12Device5Ptr pDevice, ID3D12GraphicsCommandList4Ptr pCmdList, D3D12_GPU_VIRTUAL_ADDRESS vertices)
 {
 	D3D12_RAYTRACING_GEOMETRY_DESC geomDesc = {};
 	geomDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-	geomDesc.Triangles.VertexBuffer.StartAddress = pVB->GetGPUVirtualAddress();
-	geomDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(XMFLOAT3);
-	geomDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+	geomDesc.Triangles.VertexBuffer.StartAddress = vertices;
+	geomDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(PackedSquareVertex);
+	geomDesc.Triangles.VertexFormat = DXGI_FORMAT_R16G16B16A16_SNORM; // position in SquareVertexElements
 	geomDesc.Triangles.VertexCount = 3;
 	geomDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
 
@@ -271,8 +224,13 @@ AccelerationStructureBuffers Square::createTopLevelAS(ID3D12Device5Ptr pDevice,
 	pInstanceDesc->InstanceID = 0;                            // This value will be exposed to the shader via InstanceID()
 	pInstanceDesc->InstanceContributionToHitGroupIndex = 0;   // This is the offset inside the shader-table. We only have a single geometry, so the offset 0
 	pInstanceDesc->Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-	XMMATRIX m; // Identity matrix
-	memcpy(pInstanceDesc->Transform, &m, sizeof(pInstanceDesc->Transform));
+	// Positions are quantized; the instance transform decodes them (3x4, translation in the last column)
+	memset(pInstanceDesc->Transform, 0, sizeof(pInstanceDesc->Transform));
+	for (int a = 0; a < 3; a++)
+	{
+		pInstanceDesc->Transform[a][a] = mQuantization.scale[a];
+		pInstanceDesc->Transform[a][3] = mQuantization.bias[a];
+	}
 	pInstanceDesc->AccelerationStructure = pBottomLevelAS->GetGPUVirtualAddress();
 	pInstanceDesc->InstanceMask = 0xFF;
 
@@ -302,7 +260,7 @@ void Square::CreateAccelerationStructure()
 	auto device = DX12Renderer::GetDevice();
 	auto cmd_list = DX12Renderer::GetCmdList();
 
-	mBottomLevelBuffers = createBottomLevelAS(device, cmd_list, mVertexBuffer);
+	mBottomLevelBuffers = createBottomLevelAS(device, cmd_list, mGeometryBuffer->GetVertexAddress(mGeometry));
 	mTopLevelBuffers = createTopLevelAS(device, cmd_list, mBottomLevelBuffers.pResult, mTlasSize);
 
 }
@@ -9,6 +9,14 @@
 #include <comdef.h>
 #include "stddef.h"
 #include "d3dx12.h"
+#include "TransformStore.h"
+#include "GeometryBuffer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "MeshData.h"
+#include "SquareVertex.h"
+#include <vector>
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -87,68 +95,77 @@ struct AccelerationStructureBuffers
 
 class Square
 {
-	struct Vertex {
-		XMFLOAT3 Pos;
-		XMFLOAT4 Color;
-	};
-
-	struct ShaderParameters
-	{
-		XMFLOAT4X4 mtxWorld;
-		XMFLOAT4X4 mtxView;
-		XMFLOAT4X4 mtxProj;
-	};
-	enum
-	{
-		TextureSrvDescriptorBase = 0,
-		ConstantBufferDescriptorBase = 1,
-		// Tv[͕ʃq[vȂ̂Ő擪gp
-		SamplerDescriptorBase = 0,
-	};
-
 public:
-	Square() {}
-	~Square() {}
-	void Initialize();
+	Square(TransformStore* transforms, GeometryBuffer* geometry, TransformHandle parent = TransformStore::NoParent)
+		: mTransforms(transforms), mGeometryBuffer(geometry), mParent(parent) {}
+	// Copies the vertices and indices into the shared geometry buffer and the meshlets into buffers of
+	// its own; the mesh may be unmapped afterwards. Fails with E_INVALIDARG for 32-bit indices.
+	HRESULT Initialize(const MeshView& mesh);
+	// The built-in square, for when no Square.mesh is found
+	static void BuildDefaultMesh(MeshData& out);
 	void update();
+	// Both expect the geometry buffer's views bound; the renderer binds them once per frame
 	void draw();
+	// Draws a subset of the triangles, e.g. a coarser LOD level; startIndex counts from this square's first index.
+	// baseVertex is GetGeometry().baseVertex, or 0 when the vertex shader pulls vertices and offsets them itself.
+	void draw(UINT indexCount, UINT startIndex, INT baseVertex);
 
 	void CreateAccelerationStructure();
 	void SetAccelerationStructures();
 
 
-	void SetPositionX(float pos){ mWorldMtrix = XMMatrixTranslation(pos, 0.0, 0.0); }
-	void SetPositionY(float pos){}
-	void SetPositionZ(float pos){}
+	// Local to the parent; rotation and translation compose instead of replacing each other
+	void SetPositionX(float pos){ mTransforms->SetTranslation(mTransform, XMVectorSetX(mTransforms->GetTranslation(mTransform), pos)); }
+	void SetPositionY(float pos){ mTransforms->SetTranslation(mTransform, XMVectorSetY(mTransforms->GetTranslation(mTransform), pos)); }
+	void SetPositionZ(float pos){ mTransforms->SetTranslation(mTransform, XMVectorSetZ(mTransforms->GetTranslation(mTransform), pos)); }
 	void SetRotateY(float rad);
 	void SetRotateX(float rad);
 	void SetRotateZ(float rad);
 
-	ID3D12Resource1Ptr GetVertexBuffer() { return mVertexBuffer; }
+	// Where the vertices and indices of every LOD level live in the shared buffers
+	const GeometryRange& GetGeometry() const { return mGeometry; }
+	UINT GetIndexCount() const { return mIndexCount; }
+	TransformHandle GetTransform() const { return mTransform; }
+	const XMMATRIX& GetWorldMatrix() const { return mTransforms->GetWorldMatrix(mTransform); }
+	const XMFLOAT3& GetLocalExtents() const { return mLocalExtents; }
+	// Scale and bias that turn the quantized positions in the vertex buffer back into local space
+	const VertexQuantization& GetQuantization() const { return mQuantization; }
+	const MeshletMesh& GetMeshlets() const { return mMeshlets; }
+	// Level 0 is the full mesh; every level's indices follow each other in the geometry range
+	const std::vector<MeshLod>& GetLods() const { return mLods; }
+	// Each level's meshlets are a contiguous range of GetMeshlets()
+	UINT GetLodMeshletOffset(size_t level) const { return mLodMeshletOffsets[level]; }
+	UINT GetLodMeshletCount(size_t level) const { return mLodMeshletOffsets[level + 1] - mLodMeshletOffsets[level]; }
+	D3D12_GPU_VIRTUAL_ADDRESS GetMeshletAddress() const { return mMeshletBuffer->GetGPUVirtualAddress(); }
+	D3D12_GPU_VIRTUAL_ADDRESS GetMeshletVertexAddress() const { return mMeshletVertexBuffer->GetGPUVirtualAddress(); }
+	D3D12_GPU_VIRTUAL_ADDRESS GetMeshletTriangleAddress() const { return mMeshletTriangleBuffer->GetGPUVirtualAddress(); }
 private:
-	ID3D12Resource1Ptr  mVertexBuffer;
-	ID3D12Resource1Ptr mIndexBuffer;
-	ID3D12Resource1Ptr mConstantBuffer;
-	ID3D12DescriptorHeapPtr m_heapSrvCbv;
-	D3D12_GPU_DESCRIPTOR_HANDLE m_cbViews;
-	UINT  m_srvcbvDescriptorSize;
-	UINT  mIndexCount;
+	GeometryBuffer* mGeometryBuffer;
+	GeometryRange mGeometry;
+	UINT  mIndexCount;  // level 0 only
 	UINT  mVertexCount;
-
-	XMVECTORF32 mPos;
+	VertexQuantization mQuantization;
+	XMFLOAT3 mLocalExtents; // half size of a local AABB around the origin that holds the mesh bounds
+
+	// Built once from the vertex and index data; the buffers feed the mesh shader path
+	std::vector<MeshLod> mLods;
+	std::vector<UINT> mLodMeshletOffsets; // one per level plus the end
+	MeshletMesh mMeshlets;
+	ID3D12Resource1Ptr mMeshletBuffer;
+	ID3D12Resource1Ptr mMeshletVertexBuffer;
+	ID3D12Resource1Ptr mMeshletTriangleBuffer;
+
+	TransformStore* mTransforms;
+	TransformHandle mParent;
+	TransformHandle mTransform;
 	Rotate mRotate;
-	XMMATRIX mWorldMtrix;
-	XMMATRIX mViewMatrix;
-	XMMATRIX mProjMatrix;
 
+	void UpdateRotation();
 
-	ID3D12Resource1Ptr CreateBuffer(UINT bufferSize, const void* initialData);
 
-	void SetConstantBuffer();
-	D3D12_VERTEX_BUFFER_VIEW CreateVertexBufferView();
-	D3D12_INDEX_BUFFER_VIEW CreateIndexBufferView();
+	ID3D12Resource1Ptr CreateBuffer(UINT bufferSize, const void* initialData);
 
-	AccelerationStructureBuffers createBottomLevelAS(ID3D12Device5Ptr pDevice, ID3D12GraphicsCommandList4Ptr pCmdList, ID3D12Resource1Ptr pVB);
+	AccelerationStructureBuffers createBottomLevelAS(ID3D12Device5Ptr pDevice, ID3D12GraphicsCommandList4Ptr pCmdList, D3D12_GPU_VIRTUAL_ADDRESS vertices);
 	AccelerationStructureBuffers createTopLevelAS(ID3D12Device5Ptr pDevice, ID3D12GraphicsCommandList4Ptr pCmdList, ID3D12Resource1Ptr pBottomLevelAS, uint64_t& tlasSize);
 	
 	AccelerationStructureBuffers mTopLevelBuffers;
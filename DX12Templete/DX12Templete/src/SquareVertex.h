@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include "VertexLayout.h"
+
+// The one description of Square's vertex buffer. DX12Renderer::CreatePipelineObject builds its input
+// layout from it and tools/VertexLayoutGen writes resource/SquareVertex.hlsli from it.
+// 12 bytes per vertex instead of 28 for a float3 position and a float4 colour.
+static constexpr VertexElement SquareVertexElements[] =
+{
+	{ VertexSemantic::Position, VertexEncoding::Snorm16x4 },
+	{ VertexSemantic::Color, VertexEncoding::Unorm8x4 },
+};
+
+// What the vertex buffer holds
+struct PackedSquareVertex
+{
+	int16_t position[4];
+	uint8_t color[4];
+};
+static_assert(sizeof(PackedSquareVertex) == GetVertexStride(SquareVertexElements), "PackedSquareVertex does not match SquareVertexElements");
+static_assert(offsetof(PackedSquareVertex, position) == GetVertexOffset(SquareVertexElements, 0), "PackedSquareVertex::position is misplaced");
+static_assert(offsetof(PackedSquareVertex, color) == GetVertexOffset(SquareVertexElements, 1), "PackedSquareVertex::color is misplaced");
@@ -0,0 +1,23 @@
+#include "TextureAsset.h"
+
+BOOL TextureAsset::Open(const VirtualFileSystem& files, const std::string& name)
+{
+	Close();
+
+	if (!files.Read(name, &mFile))
+	{
+		return FALSE;
+	}
+	if (!ReadDdsTexture(mFile.GetData(), mFile.GetSize(), &mView))
+	{
+		Close();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void TextureAsset::Close()
+{
+	mFile.Reset();
+	mView = TextureView();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "stddef.h"
+#include "VirtualFileSystem.h"
+#include "TextureData.h"
+
+// A block-compressed .dds texture, mapped once, loose or from a pack. Like MeshAsset, the view's mips point straight into
+// the mapping, so the asset must stay open until they have been copied into the upload buffer.
+class TextureAsset
+{
+public:
+	TextureAsset() {}
+	~TextureAsset() { Close(); }
+
+	BOOL Open(const VirtualFileSystem& files, const std::string& name);
+	void Close();
+
+	BOOL IsOpen() const { return mFile.IsValid(); }
+	const TextureView& GetView() const { return mView; }
+private:
+	FileView mFile;
+	TextureView mView;
+};
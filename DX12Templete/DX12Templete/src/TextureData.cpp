@@ -0,0 +1,301 @@
+#include "TextureData.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DdsFormat;
+
+TextureView TextureData::GetView() const
+{
+	TextureView view;
+	view.format = format;
+	view.srgb = srgb;
+	view.dxgiFormat = ToDxgiFormat(format, srgb);
+	view.width = width;
+	view.height = height;
+	view.mipCount = uint32_t(std::min<size_t>(mips.size(), MaxMipCount));
+	for (uint32_t level = 0; level < view.mipCount; level++)
+	{
+		TextureMip& mip = view.mips[level];
+		mip.data = mips[level].data();
+		mip.width = std::max(width >> level, 1u);
+		mip.height = std::max(height >> level, 1u);
+		mip.rowPitch = uint32_t(GetBlockCount(mip.width) * GetBlockBytes(format));
+		mip.rowCount = GetBlockCount(mip.height);
+		mip.size = uint64_t(mip.rowPitch) * mip.rowCount;
+	}
+	return view;
+}
+
+uint32_t GetMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+	{
+		count++;
+	}
+	return count;
+}
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static RgbaImage Downsample(const RgbaImage& source, bool srgb, const float* toLinear)
+{
+	RgbaImage out;
+	out.width = std::max(source.width / 2, 1u);
+	out.height = std::max(source.height / 2, 1u);
+	out.pixels.resize(size_t(out.width) * out.height * 4);
+	for (uint32_t y = 0; y < out.height; y++)
+	{
+		// Every source row lands in exactly one destination row; odd sizes give the last one three
+		uint32_t y0 = uint32_t(uint64_t(y) * source.height / out.height);
+		uint32_t y1 = uint32_t(uint64_t(y + 1) * source.height / out.height);
+		for (uint32_t x = 0; x < out.width; x++)
+		{
+			uint32_t x0 = uint32_t(uint64_t(x) * source.width / out.width);
+			uint32_t x1 = uint32_t(uint64_t(x + 1) * source.width / out.width);
+			float color[3] = {};
+			float weighted[3] = {};
+			float alpha = 0.0f;
+			float count = 0.0f;
+			for (uint32_t sy = y0; sy < y1; sy++)
+			{
+				const uint8_t* row = source.pixels.data() + size_t(sy) * source.width * 4;
+				for (uint32_t sx = x0; sx < x1; sx++)
+				{
+					const uint8_t* texel = row + size_t(sx) * 4;
+					float a = texel[3] / 255.0f;
+					for (int c = 0; c < 3; c++)
+					{
+						float value = toLinear[texel[c]];
+						color[c] += value;
+						weighted[c] += value * a;
+					}
+					alpha += a;
+					count += 1.0f;
+				}
+			}
+			uint8_t* texel = out.pixels.data() + (size_t(y) * out.width + x) * 4;
+			for (int c = 0; c < 3; c++)
+			{
+				float value = alpha > 0.0f ? weighted[c] / alpha : color[c] / count;
+				if (srgb)
+				{
+					value = LinearToSrgb(value);
+				}
+				texel[c] = uint8_t(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+			}
+			texel[3] = uint8_t(std::lround(alpha / count * 255.0f));
+		}
+	}
+	return out;
+}
+
+void GenerateMipChain(const RgbaImage& source, bool srgb, std::vector<RgbaImage>& out)
+{
+	float toLinear[256];
+	for (int i = 0; i < 256; i++)
+	{
+		toLinear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+	}
+
+	out.clear();
+	out.reserve(GetMipCount(source.width, source.height));
+	out.push_back(source);
+	while (out.back().width > 1 || out.back().height > 1)
+	{
+		// Each level from the one above; the box filter composes into a wider one
+		RgbaImage next = Downsample(out.back(), srgb, toLinear);
+		out.push_back(std::move(next));
+	}
+}
+
+bool BuildTextureData(const RgbaImage& source, BlockFormat format, bool srgb, uint32_t mipCount,
+	const BlockCompressor& compressor, TextureData& out, JobSystem* jobs)
+{
+	if (source.width == 0 || source.height == 0 || source.width % 4 != 0 || source.height % 4 != 0 ||
+		source.pixels.size() != size_t(source.width) * source.height * 4)
+	{
+		return false;
+	}
+	uint32_t fullCount = GetMipCount(source.width, source.height);
+	mipCount = (mipCount == 0 || mipCount > fullCount) ? fullCount : mipCount;
+
+	std::vector<RgbaImage> levels;
+	if (mipCount > 1)
+	{
+		GenerateMipChain(source, srgb, levels);
+		levels.resize(mipCount);
+	}
+	else
+	{
+		levels.push_back(source);
+	}
+
+	out.format = format;
+	out.srgb = srgb && format != BlockFormat::BC5;
+	out.width = source.width;
+	out.height = source.height;
+	out.mips.resize(mipCount);
+	for (uint32_t level = 0; level < mipCount; level++)
+	{
+		const RgbaImage& image = levels[level];
+		out.mips[level].resize(size_t(GetBlockCount(image.width)) * GetBlockCount(image.height) * GetBlockBytes(format));
+		compressor.CompressImage(format, image.pixels.data(), image.width, image.height, size_t(image.width) * 4,
+			out.mips[level].data(), jobs);
+	}
+	return true;
+}
+
+uint32_t ToDxgiFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? DxgiBC1UnormSrgb : DxgiBC1Unorm;
+	case BlockFormat::BC3: return srgb ? DxgiBC3UnormSrgb : DxgiBC3Unorm;
+	case BlockFormat::BC5: return DxgiBC5Unorm;
+	case BlockFormat::BC7: return srgb ? DxgiBC7UnormSrgb : DxgiBC7Unorm;
+	}
+	return DxgiUnknown;
+}
+
+static bool FromDxgiFormat(uint32_t dxgiFormat, BlockFormat* format, bool* srgb)
+{
+	switch (dxgiFormat)
+	{
+	case DxgiBC1Unorm: *format = BlockFormat::BC1; *srgb = false; return true;
+	case DxgiBC1UnormSrgb: *format = BlockFormat::BC1; *srgb = true; return true;
+	case DxgiBC3Unorm: *format = BlockFormat::BC3; *srgb = false; return true;
+	case DxgiBC3UnormSrgb: *format = BlockFormat::BC3; *srgb = true; return true;
+	case DxgiBC5Unorm: *format = BlockFormat::BC5; *srgb = false; return true;
+	case DxgiBC7Unorm: *format = BlockFormat::BC7; *srgb = false; return true;
+	case DxgiBC7UnormSrgb: *format = BlockFormat::BC7; *srgb = true; return true;
+	}
+	return false;
+}
+
+void WriteDdsTexture(const TextureView& texture, std::vector<uint8_t>& image)
+{
+	Header header = {};
+	header.size = sizeof(Header);
+	header.flags = CapsFlag | HeightFlag | WidthFlag | PixelFormatFlag | MipCountFlag | LinearSizeFlag;
+	header.height = texture.height;
+	header.width = texture.width;
+	header.linearSize = texture.mipCount > 0 ? uint32_t(texture.mips[0].size) : 0;
+	header.mipCount = texture.mipCount;
+	header.pixelFormat.size = sizeof(PixelFormat);
+	header.pixelFormat.flags = FourCCFlag;
+	header.pixelFormat.fourCC = Dx10;
+	header.caps = TextureCaps | (texture.mipCount > 1 ? ComplexCaps | MipMapCaps : 0);
+
+	HeaderDxt10 extension = {};
+	extension.dxgiFormat = texture.dxgiFormat;
+	extension.resourceDimension = Texture2DDimension;
+	extension.arraySize = 1;
+
+	size_t size = sizeof(Magic) + sizeof(Header) + sizeof(HeaderDxt10);
+	for (uint32_t level = 0; level < texture.mipCount; level++)
+	{
+		size += size_t(texture.mips[level].size);
+	}
+	image.assign(size, 0);
+	uint8_t* out = image.data();
+	memcpy(out, &Magic, sizeof(Magic));
+	memcpy(out + sizeof(Magic), &header, sizeof(header));
+	memcpy(out + sizeof(Magic) + sizeof(header), &extension, sizeof(extension));
+	out += sizeof(Magic) + sizeof(Header) + sizeof(HeaderDxt10);
+	for (uint32_t level = 0; level < texture.mipCount; level++)
+	{
+		memcpy(out, texture.mips[level].data, size_t(texture.mips[level].size));
+		out += texture.mips[level].size;
+	}
+}
+
+bool ReadDdsTexture(const void* data, size_t size, TextureView* out)
+{
+	const uint8_t* base = static_cast<const uint8_t*>(data);
+	uint32_t magic;
+	Header header;
+	if (size < sizeof(Magic) + sizeof(Header))
+	{
+		return false;
+	}
+	memcpy(&magic, base, sizeof(magic));
+	memcpy(&header, base + sizeof(Magic), sizeof(header));
+	if (magic != Magic || header.size != sizeof(Header) || header.pixelFormat.size != sizeof(PixelFormat) ||
+		!(header.pixelFormat.flags & FourCCFlag))
+	{
+		return false;
+	}
+
+	TextureView view;
+	size_t offset = sizeof(Magic) + sizeof(Header);
+	switch (header.pixelFormat.fourCC)
+	{
+	case Dx10:
+	{
+		HeaderDxt10 extension;
+		if (size < offset + sizeof(HeaderDxt10))
+		{
+			return false;
+		}
+		memcpy(&extension, base + offset, sizeof(extension));
+		offset += sizeof(HeaderDxt10);
+		if (extension.resourceDimension != Texture2DDimension || extension.arraySize != 1 || extension.miscFlags != 0 ||
+			!FromDxgiFormat(extension.dxgiFormat, &view.format, &view.srgb))
+		{
+			return false;
+		}
+		break;
+	}
+	case Dxt1: view.format = BlockFormat::BC1; break;
+	case Dxt5: view.format = BlockFormat::BC3; break;
+	case Ati2:
+	case Bc5u: view.format = BlockFormat::BC5; break;
+	default:
+		return false;
+	}
+	view.dxgiFormat = ToDxgiFormat(view.format, view.srgb);
+
+	// Old writers leave the mip count at 0 for a single level
+	uint32_t mipCount = (header.flags & MipCountFlag) && header.mipCount > 0 ? header.mipCount : 1;
+	if (header.width == 0 || header.height == 0 || header.width % 4 != 0 || header.height % 4 != 0 ||
+		mipCount > std::min(GetMipCount(header.width, header.height), MaxMipCount) || ((header.flags & DepthFlag) && header.depth > 1))
+	{
+		return false;
+	}
+	view.width = header.width;
+	view.height = header.height;
+	view.mipCount = mipCount;
+
+	uint64_t blockBytes = GetBlockBytes(view.format);
+	for (uint32_t level = 0; level < mipCount; level++)
+	{
+		TextureMip& mip = view.mips[level];
+		mip.width = std::max(header.width >> level, 1u);
+		mip.height = std::max(header.height >> level, 1u);
+		mip.rowPitch = uint32_t(GetBlockCount(mip.width) * blockBytes);
+		mip.rowCount = GetBlockCount(mip.height);
+		mip.size = uint64_t(mip.rowPitch) * mip.rowCount;
+		if (mip.size > size - offset)
+		{
+			return false;
+		}
+		mip.data = base + offset;
+		offset += size_t(mip.size);
+	}
+	if (offset != size)
+	{
+		return false;
+	}
+	*out = view;
+	return true;
+}
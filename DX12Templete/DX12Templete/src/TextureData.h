@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BlockCompression.h"
+#include "DdsFormat.h"
+#include "JobSystem.h"
+
+// A texture the way the renderer consumes it: a block-compressed mip chain. BuildTextureData makes
+// one from RGBA8 pixels, offline in tools/TextureCompress or at load time for the built-in texture;
+// WriteDdsTexture and ReadDdsTexture move it to and from a .dds file. Nothing here touches D3D or the
+// file system.
+
+// An RGBA8 image, rows tightly packed
+struct RgbaImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels;
+};
+
+struct TextureMip
+{
+	const uint8_t* data = nullptr;
+	uint32_t width = 0;       // texels
+	uint32_t height = 0;
+	uint32_t rowPitch = 0;    // bytes per row of blocks
+	uint32_t rowCount = 0;    // rows of blocks
+	uint64_t size = 0;        // rowPitch * rowCount
+};
+
+// Borrowed mips, e.g. straight out of a mapped .dds file or out of a TextureData
+struct TextureView
+{
+	BlockFormat format = BlockFormat::BC1;
+	bool srgb = false;
+	uint32_t dxgiFormat = DdsFormat::DxgiUnknown;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipCount = 0;
+	TextureMip mips[DdsFormat::MaxMipCount];
+};
+
+struct TextureData
+{
+	BlockFormat format = BlockFormat::BC1;
+	bool srgb = false;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<std::vector<uint8_t>> mips;
+
+	TextureView GetView() const;
+};
+
+// Mips below 1x1 do not exist, so a full chain has floor(log2(max(width, height))) + 1 levels
+uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+// Halves the image down to 1x1. Each texel averages the 2x2 (3 at odd edges) texels above it, in
+// linear light when srgb is set and weighted by alpha, so transparent texels do not bleed their
+// colour into the edges of opaque ones. out[0] is a copy of the source.
+void GenerateMipChain(const RgbaImage& source, bool srgb, std::vector<RgbaImage>& out);
+
+// Generates mipCount levels (0 for the full chain) and compresses each on jobs when given one.
+// The GPU wants the largest mip of a block-compressed texture to be whole blocks, so width and
+// height must be multiples of 4; returns false otherwise.
+bool BuildTextureData(const RgbaImage& source, BlockFormat format, bool srgb, uint32_t mipCount,
+	const BlockCompressor& compressor, TextureData& out, JobSystem* jobs = nullptr);
+
+uint32_t ToDxgiFormat(BlockFormat format, bool srgb);
+
+// Serializes the view into a .dds image with a DX10 header
+void WriteDdsTexture(const TextureView& texture, std::vector<uint8_t>& image);
+
+// Points the view into a .dds image without copying. Accepts 2D textures in BC1, BC3, BC5 and BC7
+// with a DX10 header or a legacy FourCC, largest mip a multiple of 4 texels, and refuses images whose
+// mips do not exactly fill the file.
+bool ReadDdsTexture(const void* data, size_t size, TextureView* out);
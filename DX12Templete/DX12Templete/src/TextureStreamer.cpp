@@ -0,0 +1,253 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cfloat>
+
+SlotHandle TextureStreamer::Add(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t tailMip, const uint64_t* mipBytes)
+{
+	if (mipCount == 0 || mipCount > MaxMips || tailMip >= mipCount)
+	{
+		return SlotMap<Texture>::InvalidHandle;
+	}
+
+	Texture texture = {};
+	texture.width = width;
+	texture.height = height;
+	texture.mipCount = mipCount;
+	texture.tailMip = tailMip;
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		texture.mipBytes[std::min(mip, tailMip)] += mipBytes[mip];
+	}
+	texture.residentMip = tailMip;
+	texture.loadingMip = NoMip;
+	texture.wantedMip = tailMip;
+	texture.lastWantedFrame = mFrame;
+	mUsedBytes += texture.mipBytes[tailMip];
+	return mTextures.Create(texture);
+}
+
+void TextureStreamer::Remove(SlotHandle handle)
+{
+	const Texture* texture = mTextures.Get(handle);
+	if (!texture)
+	{
+		return;
+	}
+	for (uint32_t mip = texture->residentMip; mip <= texture->tailMip; mip++)
+	{
+		mUsedBytes -= texture->mipBytes[mip];
+	}
+	if (texture->loadingMip != NoMip)
+	{
+		mUsedBytes -= texture->mipBytes[texture->loadingMip];
+		mLoadsInFlight--;
+	}
+	mTextures.Destroy(handle);
+}
+
+void TextureStreamer::Clear()
+{
+	mTextures.Clear();
+	mUsedBytes = 0;
+	mLoadsInFlight = 0;
+}
+
+void TextureStreamer::RequestScreenSize(SlotHandle handle, float pixels)
+{
+	Texture* texture = mTextures.Get(handle);
+	if (texture)
+	{
+		texture->pixels = std::max(texture->pixels, pixels);
+	}
+}
+
+uint32_t TextureStreamer::SelectMip(uint32_t width, uint32_t height, uint32_t mipCount, float pixels)
+{
+	uint32_t size = std::max(width, height);
+	uint32_t mip = 0;
+	while (mip + 1 < mipCount && float(std::max(size >> (mip + 1), 1u)) >= pixels)
+	{
+		mip++;
+	}
+	return mip;
+}
+
+void TextureStreamer::Update(std::vector<TextureStreamEvent>& loads, std::vector<TextureStreamEvent>& evictions)
+{
+	mFrame++;
+
+	for (Texture& texture : mTextures)
+	{
+		texture.wantedMip = texture.pixels > 0.0f ?
+			std::min(SelectMip(texture.width, texture.height, texture.mipCount, texture.pixels), texture.tailMip) : texture.tailMip;
+		texture.priorityPixels = texture.pixels;
+		texture.pixels = 0.0f;
+		if (texture.wantedMip <= texture.residentMip)
+		{
+			texture.lastWantedFrame = mFrame;
+		}
+	}
+
+	// Unwanted for longer than the delay: gone even with room to spare. Textures with a load in flight
+	// keep theirs, as their mips must stay contiguous.
+	for (size_t i = 0; i < mTextures.Size(); i++)
+	{
+		Texture& texture = mTextures[i];
+		if (texture.loadingMip == NoMip && texture.residentMip < texture.wantedMip && mFrame - texture.lastWantedFrame >= mEvictionDelay)
+		{
+			while (texture.residentMip < texture.wantedMip)
+			{
+				Evict(mTextures.GetHandle(i), texture, evictions);
+			}
+		}
+	}
+
+	if (!Fits(0))
+	{
+		EvictBelow(FLT_MAX, mBudget, SIZE_MAX, false, evictions);
+	}
+
+	mCandidates.clear();
+	for (size_t i = 0; i < mTextures.Size(); i++)
+	{
+		const Texture& texture = mTextures[i];
+		if (texture.wantedMip < texture.residentMip && texture.loadingMip == NoMip)
+		{
+			mCandidates.push_back(i);
+		}
+	}
+	std::sort(mCandidates.begin(), mCandidates.end(), [&](size_t a, size_t b)
+	{
+		return GetMagnification(mTextures[a], mTextures[a].residentMip) > GetMagnification(mTextures[b], mTextures[b].residentMip);
+	});
+	// Once a load cannot make room, those after it, less magnified, can only take what is free
+	bool evictionFailed = false;
+	for (size_t i : mCandidates)
+	{
+		if (mLoadsInFlight >= mMaxLoadsInFlight)
+		{
+			break;
+		}
+		Texture& texture = mTextures[i];
+		uint32_t mip = texture.residentMip - 1;
+		uint64_t bytes = texture.mipBytes[mip];
+		if (!Fits(bytes))
+		{
+			if (evictionFailed || bytes > mBudget ||
+				!EvictBelow(GetMagnification(texture, texture.residentMip), mBudget - bytes, i, true, evictions))
+			{
+				evictionFailed = true;
+				continue;
+			}
+		}
+		texture.loadingMip = mip;
+		mUsedBytes += bytes;
+		mLoadsInFlight++;
+		loads.push_back({ mTextures.GetHandle(i), mip });
+	}
+}
+
+void TextureStreamer::FinishLoad(SlotHandle handle, uint32_t mip, bool succeeded)
+{
+	Texture* texture = mTextures.Get(handle);
+	if (!texture || texture->loadingMip != mip)
+	{
+		return;
+	}
+	texture->loadingMip = NoMip;
+	mLoadsInFlight--;
+	if (succeeded)
+	{
+		texture->residentMip = mip;
+	}
+	else
+	{
+		mUsedBytes -= texture->mipBytes[mip];
+	}
+}
+
+uint32_t TextureStreamer::GetResidentMip(SlotHandle handle) const
+{
+	const Texture* texture = mTextures.Get(handle);
+	return texture ? texture->residentMip : 0;
+}
+
+uint32_t TextureStreamer::GetWantedMip(SlotHandle handle) const
+{
+	const Texture* texture = mTextures.Get(handle);
+	return texture ? texture->wantedMip : 0;
+}
+
+bool TextureStreamer::IsLoading(SlotHandle handle) const
+{
+	const Texture* texture = mTextures.Get(handle);
+	return texture && texture->loadingMip != NoMip;
+}
+
+void TextureStreamer::Evict(SlotHandle handle, Texture& texture, std::vector<TextureStreamEvent>& evictions)
+{
+	evictions.push_back({ handle, texture.residentMip });
+	mUsedBytes -= texture.mipBytes[texture.residentMip];
+	texture.residentMip++;
+}
+
+float TextureStreamer::GetMagnification(const Texture& texture, uint32_t mip)
+{
+	return texture.priorityPixels / float(std::max(std::max(texture.width, texture.height) >> mip, 1u));
+}
+
+bool TextureStreamer::EvictBelow(float limit, uint64_t target, size_t keep, bool allOrNothing, std::vector<TextureStreamEvent>& evictions)
+{
+	auto evictable = [&](size_t i)
+	{
+		const Texture& texture = mTextures[i];
+		return i != keep && texture.loadingMip == NoMip && texture.residentMip < texture.tailMip &&
+			GetMagnification(texture, texture.residentMip + 1) < limit;
+	};
+
+	if (allOrNothing)
+	{
+		uint64_t bytes = 0;
+		for (size_t i = 0; i < mTextures.Size(); i++)
+		{
+			if (!evictable(i))
+			{
+				continue;
+			}
+			const Texture& texture = mTextures[i];
+			for (uint32_t mip = texture.residentMip; mip < texture.tailMip && GetMagnification(texture, mip + 1) < limit; mip++)
+			{
+				bytes += texture.mipBytes[mip];
+			}
+		}
+		if (mUsedBytes - bytes > target)
+		{
+			return false;
+		}
+	}
+
+	while (mUsedBytes > target)
+	{
+		size_t victim = SIZE_MAX;
+		float victimMagnification = 0.0f;
+		for (size_t i = 0; i < mTextures.Size(); i++)
+		{
+			if (!evictable(i))
+			{
+				continue;
+			}
+			float magnification = GetMagnification(mTextures[i], mTextures[i].residentMip + 1);
+			if (victim == SIZE_MAX || magnification < victimMagnification)
+			{
+				victim = i;
+				victimMagnification = magnification;
+			}
+		}
+		if (victim == SIZE_MAX)
+		{
+			return false;
+		}
+		Evict(mTextures.GetHandle(victim), mTextures[victim], evictions);
+	}
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SlotMap.h"
+
+// Decides which mips of each texture are resident, so that texture memory follows what is on screen
+// instead of what was loaded. Every texture keeps a contiguous run of mips, from its finest resident
+// mip down to the tail; the tail mips are resident from Add to Remove and never streamed.
+//
+// Each frame the renderer reports how many pixels every drawn texture covers. The mip wanted is the
+// coarsest one that still has a texel per pixel. Update then hands out loads one mip finer at a time,
+// the most magnified textures first, and evictions of mips that have not been wanted for a while.
+// When the budget is short, a load may evict mips whose loss leaves their texture less magnified than
+// the loading one is now; the evicted texture then ranks below it, so the two never trade places
+// back and forth. A lowered budget evicts the least missed mips first. Loads finish asynchronously
+// and are reported back with FinishLoad; evictions take effect at once, as the min-LOD clamp moves
+// to the next mip in the same Update. Resident plus loading bytes stay within the budget, unless the tails
+// alone exceed it. Nothing here touches D3D.
+struct TextureStreamEvent
+{
+	SlotHandle texture;
+	uint32_t mip;
+};
+
+class TextureStreamer
+{
+public:
+	static constexpr uint32_t MaxMips = 16;
+	static constexpr uint32_t DefaultMaxLoadsInFlight = 4;
+	static constexpr uint32_t DefaultEvictionDelay = 60; // frames
+
+	explicit TextureStreamer(uint64_t budget = 0) : mBudget(budget) {}
+
+	// mipBytes[mip] is what the mip takes on the GPU when resident; mips from tailMip on count as one
+	// allocation, so only their total matters. Returns InvalidHandle for more than MaxMips mips.
+	SlotHandle Add(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t tailMip, const uint64_t* mipBytes);
+	// Forgets the texture, loads in flight included; their FinishLoad calls are ignored
+	void Remove(SlotHandle texture);
+	void Clear();
+
+	void SetBudget(uint64_t bytes) { mBudget = bytes; }
+	uint64_t GetBudget() const { return mBudget; }
+	void SetMaxLoadsInFlight(uint32_t loads) { mMaxLoadsInFlight = loads > 0 ? loads : 1; }
+	// Frames a mip stays resident after it was last wanted, while the budget allows
+	void SetEvictionDelay(uint32_t frames) { mEvictionDelay = frames; }
+
+	// Between Updates, for every texture drawn: the size in pixels of its largest side on screen.
+	// Repeated requests keep the largest; textures nobody requests fall back to their tail.
+	void RequestScreenSize(SlotHandle texture, float pixels);
+	// Ends the frame's requests. Loads finer mips into memory the caller maps; evicted mips are no
+	// longer sampled from this frame on and their memory may go once earlier frames have finished.
+	void Update(std::vector<TextureStreamEvent>& loads, std::vector<TextureStreamEvent>& evictions);
+	// The mip handed out by Update is on the GPU and may be sampled, or failed to get there
+	void FinishLoad(SlotHandle texture, uint32_t mip, bool succeeded);
+
+	// The finest mip that may be sampled: the min-LOD clamp
+	uint32_t GetResidentMip(SlotHandle texture) const;
+	// The finest mip the last Update wanted
+	uint32_t GetWantedMip(SlotHandle texture) const;
+	bool IsLoading(SlotHandle texture) const;
+
+	uint64_t GetUsedBytes() const { return mUsedBytes; } // resident and loading
+	uint32_t GetLoadsInFlight() const { return mLoadsInFlight; }
+	size_t GetTextureCount() const { return mTextures.Size(); }
+
+	// The coarsest mip of a width x height texture with at least one texel per pixel across pixels
+	static uint32_t SelectMip(uint32_t width, uint32_t height, uint32_t mipCount, float pixels);
+
+private:
+	static constexpr uint32_t NoMip = UINT32_MAX;
+
+	struct Texture
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipCount;
+		uint32_t tailMip;
+		uint64_t mipBytes[MaxMips];  // the tail's total at tailMip
+		uint32_t residentMip;        // finest sampled mip
+		uint32_t loadingMip;         // residentMip - 1 while a load is in flight, NoMip otherwise
+		uint32_t wantedMip;
+		float pixels;                // this frame's request, 0 for none
+		float priorityPixels;        // last Update's request, to rank textures against each other
+		uint64_t lastWantedFrame;    // last frame that wanted residentMip or finer
+	};
+
+	// Screen pixels per texel of the mip across the texture's largest side; above 1 the mip is magnified
+	static float GetMagnification(const Texture& texture, uint32_t mip);
+	void Evict(SlotHandle handle, Texture& texture, std::vector<TextureStreamEvent>& evictions);
+	// Evicts the finest mips of idle textures other than keep, those whose loss magnifies their texture
+	// least first, for as long as that stays below limit, until the used bytes are down to target.
+	// With allOrNothing, nothing goes unless target can be reached.
+	bool EvictBelow(float limit, uint64_t target, size_t keep, bool allOrNothing, std::vector<TextureStreamEvent>& evictions);
+	bool Fits(uint64_t bytes) const { return mUsedBytes + bytes <= mBudget; }
+
+	SlotMap<Texture> mTextures;
+	uint64_t mBudget;
+	uint64_t mUsedBytes = 0;
+	uint64_t mFrame = 0;
+	uint32_t mLoadsInFlight = 0;
+	uint32_t mMaxLoadsInFlight = DefaultMaxLoadsInFlight;
+	uint32_t mEvictionDelay = DefaultEvictionDelay;
+	std::vector<size_t> mCandidates; // dense indices, reused between Updates
+};
@@ -0,0 +1,270 @@
+#include "TransformStore.h"
+#include <algorithm>
+
+static size_t PadToLanes(size_t count)
+{
+	return (count + TransformStore::LaneCount - 1) & ~(TransformStore::LaneCount - 1);
+}
+
+TransformHandle TransformStore::Create(TransformHandle parent)
+{
+	// A freed slot can only hold a child if it still sorts after the parent
+	if (!mFree.empty() && (parent.index == NoParent.index || mFree.back() > parent.index))
+	{
+		TransformHandle handle = { mFree.back() };
+		mFree.pop_back();
+		SetParent(handle, parent);
+		return handle;
+	}
+
+	TransformHandle handle = { uint32_t(mCount) };
+	mCount++;
+
+	size_t padded = PadToLanes(mCount);
+	if (padded != mWorld.size())
+	{
+		// Grow a whole lane group at once; new slots start as identity
+		mTranslationX.resize(padded, 0.0f);
+		mTranslationY.resize(padded, 0.0f);
+		mTranslationZ.resize(padded, 0.0f);
+		mRotationX.resize(padded, 0.0f);
+		mRotationY.resize(padded, 0.0f);
+		mRotationZ.resize(padded, 0.0f);
+		mRotationW.resize(padded, 1.0f);
+		mScaleX.resize(padded, 1.0f);
+		mScaleY.resize(padded, 1.0f);
+		mScaleZ.resize(padded, 1.0f);
+		mParent.resize(padded, NoParent.index);
+		mChildCount.resize(padded, 0);
+		mDirty.resize(padded, 0);
+		mWorld.resize(padded, XMMatrixIdentity());
+	}
+	SetParent(handle, parent);
+	return handle;
+}
+
+bool TransformStore::Destroy(TransformHandle handle)
+{
+	// A child left behind would keep reading whatever node reuses the slot
+	if (mChildCount[handle.index] > 0)
+	{
+		return false;
+	}
+	SetTranslation(handle, XMVectorZero());
+	SetRotation(handle, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	SetScale(handle, XMVectorSplatOne());
+	uint32_t parent = mParent[handle.index];
+	if (parent != NoParent.index)
+	{
+		mChildCount[parent]--;
+	}
+	mParent[handle.index] = NoParent.index;
+	mFree.push_back(handle.index);
+	return true;
+}
+
+void TransformStore::SetParent(TransformHandle handle, TransformHandle parent)
+{
+	mParent[handle.index] = parent.index;
+	if (parent.index != NoParent.index)
+	{
+		mChildCount[parent.index]++;
+	}
+	MarkDirty(handle);
+}
+
+void TransformStore::MarkDirty(TransformHandle handle)
+{
+	mDirty[handle.index] = 1;
+	if (handle.index < mFirstDirty)
+	{
+		mFirstDirty = handle.index;
+	}
+}
+
+void TransformStore::Reserve(size_t count)
+{
+	size_t padded = PadToLanes(count);
+	mTranslationX.reserve(padded);
+	mTranslationY.reserve(padded);
+	mTranslationZ.reserve(padded);
+	mRotationX.reserve(padded);
+	mRotationY.reserve(padded);
+	mRotationZ.reserve(padded);
+	mRotationW.reserve(padded);
+	mScaleX.reserve(padded);
+	mScaleY.reserve(padded);
+	mScaleZ.reserve(padded);
+	mParent.reserve(padded);
+	mChildCount.reserve(padded);
+	mDirty.reserve(padded);
+	mWorld.reserve(padded);
+}
+
+void TransformStore::Clear()
+{
+	mCount = 0;
+	mFirstDirty = SIZE_MAX;
+	mTranslationX.clear();
+	mTranslationY.clear();
+	mTranslationZ.clear();
+	mRotationX.clear();
+	mRotationY.clear();
+	mRotationZ.clear();
+	mRotationW.clear();
+	mScaleX.clear();
+	mScaleY.clear();
+	mScaleZ.clear();
+	mFree.clear();
+	mParent.clear();
+	mChildCount.clear();
+	mDirty.clear();
+	mWorld.clear();
+}
+
+void TransformStore::SetTranslation(TransformHandle handle, FXMVECTOR translation)
+{
+	mTranslationX[handle.index] = XMVectorGetX(translation);
+	mTranslationY[handle.index] = XMVectorGetY(translation);
+	mTranslationZ[handle.index] = XMVectorGetZ(translation);
+	MarkDirty(handle);
+}
+
+void TransformStore::SetRotation(TransformHandle handle, FXMVECTOR quaternion)
+{
+	mRotationX[handle.index] = XMVectorGetX(quaternion);
+	mRotationY[handle.index] = XMVectorGetY(quaternion);
+	mRotationZ[handle.index] = XMVectorGetZ(quaternion);
+	mRotationW[handle.index] = XMVectorGetW(quaternion);
+	MarkDirty(handle);
+}
+
+void TransformStore::SetScale(TransformHandle handle, FXMVECTOR scale)
+{
+	mScaleX[handle.index] = XMVectorGetX(scale);
+	mScaleY[handle.index] = XMVectorGetY(scale);
+	mScaleZ[handle.index] = XMVectorGetZ(scale);
+	MarkDirty(handle);
+}
+
+XMVECTOR TransformStore::GetTranslation(TransformHandle handle) const
+{
+	return XMVectorSet(mTranslationX[handle.index], mTranslationY[handle.index], mTranslationZ[handle.index], 0.0f);
+}
+
+XMVECTOR TransformStore::GetRotation(TransformHandle handle) const
+{
+	return XMVectorSet(mRotationX[handle.index], mRotationY[handle.index], mRotationZ[handle.index], mRotationW[handle.index]);
+}
+
+XMVECTOR TransformStore::GetScale(TransformHandle handle) const
+{
+	return XMVectorSet(mScaleX[handle.index], mScaleY[handle.index], mScaleZ[handle.index], 0.0f);
+}
+
+static inline XMVECTOR LoadLanes(const std::vector<float>& values, size_t i)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[i]));
+}
+
+size_t TransformStore::UpdateWorldMatrices(std::vector<uint32_t>* updatedIndices)
+{
+	if (mFirstDirty >= mCount)
+	{
+		return 0;
+	}
+
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+	const XMVECTOR zero = XMVectorZero();
+
+	size_t updated = 0;
+	size_t begin = mFirstDirty & ~(LaneCount - 1);
+	size_t end = PadToLanes(mCount);
+	for (size_t i = begin; i < end; i += LaneCount)
+	{
+		// Inherit from parents first; they sit at lower indices and are already final
+		uint8_t anyDirty = 0;
+		for (size_t lane = 0; lane < LaneCount; lane++)
+		{
+			uint32_t parent = mParent[i + lane];
+			if (parent != NoParent.index)
+			{
+				mDirty[i + lane] |= mDirty[parent];
+			}
+			anyDirty |= mDirty[i + lane];
+		}
+		if (!anyDirty)
+		{
+			continue;
+		}
+
+		// Each register holds one component for four objects
+		XMVECTOR qx = LoadLanes(mRotationX, i);
+		XMVECTOR qy = LoadLanes(mRotationY, i);
+		XMVECTOR qz = LoadLanes(mRotationZ, i);
+		XMVECTOR qw = LoadLanes(mRotationW, i);
+
+		XMVECTOR x2 = XMVectorMultiply(qx, two);
+		XMVECTOR y2 = XMVectorMultiply(qy, two);
+		XMVECTOR z2 = XMVectorMultiply(qz, two);
+		XMVECTOR xx = XMVectorMultiply(qx, x2);
+		XMVECTOR yy = XMVectorMultiply(qy, y2);
+		XMVECTOR zz = XMVectorMultiply(qz, z2);
+		XMVECTOR xy = XMVectorMultiply(qx, y2);
+		XMVECTOR xz = XMVectorMultiply(qx, z2);
+		XMVECTOR yz = XMVectorMultiply(qy, z2);
+		XMVECTOR wx = XMVectorMultiply(qw, x2);
+		XMVECTOR wy = XMVectorMultiply(qw, y2);
+		XMVECTOR wz = XMVectorMultiply(qw, z2);
+
+		// Same layout as XMMatrixRotationQuaternion, rows scaled by S
+		XMVECTOR sx = LoadLanes(mScaleX, i);
+		XMVECTOR sy = LoadLanes(mScaleY, i);
+		XMVECTOR sz = LoadLanes(mScaleZ, i);
+		XMMATRIX row0(
+			XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(yy, zz)), sx),
+			XMVectorMultiply(XMVectorAdd(xy, wz), sx),
+			XMVectorMultiply(XMVectorSubtract(xz, wy), sx),
+			zero);
+		XMMATRIX row1(
+			XMVectorMultiply(XMVectorSubtract(xy, wz), sy),
+			XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, zz)), sy),
+			XMVectorMultiply(XMVectorAdd(yz, wx), sy),
+			zero);
+		XMMATRIX row2(
+			XMVectorMultiply(XMVectorAdd(xz, wy), sz),
+			XMVectorMultiply(XMVectorSubtract(yz, wx), sz),
+			XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, yy)), sz),
+			zero);
+		XMMATRIX row3(LoadLanes(mTranslationX, i), LoadLanes(mTranslationY, i), LoadLanes(mTranslationZ, i), one);
+
+		// Back from one-component-per-register to one-row-per-register
+		row0 = XMMatrixTranspose(row0);
+		row1 = XMMatrixTranspose(row1);
+		row2 = XMMatrixTranspose(row2);
+		row3 = XMMatrixTranspose(row3);
+
+		// Lanes run in order, so a parent earlier in the same group is written before its child reads it
+		for (size_t lane = 0; lane < LaneCount; lane++)
+		{
+			if (!mDirty[i + lane])
+			{
+				continue;
+			}
+			XMMATRIX local(row0.r[lane], row1.r[lane], row2.r[lane], row3.r[lane]);
+			uint32_t parent = mParent[i + lane];
+			mWorld[i + lane] = parent == NoParent.index ? local : XMMatrixMultiply(local, mWorld[parent]);
+			updated++;
+			if (updatedIndices)
+			{
+				updatedIndices->push_back(uint32_t(i + lane));
+			}
+		}
+	}
+
+	// Flags are cleared only after the pass so children later in the array still see their parent's
+	std::fill(mDirty.begin() + begin, mDirty.end(), uint8_t(0));
+	mFirstDirty = SIZE_MAX;
+	return updated;
+}
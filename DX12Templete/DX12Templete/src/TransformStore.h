@@ -0,0 +1,75 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// Dense index into a TransformStore
+struct TransformHandle
+{
+	uint32_t index;
+};
+
+// Local translation, rotation and scale kept as separate float arrays (structure of arrays) so the
+// world matrix kernel can load four objects per SIMD register without gathering.
+// The arrays are padded to a multiple of four with identity transforms.
+//
+// Nodes are stored in topological order: a parent is always created before its children, so one
+// forward pass sees every parent's final world matrix before it reaches the child.
+// Destroyed slots are reused by later creations that keep that order intact.
+// Setting a local transform marks the node dirty; the pass inherits dirtiness from the parent and
+// only rebuilds dirty nodes, and returns immediately when nothing changed.
+class TransformStore
+{
+public:
+	static constexpr size_t LaneCount = 4;
+	static constexpr TransformHandle NoParent = { UINT32_MAX };
+
+	TransformHandle Create(TransformHandle parent = NoParent);
+	// Refuses, returning false, while the node still has children; destroy them first
+	bool Destroy(TransformHandle handle);
+	void Reserve(size_t count);
+	void Clear();
+	size_t GetCount() const { return mCount; } // highest index in use + 1, including freed slots
+
+	void SetTranslation(TransformHandle handle, FXMVECTOR translation);
+	void SetRotation(TransformHandle handle, FXMVECTOR quaternion);
+	void SetScale(TransformHandle handle, FXMVECTOR scale);
+	XMVECTOR GetTranslation(TransformHandle handle) const;
+	XMVECTOR GetRotation(TransformHandle handle) const;
+	XMVECTOR GetScale(TransformHandle handle) const;
+
+	TransformHandle GetParent(TransformHandle handle) const { return { mParent[handle.index] }; }
+	uint32_t GetChildCount(TransformHandle handle) const { return mChildCount[handle.index]; }
+
+	// Rebuilds world = scale * rotation * translation * parent world for every dirty node.
+	// Returns the number of world matrices rewritten and optionally appends their indices to updated.
+	size_t UpdateWorldMatrices(std::vector<uint32_t>* updated = nullptr);
+
+	const XMMATRIX* GetWorldMatrices() const { return mWorld.data(); }
+	const XMMATRIX& GetWorldMatrix(TransformHandle handle) const { return mWorld[handle.index]; }
+
+private:
+	size_t mCount = 0;
+	size_t mFirstDirty = SIZE_MAX;
+
+	std::vector<float> mTranslationX;
+	std::vector<float> mTranslationY;
+	std::vector<float> mTranslationZ;
+	std::vector<float> mRotationX;
+	std::vector<float> mRotationY;
+	std::vector<float> mRotationZ;
+	std::vector<float> mRotationW;
+	std::vector<float> mScaleX;
+	std::vector<float> mScaleY;
+	std::vector<float> mScaleZ;
+	std::vector<uint32_t> mParent;
+	std::vector<uint32_t> mChildCount;
+	std::vector<uint8_t> mDirty;
+	std::vector<XMMATRIX> mWorld;
+	std::vector<uint32_t> mFree;
+
+	void SetParent(TransformHandle handle, TransformHandle parent);
+	void MarkDirty(TransformHandle handle);
+};
@@ -0,0 +1,342 @@
+#include "VertexLayout.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// What the input assembler hands the shader
+static const char* GetInputType(VertexEncoding encoding)
+{
+	switch (encoding)
+	{
+	case VertexEncoding::Float3: return "float3";
+	case VertexEncoding::Oct16: return "float2";
+	default: return "float4";
+	}
+}
+
+static const char* GetFieldName(VertexSemantic semantic)
+{
+	static const char* names[] = { "position", "normal", "color" };
+	return names[size_t(semantic)];
+}
+
+static int16_t ToSnorm16(float v)
+{
+	return int16_t(std::lround(std::min(1.0f, std::max(-1.0f, v)) * 32767.0f));
+}
+
+static float FromSnorm16(int16_t v)
+{
+	return std::max(float(v) / 32767.0f, -1.0f);
+}
+
+void OctEncode(const float n[3], float out[2])
+{
+	float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+	float x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+	float y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+	if (n[2] < 0.0f)
+	{
+		// Fold the lower hemisphere over the diagonals
+		float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	out[0] = x;
+	out[1] = y;
+}
+
+void OctDecode(const float e[2], float out[3])
+{
+	float n[3] = { e[0], e[1], 1.0f - std::fabs(e[0]) - std::fabs(e[1]) };
+	float t = std::max(-n[2], 0.0f);
+	n[0] += n[0] >= 0.0f ? -t : t;
+	n[1] += n[1] >= 0.0f ? -t : t;
+	float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	for (int c = 0; c < 3; c++)
+	{
+		out[c] = n[c] / length;
+	}
+}
+
+VertexLayout::VertexLayout(const VertexElement* elements, size_t count)
+	: mElements(elements, elements + count)
+{
+	for (const VertexElement& element : mElements)
+	{
+		mOffsets.push_back(mStride);
+		mStride += GetEncodingSize(element.encoding);
+	}
+}
+
+bool VertexLayout::IsQuantized() const
+{
+	return std::any_of(mElements.begin(), mElements.end(), [](const VertexElement& e)
+	{
+		return e.semantic == VertexSemantic::Position && e.encoding == VertexEncoding::Snorm16x4;
+	});
+}
+
+void VertexLayout::GetInputElements(std::vector<VertexInputElement>& out) const
+{
+	out.clear();
+	for (size_t i = 0; i < mElements.size(); i++)
+	{
+		out.push_back({ GetSemanticName(mElements[i].semantic), 0, GetEncodingFormat(mElements[i].encoding), mOffsets[i] });
+	}
+}
+
+VertexQuantization VertexLayout::ComputeQuantization(const SourceVertex* vertices, size_t count) const
+{
+	VertexQuantization quantization;
+	if (!IsQuantized() || count == 0)
+	{
+		return quantization;
+	}
+	for (int a = 0; a < 3; a++)
+	{
+		float minP = vertices[0].position[a];
+		float maxP = minP;
+		for (size_t v = 1; v < count; v++)
+		{
+			minP = std::min(minP, vertices[v].position[a]);
+			maxP = std::max(maxP, vertices[v].position[a]);
+		}
+		// Flat axes still need a scale to divide by
+		quantization.bias[a] = (minP + maxP) * 0.5f;
+		quantization.scale[a] = std::max((maxP - minP) * 0.5f, 1e-6f);
+	}
+	return quantization;
+}
+
+// Attribute as four components: positions and colours get w = 1, normals w = 0
+static void GetAttribute(const SourceVertex& vertex, VertexSemantic semantic, float out[4])
+{
+	switch (semantic)
+	{
+	case VertexSemantic::Position:
+		std::copy(vertex.position, vertex.position + 3, out);
+		out[3] = 1.0f;
+		break;
+	case VertexSemantic::Normal:
+		std::copy(vertex.normal, vertex.normal + 3, out);
+		out[3] = 0.0f;
+		break;
+	case VertexSemantic::Color:
+		std::copy(vertex.color, vertex.color + 4, out);
+		break;
+	}
+}
+
+static void SetAttribute(SourceVertex& vertex, VertexSemantic semantic, const float value[4])
+{
+	switch (semantic)
+	{
+	case VertexSemantic::Position:
+		std::copy(value, value + 3, vertex.position);
+		break;
+	case VertexSemantic::Normal:
+		std::copy(value, value + 3, vertex.normal);
+		break;
+	case VertexSemantic::Color:
+		std::copy(value, value + 4, vertex.color);
+		break;
+	}
+}
+
+void VertexLayout::Encode(const SourceVertex* vertices, size_t count, const VertexQuantization& quantization, void* out) const
+{
+	uint8_t* destination = static_cast<uint8_t*>(out);
+	for (size_t v = 0; v < count; v++, destination += mStride)
+	{
+		for (size_t i = 0; i < mElements.size(); i++)
+		{
+			float value[4];
+			GetAttribute(vertices[v], mElements[i].semantic, value);
+			uint8_t* field = destination + mOffsets[i];
+			switch (mElements[i].encoding)
+			{
+			case VertexEncoding::Float3:
+				memcpy(field, value, 12);
+				break;
+			case VertexEncoding::Float4:
+				memcpy(field, value, 16);
+				break;
+			case VertexEncoding::Snorm16x4:
+			{
+				int16_t packed[4];
+				for (int c = 0; c < 4; c++)
+				{
+					bool quantize = mElements[i].semantic == VertexSemantic::Position && c < 3;
+					packed[c] = ToSnorm16(quantize ? (value[c] - quantization.bias[c]) / quantization.scale[c] : value[c]);
+				}
+				memcpy(field, packed, sizeof(packed));
+				break;
+			}
+			case VertexEncoding::Oct16:
+			{
+				float e[2];
+				OctEncode(value, e);
+				int16_t packed[2] = { ToSnorm16(e[0]), ToSnorm16(e[1]) };
+				memcpy(field, packed, sizeof(packed));
+				break;
+			}
+			case VertexEncoding::Unorm8x4:
+				for (int c = 0; c < 4; c++)
+				{
+					field[c] = uint8_t(std::lround(std::min(1.0f, std::max(0.0f, value[c])) * 255.0f));
+				}
+				break;
+			}
+		}
+	}
+}
+
+void VertexLayout::Decode(const void* in, size_t count, const VertexQuantization& quantization, SourceVertex* out) const
+{
+	const uint8_t* source = static_cast<const uint8_t*>(in);
+	for (size_t v = 0; v < count; v++, source += mStride)
+	{
+		out[v] = SourceVertex();
+		for (size_t i = 0; i < mElements.size(); i++)
+		{
+			const uint8_t* field = source + mOffsets[i];
+			float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			switch (mElements[i].encoding)
+			{
+			case VertexEncoding::Float3:
+				memcpy(value, field, 12);
+				break;
+			case VertexEncoding::Float4:
+				memcpy(value, field, 16);
+				break;
+			case VertexEncoding::Snorm16x4:
+			{
+				int16_t packed[4];
+				memcpy(packed, field, sizeof(packed));
+				for (int c = 0; c < 4; c++)
+				{
+					bool quantized = mElements[i].semantic == VertexSemantic::Position && c < 3;
+					value[c] = quantized ? FromSnorm16(packed[c]) * quantization.scale[c] + quantization.bias[c] : FromSnorm16(packed[c]);
+				}
+				break;
+			}
+			case VertexEncoding::Oct16:
+			{
+				int16_t packed[2];
+				memcpy(packed, field, sizeof(packed));
+				float e[2] = { FromSnorm16(packed[0]), FromSnorm16(packed[1]) };
+				OctDecode(e, value);
+				value[3] = 0.0f;
+				break;
+			}
+			case VertexEncoding::Unorm8x4:
+				for (int c = 0; c < 4; c++)
+				{
+					value[c] = field[c] / 255.0f;
+				}
+				break;
+			}
+			SetAttribute(out[v], mElements[i].semantic, value);
+		}
+	}
+}
+
+// HLSL expression widening one element to four components, from an input register or a raw buffer
+static std::string ExpandInput(VertexEncoding encoding, const std::string& value)
+{
+	switch (encoding)
+	{
+	case VertexEncoding::Float3: return "float4(" + value + ", 1.0f)";
+	case VertexEncoding::Oct16: return "float4(OctDecode(" + value + "), 0.0f)";
+	default: return value;
+	}
+}
+
+static std::string LoadRaw(VertexEncoding encoding, const std::string& address)
+{
+	switch (encoding)
+	{
+	case VertexEncoding::Float3: return "float4(asfloat(buffer.Load3(" + address + ")), 1.0f)";
+	case VertexEncoding::Float4: return "asfloat(buffer.Load4(" + address + "))";
+	case VertexEncoding::Snorm16x4: return "UnpackSnorm16x4(buffer.Load2(" + address + "))";
+	case VertexEncoding::Oct16: return "float4(OctDecode(UnpackSnorm16x2(buffer.Load(" + address + "))), 0.0f)";
+	case VertexEncoding::Unorm8x4: return "UnpackUnorm8x4(buffer.Load(" + address + "))";
+	}
+	return std::string();
+}
+
+static const char* const HlslHelpers =
+	"#ifndef VERTEX_LAYOUT_HELPERS\n"
+	"#define VERTEX_LAYOUT_HELPERS\n"
+	"\n"
+	"float2 UnpackSnorm16x2(uint v)\n"
+	"{\n"
+	"\tint2 s = int2(int(v << 16) >> 16, int(v) >> 16);\n"
+	"\treturn max(float2(s) / 32767.0f, -1.0f);\n"
+	"}\n"
+	"\n"
+	"float4 UnpackSnorm16x4(uint2 v)\n"
+	"{\n"
+	"\treturn float4(UnpackSnorm16x2(v.x), UnpackSnorm16x2(v.y));\n"
+	"}\n"
+	"\n"
+	"float4 UnpackUnorm8x4(uint v)\n"
+	"{\n"
+	"\treturn float4(v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24) / 255.0f;\n"
+	"}\n"
+	"\n"
+	"float3 OctDecode(float2 e)\n"
+	"{\n"
+	"\tfloat3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));\n"
+	"\tfloat t = saturate(-n.z);\n"
+	"\tn.xy -= (step(0.0f, n.xy) * 2.0f - 1.0f) * t;\n"
+	"\treturn normalize(n);\n"
+	"}\n"
+	"\n"
+	"#endif\n";
+
+std::string VertexLayout::GenerateHlsl(const char* name) const
+{
+	std::string n = name;
+	std::string out;
+	out += "// " + std::to_string(mStride) + " bytes per vertex\n\n";
+	out += HlslHelpers;
+
+	out += "\nstruct " + n + "Input\n{\n";
+	for (const VertexElement& element : mElements)
+	{
+		out += std::string("\t") + GetInputType(element.encoding) + " " + GetFieldName(element.semantic) + " : " + GetSemanticName(element.semantic) + ";\n";
+	}
+	out += "};\n";
+
+	// Positions are quantized when IsQuantized(); their scale and bias are folded into worldViewProj
+	out += "\nstruct " + n + "\n{\n";
+	for (const VertexElement& element : mElements)
+	{
+		out += std::string("\t") + (element.semantic == VertexSemantic::Normal ? "float3 " : "float4 ") + GetFieldName(element.semantic) + ";\n";
+	}
+	out += "};\n";
+
+	out += "\n" + n + " Decode" + n + "(" + n + "Input input)\n{\n\t" + n + " result;\n";
+	for (const VertexElement& element : mElements)
+	{
+		std::string field = GetFieldName(element.semantic);
+		std::string swizzle = element.semantic == VertexSemantic::Normal ? ".xyz" : "";
+		out += "\tresult." + field + " = " + ExpandInput(element.encoding, "input." + field) + swizzle + ";\n";
+	}
+	out += "\treturn result;\n}\n";
+
+	out += "\n" + n + " Load" + n + "(ByteAddressBuffer buffer, uint index)\n{\n";
+	out += "\tuint address = index * " + std::to_string(mStride) + ";\n\t" + n + " result;\n";
+	for (size_t i = 0; i < mElements.size(); i++)
+	{
+		std::string field = GetFieldName(mElements[i].semantic);
+		std::string swizzle = mElements[i].semantic == VertexSemantic::Normal ? ".xyz" : "";
+		std::string address = mOffsets[i] ? "address + " + std::to_string(mOffsets[i]) : "address";
+		out += "\tresult." + field + " = " + LoadRaw(mElements[i].encoding, address) + swizzle + ";\n";
+	}
+	out += "\treturn result;\n}\n";
+	return out;
+}
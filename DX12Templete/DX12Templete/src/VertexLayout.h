@@ -0,0 +1,167 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Vertex formats described once and compiled into everything that has to agree on them: the byte
+// layout and the encoder on the CPU, the input elements of the pipeline state, and HLSL that decodes
+// a vertex from input assembler registers or, for mesh shaders, straight from a raw buffer.
+// Nothing here touches D3D; the renderer maps VertexFormat to DXGI.
+
+enum class VertexSemantic : uint8_t
+{
+	Position,
+	Normal,
+	Color,
+};
+
+enum class VertexEncoding : uint8_t
+{
+	Float3,     // 12 bytes
+	Float4,     // 16 bytes
+	Snorm16x4,  // positions, 8 bytes: quantized to the mesh bounds with w = 1
+	Oct16,      // unit vectors, 4 bytes: octahedral mapping in two 16-bit snorms
+	Unorm8x4,   // colours, 4 bytes
+};
+
+// What the input assembler reads
+enum class VertexFormat : uint8_t
+{
+	R32G32B32_Float,
+	R32G32B32A32_Float,
+	R16G16B16A16_Snorm,
+	R16G16_Snorm,
+	R8G8B8A8_Unorm,
+};
+
+struct VertexElement
+{
+	VertexSemantic semantic;
+	VertexEncoding encoding;
+};
+
+struct VertexInputElement
+{
+	const char* semanticName;
+	uint32_t semanticIndex;
+	VertexFormat format;
+	uint32_t offset;
+};
+
+constexpr uint32_t GetEncodingSize(VertexEncoding encoding)
+{
+	switch (encoding)
+	{
+	case VertexEncoding::Float3: return 12;
+	case VertexEncoding::Float4: return 16;
+	case VertexEncoding::Snorm16x4: return 8;
+	case VertexEncoding::Oct16: return 4;
+	case VertexEncoding::Unorm8x4: return 4;
+	}
+	return 0;
+}
+
+constexpr VertexFormat GetEncodingFormat(VertexEncoding encoding)
+{
+	switch (encoding)
+	{
+	case VertexEncoding::Float3: return VertexFormat::R32G32B32_Float;
+	case VertexEncoding::Float4: return VertexFormat::R32G32B32A32_Float;
+	case VertexEncoding::Snorm16x4: return VertexFormat::R16G16B16A16_Snorm;
+	case VertexEncoding::Oct16: return VertexFormat::R16G16_Snorm;
+	case VertexEncoding::Unorm8x4: return VertexFormat::R8G8B8A8_Unorm;
+	}
+	return VertexFormat::R32G32B32_Float;
+}
+
+constexpr const char* GetSemanticName(VertexSemantic semantic)
+{
+	switch (semantic)
+	{
+	case VertexSemantic::Position: return "POSITION";
+	case VertexSemantic::Normal: return "NORMAL";
+	case VertexSemantic::Color: return "COLOR";
+	}
+	return "";
+}
+
+// Compile-time forms of the VertexLayout queries, for descriptions declared constexpr. Packed vertex
+// structs are checked against them with static_assert, and input elements come out as constants.
+template <size_t N>
+constexpr uint32_t GetVertexOffset(const VertexElement (&elements)[N], size_t index)
+{
+	uint32_t offset = 0;
+	for (size_t i = 0; i < index; i++)
+	{
+		offset += GetEncodingSize(elements[i].encoding);
+	}
+	return offset;
+}
+
+template <size_t N>
+constexpr uint32_t GetVertexStride(const VertexElement (&elements)[N])
+{
+	return GetVertexOffset(elements, N);
+}
+
+template <size_t N>
+constexpr std::array<VertexInputElement, N> MakeInputElements(const VertexElement (&elements)[N])
+{
+	std::array<VertexInputElement, N> out = {};
+	for (size_t i = 0; i < N; i++)
+	{
+		out[i] = { GetSemanticName(elements[i].semantic), 0, GetEncodingFormat(elements[i].encoding), GetVertexOffset(elements, i) };
+	}
+	return out;
+}
+
+// Full precision vertex the encoder reads; attributes missing from a layout are ignored
+struct SourceVertex
+{
+	float position[3];
+	float normal[3];
+	float color[4];
+};
+
+// Quantized positions decode as q * scale + bias. The renderer folds this into the object's
+// matrices, so shaders transform the quantized value directly.
+struct VertexQuantization
+{
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	float bias[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+class VertexLayout
+{
+public:
+	// Elements keep their order; each semantic may appear once
+	VertexLayout(const VertexElement* elements, size_t count);
+
+	uint32_t GetStride() const { return mStride; }
+	size_t GetElementCount() const { return mElements.size(); }
+	const VertexElement& GetElement(size_t i) const { return mElements[i]; }
+	uint32_t GetOffset(size_t i) const { return mOffsets[i]; }
+	bool IsQuantized() const;
+
+	void GetInputElements(std::vector<VertexInputElement>& out) const;
+
+	// Centre and half size of the bounds; identity when positions are not quantized
+	VertexQuantization ComputeQuantization(const SourceVertex* vertices, size_t count) const;
+	void Encode(const SourceVertex* vertices, size_t count, const VertexQuantization& quantization, void* out) const;
+	// Back to full precision, including the quantization; for tools and checks
+	void Decode(const void* in, size_t count, const VertexQuantization& quantization, SourceVertex* out) const;
+
+	// Input struct, decoded struct, DecodeName() for the input assembler and LoadName() for raw buffers
+	std::string GenerateHlsl(const char* name) const;
+
+private:
+	std::vector<VertexElement> mElements;
+	std::vector<uint32_t> mOffsets;
+	uint32_t mStride = 0;
+};
+
+// Octahedral mapping of a unit vector to [-1, 1]^2 and back (Cigolle et al., JCGT 2014)
+void OctEncode(const float n[3], float out[2]);
+void OctDecode(const float e[2], float out[3]);
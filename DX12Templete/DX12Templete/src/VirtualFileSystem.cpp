@@ -0,0 +1,514 @@
+#include "VirtualFileSystem.h"
+#include "CompressedStream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace PackFormat;
+
+// The smallest page either platform maps with
+static constexpr size_t PageSize = 4096;
+
+static bool HostFileExists(const std::string& path, bool directory)
+{
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesW(WidenUtf8(path).c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && ((attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) == directory;
+#else
+	struct stat status;
+	return stat(path.c_str(), &status) == 0 && (directory ? S_ISDIR(status.st_mode) : S_ISREG(status.st_mode));
+#endif
+}
+
+static bool IsEmptyHostFile(const std::string& path)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	return GetFileAttributesExW(WidenUtf8(path).c_str(), GetFileExInfoStandard, &data) &&
+		!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && data.nFileSizeLow == 0 && data.nFileSizeHigh == 0;
+#else
+	struct stat status;
+	return stat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode) && status.st_size == 0;
+#endif
+}
+
+// One read per page, so the page faults happen here and not on whoever reads the view next.
+// Pack entries start anywhere in a page, so the steps follow page boundaries, not the view.
+static void TouchPages(const FileView& view)
+{
+	const volatile uint8_t* bytes = static_cast<const uint8_t*>(view.GetData());
+	const uintptr_t address = reinterpret_cast<uintptr_t>(view.GetData());
+	uint8_t sum = 0;
+	size_t offset = 0;
+	while (offset < view.GetSize())
+	{
+		sum ^= bytes[offset];
+		offset = ((address + offset) / PageSize + 1) * PageSize - address;
+	}
+	(void)sum;
+}
+
+VirtualFileSystem::VirtualFileSystem(unsigned ioThreadCount, unsigned decompressWorkerCount)
+	: mMounts(std::make_shared<const MountList>())
+	, mDecompressJobs(decompressWorkerCount)
+{
+	mIoThreads.reserve(ioThreadCount);
+	for (unsigned i = 0; i < ioThreadCount; i++)
+	{
+		mIoThreads.emplace_back(&VirtualFileSystem::IoThreadMain, this);
+	}
+}
+
+VirtualFileSystem::~VirtualFileSystem()
+{
+	// Queued reads still complete, so no future is left without a value
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mStop = true;
+	}
+	mQueueWake.notify_all();
+	for (std::thread& thread : mIoThreads)
+	{
+		thread.join();
+	}
+}
+
+bool VirtualFileSystem::NormalizePath(const std::string& name, std::string* normalized)
+{
+	std::string result;
+	result.reserve(name.size());
+	size_t begin = 0;
+	while (begin <= name.size())
+	{
+		size_t end = begin;
+		while (end < name.size() && name[end] != '/' && name[end] != '\\')
+		{
+			end++;
+		}
+		size_t length = end - begin;
+		if (length == 2 && name[begin] == '.' && name[begin + 1] == '.')
+		{
+			return false;
+		}
+		if (length > 0 && !(length == 1 && name[begin] == '.'))
+		{
+			if (!result.empty())
+			{
+				result += '/';
+			}
+			result.append(name, begin, length);
+		}
+		begin = end + 1;
+	}
+	*normalized = std::move(result);
+	return true;
+}
+
+std::string VirtualFileSystem::GetExecutableDirectory()
+{
+	std::string path;
+#ifdef _WIN32
+	// GetModuleFileNameW counts characters and truncates silently, so grow until the path fits
+	std::wstring buffer(MAX_PATH, L'\0');
+	for (;;)
+	{
+		DWORD length = GetModuleFileNameW(nullptr, &buffer[0], static_cast<DWORD>(buffer.size()));
+		if (length == 0)
+		{
+			return ".";
+		}
+		if (length < buffer.size())
+		{
+			buffer.resize(length);
+			break;
+		}
+		buffer.resize(buffer.size() * 2);
+	}
+	path = NarrowUtf8(buffer);
+	std::replace(path.begin(), path.end(), '\\', '/');
+#else
+	std::string buffer(256, '\0');
+	for (;;)
+	{
+		ssize_t length = readlink("/proc/self/exe", &buffer[0], buffer.size());
+		if (length <= 0)
+		{
+			return ".";
+		}
+		if (size_t(length) < buffer.size())
+		{
+			buffer.resize(size_t(length));
+			break;
+		}
+		buffer.resize(buffer.size() * 2);
+	}
+	path = buffer;
+#endif
+	size_t separator = path.find_last_of('/');
+	return separator == std::string::npos ? "." : path.substr(0, separator);
+}
+
+bool VirtualFileSystem::MountDirectory(const std::string& mountPoint, const std::string& directory)
+{
+	if (!HostFileExists(directory, true))
+	{
+		return false;
+	}
+	auto mount = std::make_shared<Mount>();
+	mount->directory = directory;
+	while (mount->directory.size() > 1 && (mount->directory.back() == '/' || mount->directory.back() == '\\'))
+	{
+		mount->directory.pop_back();
+	}
+	return AddMount(mount, mountPoint);
+}
+
+bool VirtualFileSystem::MountPack(const std::string& mountPoint, const std::string& packPath)
+{
+	auto file = std::make_shared<MappedFile>();
+	if (!file->Open(packPath))
+	{
+		return false;
+	}
+
+	// Everything a lookup will trust is checked once here
+	const uint8_t* base = static_cast<const uint8_t*>(file->GetData());
+	const uint64_t fileSize = file->GetSize();
+	if (fileSize < sizeof(Header))
+	{
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(base);
+	if (header->magic != Magic || header->version != Version || header->dataAlignment != DataAlignment || header->fileSize != fileSize)
+	{
+		return false;
+	}
+	if (header->entryOffset % alignof(Entry) != 0 || header->entryOffset > fileSize ||
+		header->entryCount > (fileSize - header->entryOffset) / sizeof(Entry))
+	{
+		return false;
+	}
+	if (header->pathOffset > fileSize || header->pathSize > fileSize - header->pathOffset)
+	{
+		return false;
+	}
+
+	const Entry* entries = reinterpret_cast<const Entry*>(base + header->entryOffset);
+	const char* paths = reinterpret_cast<const char*>(base + header->pathOffset);
+	for (uint32_t i = 0; i < header->entryCount; i++)
+	{
+		const Entry& entry = entries[i];
+		if (uint64_t(entry.pathOffset) + entry.pathLength > header->pathSize || entry.pathLength == 0)
+		{
+			return false;
+		}
+		if (entry.offset % DataAlignment != 0 || entry.offset > fileSize || entry.storedSize > fileSize - entry.offset)
+		{
+			return false;
+		}
+		// Compressed streams are checked when they are read, so mounting touches only the index
+		if ((entry.flags & ~uint32_t(CompressedEntry)) != 0 || (!(entry.flags & CompressedEntry) && entry.storedSize != entry.size))
+		{
+			return false;
+		}
+		const char* path = paths + entry.pathOffset;
+		if (entry.hash != HashPath(path, entry.pathLength))
+		{
+			return false;
+		}
+		if (i > 0)
+		{
+			const Entry& previous = entries[i - 1];
+			if (ComparePath(previous.hash, paths + previous.pathOffset, previous.pathLength, entry.hash, path, entry.pathLength) >= 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	auto mount = std::make_shared<Mount>();
+	mount->pack = file;
+	mount->entries = entries;
+	mount->entryCount = header->entryCount;
+	mount->paths = paths;
+	return AddMount(mount, mountPoint);
+}
+
+bool VirtualFileSystem::AddMount(std::shared_ptr<Mount> mount, const std::string& mountPoint)
+{
+	if (!NormalizePath(mountPoint, &mount->mountPoint))
+	{
+		return false;
+	}
+	if (!mount->mountPoint.empty())
+	{
+		mount->mountPoint += '/';
+	}
+
+	std::lock_guard<std::mutex> lock(mMountMutex);
+	auto mounts = std::make_shared<MountList>(*mMounts);
+	mounts->insert(mounts->begin(), std::move(mount));
+	mMounts = std::move(mounts);
+	return true;
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+	std::lock_guard<std::mutex> lock(mMountMutex);
+	mMounts = std::make_shared<const MountList>();
+}
+
+size_t VirtualFileSystem::GetMountCount() const
+{
+	return GetMounts()->size();
+}
+
+std::shared_ptr<const VirtualFileSystem::MountList> VirtualFileSystem::GetMounts() const
+{
+	std::lock_guard<std::mutex> lock(mMountMutex);
+	return mMounts;
+}
+
+const Entry* VirtualFileSystem::FindEntry(const Mount& mount, const std::string& path) const
+{
+	uint64_t hash = HashPath(path.data(), path.size());
+	const Entry* begin = mount.entries;
+	const Entry* end = mount.entries + mount.entryCount;
+	const Entry* found = std::lower_bound(begin, end, hash, [&](const Entry& entry, uint64_t) {
+		return ComparePath(entry.hash, mount.paths + entry.pathOffset, entry.pathLength, hash, path.data(), path.size()) < 0;
+	});
+	if (found == end || found->hash != hash || found->pathLength != path.size() ||
+		memcmp(mount.paths + found->pathOffset, path.data(), path.size()) != 0)
+	{
+		return nullptr;
+	}
+	return found;
+}
+
+bool VirtualFileSystem::Exists(const std::string& name) const
+{
+	std::string path;
+	if (!NormalizePath(name, &path))
+	{
+		return false;
+	}
+	std::shared_ptr<const MountList> mounts = GetMounts();
+	for (const std::shared_ptr<const Mount>& mount : *mounts)
+	{
+		if (path.compare(0, mount->mountPoint.size(), mount->mountPoint) != 0)
+		{
+			continue;
+		}
+		std::string relative = path.substr(mount->mountPoint.size());
+		if (mount->pack ? FindEntry(*mount, relative) != nullptr : HostFileExists(mount->directory + "/" + relative, false))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VirtualFileSystem::Locate(const std::string& name, Location* location) const
+{
+	std::string path;
+	if (!NormalizePath(name, &path))
+	{
+		return false;
+	}
+	std::shared_ptr<const MountList> mounts = GetMounts();
+	for (const std::shared_ptr<const Mount>& mount : *mounts)
+	{
+		if (path.compare(0, mount->mountPoint.size(), mount->mountPoint) != 0)
+		{
+			continue;
+		}
+		std::string relative = path.substr(mount->mountPoint.size());
+		if (mount->pack)
+		{
+			const Entry* entry = FindEntry(*mount, relative);
+			if (entry)
+			{
+				location->mount = mount;
+				location->entry = entry;
+				location->data = static_cast<const uint8_t*>(mount->pack->GetData()) + entry->offset;
+				location->size = static_cast<size_t>(entry->size);
+				location->compressed = (entry->flags & CompressedEntry) != 0;
+				return true;
+			}
+			continue;
+		}
+		std::string hostPath = mount->directory + "/" + relative;
+		auto file = std::make_shared<MappedFile>();
+		// Empty files cannot be mapped, but they read as empty from a pack, so they do here too
+		if (file->Open(hostPath) || IsEmptyHostFile(hostPath))
+		{
+			location->mount = mount;
+			location->data = static_cast<const uint8_t*>(file->GetData());
+			location->size = file->GetSize();
+			location->file = std::move(file);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VirtualFileSystem::Decompress(const Location& location, void* destination, bool writeCombined) const
+{
+	auto begin = std::chrono::steady_clock::now();
+	bool decompressed;
+	{
+		std::lock_guard<std::mutex> lock(mDecompressMutex);
+		decompressed = DecompressStream(location.data, static_cast<size_t>(location.entry->storedSize), destination, location.size,
+			&mDecompressJobs, writeCombined);
+	}
+	mDecompressNanoseconds += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+	if (decompressed)
+	{
+		mDecompressedReads++;
+		mDecompressedBytes += location.size;
+	}
+	return decompressed;
+}
+
+void VirtualFileSystem::CountRead(const Location& location) const
+{
+	mReads++;
+	mStoredBytes += location.entry ? location.entry->storedSize : location.size;
+	mBytes += location.size;
+}
+
+bool VirtualFileSystem::Read(const std::string& name, FileView* view) const
+{
+	view->Reset();
+	Location location;
+	if (!Locate(name, &location))
+	{
+		return false;
+	}
+	if (!location.compressed)
+	{
+		view->mOwner = location.file ? location.file : location.mount->pack;
+		view->mData = location.data;
+		view->mSize = location.size;
+		CountRead(location);
+		return true;
+	}
+
+	std::shared_ptr<uint8_t> buffer(new (std::align_val_t(DataAlignment)) uint8_t[location.size],
+		[](uint8_t* bytes) { operator delete[](bytes, std::align_val_t(DataAlignment)); });
+	if (!Decompress(location, buffer.get(), false))
+	{
+		return false;
+	}
+	view->mData = buffer.get();
+	view->mSize = location.size;
+	view->mOwner = std::move(buffer);
+	CountRead(location);
+	return true;
+}
+
+bool VirtualFileSystem::GetSize(const std::string& name, size_t* size) const
+{
+	Location location;
+	if (!Locate(name, &location))
+	{
+		return false;
+	}
+	*size = location.size;
+	return true;
+}
+
+bool VirtualFileSystem::ReadInto(const std::string& name, void* destination, size_t size, bool writeCombined) const
+{
+	Location location;
+	if (!Locate(name, &location) || location.size != size)
+	{
+		return false;
+	}
+	if (location.compressed)
+	{
+		if (!Decompress(location, destination, writeCombined))
+		{
+			return false;
+		}
+	}
+	else if (size > 0)
+	{
+		memcpy(destination, location.data, size);
+	}
+	CountRead(location);
+	return true;
+}
+
+FileReadStatistics VirtualFileSystem::GetStatistics() const
+{
+	FileReadStatistics statistics;
+	statistics.reads = mReads;
+	statistics.decompressedReads = mDecompressedReads;
+	statistics.storedBytes = mStoredBytes;
+	statistics.bytes = mBytes;
+	statistics.decompressedBytes = mDecompressedBytes;
+	statistics.decompressSeconds = double(mDecompressNanoseconds) * 1e-9;
+	return statistics;
+}
+
+void VirtualFileSystem::ResetStatistics()
+{
+	mReads = 0;
+	mDecompressedReads = 0;
+	mStoredBytes = 0;
+	mBytes = 0;
+	mDecompressedBytes = 0;
+	mDecompressNanoseconds = 0;
+}
+
+std::future<FileView> VirtualFileSystem::ReadAsync(const std::string& name)
+{
+	AsyncRead read;
+	read.name = name;
+	std::future<FileView> result = read.result.get_future();
+	if (mIoThreads.empty())
+	{
+		FileView view;
+		Read(name, &view);
+		read.result.set_value(std::move(view));
+		return result;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mQueue.push_back(std::move(read));
+	}
+	mQueueWake.notify_one();
+	return result;
+}
+
+void VirtualFileSystem::IoThreadMain()
+{
+	for (;;)
+	{
+		AsyncRead read;
+		{
+			std::unique_lock<std::mutex> lock(mQueueMutex);
+			mQueueWake.wait(lock, [this] { return mStop || !mQueue.empty(); });
+			if (mQueue.empty())
+			{
+				return;
+			}
+			read = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+		FileView view;
+		if (Read(read.name, &view))
+		{
+			TouchPages(view);
+		}
+		read.result.set_value(std::move(view));
+	}
+}
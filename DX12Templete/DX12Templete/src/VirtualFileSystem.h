@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "PackFormat.h"
+
+// A file's bytes, mapped, or decompressed when the pack stores them compressed. Copies share the
+// memory, which lives as long as any copy does, so a view may outlive the mount it came from and the
+// VirtualFileSystem itself. Data starts on a PackFormat::DataAlignment boundary. Empty files give a
+// valid view of size 0 and no data.
+class FileView
+{
+public:
+	bool IsValid() const { return mOwner != nullptr; }
+	const void* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+	void Reset() { *this = FileView(); }
+private:
+	friend class VirtualFileSystem;
+	std::shared_ptr<const void> mOwner;  // the mapping or the decompressed copy
+	const uint8_t* mData = nullptr;
+	size_t mSize = 0;
+};
+
+struct FileReadStatistics
+{
+	size_t reads = 0;
+	size_t decompressedReads = 0;
+	uint64_t storedBytes = 0;        // read from disk, or the page cache
+	uint64_t bytes = 0;              // handed out
+	uint64_t decompressedBytes = 0;  // the part of bytes that came out of decompression
+	double decompressSeconds = 0.0;  // wall time, on all decompression threads at once
+};
+
+// Resolves asset names to loose files or pack entries through mount points, and hands out mapped
+// views either way. Names are UTF-8 with '/' separators; backslashes, "./" and repeated separators
+// are tidied away, ".." is refused. Pack entries match case exactly. Loose files go through the OS,
+// which ignores case on Windows, so spell names in their exact case or they break once packed.
+//
+// A pack mount is one mapping and an in-memory index, so a lookup costs a binary search instead of
+// a file system call and thousands of small assets cost one open. Later mounts are searched first:
+// mount loose directories before the packs built from them and the packs win. Compressed pack entries
+// decompress chunk by chunk on a pool of workers, one file at a time at full width.
+//
+// Read, ReadInto and ReadAsync may be called from any thread; mounting belongs to the owner.
+class VirtualFileSystem
+{
+public:
+	explicit VirtualFileSystem(unsigned ioThreadCount = 2, unsigned decompressWorkerCount = JobSystem::DefaultWorkerCount());
+	~VirtualFileSystem();
+
+	VirtualFileSystem(const VirtualFileSystem&) = delete;
+	VirtualFileSystem& operator=(const VirtualFileSystem&) = delete;
+
+	// mountPoint is a virtual directory, "" for the root. Both fail when the host directory or the
+	// pack is missing or the pack is damaged, leaving the other mounts as they were.
+	bool MountDirectory(const std::string& mountPoint, const std::string& directory);
+	bool MountPack(const std::string& mountPoint, const std::string& packPath);
+	void UnmountAll();
+	size_t GetMountCount() const;
+
+	bool Exists(const std::string& name) const;
+	bool Read(const std::string& name, FileView* view) const;
+	// The size Read would return, without decompressing
+	bool GetSize(const std::string& name, size_t* size) const;
+	// Reads into memory the caller owns, e.g. a mapped upload buffer; size must be the file's size.
+	// Compressed entries decompress straight into it; pass writeCombined for upload heap memory.
+	bool ReadInto(const std::string& name, void* destination, size_t size, bool writeCombined = false) const;
+	// Maps the file on an I/O thread and faults its pages in there, so the bytes are resident by the
+	// time the future is ready. The view is invalid when the file is missing.
+	std::future<FileView> ReadAsync(const std::string& name);
+
+	// Since the last ResetStatistics
+	FileReadStatistics GetStatistics() const;
+	void ResetStatistics();
+
+	// "a/b.c" from "a\\b.c", "./a//b.c" or "/a/b.c"; false for names with ".." in them
+	static bool NormalizePath(const std::string& name, std::string* normalized);
+	// UTF-8, '/' separated, without the trailing separator
+	static std::string GetExecutableDirectory();
+
+private:
+	struct Mount
+	{
+		std::string mountPoint;                  // normalized, "" or ending in '/'
+		std::string directory;                   // loose files live here...
+		std::shared_ptr<const MappedFile> pack;  // ...or in this pack
+		const PackFormat::Entry* entries = nullptr;
+		uint32_t entryCount = 0;
+		const char* paths = nullptr;
+	};
+	using MountList = std::vector<std::shared_ptr<const Mount>>;
+
+	struct AsyncRead
+	{
+		std::string name;
+		std::promise<FileView> result;
+	};
+
+	// Where a name resolved to: a pack entry, or a mapped loose file
+	struct Location
+	{
+		std::shared_ptr<const Mount> mount;
+		const PackFormat::Entry* entry = nullptr;
+		std::shared_ptr<const MappedFile> file;
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		bool compressed = false;
+	};
+
+	bool AddMount(std::shared_ptr<Mount> mount, const std::string& mountPoint);
+	std::shared_ptr<const MountList> GetMounts() const;
+	const PackFormat::Entry* FindEntry(const Mount& mount, const std::string& path) const;
+	bool Locate(const std::string& name, Location* location) const;
+	bool Decompress(const Location& location, void* destination, bool writeCombined) const;
+	void CountRead(const Location& location) const;
+	void IoThreadMain();
+
+	// Replaced, never changed in place, so readers work on a snapshot without holding the lock
+	mutable std::mutex mMountMutex;
+	std::shared_ptr<const MountList> mMounts;
+
+	std::mutex mQueueMutex;
+	std::condition_variable mQueueWake;
+	std::deque<AsyncRead> mQueue;
+	std::vector<std::thread> mIoThreads;
+	bool mStop = false;
+
+	// ParallelFor takes one caller at a time
+	mutable JobSystem mDecompressJobs;
+	mutable std::mutex mDecompressMutex;
+
+	mutable std::atomic<size_t> mReads{ 0 };
+	mutable std::atomic<size_t> mDecompressedReads{ 0 };
+	mutable std::atomic<uint64_t> mStoredBytes{ 0 };
+	mutable std::atomic<uint64_t> mBytes{ 0 };
+	mutable std::atomic<uint64_t> mDecompressedBytes{ 0 };
+	mutable std::atomic<uint64_t> mDecompressNanoseconds{ 0 };
+};
@@ -1,15 +1,6 @@
 #pragma once
 #include "stddef.h"
 
-static std::wstring GetExecutionDirectory()
-{
-	wchar_t filePath[MAX_PATH];
-	GetModuleFileNameW(NULL, filePath, sizeof(filePath));
-	wchar_t* p = wcsrchr(filePath, L'\\');
-	std::wstring strPath(filePath, p);
-	return strPath;
-}
-
 static inline void GetAssetsPath(_Out_writes_(pathSize) WCHAR* path, UINT pathSize)
 {
 	if (path == nullptr)
@@ -0,0 +1,249 @@
+// Runs random load graphs through AssetLoader and checks the scheduling, then times a cold start.
+//
+//   g++ -std=c++17 -O2 -pthread AssetLoaderCheck.cpp ../src/AssetLoader.cpp ../src/JobSystem.cpp -o AssetLoaderCheck
+//   ./AssetLoaderCheck [loads=200]
+//
+// No load may start before all of its dependencies have finished, each key loads once however often
+// it is requested, Caller loads run on the thread that waits, and a failing or throwing load fails
+// everything built on it without running it while independent loads carry on. Unloads run after
+// everything that depends on them and leave nothing behind. With sleeping loads, the wall time of a
+// wide graph must stay close to its critical path rather than the sum of the loads.
+#include "../src/AssetLoader.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Record
+{
+	std::vector<std::vector<size_t>> dependencies;
+	std::unique_ptr<std::atomic<int>[]> runs;
+	std::unique_ptr<std::atomic<int>[]> finished;  // step at which each load finished, or -1
+	std::atomic<int> step{ 0 };
+	std::atomic<int> violations{ 0 };
+};
+
+static int CheckScheduling(unsigned workers, size_t count, std::mt19937& random)
+{
+	int failures = 0;
+	AssetLoader loader(workers);
+	Record record;
+	record.dependencies.resize(count);
+	record.runs.reset(new std::atomic<int>[count]);
+	record.finished.reset(new std::atomic<int>[count]);
+	std::vector<AssetHandle> handles(count);
+	std::vector<bool> shouldFail(count, false);
+	std::thread::id owner = std::this_thread::get_id();
+	std::atomic<int> callerOffThread{ 0 };
+
+	for (size_t i = 0; i < count; i++)
+	{
+		record.runs[i] = 0;
+		record.finished[i] = -1;
+		// A few dependencies on earlier loads, so the graph is acyclic
+		size_t dependencyCount = i == 0 ? 0 : random() % 4;
+		std::vector<AssetHandle> dependencies;
+		for (size_t d = 0; d < dependencyCount; d++)
+		{
+			size_t dependency = random() % i;
+			record.dependencies[i].push_back(dependency);
+			dependencies.push_back(handles[dependency]);
+			shouldFail[i] = shouldFail[i] || shouldFail[dependency];
+		}
+		int kind = int(random() % 40);
+		bool fails = kind == 0;
+		bool throws = kind == 1;
+		shouldFail[i] = shouldFail[i] || fails || throws;
+		AssetAffinity affinity = kind >= 36 ? AssetAffinity::Caller : AssetAffinity::Worker;
+		handles[i] = loader.Request("load" + std::to_string(i), dependencies, [&record, &callerOffThread, i, fails, throws, affinity, owner]()
+		{
+			record.runs[i]++;
+			for (size_t dependency : record.dependencies[i])
+			{
+				if (record.finished[dependency] < 0)
+				{
+					record.violations++;
+				}
+			}
+			if (affinity == AssetAffinity::Caller && std::this_thread::get_id() != owner)
+			{
+				callerOffThread++;
+			}
+			if (throws)
+			{
+				throw std::runtime_error("load failed");
+			}
+			record.finished[i] = record.step++;
+			return !fails;
+		}, nullptr, affinity);
+
+		// Asking again must not load twice
+		if (random() % 8 == 0)
+		{
+			AssetHandle again = loader.Request("load" + std::to_string(i), {}, [] { return true; });
+			if (again != handles[i])
+			{
+				printf("load %zu requested twice gave two handles\n", i);
+				failures++;
+			}
+			loader.Release(again);
+		}
+	}
+
+	bool allSucceeded = loader.Wait();
+	bool anyShouldFail = false;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool dependencyFailed = false;
+		for (size_t dependency : record.dependencies[i])
+		{
+			dependencyFailed = dependencyFailed || shouldFail[dependency];
+		}
+		AssetState expected = shouldFail[i] ? AssetState::Failed : AssetState::Ready;
+		if (loader.GetState(handles[i]) != expected)
+		{
+			printf("%u workers: load %zu is in state %d, expected %d\n", workers, i, int(loader.GetState(handles[i])), int(expected));
+			failures++;
+		}
+		if (record.runs[i] != (dependencyFailed ? 0 : 1))
+		{
+			printf("%u workers: load %zu ran %d times\n", workers, i, record.runs[i].load());
+			failures++;
+		}
+		anyShouldFail = anyShouldFail || shouldFail[i];
+	}
+	if (allSucceeded == anyShouldFail)
+	{
+		printf("%u workers: Wait reported %s\n", workers, allSucceeded ? "success" : "failure");
+		failures++;
+	}
+	if (record.violations || callerOffThread)
+	{
+		printf("%u workers: %d loads started before a dependency finished, %d Caller loads ran elsewhere\n",
+			workers, record.violations.load(), callerOffThread.load());
+		failures++;
+	}
+	AssetLoadStatistics statistics = loader.GetStatistics();
+	if (statistics.deduplicated == 0 && count > 64)
+	{
+		printf("%u workers: no request was deduplicated\n", workers);
+		failures++;
+	}
+
+	// Release in request order: dependencies are still referenced by later loads and must outlive them
+	for (AssetHandle handle : handles)
+	{
+		loader.Release(handle);
+	}
+	if (loader.GetLoadCount() != 0)
+	{
+		printf("%u workers: %zu loads left after releasing everything\n", workers, loader.GetLoadCount());
+		failures++;
+	}
+	return failures;
+}
+
+static int CheckUnloadOrder()
+{
+	int failures = 0;
+	AssetLoader loader(2);
+	std::vector<std::string> events;
+	int loads = 0;
+	AssetHandle blob = loader.Request("blob", {}, [&] { loads++; return true; }, [&] { events.push_back("blob"); });
+	AssetHandle blas = loader.Request("blas", { blob }, [] { return true; }, [&] { events.push_back("blas"); }, AssetAffinity::Caller);
+	loader.Wait();
+	loader.Release(blob);
+	if (!events.empty())
+	{
+		printf("blob unloaded while blas still uses it\n");
+		failures++;
+	}
+	loader.Release(blas);
+	if (events.size() != 2 || events[0] != "blas" || events[1] != "blob")
+	{
+		printf("unloads ran out of order\n");
+		failures++;
+	}
+	// Gone, so asking again loads again
+	AssetHandle reload = loader.Request("blob", {}, [&] { loads++; return true; });
+	loader.Wait(reload);
+	loader.Release(reload);
+	if (loads != 2)
+	{
+		printf("blob loaded %d times, expected 2\n", loads);
+		failures++;
+	}
+	return failures;
+}
+
+// Layers of sleeping loads, each depending on a few of the layer before, like files, then bytecode and
+// meshes, then pipelines and acceleration structures
+static int TimeColdStart(size_t count, std::mt19937& random)
+{
+	AssetLoader loader(7);
+	const size_t layers = 4;
+	std::vector<std::vector<AssetHandle>> layer(layers);
+	std::vector<AssetHandle> all;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t depth = i * layers / count;
+		std::vector<AssetHandle> dependencies;
+		for (size_t d = 0; depth > 0 && d < 2; d++)
+		{
+			dependencies.push_back(layer[depth - 1][random() % layer[depth - 1].size()]);
+		}
+		int milliseconds = 1 + int(random() % 4);
+		AssetHandle handle = loader.Request("cold" + std::to_string(i), dependencies, [milliseconds]
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+			return true;
+		});
+		layer[depth].push_back(handle);
+		all.push_back(handle);
+	}
+	auto begin = std::chrono::steady_clock::now();
+	loader.Wait();
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	AssetLoadStatistics statistics = loader.GetStatistics();
+	// Eight threads (seven workers and the waiting one) bound the wall time from below as well
+	double bound = std::max(statistics.criticalPathSeconds, statistics.workSeconds / 8.0);
+	printf("cold start: %zu loads, %.1f ms of work, critical path %.1f ms, wall %.1f ms (%.2fx the bound of %.1f ms)\n",
+		statistics.loads, statistics.workSeconds * 1e3, statistics.criticalPathSeconds * 1e3, wall * 1e3,
+		wall / bound, bound * 1e3);
+	for (AssetHandle handle : all)
+	{
+		loader.Release(handle);
+	}
+	if (wall > statistics.workSeconds * 0.5)
+	{
+		printf("loads barely overlapped\n");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? std::max<size_t>(8, strtoull(argv[1], nullptr, 10)) : 200;
+	std::mt19937 random(11);
+	int failures = 0;
+
+	for (unsigned workers : { 0u, 1u, 3u, 8u })
+	{
+		for (int round = 0; round < 20; round++)
+		{
+			failures += CheckScheduling(workers, count, random);
+		}
+	}
+	failures += CheckUnloadOrder();
+	failures += TimeColdStart(count, random);
+
+	printf(failures ? "FAILED\n" : "asset loader checks out\n");
+	return failures ? 1 : 0;
+}
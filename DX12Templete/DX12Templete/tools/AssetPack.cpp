@@ -0,0 +1,94 @@
+// Packs every file under one or more directories into a .pak that VirtualFileSystem mounts.
+//
+//   g++ -std=c++17 -O2 -pthread AssetPack.cpp ../src/VirtualFileSystem.cpp ../src/MappedFile.cpp ../src/CompressedStream.cpp ../src/Lz4.cpp ../src/JobSystem.cpp -o AssetPack
+//   ./AssetPack [--compress] Assets.pak <directory>...
+//
+// Each file is stored under its path relative to the directory it was found in, with '/' separators,
+// which is the name the renderer reads it by. With --compress, files of 4 KiB and up are stored as
+// LZ4 chunks where that saves at least an eighth. The pack is mounted and read back before the tool
+// reports success.
+#include "PackWriter.h"
+#include "ShaderArchiveWriter.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv)
+{
+	int first = 1;
+	bool compress = argc > 1 && strcmp(argv[1], "--compress") == 0;
+	if (compress)
+	{
+		first++;
+	}
+	if (argc < first + 2)
+	{
+		fprintf(stderr, "usage: %s [--compress] <output.pak> <directory>...\n", argv[0]);
+		return 1;
+	}
+	const char* output = argv[first];
+
+	JobSystem jobs;
+	PackWriter writer;
+	if (compress)
+	{
+		writer.EnableCompression(&jobs);
+	}
+	std::vector<std::pair<std::string, std::string>> sources; // name, host path
+	uint64_t bytes = 0;
+	for (int i = first + 1; i < argc; i++)
+	{
+		std::error_code error;
+		fs::recursive_directory_iterator it(argv[i], error);
+		if (error)
+		{
+			fprintf(stderr, "cannot list '%s': %s\n", argv[i], error.message().c_str());
+			return 1;
+		}
+		for (const fs::directory_entry& entry : it)
+		{
+			if (!entry.is_regular_file())
+			{
+				continue;
+			}
+			std::string name = fs::relative(entry.path(), argv[i]).generic_string();
+			std::vector<uint8_t> data;
+			if (!ReadWholeFile(entry.path().string(), data))
+			{
+				fprintf(stderr, "cannot read '%s'\n", entry.path().string().c_str());
+				return 1;
+			}
+			bytes += data.size();
+			if (!writer.Add(name, std::move(data)))
+			{
+				return 1;
+			}
+			sources.emplace_back(name, entry.path().string());
+		}
+	}
+	if (!writer.Write(output))
+	{
+		return 1;
+	}
+
+	VirtualFileSystem files(0);
+	if (!files.MountPack("", output))
+	{
+		fprintf(stderr, "'%s' does not mount\n", output);
+		return 1;
+	}
+	for (const auto& source : sources)
+	{
+		std::vector<uint8_t> expected;
+		FileView view;
+		if (!ReadWholeFile(source.second, expected) || !files.Read(source.first, &view) || view.GetSize() != expected.size() ||
+			(!expected.empty() && memcmp(view.GetData(), expected.data(), expected.size()) != 0))
+		{
+			fprintf(stderr, "'%s' does not read back from '%s'\n", source.first.c_str(), output);
+			return 1;
+		}
+	}
+	printf("%s: %zu files, %llu bytes stored as %llu\n", output, writer.GetFileCount(), (unsigned long long)bytes,
+		(unsigned long long)writer.GetStoredBytes());
+	return 0;
+}
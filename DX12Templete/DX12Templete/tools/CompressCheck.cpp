@@ -0,0 +1,302 @@
+// Round-trips the LZ4 codec and the chunked stream format over awkward and realistic data, feeds the
+// decoder damaged blocks, then measures ratio and throughput and what they mean for load bandwidth.
+//
+//   g++ -std=c++17 -O2 -pthread CompressCheck.cpp ../src/CompressedStream.cpp ../src/Lz4.cpp ../src/JobSystem.cpp -o CompressCheck
+//   ./CompressCheck [megabytes=64]
+//
+// Every block must decode to exactly its input and refuse a destination of any other size. Damaged or
+// truncated blocks may decode to garbage but must never read or write out of bounds (run under
+// -fsanitize=address to see that), and damaged stream tables must fail before anything is written.
+// Streams must not depend on how many threads compressed them or on how they are decompressed.
+#include "../src/CompressedStream.h"
+#include "../src/Lz4.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+static double Seconds(Clock::time_point begin)
+{
+	return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Interleaved vertices of a smooth surface, quantized to 16 bits: what .mesh vertex streams look like
+static void FillVertices(std::vector<uint8_t>& data, std::mt19937& random)
+{
+	for (size_t i = 0; i + 16 <= data.size(); i += 16)
+	{
+		size_t vertex = i / 16;
+		uint16_t fields[8] = {
+			uint16_t(vertex % 256 * 128), uint16_t(vertex / 256 * 128), uint16_t(32768 + (vertex % 97)),
+			uint16_t(32767), uint16_t(0), uint16_t(65535), uint16_t(vertex % 4 == 0 ? 0xffff : 0x8080), uint16_t(random() % 4),
+		};
+		memcpy(data.data() + i, fields, sizeof(fields));
+	}
+}
+
+// Shader-source-like text: a small vocabulary with structure
+static void FillText(std::vector<uint8_t>& data, std::mt19937& random)
+{
+	static const char* words[] = { "float4 ", "position", " = ", "mul(", "worldViewProjection", ", input.", "normal", ");\n",
+		"struct ", "{\n", "}\n", "\tfloat3 ", "color", " : COLOR;\n", "return ", "output", ";\n", "if (", "< 0.5)", "cbuffer " };
+	size_t at = 0;
+	while (at < data.size())
+	{
+		const char* word = words[random() % (sizeof(words) / sizeof(words[0]))];
+		for (const char* c = word; *c && at < data.size(); c++)
+		{
+			data[at++] = uint8_t(*c);
+		}
+	}
+}
+
+static void FillRandom(std::vector<uint8_t>& data, std::mt19937& random)
+{
+	for (uint8_t& byte : data)
+	{
+		byte = uint8_t(random());
+	}
+}
+
+// Short periods exercise overlapping match copies; long ones the offset limit
+static void FillPeriodic(std::vector<uint8_t>& data, std::mt19937& random, size_t period)
+{
+	std::vector<uint8_t> pattern(period);
+	FillRandom(pattern, random);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = pattern[i % period];
+	}
+}
+
+static bool RoundTrip(const std::vector<uint8_t>& data, const char* what)
+{
+	std::vector<uint8_t> compressed(Lz4CompressBound(data.size()));
+	size_t size = Lz4Compress(data.data(), data.size(), compressed.data(), compressed.size());
+	compressed.resize(size);
+	// Exactly sized, so any overrun shows up under the address sanitizer
+	std::vector<uint8_t> decoded(data.size());
+	std::vector<uint8_t> tooSmall(data.empty() ? 0 : data.size() - 1);
+	std::vector<uint8_t> tooLarge(data.size() + 1);
+	bool ok = size > 0 && Lz4Decompress(compressed.data(), compressed.size(), decoded.data(), decoded.size()) && decoded == data &&
+		(data.empty() || !Lz4Decompress(compressed.data(), compressed.size(), tooSmall.data(), tooSmall.size())) &&
+		!Lz4Decompress(compressed.data(), compressed.size(), tooLarge.data(), tooLarge.size());
+	if (!ok)
+	{
+		printf("%s: %zu bytes do not round-trip\n", what, data.size());
+		failures++;
+	}
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	size_t megabytes = argc > 1 ? strtoull(argv[1], nullptr, 10) : 64;
+	std::mt19937 random(17);
+
+	// Every small size, where the end-of-block rules matter most
+	for (size_t size = 0; size <= 300; size++)
+	{
+		std::vector<uint8_t> data(size);
+		FillPeriodic(data, random, 1 + size % 5);
+		RoundTrip(data, "periodic");
+		FillRandom(data, random);
+		RoundTrip(data, "random");
+		FillText(data, random);
+		RoundTrip(data, "text");
+	}
+	const size_t periods[] = { 1, 2, 3, 7, 15, 16, 17, 64, 4095, 65535, 65536, 70000 };
+	for (size_t period : periods)
+	{
+		std::vector<uint8_t> data(200000);
+		FillPeriodic(data, random, period);
+		RoundTrip(data, "periodic");
+	}
+	{
+		// Incompressible input must still fit the bound
+		std::vector<uint8_t> data(1 << 20);
+		FillRandom(data, random);
+		RoundTrip(data, "random");
+		std::vector<uint8_t> compressed(Lz4CompressBound(data.size()));
+		if (Lz4Compress(data.data(), data.size(), compressed.data(), data.size() / 2) != 0)
+		{
+			printf("compression claimed to fit random data in half its size\n");
+			failures++;
+		}
+	}
+
+	// Damaged and truncated blocks
+	{
+		std::vector<uint8_t> data(20000);
+		FillText(data, random);
+		std::vector<uint8_t> compressed(Lz4CompressBound(data.size()));
+		compressed.resize(Lz4Compress(data.data(), data.size(), compressed.data(), compressed.size()));
+		std::vector<uint8_t> decoded(data.size());
+		size_t refusedTruncations = 0;
+		for (size_t size = 0; size < compressed.size(); size++)
+		{
+			std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + size);
+			refusedTruncations += !Lz4Decompress(truncated.data(), truncated.size(), decoded.data(), decoded.size());
+		}
+		if (refusedTruncations != compressed.size())
+		{
+			printf("%zu truncated blocks decoded\n", compressed.size() - refusedTruncations);
+			failures++;
+		}
+		size_t refused = 0;
+		for (int i = 0; i < 20000; i++)
+		{
+			std::vector<uint8_t> damaged = compressed;
+			damaged[random() % damaged.size()] ^= uint8_t(1 + random() % 255);
+			refused += !Lz4Decompress(damaged.data(), damaged.size(), decoded.data(), decoded.size());
+		}
+		printf("damaged blocks: %zu of %zu truncations and %zu of 20000 byte flips refused\n", refusedTruncations, compressed.size(), refused);
+	}
+
+	// Streams: deterministic, and the same however they are decompressed
+	JobSystem jobs;
+	{
+		std::vector<uint8_t> data(3 * CompressedStreamFormat::DefaultChunkSize + 12345);
+		FillVertices(data, random);
+		std::fill(data.begin() + 70000, data.begin() + 140000, 0);
+		std::vector<uint8_t> serial;
+		std::vector<uint8_t> parallel;
+		CompressStream(data.data(), data.size(), serial);
+		CompressStream(data.data(), data.size(), parallel, CompressedStreamFormat::DefaultChunkSize, &jobs);
+		if (serial != parallel)
+		{
+			printf("the stream depends on how many threads compressed it\n");
+			failures++;
+		}
+		uint64_t rawSize = 0;
+		std::vector<uint8_t> out(data.size());
+		bool ok = ReadCompressedStream(serial.data(), serial.size(), &rawSize) && rawSize == data.size();
+		for (int mode = 0; mode < 4 && ok; mode++)
+		{
+			std::fill(out.begin(), out.end(), 0);
+			ok = DecompressStream(serial.data(), serial.size(), out.data(), out.size(), mode & 1 ? &jobs : nullptr, (mode & 2) != 0) && out == data;
+		}
+		ok = ok && !DecompressStream(serial.data(), serial.size(), out.data(), out.size() - 1);
+		std::vector<uint8_t> empty;
+		CompressStream(nullptr, 0, empty);
+		ok = ok && ReadCompressedStream(empty.data(), empty.size(), &rawSize) && rawSize == 0 && DecompressStream(empty.data(), empty.size(), nullptr, 0);
+		if (!ok)
+		{
+			printf("streams do not round-trip\n");
+			failures++;
+		}
+
+		// A damaged header or chunk table must fail before the destination is touched
+		const size_t tableSize = sizeof(CompressedStreamFormat::Header) + sizeof(CompressedStreamFormat::Chunk) * 4;
+		size_t refused = 0;
+		for (size_t i = 0; i < tableSize * 8; i++)
+		{
+			std::vector<uint8_t> damaged = serial;
+			damaged[i / 8] ^= uint8_t(1 << (i % 8));
+			std::fill(out.begin(), out.end(), 0xcd);
+			if (!ReadCompressedStream(damaged.data(), damaged.size(), &rawSize))
+			{
+				refused++;
+				if (DecompressStream(damaged.data(), damaged.size(), out.data(), out.size(), &jobs) ||
+					std::any_of(out.begin(), out.end(), [](uint8_t byte) { return byte != 0xcd; }))
+				{
+					printf("a refused stream table still wrote output\n");
+					failures++;
+					break;
+				}
+			}
+			else
+			{
+				std::vector<uint8_t> sized(static_cast<size_t>(std::min<uint64_t>(rawSize, 1u << 24)));
+				DecompressStream(damaged.data(), damaged.size(), sized.data(), sized.size(), &jobs);
+			}
+		}
+		for (size_t size = 0; size < tableSize; size++)
+		{
+			if (ReadCompressedStream(serial.data(), size, &rawSize))
+			{
+				printf("a stream cut to %zu bytes passed\n", size);
+				failures++;
+			}
+		}
+		printf("damaged tables: %zu of %zu bit flips refused\n", refused, tableSize * 8);
+	}
+
+	// Throughput over a mix shaped like a content build: vertex streams, shader text, noise-like
+	// texture payloads and zero padding
+	struct Corpus
+	{
+		const char* name;
+		std::vector<uint8_t> data;
+	};
+	std::vector<Corpus> corpora(4);
+	size_t bytes = megabytes << 20;
+	corpora[0] = { "vertices", std::vector<uint8_t>(bytes / 2) };
+	corpora[1] = { "text", std::vector<uint8_t>(bytes / 4) };
+	corpora[2] = { "noise", std::vector<uint8_t>(bytes / 8) };
+	corpora[3] = { "zeros", std::vector<uint8_t>(bytes / 8) };
+	FillVertices(corpora[0].data, random);
+	FillText(corpora[1].data, random);
+	FillRandom(corpora[2].data, random);
+	printf("%-9s %8s %7s %12s %12s %12s %12s\n", "data", "MB", "ratio", "compress", "1 thread", "parallel", "memcpy");
+	double totalRaw = 0.0;
+	double totalStored = 0.0;
+	double totalParallelSeconds = 0.0;
+	for (Corpus& corpus : corpora)
+	{
+		const std::vector<uint8_t>& data = corpus.data;
+		std::vector<uint8_t> stream;
+		auto begin = Clock::now();
+		CompressStream(data.data(), data.size(), stream, CompressedStreamFormat::DefaultChunkSize, &jobs);
+		double compressSeconds = Seconds(begin);
+
+		std::vector<uint8_t> out(data.size());
+		double serialSeconds = 1e30;
+		double parallelSeconds = 1e30;
+		double copySeconds = 1e30;
+		for (int pass = 0; pass < 3; pass++)
+		{
+			begin = Clock::now();
+			DecompressStream(stream.data(), stream.size(), out.data(), out.size());
+			serialSeconds = std::min(serialSeconds, Seconds(begin));
+			begin = Clock::now();
+			DecompressStream(stream.data(), stream.size(), out.data(), out.size(), &jobs);
+			parallelSeconds = std::min(parallelSeconds, Seconds(begin));
+			begin = Clock::now();
+			memcpy(out.data(), data.data(), data.size());
+			copySeconds = std::min(copySeconds, Seconds(begin));
+		}
+		if (!DecompressStream(stream.data(), stream.size(), out.data(), out.size(), &jobs) || out != data)
+		{
+			printf("%s does not round-trip\n", corpus.name);
+			failures++;
+		}
+		double mb = data.size() / 1e6;
+		printf("%-9s %8.1f %7.2f %9.0f MB/s %7.0f MB/s %7.0f MB/s %7.0f MB/s\n", corpus.name, mb, double(data.size()) / stream.size(),
+			mb / compressSeconds, mb / serialSeconds, mb / parallelSeconds, mb / copySeconds);
+		totalRaw += data.size();
+		totalStored += stream.size();
+		totalParallelSeconds += parallelSeconds;
+	}
+
+	// Streaming overlaps reading with decompression, so a load takes whichever is slower
+	printf("whole mix: ratio %.2f on %u threads\n", totalRaw / totalStored, jobs.GetWorkerCount() + 1);
+	const double disks[] = { 150.0, 550.0, 3500.0 };
+	for (double disk : disks)
+	{
+		double rawSeconds = totalRaw / 1e6 / disk;
+		double compressedSeconds = std::max(totalStored / 1e6 / disk, totalParallelSeconds);
+		printf("  %4.0f MB/s disk: %6.0f MB/s effective, %.1fx raw reads\n", disk, totalRaw / 1e6 / compressedSeconds, rawSeconds / compressedSeconds);
+	}
+
+	printf(failures ? "FAILED\n" : "compression checks out\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Times FrustumCuller's kernels on synthetic bounds and checks they agree with the scalar path,
+// then times the same query through a LooseOctree.
+//
+//   g++ -std=c++17 -O2 -pthread CullBench.cpp ../src/FrustumCuller.cpp ../src/JobSystem.cpp ../src/LooseOctree.cpp -o CullBench
+//   ./CullBench [objects=1000000] [iterations=50]
+//
+// Objects are scattered through a cube around a camera at the origin looking down +z, so roughly
+// a fifth of them are visible and a good share straddle a plane.
+#include "../src/FrustumCuller.h"
+#include "../src/JobSystem.h"
+#include "../src/LooseOctree.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static Frustum MakeFrustum()
+{
+	// XMMatrixPerspectiveFovLH(60 degrees, 16:9, 0.1, 500) with an identity view
+	const float nearZ = 0.1f;
+	const float farZ = 500.0f;
+	const float yScale = 1.0f / std::tan(0.5f * 3.14159265f / 3.0f);
+	const float xScale = yScale / (16.0f / 9.0f);
+	const float range = farZ / (farZ - nearZ);
+	const float m[16] =
+	{
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range * nearZ, 0.0f,
+	};
+	return Frustum::FromViewProj(m);
+}
+
+int main(int argc, char** argv)
+{
+	size_t objects = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 50;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-400.0f, 400.0f);
+	std::uniform_real_distribution<float> size(0.5f, 8.0f);
+	CullingBounds bounds;
+	bounds.Resize(objects);
+	for (size_t i = 0; i < objects; i++)
+	{
+		float center[3] = { position(random), position(random), position(random) };
+		float extents[3] = { size(random), size(random), size(random) };
+		bounds.Set(i, center, extents);
+	}
+
+	Frustum frustum = MakeFrustum();
+	JobSystem jobs;
+	FrustumCuller culler;
+	std::vector<uint32_t> reference;
+	std::vector<uint32_t> visible;
+
+	culler.SetKernel(FrustumCuller::Kernel::Scalar);
+	culler.Cull(frustum, bounds, nullptr, reference);
+	printf("%zu objects, %zu visible, %u workers + caller\n", objects, reference.size(), jobs.GetWorkerCount());
+
+	const FrustumCuller::Kernel kernels[] = { FrustumCuller::Kernel::Scalar, FrustumCuller::Kernel::Avx2, FrustumCuller::Kernel::Avx512 };
+	int result = 0;
+	for (FrustumCuller::Kernel kernel : kernels)
+	{
+		culler.SetKernel(kernel);
+		if (culler.GetKernel() != kernel)
+		{
+			printf("%-8s not supported by this CPU\n", FrustumCuller::GetKernelName(kernel));
+			continue;
+		}
+
+		for (JobSystem* pool : { (JobSystem*)nullptr, &jobs })
+		{
+			culler.Cull(frustum, bounds, pool, visible);
+			if (visible != reference)
+			{
+				printf("%-8s MISMATCH (%zu visible)\n", FrustumCuller::GetKernelName(kernel), visible.size());
+				result = 1;
+				continue;
+			}
+
+			auto begin = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++)
+			{
+				culler.Cull(frustum, bounds, pool, visible);
+			}
+			double ms = Milliseconds(begin) / iterations;
+			printf("%-8s %-8s %8.3f ms  %7.2f Mobj/s\n", FrustumCuller::GetKernelName(kernel), pool ? "threads" : "single", ms, objects / ms / 1000.0);
+		}
+	}
+
+	// The octree only tests spheres, so it may keep a few objects the box test rejects, never fewer
+	const float origin[3] = { 0.0f, 0.0f, 0.0f };
+	LooseOctree octree(origin, 512.0f);
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < objects; i++)
+	{
+		float center[3] = { bounds.CenterX()[i], bounds.CenterY()[i], bounds.CenterZ()[i] };
+		octree.Update(uint32_t(i), center, bounds.Radius()[i]);
+	}
+	printf("octree   build    %8.3f ms\n", Milliseconds(begin));
+
+	octree.QueryFrustum(frustum, visible);
+	std::sort(visible.begin(), visible.end());
+	if (!std::includes(visible.begin(), visible.end(), reference.begin(), reference.end()))
+	{
+		printf("octree   MISSING OBJECTS\n");
+		result = 1;
+	}
+	begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		visible.clear();
+		octree.QueryFrustum(frustum, visible);
+	}
+	double ms = Milliseconds(begin) / iterations;
+	printf("octree   single   %8.3f ms  %7.2f Mobj/s  (%zu candidates)\n", ms, objects / ms / 1000.0, visible.size());
+	return result;
+}
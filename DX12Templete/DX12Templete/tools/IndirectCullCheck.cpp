@@ -0,0 +1,154 @@
+// Checks the CPU reference of resource/CullInstances.hlsl against the CPU culling path and times it.
+//
+//   g++ -std=c++17 -O2 -pthread IndirectCullCheck.cpp ../src/IndirectCulling.cpp ../src/SoftwareOcclusion.cpp ../src/FrustumCuller.cpp ../src/JobSystem.cpp -o IndirectCullCheck
+//   ./IndirectCullCheck [instances=200000] [iterations=20]
+//
+// The reference must keep exactly the objects FrustumCuller and SoftwareOcclusion keep, in the same
+// order, and write their draw arguments. The shader appends a wave at a time in whatever order the
+// waves run; that is replayed here with shuffled 64-wide waves and must produce the same set of commands.
+#include "../src/IndirectCulling.h"
+#include "../src/FrustumCuller.h"
+#include "../src/SoftwareOcclusion.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static const int Width = 256;
+static const int Height = 144;
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+	// XMMatrixPerspectiveFovLH(60 degrees, 16:9, 0.1, 500) with an identity view
+	const float nearZ = 0.1f;
+	const float farZ = 500.0f;
+	const float yScale = 1.0f / std::tan(0.5f * 3.14159265f / 3.0f);
+	const float xScale = yScale / (16.0f / 9.0f);
+	const float range = farZ / (farZ - nearZ);
+	const float viewProj[16] =
+	{
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range * nearZ, 0.0f,
+	};
+	Frustum frustum = Frustum::FromViewProj(viewProj);
+
+	// A few large walls in front of a field of boxes, half of which fall outside the frustum
+	std::mt19937 random(99);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	SoftwareOcclusion occlusion(Width, Height);
+	occlusion.Begin(viewProj);
+	const uint32_t quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+	const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	for (int wall = 0; wall < 24; wall++)
+	{
+		float cx = unit(random) * 30.0f;
+		float cy = unit(random) * 12.0f;
+		float cz = 20.0f + (unit(random) + 1.0f) * 20.0f;
+		float h = 6.0f + unit(random) * 2.0f;
+		const float quad[12] = { cx - h, cy - h, cz, cx + h, cy - h, cz, cx + h, cy + h, cz, cx - h, cy + h, cz };
+		occlusion.AddOccluder(quad, 4, quadIndices, 6, identity);
+	}
+	occlusion.Rasterize(nullptr);
+
+	CullingBounds bounds;
+	bounds.Resize(count);
+	std::vector<CullInstance> instances(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		float z = 5.0f + (unit(random) + 1.0f) * 150.0f;
+		float center[3] = { unit(random) * z * 1.2f, unit(random) * z * 0.7f, z };
+		float extents[3] = { 0.5f + unit(random) * 0.4f, 0.5f + unit(random) * 0.4f, 0.5f + unit(random) * 0.4f };
+		bounds.Set(i, center, extents);
+
+		CullInstance& instance = instances[i];
+		std::copy(center, center + 3, instance.center);
+		std::copy(extents, extents + 3, instance.extents);
+		instance.objectIndex = uint32_t(i * 7 % count);
+		instance.indexCount = 6;
+		instance.startIndex = uint32_t(i * 6);
+		instance.baseVertex = int32_t(i * 4);
+	}
+
+	// CPU path
+	FrustumCuller culler;
+	culler.SetKernel(FrustumCuller::Kernel::Scalar);
+	std::vector<uint32_t> expected;
+	culler.Cull(frustum, bounds, nullptr, expected);
+	size_t inFrustum = expected.size();
+	expected.resize(occlusion.CullOccluded(bounds, expected.data(), expected.size(), nullptr));
+
+	// Object constants straddle a 4 GB boundary so the carry into the high half is exercised
+	const uint64_t objectConstants = 0xfffff000ull;
+	CullConstants constants;
+	std::vector<float> hiz;
+	StoreCullConstants(viewProj, frustum, occlusion, objectConstants, 256, uint32_t(count), &constants, hiz);
+
+	std::vector<IndirectDrawCommand> commands(count);
+	size_t written = CullInstancesReference(constants, instances.data(), hiz.data(), commands.data());
+	printf("%zu instances, %zu in frustum, %zu drawn\n", count, inFrustum, written);
+
+	int result = 0;
+	if (written != expected.size())
+	{
+		printf("reference drew %zu, CPU path %zu\n", written, expected.size());
+		result = 1;
+	}
+	for (size_t i = 0; i < std::min(written, expected.size()) && result == 0; i++)
+	{
+		const CullInstance& instance = instances[expected[i]];
+		const IndirectDrawCommand& command = commands[i];
+		if (command.objectConstants != objectConstants + uint64_t(instance.objectIndex) * 256 ||
+			command.startIndexLocation != instance.startIndex || command.baseVertexLocation != instance.baseVertex ||
+			command.indexCountPerInstance != instance.indexCount || command.instanceCount != 1)
+		{
+			printf("command %zu does not match instance %u\n", i, expected[i]);
+			result = 1;
+		}
+	}
+
+	// Replay the shader's compaction: waves in random order, one atomic per wave, prefix offsets within it
+	std::vector<size_t> waves((count + CullThreadGroupSize - 1) / CullThreadGroupSize);
+	for (size_t i = 0; i < waves.size(); i++)
+	{
+		waves[i] = i;
+	}
+	std::shuffle(waves.begin(), waves.end(), random);
+	std::vector<IndirectDrawCommand> scattered(count);
+	uint32_t drawCount = 0;
+	IndirectDrawCommand laneCommands[CullThreadGroupSize];
+	for (size_t wave : waves)
+	{
+		size_t first = wave * CullThreadGroupSize;
+		CullConstants waveConstants = constants;
+		waveConstants.instanceCount = uint32_t(std::min<size_t>(CullThreadGroupSize, count - first));
+		size_t survivors = CullInstancesReference(waveConstants, &instances[first], hiz.data(), laneCommands);
+		std::copy(laneCommands, laneCommands + survivors, &scattered[drawCount]);
+		drawCount += uint32_t(survivors);
+	}
+	auto byStart = [](const IndirectDrawCommand& a, const IndirectDrawCommand& b) { return a.startIndexLocation < b.startIndexLocation; };
+	std::sort(scattered.begin(), scattered.begin() + drawCount, byStart);
+	std::sort(commands.begin(), commands.begin() + written, byStart);
+	if (drawCount != written || !std::equal(commands.begin(), commands.begin() + written, scattered.begin(),
+		[](const IndirectDrawCommand& a, const IndirectDrawCommand& b) { return a.objectConstants == b.objectConstants && a.startIndexLocation == b.startIndexLocation; }))
+	{
+		printf("wave compaction produced a different command set\n");
+		result = 1;
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		CullInstancesReference(constants, instances.data(), hiz.data(), commands.data());
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+	printf("reference %8.3f ms  %7.2f Minst/s\n", ms, count / ms / 1000.0);
+	printf(result ? "FAILED\n" : "reference matches the CPU path\n");
+	return result;
+}
@@ -0,0 +1,320 @@
+// Builds LOD chains with the quadric simplifier and checks them.
+//
+//   g++ -std=c++17 -O2 LodCheck.cpp ../src/MeshSimplifier.cpp -o LodCheck
+//   ./LodCheck [rings=256]
+//
+// A flat coloured grid must simplify almost completely without changing its area, flipping a triangle
+// or moving a vertex on a colour seam, and with colour error taken into account its colours must drift
+// less than without. Every level of a torus chain must be a valid, smaller mesh whose measured distance
+// from the source stays within reach of the error it reports, and the selector must never pick a finer
+// level further away.
+#include "../src/MeshSimplifier.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static void MakeGrid(int size, bool seam, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// A sharp red ramp across the middle third; the seam column gets its own copy of each vertex
+	int seamColumn = size / 4;
+	std::vector<uint32_t> ids(size_t(size + 1) * (size + 1));
+	std::vector<uint32_t> seamIds(size + 1);
+	for (int y = 0; y <= size; y++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			float u = float(x) / size;
+			float v = float(y) / size;
+			float red = std::min(1.0f, std::max(0.0f, (u - 0.33f) * 3.0f));
+			red = red * red * (3.0f - 2.0f * red);
+			ids[y * (size + 1) + x] = uint32_t(vertices.size());
+			vertices.push_back({ { u, v, 0.0f }, { red, v, 0.0f, 1.0f } });
+			if (seam && x == seamColumn)
+			{
+				seamIds[y] = uint32_t(vertices.size());
+				vertices.push_back({ { u, v, 0.0f }, { red, v, 1.0f, 1.0f } });
+			}
+		}
+	}
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			// Right of the seam column the copy is used
+			auto id = [&](int cx, int cy) { return (seam && cx == seamColumn && x >= seamColumn) ? seamIds[cy] : ids[cy * (size + 1) + cx]; };
+			uint32_t a = id(x, y);
+			uint32_t b = id(x, y + 1);
+			uint32_t c = id(x + 1, y + 1);
+			uint32_t d = id(x + 1, y);
+			uint32_t quad[6] = { a, b, c, a, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+static SimplifyVertices Describe(const std::vector<Vertex>& vertices, const float* colorWeights)
+{
+	SimplifyVertices description;
+	description.positions = vertices[0].position;
+	description.positionStride = sizeof(Vertex);
+	description.count = vertices.size();
+	description.attributes = colorWeights ? vertices[0].color : nullptr;
+	description.attributeStride = sizeof(Vertex);
+	description.attributeCount = colorWeights ? 4 : 0;
+	description.attributeWeights = colorWeights;
+	return description;
+}
+
+static float SignedAreaZ(const std::vector<Vertex>& vertices, const uint32_t* t)
+{
+	const float* a = vertices[t[0]].position;
+	const float* b = vertices[t[1]].position;
+	const float* c = vertices[t[2]].position;
+	return 0.5f * ((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]));
+}
+
+// Largest colour difference between each source vertex and the simplified grid interpolated under it
+static float ColorDrift(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& source, const std::vector<uint32_t>& simplified)
+{
+	std::vector<uint8_t> used(vertices.size(), 0);
+	for (uint32_t index : source)
+	{
+		used[index] = 1;
+	}
+	float drift = 0.0f;
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		if (!used[v])
+		{
+			continue;
+		}
+		const float* p = vertices[v].position;
+		for (size_t t = 0; t < simplified.size(); t += 3)
+		{
+			const Vertex& a = vertices[simplified[t]];
+			const Vertex& b = vertices[simplified[t + 1]];
+			const Vertex& c = vertices[simplified[t + 2]];
+			float area = (b.position[0] - a.position[0]) * (c.position[1] - a.position[1]) - (b.position[1] - a.position[1]) * (c.position[0] - a.position[0]);
+			float wa = ((b.position[0] - p[0]) * (c.position[1] - p[1]) - (b.position[1] - p[1]) * (c.position[0] - p[0])) / area;
+			float wb = ((c.position[0] - p[0]) * (a.position[1] - p[1]) - (c.position[1] - p[1]) * (a.position[0] - p[0])) / area;
+			float wc = 1.0f - wa - wb;
+			if (wa < -1e-5f || wb < -1e-5f || wc < -1e-5f)
+			{
+				continue;
+			}
+			for (int channel = 0; channel < 2; channel++)
+			{
+				float interpolated = wa * a.color[channel] + wb * b.color[channel] + wc * c.color[channel];
+				drift = std::max(drift, std::fabs(interpolated - vertices[v].color[channel]));
+			}
+			break;
+		}
+	}
+	return drift;
+}
+
+static float PointTriangleDistance(const float p[3], const float a[3], const float b[3], const float c[3])
+{
+	// Closest point on the triangle (Ericson, Real-Time Collision Detection 5.1.5)
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+	auto dot = [](const float* x, const float* y) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+	auto distance = [&](const float* q) { float d[3] = { p[0] - q[0], p[1] - q[1], p[2] - q[2] }; return std::sqrt(dot(d, d)); };
+	float d1 = dot(ab, ap);
+	float d2 = dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return distance(a);
+	}
+	float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	float d3 = dot(ab, bp);
+	float d4 = dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return distance(b);
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		float v = d1 / (d1 - d3);
+		float q[3] = { a[0] + v * ab[0], a[1] + v * ab[1], a[2] + v * ab[2] };
+		return distance(q);
+	}
+	float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+	float d5 = dot(ab, cp);
+	float d6 = dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return distance(c);
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		float w = d2 / (d2 - d6);
+		float q[3] = { a[0] + w * ac[0], a[1] + w * ac[1], a[2] + w * ac[2] };
+		return distance(q);
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		float q[3] = { b[0] + w * (c[0] - b[0]), b[1] + w * (c[1] - b[1]), b[2] + w * (c[2] - b[2]) };
+		return distance(q);
+	}
+	float denominator = 1.0f / (va + vb + vc);
+	float v = vb * denominator;
+	float w = vc * denominator;
+	float q[3] = { a[0] + ab[0] * v + ac[0] * w, a[1] + ab[1] * v + ac[1] * w, a[2] + ab[2] * v + ac[2] * w };
+	return distance(q);
+}
+
+static int CheckGrid()
+{
+	int failures = 0;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	MakeGrid(64, true, vertices, indices);
+
+	float sourceArea = 0.0f;
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		sourceArea += SignedAreaZ(vertices, &indices[t]);
+	}
+
+	const float colorWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float drift[2];
+	for (int weighted = 0; weighted < 2; weighted++)
+	{
+		std::vector<uint32_t> simplified(indices.size());
+		float error = 0.0f;
+		SimplifyVertices description = Describe(vertices, weighted ? colorWeights : nullptr);
+		simplified.resize(SimplifyMesh(description, indices.data(), indices.size(), indices.size() / 50, weighted ? 0.02f : 1e-4f, simplified.data(), &error));
+
+		float area = 0.0f;
+		size_t flipped = 0;
+		for (size_t t = 0; t < simplified.size(); t += 3)
+		{
+			float triangleArea = SignedAreaZ(vertices, &simplified[t]);
+			area += triangleArea;
+			flipped += triangleArea >= 0.0f ? 1 : 0;
+		}
+		std::vector<uint8_t> kept(vertices.size(), 0);
+		for (uint32_t index : simplified)
+		{
+			kept[index] = 1;
+		}
+		size_t seamLost = 0;
+		for (size_t v = 0; v < vertices.size(); v++)
+		{
+			// Seam copies are the vertices with blue = 1, their twins sit at the same position
+			bool onSeam = vertices[v].color[2] == 1.0f || (v + 1 < vertices.size() && vertices[v + 1].color[2] == 1.0f);
+			seamLost += onSeam && !kept[v] ? 1 : 0;
+		}
+		drift[weighted] = ColorDrift(vertices, indices, simplified);
+
+		printf("grid %-12s %zu -> %zu triangles, error %.5f, colour drift %.3f\n", weighted ? "with colour" : "positions", indices.size() / 3, simplified.size() / 3, error, drift[weighted]);
+		if (std::fabs(area - sourceArea) > 1e-4f * std::fabs(sourceArea) || flipped || seamLost)
+		{
+			printf("grid: area %f of %f, %zu flipped, %zu seam vertices lost\n", area, sourceArea, flipped, seamLost);
+			failures++;
+		}
+		if (simplified.size() * 4 > indices.size())
+		{
+			printf("grid: a flat grid should lose far more triangles\n");
+			failures++;
+		}
+	}
+	if (drift[1] >= drift[0])
+	{
+		printf("grid: colour weights did not reduce colour drift\n");
+		failures++;
+	}
+	return failures;
+}
+
+static int CheckTorus(int rings)
+{
+	int failures = 0;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	// A little ripple so the coarse levels have something to lose
+	MakeTorus(rings, std::max(3, rings / 2), vertices, indices, 0.05f);
+
+	LodSettings settings;
+	settings.maxLevels = 6;
+	std::vector<MeshLod> lods;
+	std::vector<uint32_t> lodIndices;
+	auto begin = std::chrono::steady_clock::now();
+	BuildLodChain(Describe(vertices, nullptr), indices.data(), indices.size(), settings, lods, lodIndices);
+	double ms = Milliseconds(begin);
+	printf("torus %zu triangles, %zu levels in %.1f ms\n", indices.size() / 3, lods.size(), ms);
+
+	// Every 97th source vertex against each level, brute force
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		const MeshLod& lod = lods[level];
+		const uint32_t* levelIndices = &lodIndices[lod.indexOffset];
+		size_t degenerate = 0;
+		for (size_t i = 0; i < lod.indexCount; i += 3)
+		{
+			uint32_t a = levelIndices[i], b = levelIndices[i + 1], c = levelIndices[i + 2];
+			degenerate += (a == b || b == c || a == c || a >= vertices.size() || b >= vertices.size() || c >= vertices.size()) ? 1 : 0;
+		}
+		float measured = 0.0f;
+		for (size_t v = 0; v < vertices.size(); v += 97)
+		{
+			float nearest = INFINITY;
+			for (size_t i = 0; i < lod.indexCount; i += 3)
+			{
+				nearest = std::min(nearest, PointTriangleDistance(vertices[v].position,
+					vertices[levelIndices[i]].position, vertices[levelIndices[i + 1]].position, vertices[levelIndices[i + 2]].position));
+			}
+			measured = std::max(measured, nearest);
+		}
+		printf("  level %zu  %7u triangles  error %.5f  measured %.5f\n", level, lod.indexCount / 3, lod.error, measured);
+
+		if (degenerate || (level > 0 && (lod.indexCount >= lods[level - 1].indexCount || lod.error < lods[level - 1].error)))
+		{
+			printf("torus: level %zu is not a smaller valid mesh (%zu bad triangles)\n", level, degenerate);
+			failures++;
+		}
+		// The quadric error is an average over planes, not a bound, so allow some slack
+		if (measured > lod.error * 4.0f + 1e-3f)
+		{
+			printf("torus: level %zu is further from the source than its error says\n", level);
+			failures++;
+		}
+	}
+
+	// One pixel of error at 1080p with a 45 degree field of view
+	float projectionScale = 1.0f / std::tan(0.5f * 3.14159265f / 4.0f) * 540.0f;
+	size_t previous = 0;
+	for (float distance = 0.5f; distance < 4000.0f; distance *= 1.5f)
+	{
+		size_t level = SelectLod(lods.data(), lods.size(), 1.0f, distance, projectionScale, 1.0f);
+		if (level < previous)
+		{
+			printf("torus: selector picked a finer level further away\n");
+			failures++;
+		}
+		previous = level;
+	}
+	if (SelectLod(lods.data(), lods.size(), 1.0f, 0.5f, projectionScale, 1.0f) != 0 || previous != lods.size() - 1)
+	{
+		printf("torus: selector does not span the chain\n");
+		failures++;
+	}
+	return failures;
+}
+
+int main(int argc, char** argv)
+{
+	int rings = argc > 1 ? atoi(argv[1]) : 256;
+	int failures = CheckGrid() + CheckTorus(rings);
+	printf(failures ? "FAILED\n" : "LOD chains check out\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,296 @@
+// Writes a torus as a .mesh image, reads it back and checks it, then times loading against memcpy.
+//
+//   g++ -std=c++17 -O2 MeshAssetCheck.cpp ../src/MeshData.cpp ../src/VertexLayout.cpp ../src/MeshSimplifier.cpp ../src/MeshOptimizer.cpp ../src/MeshletBuilder.cpp -o MeshAssetCheck
+//   ./MeshAssetCheck [rings=180]
+//
+// The view ReadMeshAsset returns must point into the image and match what was written byte for
+// byte, and writing it again must reproduce the image. Every truncation, every damaged header field
+// and every table entry pointing outside its stream must be refused, and no single corrupted byte
+// anywhere in the header may produce a view that reaches outside the image. Loading is the check
+// plus copying vertices and indices into place, as Square does into the geometry buffer, so its
+// throughput is compared with one plain memcpy of the same bytes.
+#include "../src/MeshData.h"
+#include "../src/MeshAssetFormat.h"
+#include "../src/SquareVertex.h"
+#include "TestMeshes.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+
+// Mapped files start on a page; heap blocks need help to start on StreamAlignment
+class AlignedImage
+{
+public:
+	explicit AlignedImage(const std::vector<uint8_t>& bytes)
+		: mStorage(new uint8_t[bytes.size() + MeshAssetFormat::StreamAlignment]), mSize(bytes.size())
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(mStorage.get());
+		mData = mStorage.get() + (MeshAssetFormat::AlignUp(address, MeshAssetFormat::StreamAlignment) - address);
+		if (!bytes.empty())
+		{
+			memcpy(mData, bytes.data(), bytes.size());
+		}
+	}
+	uint8_t* GetData() { return mData; }
+	size_t GetSize() const { return mSize; }
+
+private:
+	std::unique_ptr<uint8_t[]> mStorage;
+	uint8_t* mData;
+	size_t mSize;
+};
+
+// The shared torus at about a third of the size, lifted off the origin, with normals and a colour ramp
+static void MakeSourceTorus(int rings, int sides, std::vector<SourceVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<Vertex> torus;
+	MakeTorus(rings, sides, torus, indices);
+	for (size_t i = 0; i < torus.size(); i++)
+	{
+		const float* position = torus[i].position;
+		float ring = 3.0f / std::sqrt(position[0] * position[0] + position[2] * position[2]);
+		SourceVertex vertex = {};
+		vertex.position[0] = position[0] / 3.0f;
+		vertex.position[1] = position[1] / 3.0f + 0.5f;
+		vertex.position[2] = position[2] / 3.0f;
+		// The minor radius is 1, so the offset from the ring is already unit length
+		vertex.normal[0] = position[0] - position[0] * ring;
+		vertex.normal[1] = position[1];
+		vertex.normal[2] = position[2] - position[2] * ring;
+		vertex.color[0] = float(i / sides) / rings;
+		vertex.color[1] = float(i % sides) / sides;
+		vertex.color[2] = 0.5f;
+		vertex.color[3] = 1.0f;
+		vertices.push_back(vertex);
+	}
+}
+
+static bool Inside(const void* p, size_t size, const AlignedImage& image, const uint8_t* base)
+{
+	const uint8_t* begin = static_cast<const uint8_t*>(p);
+	return begin >= base && begin + size <= base + image.GetSize();
+}
+
+// Every array the view points at lies inside the image
+static bool ViewStaysInside(const MeshView& view, AlignedImage& image)
+{
+	const uint8_t* base = image.GetData();
+	return Inside(view.vertices, size_t(view.vertexCount) * view.vertexStride, image, base) &&
+		Inside(view.indices, size_t(view.indexCount) * view.indexSize, image, base) &&
+		Inside(view.lods, view.lodCount * sizeof(MeshLod), image, base) &&
+		Inside(view.lodMeshletOffsets, (view.lodCount + 1) * sizeof(uint32_t), image, base) &&
+		Inside(view.meshlets, view.meshletCount * sizeof(Meshlet), image, base) &&
+		Inside(view.meshletBounds, view.meshletCount * sizeof(MeshletBounds), image, base) &&
+		Inside(view.meshletVertices, view.meshletVertexCount * sizeof(uint32_t), image, base) &&
+		Inside(view.meshletTriangles, view.meshletTriangleCount * sizeof(uint32_t), image, base);
+}
+
+static bool SameBytes(const void* a, const void* b, size_t size)
+{
+	return size == 0 || memcmp(a, b, size) == 0;
+}
+
+// Reads a damaged copy of the image and reports whether it was accepted
+static bool AcceptsDamaged(const std::vector<uint8_t>& bytes, size_t offset, const void* value, size_t size)
+{
+	std::vector<uint8_t> damaged = bytes;
+	memcpy(&damaged[offset], value, size);
+	AlignedImage image(damaged);
+	MeshView view;
+	return ReadMeshAsset(image.GetData(), image.GetSize(), &view);
+}
+
+int main(int argc, char** argv)
+{
+	int rings = argc > 1 ? std::max(3, atoi(argv[1])) : 180;
+	int failures = 0;
+
+	std::vector<SourceVertex> vertices;
+	std::vector<uint32_t> indices;
+	MakeSourceTorus(rings, rings / 3, vertices, indices);
+	MeshData mesh;
+	if (!BuildMeshData(vertices.data(), vertices.size(), indices.data(), indices.size(),
+		SquareVertexElements, std::size(SquareVertexElements), LodSettings(), mesh))
+	{
+		printf("BuildMeshData refused the torus\n");
+		return 1;
+	}
+	std::vector<uint8_t> bytes;
+	WriteMeshAsset(mesh.GetView(), bytes);
+	printf("torus: %u vertices, %u indices in %zu LODs, %zu meshlets, %zu bytes (%u-bit indices)\n",
+		mesh.vertexCount, mesh.indexCount, mesh.lods.size(), mesh.meshlets.meshlets.size(), bytes.size(), mesh.indexSize * 8);
+
+	// Round trip
+	AlignedImage image(bytes);
+	MeshView view;
+	if (!ReadMeshAsset(image.GetData(), image.GetSize(), &view))
+	{
+		printf("the written image is refused\n");
+		return 1;
+	}
+	if (!ViewStaysInside(view, image) || view.vertices != image.GetData() + MeshAssetFormat::AlignUp(sizeof(MeshAssetFormat::Header), MeshAssetFormat::StreamAlignment))
+	{
+		printf("the view does not point into the image\n");
+		failures++;
+	}
+	if (!MatchesVertexElements(view, SquareVertexElements, std::size(SquareVertexElements)) ||
+		view.vertexCount != mesh.vertexCount || view.vertexStride != mesh.vertexStride ||
+		!SameBytes(view.vertices, mesh.vertices.data(), mesh.vertices.size()) ||
+		view.indexCount != mesh.indexCount || view.indexSize != mesh.indexSize ||
+		!SameBytes(view.indices, mesh.indices.data(), mesh.indices.size()) ||
+		view.lodCount != mesh.lods.size() || !SameBytes(view.lods, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod)) ||
+		!SameBytes(view.lodMeshletOffsets, mesh.lodMeshletOffsets.data(), mesh.lodMeshletOffsets.size() * sizeof(uint32_t)) ||
+		view.meshletCount != mesh.meshlets.meshlets.size() ||
+		!SameBytes(view.meshlets, mesh.meshlets.meshlets.data(), mesh.meshlets.meshlets.size() * sizeof(Meshlet)) ||
+		!SameBytes(view.meshletBounds, mesh.meshlets.bounds.data(), mesh.meshlets.bounds.size() * sizeof(MeshletBounds)) ||
+		!SameBytes(view.meshletVertices, mesh.meshlets.vertices.data(), mesh.meshlets.vertices.size() * sizeof(uint32_t)) ||
+		!SameBytes(view.meshletTriangles, mesh.meshlets.triangles.data(), mesh.meshlets.triangles.size() * sizeof(uint32_t)) ||
+		!SameBytes(&view.quantization, &mesh.quantization, sizeof(VertexQuantization)) ||
+		!SameBytes(view.boundsCenter, mesh.boundsCenter, sizeof(mesh.boundsCenter)) ||
+		!SameBytes(view.boundsExtents, mesh.boundsExtents, sizeof(mesh.boundsExtents)))
+	{
+		printf("the view differs from the mesh that was written\n");
+		failures++;
+	}
+	std::vector<uint8_t> rewritten;
+	WriteMeshAsset(view, rewritten);
+	if (rewritten != bytes)
+	{
+		printf("writing the view again changes the image\n");
+		failures++;
+	}
+
+	// The bounds hold every decoded vertex
+	std::vector<SourceVertex> decoded(view.vertexCount);
+	VertexLayout(view.elements, view.elementCount).Decode(view.vertices, view.vertexCount, view.quantization, decoded.data());
+	for (const SourceVertex& vertex : decoded)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			if (std::fabs(vertex.position[a] - view.boundsCenter[a]) > view.boundsExtents[a] + 1e-3f)
+			{
+				printf("decoded vertex outside the bounds on axis %d\n", a);
+				failures++;
+				a = 3;
+				break;
+			}
+		}
+		if (failures)
+		{
+			break;
+		}
+	}
+
+	// Truncated files, whatever the length
+	size_t truncationsAccepted = 0;
+	for (size_t size = 0; size < bytes.size(); size += size < 4096 ? 1 : 4093)
+	{
+		std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + size);
+		AlignedImage cut(truncated);
+		MeshView ignored;
+		truncationsAccepted += ReadMeshAsset(cut.GetData(), cut.GetSize(), &ignored);
+	}
+	if (truncationsAccepted)
+	{
+		printf("%zu truncated images accepted\n", truncationsAccepted);
+		failures++;
+	}
+
+	// Damage that has to be caught
+	using namespace MeshAssetFormat;
+	const Header& header = *reinterpret_cast<const Header*>(bytes.data());
+	struct Damage
+	{
+		const char* name;
+		size_t offset;
+		uint64_t value;
+		size_t size;
+	};
+	const uint32_t lod0 = uint32_t(header.streams[LodStream].offset);
+	const uint32_t meshlet0 = uint32_t(header.streams[MeshletStream].offset);
+	const uint32_t lodOffsets = uint32_t(header.streams[LodMeshletOffsetStream].offset);
+	const Damage damages[] =
+	{
+		{ "magic", offsetof(Header, magic), 0x4853454e, 4 },
+		{ "version", offsetof(Header, version), Version + 1, 4 },
+		{ "file size", offsetof(Header, fileSize), header.fileSize + 64, 8 },
+		{ "vertex stride", offsetof(Header, vertexStride), header.vertexStride + 4, 4 },
+		{ "index size", offsetof(Header, indexSize), 3, 4 },
+		{ "vertex count", offsetof(Header, vertexCount), header.vertexCount + 1, 4 },
+		{ "element encoding", offsetof(Header, elements) + 1, 200, 1 },
+		{ "no elements", offsetof(Header, elementCount), 0, 4 },
+		{ "no LODs", offsetof(Header, lodCount), 0, 4 },
+		{ "misaligned stream", offsetof(Header, streams) + IndexStream * sizeof(StreamRange), header.streams[IndexStream].offset + 4, 8 },
+		{ "stream past the end", offsetof(Header, streams) + MeshletTriangleStream * sizeof(StreamRange), header.fileSize, 8 },
+		{ "stream over the header", offsetof(Header, streams) + VertexStream * sizeof(StreamRange), 0, 8 },
+		{ "LOD past the indices", lod0 + offsetof(MeshLod, indexOffset), header.indexCount, 4 },
+		{ "LOD count not whole triangles", lod0 + offsetof(MeshLod, indexCount), 4, 4 },
+		{ "meshlet table end", lodOffsets + header.lodCount * 4, header.meshletCount + 1, 4 },
+		{ "meshlet vertices", meshlet0 + offsetof(Meshlet, vertexOffset), header.meshletVertexCount, 4 },
+		{ "meshlet triangles", meshlet0 + offsetof(Meshlet, triangleCount), MaxMeshletTriangles + 1, 4 },
+	};
+	for (const Damage& damage : damages)
+	{
+		if (AcceptsDamaged(bytes, damage.offset, &damage.value, damage.size))
+		{
+			printf("damaged %s accepted\n", damage.name);
+			failures++;
+		}
+	}
+
+	// Any single damaged header byte is either refused or still describes arrays inside the image
+	size_t flipsAccepted = 0;
+	for (size_t offset = 0; offset < sizeof(Header); offset++)
+	{
+		for (int bit = 0; bit < 8; bit++)
+		{
+			std::vector<uint8_t> damaged = bytes;
+			damaged[offset] ^= uint8_t(1 << bit);
+			AlignedImage flipped(damaged);
+			MeshView flippedView;
+			if (ReadMeshAsset(flipped.GetData(), flipped.GetSize(), &flippedView))
+			{
+				flipsAccepted++;
+				if (!ViewStaysInside(flippedView, flipped))
+				{
+					printf("flipping bit %d of header byte %zu gives a view outside the image\n", bit, offset);
+					failures++;
+				}
+			}
+		}
+	}
+	printf("%zu of %zu header bit flips still read, all inside the image\n", flipsAccepted, sizeof(Header) * 8);
+
+	// Loading: check the image and copy the vertices and indices into upload memory, as Square does
+	const int repeats = 50;
+	std::vector<uint8_t> upload(bytes.size());
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+	{
+		MeshView loaded;
+		if (!ReadMeshAsset(image.GetData(), image.GetSize(), &loaded))
+		{
+			failures++;
+			break;
+		}
+		size_t vertexBytes = size_t(loaded.vertexCount) * loaded.vertexStride;
+		memcpy(upload.data(), loaded.vertices, vertexBytes);
+		memcpy(upload.data() + vertexBytes, loaded.indices, size_t(loaded.indexCount) * loaded.indexSize);
+	}
+	double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+	{
+		memcpy(upload.data(), image.GetData(), image.GetSize());
+	}
+	double copySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	double megabytes = double(bytes.size()) * repeats / (1024.0 * 1024.0);
+	printf("load %.0f MB/s of image, memcpy %.0f MB/s\n", megabytes / loadSeconds, megabytes / copySeconds);
+
+	printf(failures ? "FAILED\n" : "mesh assets check out\n");
+	return failures ? 1 : 0;
+}
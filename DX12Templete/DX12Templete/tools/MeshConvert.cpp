@@ -0,0 +1,999 @@
+// Converts OBJ and glTF 2.0 (.gltf with external or embedded buffers, or .glb) into a .mesh asset in
+// the vertex format of SquareVertexElements, with LODs, vertex cache order and meshlets baked in.
+//
+//   g++ -std=c++17 -O2 MeshConvert.cpp ../src/MeshData.cpp ../src/VertexLayout.cpp ../src/MeshSimplifier.cpp ../src/MeshOptimizer.cpp ../src/MeshletBuilder.cpp -o MeshConvert
+//   ./MeshConvert ../resource/Square.obj Square.mesh [maxLevels=5]
+//
+// Every triangle primitive of the scene is merged into one mesh, with node transforms applied. Both
+// formats are right-handed with counter-clockwise front faces; negating z makes them left-handed,
+// which looks the same on screen, and reversing every triangle makes the front faces clockwise for D3D. OBJ colours come from the "v x y z r g b" extension;
+// glTF reads POSITION, NORMAL and COLOR_0. Meshes over 65536 vertices are written with 32-bit indices,
+// which the renderer does not draw yet.
+#include "../src/MeshData.h"
+#include "../src/SquareVertex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SourceMesh
+{
+	std::vector<SourceVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& data)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (!fp)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	rewind(fp);
+	data.resize(size > 0 ? size_t(size) : 0);
+	bool ok = size >= 0 && fread(data.data(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+	return ok;
+}
+
+static std::string GetDirectory(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static bool EndsWith(const std::string& s, const char* suffix)
+{
+	size_t n = strlen(suffix);
+	if (s.size() < n)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < n; i++)
+	{
+		if (tolower(s[s.size() - n + i]) != suffix[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static SourceVertex MakeVertex()
+{
+	SourceVertex vertex = {};
+	for (int c = 0; c < 4; c++)
+	{
+		vertex.color[c] = 1.0f;
+	}
+	return vertex;
+}
+
+// OBJ
+
+// 1-based, or negative counting back from the latest element; 0 when absent
+static long ParseObjIndex(const char*& p)
+{
+	char* end;
+	long value = strtol(p, &end, 10);
+	if (end == p)
+	{
+		return 0;
+	}
+	p = end;
+	return value;
+}
+
+static bool ResolveObjIndex(long index, size_t count, uint32_t* out)
+{
+	long resolved = index < 0 ? long(count) + index : index - 1;
+	if (resolved < 0 || size_t(resolved) >= count)
+	{
+		return false;
+	}
+	*out = uint32_t(resolved);
+	return true;
+}
+
+static bool LoadObj(const std::string& path, SourceMesh& mesh)
+{
+	std::vector<uint8_t> file;
+	if (!ReadFile(path, file))
+	{
+		fprintf(stderr, "cannot read '%s'\n", path.c_str());
+		return false;
+	}
+	file.push_back('\0');
+
+	std::vector<SourceVertex> positions;  // position and colour
+	std::vector<float> normals;
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> unique; // (position, normal + 1) -> vertex
+	std::vector<uint32_t> face;
+	size_t lineNumber = 0;
+	const char* line = reinterpret_cast<const char*>(file.data());
+	while (*line)
+	{
+		const char* next = strchr(line, '\n');
+		next = next ? next + 1 : line + strlen(line);
+		lineNumber++;
+		const char* p = line;
+		while (*p == ' ' || *p == '\t')
+		{
+			p++;
+		}
+
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			SourceVertex vertex = MakeVertex();
+			char* end;
+			p += 2;
+			for (int a = 0; a < 3; a++)
+			{
+				vertex.position[a] = strtof(p, &end);
+				p = end;
+			}
+			float color[3];
+			int channels = 0;
+			for (; channels < 3; channels++)
+			{
+				color[channels] = strtof(p, &end);
+				if (end == p)
+				{
+					break;
+				}
+				p = end;
+			}
+			if (channels == 3)
+			{
+				memcpy(vertex.color, color, sizeof(color));
+			}
+			vertex.position[2] = -vertex.position[2];
+			positions.push_back(vertex);
+		}
+		else if (p[0] == 'v' && p[1] == 'n')
+		{
+			char* end;
+			p += 2;
+			for (int a = 0; a < 3; a++)
+			{
+				normals.push_back(strtof(p, &end));
+				p = end;
+			}
+			normals.back() = -normals.back();
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// v, v/vt, v//vn or v/vt/vn; polygons become fans
+			face.clear();
+			p++;
+			while (true)
+			{
+				while (*p == ' ' || *p == '\t')
+				{
+					p++;
+				}
+				long v = ParseObjIndex(p);
+				if (v == 0)
+				{
+					break;
+				}
+				long vn = 0;
+				if (*p == '/')
+				{
+					p++;
+					ParseObjIndex(p);
+					if (*p == '/')
+					{
+						p++;
+						vn = ParseObjIndex(p);
+					}
+				}
+				uint32_t position;
+				uint32_t normal = UINT32_MAX;
+				if (!ResolveObjIndex(v, positions.size(), &position) ||
+					(vn != 0 && !ResolveObjIndex(vn, normals.size() / 3, &normal)))
+				{
+					fprintf(stderr, "%s:%zu: index out of range\n", path.c_str(), lineNumber);
+					return false;
+				}
+				auto key = std::make_pair(position, normal + 1);
+				auto found = unique.find(key);
+				if (found == unique.end())
+				{
+					SourceVertex vertex = positions[position];
+					if (normal != UINT32_MAX)
+					{
+						memcpy(vertex.normal, &normals[size_t(normal) * 3], sizeof(vertex.normal));
+					}
+					found = unique.emplace(key, uint32_t(mesh.vertices.size())).first;
+					mesh.vertices.push_back(vertex);
+				}
+				face.push_back(found->second);
+			}
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				mesh.indices.push_back(face[0]);
+				mesh.indices.push_back(face[i]);
+				mesh.indices.push_back(face[i - 1]);
+			}
+		}
+		line = next;
+	}
+	return true;
+}
+
+// glTF
+
+struct Json
+{
+	enum Type { Null, Bool, Number, String, Array, Object };
+	Type type = Null;
+	double number = 0.0;
+	std::string string;
+	std::vector<Json> items;
+	std::vector<std::pair<std::string, Json>> members;
+
+	const Json* Find(const char* name) const
+	{
+		for (const auto& member : members)
+		{
+			if (member.first == name)
+			{
+				return &member.second;
+			}
+		}
+		return nullptr;
+	}
+	double GetNumber(const char* name, double fallback) const
+	{
+		const Json* value = Find(name);
+		return value && value->type == Number ? value->number : fallback;
+	}
+};
+
+class JsonParser
+{
+public:
+	JsonParser(const char* begin, const char* end) : mP(begin), mEnd(end) {}
+
+	bool Parse(Json& out)
+	{
+		if (!ParseValue(out, 0))
+		{
+			return false;
+		}
+		SkipSpace();
+		return mP == mEnd;
+	}
+
+private:
+	void SkipSpace()
+	{
+		while (mP < mEnd && (*mP == ' ' || *mP == '\t' || *mP == '\n' || *mP == '\r'))
+		{
+			mP++;
+		}
+	}
+
+	bool Match(const char* literal)
+	{
+		size_t n = strlen(literal);
+		if (size_t(mEnd - mP) < n || memcmp(mP, literal, n) != 0)
+		{
+			return false;
+		}
+		mP += n;
+		return true;
+	}
+
+	static void AppendUtf8(std::string& s, uint32_t c)
+	{
+		if (c < 0x80)
+		{
+			s += char(c);
+		}
+		else if (c < 0x800)
+		{
+			s += char(0xc0 | (c >> 6));
+			s += char(0x80 | (c & 0x3f));
+		}
+		else
+		{
+			s += char(0xe0 | (c >> 12));
+			s += char(0x80 | ((c >> 6) & 0x3f));
+			s += char(0x80 | (c & 0x3f));
+		}
+	}
+
+	bool ParseString(std::string& out)
+	{
+		mP++;
+		while (mP < mEnd && *mP != '"')
+		{
+			char c = *mP++;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (mP >= mEnd)
+			{
+				return false;
+			}
+			c = *mP++;
+			switch (c)
+			{
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				if (mEnd - mP < 4)
+				{
+					return false;
+				}
+				char hex[5] = { mP[0], mP[1], mP[2], mP[3], 0 };
+				AppendUtf8(out, uint32_t(strtoul(hex, nullptr, 16)));
+				mP += 4;
+				break;
+			}
+			default: out += c; break;
+			}
+		}
+		if (mP >= mEnd)
+		{
+			return false;
+		}
+		mP++;
+		return true;
+	}
+
+	bool ParseValue(Json& out, int depth)
+	{
+		SkipSpace();
+		if (mP >= mEnd || depth > 64)
+		{
+			return false;
+		}
+		if (*mP == '{')
+		{
+			out.type = Json::Object;
+			mP++;
+			SkipSpace();
+			if (mP < mEnd && *mP == '}')
+			{
+				mP++;
+				return true;
+			}
+			while (true)
+			{
+				SkipSpace();
+				std::pair<std::string, Json> member;
+				if (mP >= mEnd || *mP != '"' || !ParseString(member.first))
+				{
+					return false;
+				}
+				SkipSpace();
+				if (!Match(":") || !ParseValue(member.second, depth + 1))
+				{
+					return false;
+				}
+				out.members.push_back(std::move(member));
+				SkipSpace();
+				if (Match("}"))
+				{
+					return true;
+				}
+				if (!Match(","))
+				{
+					return false;
+				}
+			}
+		}
+		if (*mP == '[')
+		{
+			out.type = Json::Array;
+			mP++;
+			SkipSpace();
+			if (mP < mEnd && *mP == ']')
+			{
+				mP++;
+				return true;
+			}
+			while (true)
+			{
+				out.items.emplace_back();
+				if (!ParseValue(out.items.back(), depth + 1))
+				{
+					return false;
+				}
+				SkipSpace();
+				if (Match("]"))
+				{
+					return true;
+				}
+				if (!Match(","))
+				{
+					return false;
+				}
+			}
+		}
+		if (*mP == '"')
+		{
+			out.type = Json::String;
+			return ParseString(out.string);
+		}
+		if (Match("true"))
+		{
+			out.type = Json::Bool;
+			out.number = 1.0;
+			return true;
+		}
+		if (Match("false"))
+		{
+			out.type = Json::Bool;
+			return true;
+		}
+		if (Match("null"))
+		{
+			return true;
+		}
+		std::string number;
+		while (mP < mEnd && strchr("+-0123456789.eE", *mP))
+		{
+			number += *mP++;
+		}
+		char* end;
+		out.type = Json::Number;
+		out.number = strtod(number.c_str(), &end);
+		return !number.empty() && *end == '\0';
+	}
+
+	const char* mP;
+	const char* mEnd;
+};
+
+static bool DecodeBase64(const std::string& text, size_t begin, std::vector<uint8_t>& out)
+{
+	uint32_t bits = 0;
+	int count = 0;
+	for (size_t i = begin; i < text.size() && text[i] != '='; i++)
+	{
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		const char* found = strchr(alphabet, text[i]);
+		if (!found || text[i] == '\0')
+		{
+			return false;
+		}
+		bits = (bits << 6) | uint32_t(found - alphabet);
+		count += 6;
+		if (count >= 8)
+		{
+			count -= 8;
+			out.push_back(uint8_t(bits >> count));
+		}
+	}
+	return true;
+}
+
+struct Gltf
+{
+	Json json;
+	std::vector<std::vector<uint8_t>> buffers;
+};
+
+static bool LoadGltfFile(const std::string& path, Gltf& gltf)
+{
+	std::vector<uint8_t> file;
+	if (!ReadFile(path, file))
+	{
+		fprintf(stderr, "cannot read '%s'\n", path.c_str());
+		return false;
+	}
+
+	// A .glb is a 12-byte header, then a JSON chunk and an optional BIN chunk
+	const char* text = reinterpret_cast<const char*>(file.data());
+	size_t textSize = file.size();
+	std::vector<uint8_t> binary;
+	bool glb = file.size() >= 12 && memcmp(file.data(), "glTF", 4) == 0;
+	if (glb)
+	{
+		size_t offset = 12;
+		textSize = 0;
+		while (offset + 8 <= file.size())
+		{
+			uint32_t length;
+			uint32_t type;
+			memcpy(&length, &file[offset], 4);
+			memcpy(&type, &file[offset + 4], 4);
+			if (length > file.size() - offset - 8)
+			{
+				fprintf(stderr, "%s: truncated chunk\n", path.c_str());
+				return false;
+			}
+			if (type == 0x4e4f534a) // "JSON"
+			{
+				text = reinterpret_cast<const char*>(&file[offset + 8]);
+				textSize = length;
+			}
+			else if (type == 0x004e4942) // "BIN\0"
+			{
+				binary.assign(file.begin() + offset + 8, file.begin() + offset + 8 + length);
+			}
+			offset += 8 + ((size_t(length) + 3) & ~size_t(3));
+		}
+	}
+
+	JsonParser parser(text, text + textSize);
+	if (!parser.Parse(gltf.json) || gltf.json.type != Json::Object)
+	{
+		fprintf(stderr, "%s: malformed JSON\n", path.c_str());
+		return false;
+	}
+
+	const Json* buffers = gltf.json.Find("buffers");
+	for (size_t i = 0; buffers && i < buffers->items.size(); i++)
+	{
+		const Json* uri = buffers->items[i].Find("uri");
+		std::vector<uint8_t> data;
+		if (!uri)
+		{
+			data = binary;
+		}
+		else if (uri->string.compare(0, 5, "data:") == 0)
+		{
+			size_t comma = uri->string.find(";base64,");
+			if (comma == std::string::npos || !DecodeBase64(uri->string, comma + 8, data))
+			{
+				fprintf(stderr, "%s: buffer %zu has an unsupported data URI\n", path.c_str(), i);
+				return false;
+			}
+		}
+		else if (!ReadFile(GetDirectory(path) + uri->string, data))
+		{
+			fprintf(stderr, "%s: cannot read buffer '%s'\n", path.c_str(), uri->string.c_str());
+			return false;
+		}
+		size_t byteLength = size_t(buffers->items[i].GetNumber("byteLength", 0.0));
+		if (data.size() < byteLength)
+		{
+			fprintf(stderr, "%s: buffer %zu is shorter than its byteLength\n", path.c_str(), i);
+			return false;
+		}
+		gltf.buffers.push_back(std::move(data));
+	}
+	return true;
+}
+
+static size_t GetComponentSize(int componentType)
+{
+	switch (componentType)
+	{
+	case 5120: case 5121: return 1;
+	case 5122: case 5123: return 2;
+	case 5125: case 5126: return 4;
+	}
+	return 0;
+}
+
+static size_t GetComponentCount(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+// Reads an accessor as floats, normalized integers mapped to [0, 1] or [-1, 1]. Fails on sparse
+// accessors and on anything that would read outside its buffer.
+static bool ReadAccessor(const Gltf& gltf, size_t index, size_t components, std::vector<double>& out, size_t* count)
+{
+	const Json* accessors = gltf.json.Find("accessors");
+	const Json* views = gltf.json.Find("bufferViews");
+	if (!accessors || index >= accessors->items.size())
+	{
+		return false;
+	}
+	const Json& accessor = accessors->items[index];
+	const Json* typeName = accessor.Find("type");
+	int componentType = int(accessor.GetNumber("componentType", 0.0));
+	size_t componentSize = GetComponentSize(componentType);
+	size_t available = typeName ? GetComponentCount(typeName->string) : 0;
+	*count = size_t(accessor.GetNumber("count", 0.0));
+	if (accessor.Find("sparse") || componentSize == 0 || available == 0 || components > available)
+	{
+		return false;
+	}
+	bool normalized = accessor.Find("normalized") && accessor.Find("normalized")->number != 0.0;
+
+	out.assign(*count * components, 0.0);
+	const Json* viewIndex = accessor.Find("bufferView");
+	if (!viewIndex)
+	{
+		return true; // all zeros
+	}
+	if (!views || size_t(viewIndex->number) >= views->items.size())
+	{
+		return false;
+	}
+	const Json& view = views->items[size_t(viewIndex->number)];
+	size_t buffer = size_t(view.GetNumber("buffer", 0.0));
+	if (buffer >= gltf.buffers.size())
+	{
+		return false;
+	}
+	size_t elementSize = componentSize * available;
+	size_t stride = size_t(view.GetNumber("byteStride", double(elementSize)));
+	size_t begin = size_t(view.GetNumber("byteOffset", 0.0)) + size_t(accessor.GetNumber("byteOffset", 0.0));
+	size_t viewEnd = size_t(view.GetNumber("byteOffset", 0.0)) + size_t(view.GetNumber("byteLength", 0.0));
+	if (*count > 0 && (viewEnd > gltf.buffers[buffer].size() || begin + (*count - 1) * stride + elementSize > viewEnd))
+	{
+		return false;
+	}
+
+	const uint8_t* data = gltf.buffers[buffer].data() + begin;
+	for (size_t i = 0; i < *count; i++)
+	{
+		for (size_t c = 0; c < components; c++)
+		{
+			const uint8_t* p = data + i * stride + c * componentSize;
+			double value = 0.0;
+			switch (componentType)
+			{
+			case 5120: { int8_t v; memcpy(&v, p, 1); value = normalized ? std::max(v / 127.0, -1.0) : v; break; }
+			case 5121: { uint8_t v = *p; value = normalized ? v / 255.0 : v; break; }
+			case 5122: { int16_t v; memcpy(&v, p, 2); value = normalized ? std::max(v / 32767.0, -1.0) : v; break; }
+			case 5123: { uint16_t v; memcpy(&v, p, 2); value = normalized ? v / 65535.0 : v; break; }
+			case 5125: { uint32_t v; memcpy(&v, p, 4); value = v; break; }
+			case 5126: { float v; memcpy(&v, p, 4); value = v; break; }
+			}
+			out[i * components + c] = value;
+		}
+	}
+	return true;
+}
+
+// Column-major, as glTF stores matrices
+static void Multiply(const double a[16], const double b[16], double out[16])
+{
+	double result[16];
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			double sum = 0.0;
+			for (int k = 0; k < 4; k++)
+			{
+				sum += a[k * 4 + row] * b[column * 4 + k];
+			}
+			result[column * 4 + row] = sum;
+		}
+	}
+	memcpy(out, result, sizeof(result));
+}
+
+static void GetNodeMatrix(const Json& node, double out[16])
+{
+	const Json* matrix = node.Find("matrix");
+	if (matrix && matrix->items.size() == 16)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			out[i] = matrix->items[i].number;
+		}
+		return;
+	}
+	double t[3] = { 0.0, 0.0, 0.0 };
+	double r[4] = { 0.0, 0.0, 0.0, 1.0 };
+	double s[3] = { 1.0, 1.0, 1.0 };
+	const Json* translation = node.Find("translation");
+	const Json* rotation = node.Find("rotation");
+	const Json* scale = node.Find("scale");
+	for (int i = 0; translation && i < 3 && size_t(i) < translation->items.size(); i++) t[i] = translation->items[i].number;
+	for (int i = 0; rotation && i < 4 && size_t(i) < rotation->items.size(); i++) r[i] = rotation->items[i].number;
+	for (int i = 0; scale && i < 3 && size_t(i) < scale->items.size(); i++) s[i] = scale->items[i].number;
+
+	double x = r[0], y = r[1], z = r[2], w = r[3];
+	double rotationMatrix[9] =
+	{
+		1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+		2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+		2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y),
+	};
+	for (int column = 0; column < 3; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			out[column * 4 + row] = rotationMatrix[column * 3 + row] * s[column];
+		}
+		out[column * 4 + 3] = 0.0;
+	}
+	out[12] = t[0];
+	out[13] = t[1];
+	out[14] = t[2];
+	out[15] = 1.0;
+}
+
+static bool AppendPrimitive(const Gltf& gltf, const Json& primitive, const double world[16], SourceMesh& mesh, const std::string& path)
+{
+	if (primitive.GetNumber("mode", 4.0) != 4.0)
+	{
+		fprintf(stderr, "%s: skipping a primitive that is not a triangle list\n", path.c_str());
+		return true;
+	}
+	const Json* attributes = primitive.Find("attributes");
+	const Json* position = attributes ? attributes->Find("POSITION") : nullptr;
+	if (!position)
+	{
+		return true;
+	}
+
+	std::vector<double> positions;
+	size_t count;
+	if (!ReadAccessor(gltf, size_t(position->number), 3, positions, &count))
+	{
+		fprintf(stderr, "%s: unreadable POSITION accessor\n", path.c_str());
+		return false;
+	}
+	std::vector<double> normals;
+	std::vector<double> colors;
+	size_t attributeCount;
+	const Json* normal = attributes->Find("NORMAL");
+	if (normal && (!ReadAccessor(gltf, size_t(normal->number), 3, normals, &attributeCount) || attributeCount != count))
+	{
+		fprintf(stderr, "%s: unreadable NORMAL accessor\n", path.c_str());
+		return false;
+	}
+	const Json* color = attributes->Find("COLOR_0");
+	size_t colorComponents = 4;
+	if (color)
+	{
+		const Json* accessors = gltf.json.Find("accessors");
+		const Json* type = accessors && size_t(color->number) < accessors->items.size() ? accessors->items[size_t(color->number)].Find("type") : nullptr;
+		colorComponents = type && type->string == "VEC3" ? 3 : 4;
+		if (!ReadAccessor(gltf, size_t(color->number), colorComponents, colors, &attributeCount) || attributeCount != count)
+		{
+			fprintf(stderr, "%s: unreadable COLOR_0 accessor\n", path.c_str());
+			return false;
+		}
+	}
+
+	// Normals take the inverse transpose; a mirroring transform also reverses the winding
+	double m[9];
+	for (int column = 0; column < 3; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			m[column * 3 + row] = world[column * 4 + row];
+		}
+	}
+	double determinant = m[0] * (m[4] * m[8] - m[7] * m[5]) - m[3] * (m[1] * m[8] - m[7] * m[2]) + m[6] * (m[1] * m[5] - m[4] * m[2]);
+	double cofactor[9] =
+	{
+		m[4] * m[8] - m[5] * m[7], m[5] * m[6] - m[3] * m[8], m[3] * m[7] - m[4] * m[6],
+		m[2] * m[7] - m[1] * m[8], m[0] * m[8] - m[2] * m[6], m[1] * m[6] - m[0] * m[7],
+		m[1] * m[5] - m[2] * m[4], m[2] * m[3] - m[0] * m[5], m[0] * m[4] - m[1] * m[3],
+	};
+
+	uint32_t base = uint32_t(mesh.vertices.size());
+	for (size_t i = 0; i < count; i++)
+	{
+		SourceVertex vertex = MakeVertex();
+		const double* p = &positions[i * 3];
+		for (int a = 0; a < 3; a++)
+		{
+			vertex.position[a] = float(world[a] * p[0] + world[4 + a] * p[1] + world[8 + a] * p[2] + world[12 + a]);
+		}
+		if (!normals.empty())
+		{
+			const double* n = &normals[i * 3];
+			double t[3];
+			for (int a = 0; a < 3; a++)
+			{
+				t[a] = cofactor[a * 3] * n[0] + cofactor[a * 3 + 1] * n[1] + cofactor[a * 3 + 2] * n[2];
+			}
+			double length = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+			for (int a = 0; a < 3 && length > 0.0; a++)
+			{
+				vertex.normal[a] = float(t[a] / length * (determinant < 0.0 ? -1.0 : 1.0));
+			}
+		}
+		for (size_t c = 0; c < colors.size() / count; c++)
+		{
+			vertex.color[c] = float(colors[i * colorComponents + c]);
+		}
+		vertex.position[2] = -vertex.position[2];
+		vertex.normal[2] = -vertex.normal[2];
+		mesh.vertices.push_back(vertex);
+	}
+
+	std::vector<uint32_t> indices;
+	const Json* indexAccessor = primitive.Find("indices");
+	if (indexAccessor)
+	{
+		std::vector<double> values;
+		size_t indexCount;
+		if (!ReadAccessor(gltf, size_t(indexAccessor->number), 1, values, &indexCount))
+		{
+			fprintf(stderr, "%s: unreadable indices accessor\n", path.c_str());
+			return false;
+		}
+		for (double value : values)
+		{
+			if (value >= double(count))
+			{
+				fprintf(stderr, "%s: index %.0f out of range\n", path.c_str(), value);
+				return false;
+			}
+			indices.push_back(uint32_t(value));
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			indices.push_back(uint32_t(i));
+		}
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		// Clockwise fronts, unless a mirroring node transform already reversed the triangle
+		bool swap = determinant >= 0.0;
+		mesh.indices.push_back(base + indices[i]);
+		mesh.indices.push_back(base + indices[swap ? i + 2 : i + 1]);
+		mesh.indices.push_back(base + indices[swap ? i + 1 : i + 2]);
+	}
+	return true;
+}
+
+static bool AppendNode(const Gltf& gltf, size_t index, const double parent[16], SourceMesh& mesh, const std::string& path, int depth)
+{
+	const Json* nodes = gltf.json.Find("nodes");
+	if (!nodes || index >= nodes->items.size() || depth > 64)
+	{
+		fprintf(stderr, "%s: bad node %zu\n", path.c_str(), index);
+		return false;
+	}
+	const Json& node = nodes->items[index];
+	double local[16];
+	double world[16];
+	GetNodeMatrix(node, local);
+	Multiply(parent, local, world);
+
+	const Json* meshIndex = node.Find("mesh");
+	const Json* meshes = gltf.json.Find("meshes");
+	if (meshIndex)
+	{
+		if (!meshes || size_t(meshIndex->number) >= meshes->items.size())
+		{
+			fprintf(stderr, "%s: bad mesh %.0f\n", path.c_str(), meshIndex->number);
+			return false;
+		}
+		const Json* primitives = meshes->items[size_t(meshIndex->number)].Find("primitives");
+		for (size_t i = 0; primitives && i < primitives->items.size(); i++)
+		{
+			if (!AppendPrimitive(gltf, primitives->items[i], world, mesh, path))
+			{
+				return false;
+			}
+		}
+	}
+	const Json* children = node.Find("children");
+	for (size_t i = 0; children && i < children->items.size(); i++)
+	{
+		if (!AppendNode(gltf, size_t(children->items[i].number), world, mesh, path, depth + 1))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool LoadGltf(const std::string& path, SourceMesh& mesh)
+{
+	Gltf gltf;
+	if (!LoadGltfFile(path, gltf))
+	{
+		return false;
+	}
+	static const double identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	// The default scene's node trees, or every mesh untransformed when the file has no scenes
+	const Json* scenes = gltf.json.Find("scenes");
+	if (scenes && !scenes->items.empty())
+	{
+		size_t scene = size_t(gltf.json.GetNumber("scene", 0.0));
+		const Json* roots = scene < scenes->items.size() ? scenes->items[scene].Find("nodes") : nullptr;
+		for (size_t i = 0; roots && i < roots->items.size(); i++)
+		{
+			if (!AppendNode(gltf, size_t(roots->items[i].number), identity, mesh, path, 0))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	const Json* meshes = gltf.json.Find("meshes");
+	for (size_t m = 0; meshes && m < meshes->items.size(); m++)
+	{
+		const Json* primitives = meshes->items[m].Find("primitives");
+		for (size_t i = 0; primitives && i < primitives->items.size(); i++)
+		{
+			if (!AppendPrimitive(gltf, primitives->items[i], identity, mesh, path))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <input.obj|input.gltf|input.glb> <output.mesh> [maxLevels=5]\n", argv[0]);
+		return 1;
+	}
+	std::string input = argv[1];
+	LodSettings settings;
+	if (argc > 3)
+	{
+		settings.maxLevels = std::max<size_t>(1, strtoull(argv[3], nullptr, 10));
+	}
+
+	SourceMesh source;
+	bool loaded = EndsWith(input, ".obj") ? LoadObj(input, source) :
+		EndsWith(input, ".gltf") || EndsWith(input, ".glb") ? LoadGltf(input, source) : false;
+	if (!loaded)
+	{
+		if (!EndsWith(input, ".obj") && !EndsWith(input, ".gltf") && !EndsWith(input, ".glb"))
+		{
+			fprintf(stderr, "'%s' is neither .obj, .gltf nor .glb\n", input.c_str());
+		}
+		return 1;
+	}
+
+	MeshData mesh;
+	MeshBuildStatistics statistics;
+	if (!BuildMeshData(source.vertices.data(), source.vertices.size(), source.indices.data(), source.indices.size(),
+		SquareVertexElements, std::size(SquareVertexElements), settings, mesh, &statistics))
+	{
+		fprintf(stderr, "%s: no triangles\n", input.c_str());
+		return 1;
+	}
+	if (mesh.indexSize != sizeof(uint16_t))
+	{
+		fprintf(stderr, "warning: %u vertices need 32-bit indices; the renderer only draws meshes of up to 65536\n", mesh.vertexCount);
+	}
+
+	std::vector<uint8_t> image;
+	WriteMeshAsset(mesh.GetView(), image);
+	FILE* fp = fopen(argv[2], "wb");
+	if (!fp || fwrite(image.data(), 1, image.size(), fp) != image.size())
+	{
+		fprintf(stderr, "cannot write '%s'\n", argv[2]);
+		if (fp)
+		{
+			fclose(fp);
+		}
+		return 1;
+	}
+	fclose(fp);
+
+	printf("%s: %u vertices (%zu unused dropped), %zu triangles, %zu LODs, %zu meshlets, ACMR %.3f -> %.3f, %zu bytes\n",
+		argv[2], mesh.vertexCount, statistics.unusedVertices, source.indices.size() / 3, mesh.lods.size(),
+		mesh.meshlets.meshlets.size(), statistics.before.acmr, statistics.after.acmr, image.size());
+	return 0;
+}
@@ -0,0 +1,146 @@
+// Orders a tessellated torus with its triangles shuffled for the vertex cache and vertex fetch,
+// checks that the mesh is unchanged, and reports the cache miss ratios before and after.
+//
+//   g++ -std=c++17 -O2 MeshOptCheck.cpp ../src/MeshOptimizer.cpp -o MeshOptCheck
+//   ./MeshOptCheck [rings=256]
+//
+// The reordered list must hold exactly the source triangles with their winding, fetch remapping must
+// keep every triangle on the same positions, and the optimized order must beat both the source order
+// and the shuffled one on every cache size.
+#include "../src/MeshOptimizer.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Triangles by position, rotated so the smallest key comes first, to compare lists whatever their order
+static std::vector<std::array<float, 9>> TriangleKeys(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	std::vector<std::array<float, 9>> keys;
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		std::array<float, 9> corners[3];
+		for (int rotation = 0; rotation < 3; rotation++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				const float* p = vertices[indices[t + (c + rotation) % 3]].position;
+				std::copy(p, p + 3, corners[rotation].begin() + c * 3);
+			}
+		}
+		keys.push_back(*std::min_element(corners, corners + 3));
+	}
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+int main(int argc, char** argv)
+{
+	int rings = argc > 1 ? atoi(argv[1]) : 256;
+	int failures = 0;
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	MakeTorus(rings, std::max(3, rings / 2), vertices, indices);
+
+	// Imported assets rarely come in a good order; shuffling triangles is the worst case
+	std::vector<uint32_t> shuffled(indices);
+	{
+		std::mt19937 random(7);
+		for (size_t t = shuffled.size() / 3; t > 1; t--)
+		{
+			size_t other = random() % t;
+			std::swap_ranges(&shuffled[(t - 1) * 3], &shuffled[(t - 1) * 3] + 3, &shuffled[other * 3]);
+		}
+	}
+
+	std::vector<uint32_t> optimized(shuffled.size());
+	auto begin = std::chrono::steady_clock::now();
+	OptimizeVertexCache(optimized.data(), shuffled.data(), shuffled.size(), vertices.size());
+	double cacheMs = Milliseconds(begin);
+
+	if (TriangleKeys(vertices, optimized) != TriangleKeys(vertices, indices))
+	{
+		printf("cache order does not hold the source triangles\n");
+		failures++;
+	}
+
+	printf("%zu triangles, %zu vertices, cache order in %.1f ms\n", indices.size() / 3, vertices.size(), cacheMs);
+	printf("cache  source ACMR  shuffled ACMR  optimized ACMR  ATVR\n");
+	for (size_t cacheSize : { size_t(8), size_t(12), size_t(16), size_t(24), size_t(32) })
+	{
+		VertexCacheStatistics source = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize);
+		VertexCacheStatistics before = AnalyzeVertexCache(shuffled.data(), shuffled.size(), vertices.size(), cacheSize);
+		VertexCacheStatistics after = AnalyzeVertexCache(optimized.data(), optimized.size(), vertices.size(), cacheSize);
+		printf("%5zu  %11.3f  %13.3f  %14.3f  %.3f\n", cacheSize, source.acmr, before.acmr, after.acmr, after.atvr);
+		if (after.acmr >= before.acmr || after.acmr >= source.acmr)
+		{
+			printf("cache size %zu: optimized order is no better\n", cacheSize);
+			failures++;
+		}
+	}
+
+	// Fetch order: new indices count up in order of first use and point at the same positions
+	std::vector<uint32_t> fetched(optimized);
+	std::vector<uint32_t> remap;
+	begin = std::chrono::steady_clock::now();
+	size_t used = OptimizeVertexFetch(fetched.data(), fetched.size(), vertices.size(), remap);
+	std::vector<Vertex> remapped(used);
+	RemapVertices(remapped.data(), vertices.data(), vertices.size(), sizeof(Vertex), remap.data());
+	double fetchMs = Milliseconds(begin);
+
+	uint32_t highest = 0;
+	size_t jumps = 0;
+	for (size_t i = 0; i < fetched.size(); i++)
+	{
+		if (fetched[i] > highest + 1 || (i == 0 && fetched[i] != 0))
+		{
+			jumps++;
+		}
+		highest = std::max(highest, fetched[i]);
+		const float* a = remapped[fetched[i]].position;
+		const float* b = vertices[optimized[i]].position;
+		if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2])
+		{
+			printf("index %zu moved to another position\n", i);
+			failures++;
+			break;
+		}
+	}
+	if (used != vertices.size() || jumps)
+	{
+		printf("fetch order: %zu of %zu vertices, %zu out-of-order first uses\n", used, vertices.size(), jumps);
+		failures++;
+	}
+	if (AnalyzeVertexCache(fetched.data(), fetched.size(), used).acmr != AnalyzeVertexCache(optimized.data(), optimized.size(), vertices.size()).acmr)
+	{
+		printf("fetch order changed the cache behaviour\n");
+		failures++;
+	}
+	printf("fetch order in %.1f ms\n", fetchMs);
+
+	// 16-bit indices when the vertices allow
+	if (FitsIndex16(used))
+	{
+		std::vector<uint16_t> packed(fetched.size());
+		PackIndices16(fetched.data(), fetched.size(), packed.data());
+		if (!std::equal(packed.begin(), packed.end(), fetched.begin()))
+		{
+			printf("16-bit indices do not round-trip\n");
+			failures++;
+		}
+		printf("16-bit indices: %zu bytes instead of %zu\n", packed.size() * sizeof(uint16_t), fetched.size() * sizeof(uint32_t));
+	}
+	if (!FitsIndex16(0x10000) || FitsIndex16(0x10001))
+	{
+		printf("16-bit index limit is off\n");
+		failures++;
+	}
+
+	printf(failures ? "FAILED\n" : "mesh order checks out\n");
+	return failures ? 1 : 0;
+}
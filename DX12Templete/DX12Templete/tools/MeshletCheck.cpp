@@ -0,0 +1,357 @@
+// Builds meshlets for a tessellated torus and a soup of loose quads, checks the clusters, and times
+// the builder and the cluster culling.
+//
+//   g++ -std=c++17 -O2 -pthread MeshletCheck.cpp ../src/MeshletBuilder.cpp ../src/ClusterCulling.cpp ../src/FrustumCuller.cpp ../src/SoftwareOcclusion.cpp ../src/JobSystem.cpp -o MeshletCheck
+//   ./MeshletCheck [rings=512] [iterations=20]
+//
+// Every meshlet must respect the vertex and triangle limits and every source triangle must come out
+// exactly once with its winding. Bounds must be conservative: a sphere holds all of its meshlet's
+// vertices, a meshlet culled by its cone has no front-facing triangle for that eye, and one culled by
+// the frustum lies wholly outside a plane.
+#include "../src/MeshletBuilder.h"
+#include "../src/ClusterCulling.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+typedef std::array<uint32_t, 3> Triangle;
+
+// Rotated so the smallest index leads, which keeps the winding
+static Triangle Canonical(uint32_t a, uint32_t b, uint32_t c)
+{
+	if (b < a && b < c)
+	{
+		return { b, c, a };
+	}
+	if (c < a && c < b)
+	{
+		return { c, a, b };
+	}
+	return { a, b, c };
+}
+
+// Square::Initialize's quad, scattered
+static void MakeQuads(size_t count, std::mt19937& random, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	const float k = 0.25f;
+	for (size_t i = 0; i < count; i++)
+	{
+		float x = position(random);
+		float y = position(random);
+		float z = position(random);
+		uint32_t base = uint32_t(vertices.size());
+		Vertex quad[4] =
+		{
+			{ { x - k, y - k, z }, { 1, 0, 0, 1 } },
+			{ { x - k, y + k, z }, { 0, 1, 0, 1 } },
+			{ { x + k, y + k, z }, { 0, 0, 1, 1 } },
+			{ { x + k, y - k, z }, { 0, 1, 1, 1 } },
+		};
+		vertices.insert(vertices.end(), quad, quad + 4);
+		uint32_t quadIndices[6] = { base, base + 1, base + 2, base + 3, base, base + 2 };
+		indices.insert(indices.end(), quadIndices, quadIndices + 6);
+	}
+}
+
+static const float* Position(const std::vector<Vertex>& vertices, uint32_t index)
+{
+	return vertices[index].position;
+}
+
+static void TransformPoint(const float world[16], const float p[3], float out[3])
+{
+	for (int c = 0; c < 3; c++)
+	{
+		out[c] = p[0] * world[c] + p[1] * world[4 + c] + p[2] * world[8 + c] + world[12 + c];
+	}
+}
+
+static int CheckStructure(const char* name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const MeshletMesh& mesh)
+{
+	int failures = 0;
+	std::vector<uint8_t> seen(vertices.size(), 0);
+	for (size_t m = 0; m < mesh.meshlets.size(); m++)
+	{
+		const Meshlet& meshlet = mesh.meshlets[m];
+		if (meshlet.vertexCount > MaxMeshletVertices || meshlet.triangleCount > MaxMeshletTriangles || meshlet.triangleCount == 0)
+		{
+			printf("%s: meshlet %zu has %u vertices and %u triangles\n", name, m, meshlet.vertexCount, meshlet.triangleCount);
+			failures++;
+		}
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			uint32_t v = mesh.vertices[meshlet.vertexOffset + i];
+			if (seen[v])
+			{
+				printf("%s: meshlet %zu lists vertex %u twice\n", name, m, v);
+				failures++;
+			}
+			seen[v] = 1;
+		}
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			seen[mesh.vertices[meshlet.vertexOffset + i]] = 0;
+		}
+
+		const MeshletBounds& bounds = mesh.bounds[m];
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				uint32_t corner = MeshletCorner(mesh.triangles[meshlet.triangleOffset + t], c);
+				if (corner >= meshlet.vertexCount)
+				{
+					printf("%s: meshlet %zu triangle %u points past its vertices\n", name, m, t);
+					failures++;
+					continue;
+				}
+				const float* p = Position(vertices, mesh.vertices[meshlet.vertexOffset + corner]);
+				float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+				if (std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) > bounds.radius * 1.0001f + 1e-5f)
+				{
+					printf("%s: meshlet %zu sphere misses a vertex\n", name, m);
+					failures++;
+				}
+			}
+		}
+	}
+
+	// Every source triangle exactly once, winding kept
+	std::vector<uint32_t> all(mesh.meshlets.size());
+	for (size_t m = 0; m < all.size(); m++)
+	{
+		all[m] = uint32_t(m);
+	}
+	std::vector<uint32_t> compacted(mesh.GetTriangleCount() * 3);
+	compacted.resize(CompactMeshletIndices(mesh, all.data(), all.size(), compacted.data()));
+	std::vector<Triangle> expected;
+	std::vector<Triangle> actual;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		expected.push_back(Canonical(indices[i], indices[i + 1], indices[i + 2]));
+	}
+	for (size_t i = 0; i + 2 < compacted.size(); i += 3)
+	{
+		actual.push_back(Canonical(compacted[i], compacted[i + 1], compacted[i + 2]));
+	}
+	std::sort(expected.begin(), expected.end());
+	std::sort(actual.begin(), actual.end());
+	if (expected != actual)
+	{
+		printf("%s: meshlets hold %zu triangles, the source %zu, or they differ\n", name, actual.size(), expected.size());
+		failures++;
+	}
+	return failures;
+}
+
+// Culls the mesh from random eyes and checks that nothing culled could have been seen
+static int CheckCulling(const char* name, const std::vector<Vertex>& vertices, const MeshletMesh& mesh, std::mt19937& random)
+{
+	// Rotation about y, uniform scale 1.5, translation
+	const float angle = 0.7f;
+	const float s = 1.5f;
+	const float world[16] =
+	{
+		s * std::cos(angle), 0.0f, -s * std::sin(angle), 0.0f,
+		0.0f, s, 0.0f, 0.0f,
+		s * std::sin(angle), 0.0f, s * std::cos(angle), 0.0f,
+		2.0f, -1.0f, 15.0f, 1.0f,
+	};
+
+	// XMMatrixPerspectiveFovLH(60 degrees, 16:9, 0.1, 500) with an identity view, eye at the origin
+	const float nearZ = 0.1f;
+	const float farZ = 500.0f;
+	const float yScale = 1.0f / std::tan(0.5f * 3.14159265f / 3.0f);
+	const float xScale = yScale / (16.0f / 9.0f);
+	const float range = farZ / (farZ - nearZ);
+	const float viewProj[16] =
+	{
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range * nearZ, 0.0f,
+	};
+
+	std::vector<float> worldPositions(vertices.size() * 3);
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		TransformPoint(world, vertices[v].position, &worldPositions[v * 3]);
+	}
+
+	int failures = 0;
+	std::vector<uint32_t> visible(mesh.meshlets.size());
+	std::vector<uint8_t> kept(mesh.meshlets.size());
+	ClusterCullStats totals;
+	std::uniform_real_distribution<float> offset(-12.0f, 12.0f);
+	const int eyes = 200;
+	for (int e = 0; e < eyes; e++)
+	{
+		ClusterView view;
+		view.eye[0] = e == 0 ? 0.0f : 2.0f + offset(random);
+		view.eye[1] = e == 0 ? 0.0f : -1.0f + offset(random);
+		view.eye[2] = e == 0 ? 0.0f : 15.0f + offset(random);
+		view.backfaceCulling = true;
+		// The frustum only matches the eye at the origin; elsewhere every plane passes everything
+		if (e == 0)
+		{
+			view.frustum = Frustum::FromViewProj(viewProj);
+		}
+		else
+		{
+			for (auto& plane : view.frustum.planes)
+			{
+				plane[0] = plane[1] = plane[2] = 0.0f;
+				plane[3] = 1.0f;
+			}
+		}
+
+		ClusterCullStats stats;
+		size_t count = CullMeshlets(mesh, 0, mesh.meshlets.size(), world, view, visible.data(), &stats);
+		totals.frustum += stats.frustum;
+		totals.backface += stats.backface;
+		std::fill(kept.begin(), kept.end(), 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			kept[visible[i]] = 1;
+		}
+
+		for (size_t m = 0; m < mesh.meshlets.size(); m++)
+		{
+			if (kept[m])
+			{
+				continue;
+			}
+			const Meshlet& meshlet = mesh.meshlets[m];
+			bool outside = false;
+			for (const auto& plane : view.frustum.planes)
+			{
+				bool allOutside = true;
+				for (uint32_t i = 0; i < meshlet.vertexCount && allOutside; i++)
+				{
+					const float* p = &worldPositions[mesh.vertices[meshlet.vertexOffset + i] * 3];
+					allOutside = plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3] < 0.0f;
+				}
+				outside = outside || allOutside;
+			}
+			if (outside)
+			{
+				continue;
+			}
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				uint32_t packed = mesh.triangles[meshlet.triangleOffset + t];
+				const float* p0 = &worldPositions[mesh.vertices[meshlet.vertexOffset + MeshletCorner(packed, 0)] * 3];
+				const float* p1 = &worldPositions[mesh.vertices[meshlet.vertexOffset + MeshletCorner(packed, 1)] * 3];
+				const float* p2 = &worldPositions[mesh.vertices[meshlet.vertexOffset + MeshletCorner(packed, 2)] * 3];
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float toEye[3] = { view.eye[0] - p0[0], view.eye[1] - p0[1], view.eye[2] - p0[2] };
+				float facing = n[0] * toEye[0] + n[1] * toEye[1] + n[2] * toEye[2];
+				float scale = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * std::sqrt(toEye[0] * toEye[0] + toEye[1] * toEye[1] + toEye[2] * toEye[2]);
+				if (facing > scale * 1e-4f)
+				{
+					printf("%s: meshlet %zu culled with a front-facing triangle\n", name, m);
+					failures++;
+					break;
+				}
+			}
+		}
+	}
+	printf("%-8s frustum culled %zu and cones %zu of %zu meshlet tests\n", name, totals.frustum, totals.backface, mesh.meshlets.size() * eyes);
+	return failures;
+}
+
+int main(int argc, char** argv)
+{
+	int rings = argc > 1 ? atoi(argv[1]) : 512;
+	int iterations = argc > 2 ? atoi(argv[2]) : 20;
+	std::mt19937 random(5);
+
+	std::vector<Vertex> torusVertices;
+	std::vector<uint32_t> torusIndices;
+	MakeTorus(rings, std::max(3, rings / 2), torusVertices, torusIndices);
+
+	// The same torus with its triangles in random order, which is the builder's worst input
+	std::vector<uint32_t> shuffledIndices(torusIndices.size());
+	std::vector<uint32_t> order(torusIndices.size() / 3);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = uint32_t(i);
+	}
+	std::shuffle(order.begin(), order.end(), random);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		std::copy(&torusIndices[order[i] * 3], &torusIndices[order[i] * 3] + 3, &shuffledIndices[i * 3]);
+	}
+
+	std::vector<Vertex> quadVertices;
+	std::vector<uint32_t> quadIndices;
+	MakeQuads(20000, random, quadVertices, quadIndices);
+
+	struct Case
+	{
+		const char* name;
+		const std::vector<Vertex>* vertices;
+		const std::vector<uint32_t>* indices;
+	};
+	const Case cases[] =
+	{
+		{ "torus", &torusVertices, &torusIndices },
+		{ "shuffled", &torusVertices, &shuffledIndices },
+		{ "quads", &quadVertices, &quadIndices },
+	};
+
+	int failures = 0;
+	for (const Case& test : cases)
+	{
+		MeshletMesh mesh;
+		auto begin = std::chrono::steady_clock::now();
+		BuildMeshlets(test.vertices->data(), sizeof(Vertex), test.vertices->size(), test.indices->data(), test.indices->size(), mesh);
+		double buildMs = Milliseconds(begin);
+
+		size_t triangles = test.indices->size() / 3;
+		printf("%-8s %zu triangles -> %zu meshlets, %.1f vertices and %.1f triangles each, %.2f vertex loads per vertex, built in %.1f ms\n",
+			test.name, triangles, mesh.meshlets.size(), double(mesh.vertices.size()) / mesh.meshlets.size(),
+			double(triangles) / mesh.meshlets.size(), double(mesh.vertices.size()) / test.vertices->size(), buildMs);
+
+		failures += CheckStructure(test.name, *test.vertices, *test.indices, mesh);
+		failures += CheckCulling(test.name, *test.vertices, mesh, random);
+
+		if (test.indices == &torusIndices)
+		{
+			// Culling plus compaction as the renderer's fallback path runs it, eye at the origin
+			const float world[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 2, -1, 15, 1 };
+			ClusterView view;
+			view.eye[0] = view.eye[1] = view.eye[2] = 0.0f;
+			view.backfaceCulling = true;
+			for (auto& plane : view.frustum.planes)
+			{
+				plane[0] = plane[1] = plane[2] = 0.0f;
+				plane[3] = 1.0f;
+			}
+			std::vector<uint32_t> visible(mesh.meshlets.size());
+			std::vector<uint32_t> compacted(test.indices->size());
+			size_t count = 0;
+			size_t indexCount = 0;
+			begin = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++)
+			{
+				count = CullMeshlets(mesh, 0, mesh.meshlets.size(), world, view, visible.data());
+				indexCount = CompactMeshletIndices(mesh, visible.data(), count, compacted.data());
+			}
+			double ms = Milliseconds(begin) / iterations;
+			printf("%-8s cull and compact %7.3f ms, %zu of %zu meshlets and %zu of %zu indices left\n",
+				test.name, ms, count, mesh.meshlets.size(), indexCount, test.indices->size());
+		}
+	}
+
+	printf(failures ? "FAILED\n" : "all meshlets check out\n");
+	return failures ? 1 : 0;
+}
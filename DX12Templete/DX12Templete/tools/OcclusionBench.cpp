@@ -0,0 +1,235 @@
+// Times SoftwareOcclusion on a synthetic interior: rows of wall quads in front of the camera with
+// boxes scattered behind and between them. Every box it reports occluded is checked against a
+// per-pixel depth buffer rasterized from the same walls, so a wrong cull fails the run.
+//
+//   g++ -std=c++17 -O2 -pthread OcclusionBench.cpp ../src/SoftwareOcclusion.cpp ../src/FrustumCuller.cpp ../src/JobSystem.cpp -o OcclusionBench
+//   ./OcclusionBench [boxes=200000] [walls=400] [iterations=50]
+#include "../src/SoftwareOcclusion.h"
+#include "../src/FrustumCuller.h"
+#include "../src/JobSystem.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static const int Width = 320;
+static const int Height = 192;
+
+// XMMatrixPerspectiveFovLH(60 degrees, 5:3, 0.1, 500) with an identity view
+static void MakeViewProj(float m[16])
+{
+	const float nearZ = 0.1f;
+	const float farZ = 500.0f;
+	const float yScale = 1.0f / std::tan(0.5f * 3.14159265f / 3.0f);
+	const float xScale = yScale / (float(Width) / float(Height));
+	const float range = farZ / (farZ - nearZ);
+	const float values[16] =
+	{
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range * nearZ, 0.0f,
+	};
+	std::copy(values, values + 16, m);
+}
+
+static void Project(const float m[16], const float p[3], float& x, float& y, float& z)
+{
+	float clip[4];
+	for (int c = 0; c < 4; c++)
+	{
+		clip[c] = p[0] * m[c] + p[1] * m[4 + c] + p[2] * m[8 + c] + m[12 + c];
+	}
+	x = (clip[0] / clip[3] * 0.5f + 0.5f) * float(Width);
+	y = (0.5f - clip[1] / clip[3] * 0.5f) * float(Height);
+	z = clip[2] / clip[3];
+}
+
+// Nearest depth per pixel centre, one triangle at a time
+static void RasterizeReference(const float m[16], const std::vector<float>& walls, std::vector<float>& depth)
+{
+	depth.assign(size_t(Width) * Height, 1.0f);
+	for (size_t w = 0; w < walls.size(); w += 12)
+	{
+		float x[4], y[4], z[4];
+		for (int v = 0; v < 4; v++)
+		{
+			Project(m, &walls[w + v * 3], x[v], y[v], z[v]);
+		}
+		const int triangles[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+		for (const auto& t : triangles)
+		{
+			int a = t[0], b = t[1], c = t[2];
+			float area = (x[b] - x[a]) * (y[c] - y[a]) - (x[c] - x[a]) * (y[b] - y[a]);
+			for (int py = 0; py < Height; py++)
+			{
+				for (int px = 0; px < Width; px++)
+				{
+					float sx = px + 0.5f;
+					float sy = py + 0.5f;
+					float w0 = ((x[b] - sx) * (y[c] - sy) - (x[c] - sx) * (y[b] - sy)) / area;
+					float w1 = ((x[c] - sx) * (y[a] - sy) - (x[a] - sx) * (y[c] - sy)) / area;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+					{
+						float d = w0 * z[a] + w1 * z[b] + w2 * z[c];
+						float& target = depth[py * Width + px];
+						target = std::min(target, d);
+					}
+				}
+			}
+		}
+	}
+}
+
+static bool IsOccludedReference(const float m[16], const std::vector<float>& depth, const float center[3], const float extents[3])
+{
+	float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY, minZ = INFINITY;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float p[3] =
+		{
+			center[0] + ((corner & 1) ? extents[0] : -extents[0]),
+			center[1] + ((corner & 2) ? extents[1] : -extents[1]),
+			center[2] + ((corner & 4) ? extents[2] : -extents[2]),
+		};
+		float x, y, z;
+		Project(m, p, x, y, z);
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, z);
+	}
+	int x0 = std::max(0, int(std::floor(minX)));
+	int y0 = std::max(0, int(std::floor(minY)));
+	int x1 = std::min(Width - 1, int(std::ceil(maxX)));
+	int y1 = std::min(Height - 1, int(std::ceil(maxY)));
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			if (depth[y * Width + x] >= minZ)
+			{
+				return false;
+			}
+		}
+	}
+	return x0 <= x1 && y0 <= y1;
+}
+
+int main(int argc, char** argv)
+{
+	size_t boxes = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+	size_t walls = argc > 2 ? strtoull(argv[2], nullptr, 10) : 400;
+	int iterations = argc > 3 ? atoi(argv[3]) : 50;
+
+	// Walls face the camera at a spread of depths and angles, like partitions in a building
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> lateral(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> distance(10.0f, 150.0f);
+	std::uniform_real_distribution<float> halfSize(3.0f, 12.0f);
+	std::uniform_real_distribution<float> slant(-0.6f, 0.6f);
+	std::vector<float> wallPositions;
+	for (size_t i = 0; i < walls; i++)
+	{
+		float cx = lateral(random) * 0.6f;
+		float cy = lateral(random) * 0.3f;
+		float cz = distance(random);
+		float hx = halfSize(random);
+		float hy = halfSize(random);
+		float s = slant(random);
+		const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+		for (const auto& corner : corners)
+		{
+			wallPositions.push_back(cx + corner[0] * hx);
+			wallPositions.push_back(cy + corner[1] * hy);
+			wallPositions.push_back(cz + corner[0] * hx * s);
+		}
+	}
+	const uint32_t quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+	const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	std::uniform_real_distribution<float> boxDistance(12.0f, 300.0f);
+	std::uniform_real_distribution<float> boxSize(0.2f, 2.0f);
+	CullingBounds bounds;
+	bounds.Resize(boxes);
+	std::vector<uint32_t> all(boxes);
+	for (size_t i = 0; i < boxes; i++)
+	{
+		float z = boxDistance(random);
+		float center[3] = { lateral(random) * z / 100.0f, lateral(random) * z / 160.0f, z };
+		float extents[3] = { boxSize(random), boxSize(random), boxSize(random) };
+		bounds.Set(i, center, extents);
+		all[i] = uint32_t(i);
+	}
+
+	float viewProj[16];
+	MakeViewProj(viewProj);
+	SoftwareOcclusion occlusion(Width, Height);
+	JobSystem jobs;
+
+	auto addWalls = [&]()
+	{
+		occlusion.Begin(viewProj);
+		for (size_t w = 0; w < walls; w++)
+		{
+			occlusion.AddOccluder(&wallPositions[w * 12], 4, quadIndices, 6, identity);
+		}
+	};
+
+	int result = 0;
+	std::vector<uint32_t> visible;
+	for (JobSystem* pool : { (JobSystem*)nullptr, &jobs })
+	{
+		auto begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			addWalls();
+			occlusion.Rasterize(pool);
+		}
+		double rasterMs = Milliseconds(begin) / iterations;
+
+		begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			visible = all;
+			visible.resize(occlusion.CullOccluded(bounds, visible.data(), visible.size(), pool));
+		}
+		double testMs = Milliseconds(begin) / iterations;
+		printf("%-8s %zu triangles  rasterize %7.3f ms  test %7.3f ms  %zu of %zu boxes visible\n",
+			pool ? "threads" : "single", occlusion.GetTriangleCount(), rasterMs, testMs, visible.size(), boxes);
+	}
+
+	// Every box culled must also be hidden in the exact buffer
+	std::vector<float> depth;
+	RasterizeReference(viewProj, wallPositions, depth);
+	size_t referenceOccluded = 0;
+	size_t wrong = 0;
+	std::vector<bool> kept(boxes, false);
+	for (uint32_t index : visible)
+	{
+		kept[index] = true;
+	}
+	for (size_t i = 0; i < boxes; i++)
+	{
+		float center[3] = { bounds.CenterX()[i], bounds.CenterY()[i], bounds.CenterZ()[i] };
+		float extents[3] = { bounds.ExtentX()[i], bounds.ExtentY()[i], bounds.ExtentZ()[i] };
+		bool hidden = IsOccludedReference(viewProj, depth, center, extents);
+		referenceOccluded += hidden ? 1 : 0;
+		if (!kept[i] && !hidden)
+		{
+			wrong++;
+		}
+	}
+	printf("per-pixel reference occludes %zu, software culled %zu\n", referenceOccluded, boxes - visible.size());
+	if (wrong)
+	{
+		printf("%zu VISIBLE BOXES CULLED\n", wrong);
+		result = 1;
+	}
+	return result;
+}
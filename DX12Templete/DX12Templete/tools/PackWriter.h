@@ -0,0 +1,145 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../src/CompressedStream.h"
+#include "../src/PackFormat.h"
+#include "../src/VirtualFileSystem.h"
+
+// Builds a .pak from in-memory files. Portable: used by the Linux content tools.
+class PackWriter
+{
+public:
+	// Files below this are stored: they are read in one page anyway
+	static constexpr size_t MinCompressSize = 4096;
+
+	// Compresses files added from now on where it saves at least an eighth, on jobs when given
+	void EnableCompression(JobSystem* jobs = nullptr)
+	{
+		mCompress = true;
+		mJobs = jobs;
+	}
+
+	bool Add(const std::string& name, std::vector<uint8_t> data)
+	{
+		std::string path;
+		if (!VirtualFileSystem::NormalizePath(name, &path) || path.empty())
+		{
+			fprintf(stderr, "'%s' is not a valid asset name\n", name.c_str());
+			return false;
+		}
+		if (!mPaths.insert(path).second)
+		{
+			fprintf(stderr, "duplicate asset name '%s'\n", path.c_str());
+			return false;
+		}
+		File file = { path, PackFormat::HashPath(path.data(), path.size()), data.size(), false, std::move(data) };
+		if (mCompress && file.data.size() >= MinCompressSize)
+		{
+			std::vector<uint8_t> stream;
+			CompressStream(file.data.data(), file.data.size(), stream, CompressedStreamFormat::DefaultChunkSize, mJobs);
+			if (stream.size() <= file.data.size() - file.data.size() / 8)
+			{
+				file.data = std::move(stream);
+				file.compressed = true;
+			}
+		}
+		mStoredBytes += file.data.size();
+		mFiles.push_back(std::move(file));
+		return true;
+	}
+
+	size_t GetFileCount() const { return mFiles.size(); }
+	uint64_t GetStoredBytes() const { return mStoredBytes; }
+
+	// The same files always give the same bytes, whatever order they were added in
+	void Build(std::vector<uint8_t>& image)
+	{
+		using namespace PackFormat;
+
+		std::sort(mFiles.begin(), mFiles.end(), [](const File& a, const File& b) {
+			return ComparePath(a.hash, a.path.data(), a.path.size(), b.hash, b.path.data(), b.path.size()) < 0;
+		});
+
+		Header header = {};
+		header.magic = Magic;
+		header.version = Version;
+		header.entryCount = static_cast<uint32_t>(mFiles.size());
+		header.dataAlignment = DataAlignment;
+		header.entryOffset = sizeof(Header);
+		header.pathOffset = header.entryOffset + sizeof(Entry) * mFiles.size();
+
+		std::vector<Entry> entries(mFiles.size());
+		std::string paths;
+		for (size_t i = 0; i < mFiles.size(); i++)
+		{
+			memset(&entries[i], 0, sizeof(Entry));
+			entries[i].hash = mFiles[i].hash;
+			entries[i].pathOffset = static_cast<uint32_t>(paths.size());
+			entries[i].pathLength = static_cast<uint32_t>(mFiles[i].path.size());
+			paths += mFiles[i].path;
+		}
+		header.pathSize = paths.size();
+
+		uint64_t offset = AlignUp(header.pathOffset + header.pathSize, DataAlignment);
+		for (size_t i = 0; i < mFiles.size(); i++)
+		{
+			entries[i].offset = offset;
+			entries[i].storedSize = mFiles[i].data.size();
+			entries[i].size = mFiles[i].size;
+			entries[i].flags = mFiles[i].compressed ? uint32_t(CompressedEntry) : 0;
+			offset = AlignUp(offset + mFiles[i].data.size(), DataAlignment);
+		}
+		header.fileSize = offset;
+
+		image.assign(offset, 0);
+		memcpy(image.data(), &header, sizeof(header));
+		if (!entries.empty())
+		{
+			memcpy(image.data() + header.entryOffset, entries.data(), sizeof(Entry) * entries.size());
+		}
+		if (!paths.empty())
+		{
+			memcpy(image.data() + header.pathOffset, paths.data(), paths.size());
+		}
+		for (size_t i = 0; i < mFiles.size(); i++)
+		{
+			if (!mFiles[i].data.empty())
+			{
+				memcpy(image.data() + entries[i].offset, mFiles[i].data.data(), mFiles[i].data.size());
+			}
+		}
+	}
+
+	bool Write(const std::string& path)
+	{
+		std::vector<uint8_t> image;
+		Build(image);
+		FILE* fp = fopen(path.c_str(), "wb");
+		if (!fp)
+		{
+			fprintf(stderr, "cannot open '%s' for writing\n", path.c_str());
+			return false;
+		}
+		bool ok = fwrite(image.data(), 1, image.size(), fp) == image.size();
+		ok = (fclose(fp) == 0) && ok;
+		return ok;
+	}
+
+private:
+	struct File
+	{
+		std::string path;
+		uint64_t hash;
+		uint64_t size;
+		bool compressed;
+		std::vector<uint8_t> data;  // as stored
+	};
+	std::vector<File> mFiles;
+	std::unordered_set<std::string> mPaths;
+	uint64_t mStoredBytes = 0;
+	bool mCompress = false;
+	JobSystem* mJobs = nullptr;
+};
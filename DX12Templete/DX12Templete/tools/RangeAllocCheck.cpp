@@ -0,0 +1,177 @@
+// Churns RangeAllocator with random mesh-sized allocations and frees and checks it against a plain
+// occupancy map, then times it.
+//
+//   g++ -std=c++17 -O2 RangeAllocCheck.cpp ../src/RangeAllocator.cpp -o RangeAllocCheck
+//   ./RangeAllocCheck [operations=200000]
+//
+// Ranges must never overlap or leave the capacity, the used count and the free list must agree with
+// the occupancy map at every step, no two free ranges may touch, and once everything is freed the
+// whole capacity must be one free range again.
+#include "../src/RangeAllocator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Allocation
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+// Free ranges as the occupancy map sees them: maximal runs of unused elements
+static void CountFreeRuns(const std::vector<bool>& occupied, size_t& runs, uint32_t& largest)
+{
+	runs = 0;
+	largest = 0;
+	uint32_t run = 0;
+	for (size_t i = 0; i <= occupied.size(); i++)
+	{
+		if (i < occupied.size() && !occupied[i])
+		{
+			run++;
+			continue;
+		}
+		if (run > 0)
+		{
+			runs++;
+			largest = std::max(largest, run);
+		}
+		run = 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t operations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+	int failures = 0;
+
+	// Mostly small meshes with the odd large one, in a buffer that has to grow a few times
+	std::mt19937 random(5);
+	std::vector<bool> occupied(1024, false);
+	RangeAllocator allocator(1024);
+	std::vector<Allocation> live;
+	size_t grown = 0;
+	size_t failed = 0;
+	for (size_t op = 0; op < operations && failures == 0; op++)
+	{
+		bool allocate = live.empty() || random() % 100 < 55;
+		if (allocate)
+		{
+			uint32_t count = random() % 16 == 0 ? 256 + random() % 2048 : 1 + random() % 64;
+			uint32_t offset = allocator.Allocate(count);
+			if (offset == RangeAllocator::InvalidOffset)
+			{
+				if (allocator.GetLargestFree() >= count)
+				{
+					printf("op %zu: %u elements refused with a free range of %u\n", op, count, allocator.GetLargestFree());
+					failures++;
+					break;
+				}
+				failed++;
+				if (allocator.GetCapacity() >= (1u << 20))
+				{
+					continue;
+				}
+				uint32_t capacity = std::max(allocator.GetCapacity() * 2, allocator.GetCapacity() + count);
+				allocator.Grow(capacity);
+				occupied.resize(capacity, false);
+				grown++;
+				offset = allocator.Allocate(count);
+				if (offset == RangeAllocator::InvalidOffset)
+				{
+					printf("op %zu: %u elements refused after growing\n", op, count);
+					failures++;
+					break;
+				}
+			}
+			if (size_t(offset) + count > allocator.GetCapacity())
+			{
+				printf("op %zu: range %u+%u leaves the capacity %u\n", op, offset, count, allocator.GetCapacity());
+				failures++;
+				break;
+			}
+			for (uint32_t i = offset; i < offset + count; i++)
+			{
+				if (occupied[i])
+				{
+					printf("op %zu: range %u+%u overlaps a live range at %u\n", op, offset, count, i);
+					failures++;
+					break;
+				}
+				occupied[i] = true;
+			}
+			live.push_back({ offset, count });
+		}
+		else
+		{
+			size_t pick = random() % live.size();
+			Allocation allocation = live[pick];
+			live[pick] = live.back();
+			live.pop_back();
+			allocator.Free(allocation.offset, allocation.count);
+			std::fill(occupied.begin() + allocation.offset, occupied.begin() + allocation.offset + allocation.count, false);
+		}
+
+		if (op % 97 == 0)
+		{
+			uint32_t used = uint32_t(std::count(occupied.begin(), occupied.end(), true));
+			size_t runs;
+			uint32_t largest;
+			CountFreeRuns(occupied, runs, largest);
+			if (used != allocator.GetUsed() || runs != allocator.GetFreeRangeCount() || largest != allocator.GetLargestFree())
+			{
+				printf("op %zu: allocator has %u used, %zu free ranges, largest %u; map has %u, %zu, %u\n", op,
+					allocator.GetUsed(), allocator.GetFreeRangeCount(), allocator.GetLargestFree(), used, runs, largest);
+				failures++;
+			}
+		}
+	}
+
+	uint32_t peakCapacity = allocator.GetCapacity();
+	size_t liveCount = live.size();
+	size_t fragments = allocator.GetFreeRangeCount();
+	uint32_t used = allocator.GetUsed();
+	for (const Allocation& allocation : live)
+	{
+		allocator.Free(allocation.offset, allocation.count);
+	}
+	if (failures == 0 && (allocator.GetUsed() != 0 || allocator.GetFreeRangeCount() != 1 || allocator.GetLargestFree() != allocator.GetCapacity()))
+	{
+		printf("freeing everything left %u used in %zu free ranges\n", allocator.GetUsed(), allocator.GetFreeRangeCount());
+		failures++;
+	}
+	printf("%zu operations: capacity %u after %zu grows, %zu live ranges using %.1f%%, %zu free ranges, %zu refusals\n",
+		operations, peakCapacity, grown, liveCount, 100.0 * used / peakCapacity, fragments, failed);
+
+	// Steady churn at a fixed capacity, as meshes stream in and out
+	RangeAllocator timed(1u << 20);
+	std::vector<Allocation> ranges;
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t op = 0; op < operations; op++)
+	{
+		if (ranges.empty() || random() % 2 == 0)
+		{
+			uint32_t count = 1 + random() % 512;
+			uint32_t offset = timed.Allocate(count);
+			if (offset != RangeAllocator::InvalidOffset)
+			{
+				ranges.push_back({ offset, count });
+			}
+		}
+		else
+		{
+			size_t pick = random() % ranges.size();
+			timed.Free(ranges[pick].offset, ranges[pick].count);
+			ranges[pick] = ranges.back();
+			ranges.pop_back();
+		}
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	printf("churn: %.1f ns per operation\n", ms * 1e6 / operations);
+
+	printf(failures ? "FAILED\n" : "range allocator checks out\n");
+	return failures ? 1 : 0;
+}
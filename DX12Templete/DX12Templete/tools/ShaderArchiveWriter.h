@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../src/ShaderArchiveFormat.h"
+
+// Builds a Shaders.pak from in-memory blobs. Portable: used by the Linux content tools.
+class ShaderArchiveWriter
+{
+public:
+	bool Add(const std::string& name, std::vector<uint8_t> blob)
+	{
+		if (name.empty() || name.size() >= ShaderArchiveFormat::MaxNameLength)
+		{
+			fprintf(stderr, "shader name '%s' must be 1-%u characters\n", name.c_str(), ShaderArchiveFormat::MaxNameLength - 1);
+			return false;
+		}
+		for (const auto& shader : mShaders)
+		{
+			if (shader.name == name)
+			{
+				fprintf(stderr, "duplicate shader name '%s'\n", name.c_str());
+				return false;
+			}
+		}
+		mShaders.push_back({ name, std::move(blob) });
+		return true;
+	}
+
+	bool Write(const std::string& path)
+	{
+		using namespace ShaderArchiveFormat;
+
+		std::sort(mShaders.begin(), mShaders.end(), [](const Shader& a, const Shader& b) { return a.name < b.name; });
+
+		Header header = {};
+		header.magic = Magic;
+		header.version = Version;
+		header.entryCount = static_cast<uint32_t>(mShaders.size());
+		header.blobAlignment = BlobAlignment;
+		header.entryOffset = sizeof(Header);
+		header.dataOffset = AlignUp(header.entryOffset + sizeof(Entry) * mShaders.size(), BlobAlignment);
+
+		std::vector<Entry> entries(mShaders.size());
+		uint64_t offset = header.dataOffset;
+		for (size_t i = 0; i < mShaders.size(); i++)
+		{
+			memset(&entries[i], 0, sizeof(Entry));
+			memcpy(entries[i].name, mShaders[i].name.c_str(), mShaders[i].name.size());
+			entries[i].offset = offset;
+			entries[i].size = mShaders[i].blob.size();
+			offset = AlignUp(offset + mShaders[i].blob.size(), BlobAlignment);
+		}
+
+		std::vector<uint8_t> image(offset, 0);
+		memcpy(image.data(), &header, sizeof(header));
+		memcpy(image.data() + header.entryOffset, entries.data(), sizeof(Entry) * entries.size());
+		for (size_t i = 0; i < mShaders.size(); i++)
+		{
+			memcpy(image.data() + entries[i].offset, mShaders[i].blob.data(), mShaders[i].blob.size());
+		}
+
+		FILE* fp = fopen(path.c_str(), "wb");
+		if (!fp)
+		{
+			fprintf(stderr, "cannot open '%s' for writing\n", path.c_str());
+			return false;
+		}
+		bool ok = fwrite(image.data(), 1, image.size(), fp) == image.size();
+		ok = (fclose(fp) == 0) && ok;
+		return ok;
+	}
+
+private:
+	struct Shader
+	{
+		std::string name;
+		std::vector<uint8_t> blob;
+	};
+	std::vector<Shader> mShaders;
+};
+
+static inline bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& data)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (!fp)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	rewind(fp);
+	data.resize(size > 0 ? size_t(size) : 0);
+	bool ok = size >= 0 && fread(data.data(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+	return ok;
+}
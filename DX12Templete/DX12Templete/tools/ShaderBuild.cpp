@@ -0,0 +1,757 @@
+// Offline shader build: compiles every shader listed in a manifest to SM 6.x DXIL with libdxcompiler,
+// writes reflection metadata next to each object and packs the results into Shaders.pak.
+//
+//   g++ -std=c++17 -O2 ShaderBuild.cpp -I$DXC/include -I$DXC/include/dxc -L$DXC/lib -ldxcompiler -o ShaderBuild
+//   ./ShaderBuild ../resource/ShaderManifest.txt build/shaders --pack build/Shaders.pak
+//
+// libdxil.so must sit next to libdxcompiler.so, otherwise the output is not signed and the runtime rejects it.
+//
+// Rebuilds are incremental: every shader gets a .deps file holding a hash of its compile options and the
+// timestamps of the source and every file it included. A shader is only recompiled when one of those changed.
+//
+// With --budgets, the statistics recorded for each shader (from its DXIL disassembly) are compared against the
+// checked-in budget file and the tool exits with code 2 when any shader exceeds its budget. --write-budgets
+// rewrites the budget file from the current statistics after an intended change, with BudgetMargin on top
+// of the instruction counts; the other counts are budgeted exactly.
+#ifdef _WIN32
+#include <windows.h>
+#include <atlbase.h>
+#endif
+#include <dxcapi.h>
+#include <d3d12shader.h>
+#include <clocale>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include "ShaderArchiveWriter.h"
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t ToolVersion = 1;
+
+struct ShaderJob
+{
+	std::string name;
+	fs::path source;
+	std::string entry;    // "-" for libraries
+	std::string profile;
+	std::vector<std::string> defines;
+};
+
+static std::wstring Widen(const std::string& s)
+{
+	std::wstring w(s.size() + 1, L'\0');
+	size_t n = mbstowcs(&w[0], s.c_str(), w.size());
+	w.resize(n == size_t(-1) ? 0 : n);
+	return w;
+}
+
+static std::string Narrow(const wchar_t* s)
+{
+	std::string n(wcslen(s) * 4 + 1, '\0');
+	size_t len = wcstombs(&n[0], s, n.size());
+	n.resize(len == size_t(-1) ? 0 : len);
+	return n;
+}
+
+static uint64_t HashString(const std::string& s, uint64_t hash = 14695981039346656037ull)
+{
+	for (unsigned char c : s)
+	{
+		hash = (hash ^ c) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool ParseManifest(const fs::path& path, std::vector<ShaderJob>& jobs)
+{
+	std::ifstream file(path);
+	if (!file.good())
+	{
+		fprintf(stderr, "cannot open manifest '%s'\n", path.string().c_str());
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.resize(comment);
+		}
+
+		std::istringstream tokens(line);
+		ShaderJob job;
+		std::string source;
+		if (!(tokens >> job.name))
+		{
+			continue;
+		}
+		if (!(tokens >> source >> job.entry >> job.profile))
+		{
+			fprintf(stderr, "%s(%d): expected <name> <source> <entry> <profile> [defines...]\n", path.string().c_str(), lineNumber);
+			return false;
+		}
+		size_t separator = job.profile.find('_');
+		if (separator == std::string::npos || job.profile.compare(separator, 3, "_6_") != 0)
+		{
+			fprintf(stderr, "%s(%d): profile '%s' is not shader model 6.x\n", path.string().c_str(), lineNumber, job.profile.c_str());
+			return false;
+		}
+		std::string define;
+		while (tokens >> define)
+		{
+			job.defines.push_back(define);
+		}
+		job.source = path.parent_path() / source;
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+// Forwards to the default include handler and records every file the compiler pulls in
+class DependencyIncludeHandler : public IDxcIncludeHandler
+{
+public:
+	DependencyIncludeHandler(IDxcUtils* utils)
+	{
+		utils->CreateDefaultIncludeHandler(&mDefault);
+	}
+
+	HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override
+	{
+		HRESULT hr = mDefault->LoadSource(pFilename, ppIncludeSource);
+		if (SUCCEEDED(hr))
+		{
+			mIncludes.insert(fs::absolute(Narrow(pFilename)).lexically_normal().string());
+		}
+		return hr;
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+		{
+			*ppvObject = static_cast<IDxcIncludeHandler*>(this);
+			return S_OK;
+		}
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+	// Lives on the stack for the duration of one compile
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	const std::set<std::string>& GetIncludes() const { return mIncludes; }
+private:
+	CComPtr<IDxcIncludeHandler> mDefault;
+	std::set<std::string> mIncludes;
+};
+
+static std::vector<std::wstring> BuildArguments(const ShaderJob& job)
+{
+	std::vector<std::wstring> args;
+	args.push_back(Widen(job.source.string()));
+	if (job.entry != "-")
+	{
+		args.push_back(L"-E");
+		args.push_back(Widen(job.entry));
+	}
+	args.push_back(L"-T");
+	args.push_back(Widen(job.profile));
+	args.push_back(L"-I");
+	args.push_back(Widen(job.source.parent_path().string()));
+	args.push_back(L"-O3");
+	args.push_back(L"-Qstrip_debug");
+	// Reflection ships as a separate .refl blob, the runtime object stays lean
+	args.push_back(L"-Qstrip_reflection");
+	for (const auto& define : job.defines)
+	{
+		args.push_back(L"-D");
+		args.push_back(Widen(define));
+	}
+	return args;
+}
+
+static uint64_t OptionsHash(const ShaderJob& job)
+{
+	uint64_t hash = HashString(std::to_string(ToolVersion));
+	for (const auto& arg : BuildArguments(job))
+	{
+		hash = HashString(Narrow(arg.c_str()), hash);
+	}
+	return hash;
+}
+
+static int64_t FileStamp(const std::string& path)
+{
+	std::error_code ec;
+	auto time = fs::last_write_time(path, ec);
+	return ec ? -1 : int64_t(time.time_since_epoch().count());
+}
+
+static bool IsUpToDate(const ShaderJob& job, const fs::path& outDir)
+{
+	std::ifstream deps(outDir / (job.name + ".deps"));
+	if (!deps.good() || !fs::exists(outDir / (job.name + ".dxil")) || !fs::exists(outDir / (job.name + ".refl")) ||
+		!fs::exists(outDir / (job.name + ".stats")))
+	{
+		return false;
+	}
+
+	uint64_t hash = 0;
+	if (!(deps >> hash) || hash != OptionsHash(job))
+	{
+		return false;
+	}
+	int64_t stamp;
+	std::string path;
+	while (deps >> stamp && std::getline(deps >> std::ws, path))
+	{
+		if (FileStamp(path) != stamp)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void WriteDependencies(const ShaderJob& job, const fs::path& outDir, const std::set<std::string>& includes)
+{
+	std::ofstream deps(outDir / (job.name + ".deps"));
+	deps << OptionsHash(job) << "\n";
+	std::string source = fs::absolute(job.source).lexically_normal().string();
+	deps << FileStamp(source) << " " << source << "\n";
+	for (const auto& include : includes)
+	{
+		if (include != source)
+		{
+			deps << FileStamp(include) << " " << include << "\n";
+		}
+	}
+}
+
+static bool WriteBlob(const fs::path& path, IDxcBlob* blob)
+{
+	std::ofstream file(path, std::ios::binary);
+	file.write(static_cast<const char*>(blob->GetBufferPointer()), blob->GetBufferSize());
+	return file.good();
+}
+
+static const char* InputTypeName(D3D_SHADER_INPUT_TYPE type)
+{
+	switch (type)
+	{
+	case D3D_SIT_CBUFFER: return "cbuffer";
+	case D3D_SIT_TBUFFER: return "tbuffer";
+	case D3D_SIT_TEXTURE: return "texture";
+	case D3D_SIT_SAMPLER: return "sampler";
+	case D3D_SIT_UAV_RWTYPED: return "rwtexture";
+	case D3D_SIT_STRUCTURED: return "structured";
+	case D3D_SIT_UAV_RWSTRUCTURED: return "rwstructured";
+	case D3D_SIT_BYTEADDRESS: return "byteaddress";
+	case D3D_SIT_UAV_RWBYTEADDRESS: return "rwbyteaddress";
+	case D3D_SIT_RTACCELERATIONSTRUCTURE: return "accelerationstructure";
+	default: return "other";
+	}
+}
+
+template <class Reflection>
+static void WriteBindings(std::ostream& out, Reflection* reflection, UINT boundResources, UINT constantBuffers)
+{
+	out << "  \"bindings\": [\n";
+	for (UINT i = 0; i < boundResources; i++)
+	{
+		D3D12_SHADER_INPUT_BIND_DESC bind;
+		reflection->GetResourceBindingDesc(i, &bind);
+		out << "    { \"name\": \"" << bind.Name << "\", \"type\": \"" << InputTypeName(bind.Type)
+			<< "\", \"register\": " << bind.BindPoint << ", \"space\": " << bind.Space
+			<< ", \"count\": " << bind.BindCount << " }" << (i + 1 < boundResources ? "," : "") << "\n";
+	}
+	out << "  ],\n  \"cbuffers\": [\n";
+	for (UINT i = 0; i < constantBuffers; i++)
+	{
+		ID3D12ShaderReflectionConstantBuffer* cb = reflection->GetConstantBufferByIndex(i);
+		D3D12_SHADER_BUFFER_DESC cbDesc;
+		cb->GetDesc(&cbDesc);
+		out << "    { \"name\": \"" << cbDesc.Name << "\", \"size\": " << cbDesc.Size << ", \"variables\": [";
+		for (UINT v = 0; v < cbDesc.Variables; v++)
+		{
+			D3D12_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+			out << (v ? ", " : " ") << "{ \"name\": \"" << varDesc.Name << "\", \"offset\": " << varDesc.StartOffset
+				<< ", \"size\": " << varDesc.Size << " }";
+		}
+		out << " ] }" << (i + 1 < constantBuffers ? "," : "") << "\n";
+	}
+	out << "  ]";
+}
+
+// Human readable summary of the reflection blob, for diffing and for tools that do not link dxcompiler
+static bool WriteReflectionMetadata(IDxcUtils* utils, const ShaderJob& job, IDxcBlob* reflectionBlob, const fs::path& path)
+{
+	DxcBuffer buffer = { reflectionBlob->GetBufferPointer(), reflectionBlob->GetBufferSize(), 0 };
+	std::ofstream out(path);
+	out << "{\n  \"name\": \"" << job.name << "\",\n  \"profile\": \"" << job.profile << "\",\n";
+
+	if (job.profile.compare(0, 3, "lib") == 0)
+	{
+		CComPtr<ID3D12LibraryReflection> library;
+		if (FAILED(utils->CreateReflection(&buffer, IID_PPV_ARGS(&library))))
+		{
+			return false;
+		}
+		D3D12_LIBRARY_DESC libDesc;
+		library->GetDesc(&libDesc);
+		out << "  \"functions\": [\n";
+		for (UINT i = 0; i < libDesc.FunctionCount; i++)
+		{
+			ID3D12FunctionReflection* function = library->GetFunctionByIndex(int(i));
+			D3D12_FUNCTION_DESC funcDesc;
+			function->GetDesc(&funcDesc);
+			out << "  {\n  \"name\": \"" << funcDesc.Name << "\",\n";
+			WriteBindings(out, function, funcDesc.BoundResources, funcDesc.ConstantBuffers);
+			out << "\n  }" << (i + 1 < libDesc.FunctionCount ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+		return out.good();
+	}
+
+	CComPtr<ID3D12ShaderReflection> reflection;
+	if (FAILED(utils->CreateReflection(&buffer, IID_PPV_ARGS(&reflection))))
+	{
+		return false;
+	}
+	D3D12_SHADER_DESC shaderDesc;
+	reflection->GetDesc(&shaderDesc);
+	out << "  \"inputs\": [";
+	for (UINT i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D12_SIGNATURE_PARAMETER_DESC param;
+		reflection->GetInputParameterDesc(i, &param);
+		out << (i ? ", " : " ") << "{ \"semantic\": \"" << param.SemanticName << "\", \"index\": " << param.SemanticIndex
+			<< ", \"mask\": " << int(param.Mask) << " }";
+	}
+	out << " ],\n";
+	WriteBindings(out, reflection.p, shaderDesc.BoundResources, shaderDesc.ConstantBuffers);
+	out << "\n}\n";
+	return out.good();
+}
+
+// Cost statistics taken from the DXIL disassembly, in the column order of ShaderBudgets.txt
+enum ShaderStat
+{
+	StatInstructions,
+	StatTextureOps,
+	StatCBufferLoads,
+	StatScratchAllocs,
+	StatCount
+};
+static const char* const kStatNames[StatCount] = { "instructions", "texture_ops", "cbuffer_loads", "scratch_allocs" };
+
+// Headroom for instruction counts that shift with the compiler version: 10%, and at least 4
+static uint32_t BudgetMargin(uint32_t instructions)
+{
+	return instructions / 10 > 4 ? instructions / 10 : 4;
+}
+
+struct ShaderStats
+{
+	uint32_t values[StatCount] = {};
+};
+
+static ShaderStats CountStats(const std::string& disassembly)
+{
+	ShaderStats stats;
+	std::istringstream lines(disassembly);
+	std::string line;
+	bool inFunction = false;
+	while (std::getline(lines, line))
+	{
+		if (line.compare(0, 7, "define ") == 0)
+		{
+			inFunction = true;
+			continue;
+		}
+		if (!inFunction)
+		{
+			continue;
+		}
+		if (line == "}")
+		{
+			inFunction = false;
+			continue;
+		}
+
+		size_t first = line.find_first_not_of(" \t");
+		if (first == std::string::npos || line[first] == ';' || line.back() == ':' || line.find(": ;") != std::string::npos)
+		{
+			// Blank lines, comments and basic block labels
+			continue;
+		}
+		stats.values[StatInstructions]++;
+		if (line.find("@dx.op.sample") != std::string::npos ||
+			line.find("@dx.op.textureLoad") != std::string::npos ||
+			line.find("@dx.op.textureGather") != std::string::npos)
+		{
+			stats.values[StatTextureOps]++;
+		}
+		if (line.find("@dx.op.cbufferLoad") != std::string::npos)
+		{
+			stats.values[StatCBufferLoads]++;
+		}
+		if (line.find(" alloca ") != std::string::npos)
+		{
+			stats.values[StatScratchAllocs]++;
+		}
+	}
+	return stats;
+}
+
+static bool WriteStats(IDxcCompiler3* compiler, const ShaderJob& job, IDxcBlob* object, const fs::path& path)
+{
+	DxcBuffer buffer = { object->GetBufferPointer(), object->GetBufferSize(), 0 };
+	CComPtr<IDxcResult> result;
+	CComPtr<IDxcBlobUtf8> disassembly;
+	if (FAILED(compiler->Disassemble(&buffer, IID_PPV_ARGS(&result))) ||
+		FAILED(result->GetOutput(DXC_OUT_DISASSEMBLY, IID_PPV_ARGS(&disassembly), nullptr)) || !disassembly)
+	{
+		fprintf(stderr, "%s: cannot disassemble\n", job.name.c_str());
+		return false;
+	}
+
+	ShaderStats stats = CountStats(std::string(disassembly->GetStringPointer(), disassembly->GetStringLength()));
+	std::ofstream out(path);
+	for (int i = 0; i < StatCount; i++)
+	{
+		out << kStatNames[i] << " " << stats.values[i] << "\n";
+	}
+	return out.good();
+}
+
+static bool ReadStats(const fs::path& path, ShaderStats& stats)
+{
+	std::ifstream in(path);
+	std::string name;
+	uint32_t value;
+	int found = 0;
+	while (in >> name >> value)
+	{
+		for (int i = 0; i < StatCount; i++)
+		{
+			if (name == kStatNames[i])
+			{
+				stats.values[i] = value;
+				found++;
+			}
+		}
+	}
+	return found == StatCount;
+}
+
+static bool ReadBudgets(const std::string& path, std::vector<std::pair<std::string, ShaderStats>>& budgets)
+{
+	std::ifstream in(path);
+	if (!in.good())
+	{
+		fprintf(stderr, "cannot open budgets '%s'\n", path.c_str());
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line))
+	{
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.resize(comment);
+		}
+		std::istringstream tokens(line);
+		std::pair<std::string, ShaderStats> budget;
+		if (!(tokens >> budget.first))
+		{
+			continue;
+		}
+		for (int i = 0; i < StatCount; i++)
+		{
+			if (!(tokens >> budget.second.values[i]))
+			{
+				fprintf(stderr, "%s: '%s' needs %d budget values\n", path.c_str(), budget.first.c_str(), int(StatCount));
+				return false;
+			}
+		}
+		budgets.push_back(budget);
+	}
+	return true;
+}
+
+static bool WriteBudgets(const std::vector<ShaderJob>& jobs, const fs::path& outDir, const std::string& path)
+{
+	std::ofstream out(path);
+	out << "# Per-shader cost budgets checked by ShaderBuild --budgets. Written by ShaderBuild --write-budgets from the\n";
+	out << "# DXIL disassembly of a DXC build; instructions carry a margin of 10% (at least 4), the other counts are exact.\n";
+	out << "# name";
+	for (int i = 0; i < StatCount; i++)
+	{
+		out << " " << kStatNames[i];
+	}
+	out << "\n";
+	for (const auto& job : jobs)
+	{
+		ShaderStats stats;
+		if (!ReadStats(outDir / (job.name + ".stats"), stats))
+		{
+			fprintf(stderr, "%s: missing statistics\n", job.name.c_str());
+			return false;
+		}
+		stats.values[StatInstructions] += BudgetMargin(stats.values[StatInstructions]);
+		out << job.name;
+		for (int i = 0; i < StatCount; i++)
+		{
+			out << " " << stats.values[i];
+		}
+		out << "\n";
+	}
+	return out.good();
+}
+
+// Returns the number of shaders over budget, or -1 when the check itself could not run
+static int CheckBudgets(const std::vector<ShaderJob>& jobs, const fs::path& outDir, const std::string& path)
+{
+	std::vector<std::pair<std::string, ShaderStats>> budgets;
+	if (!ReadBudgets(path, budgets))
+	{
+		return -1;
+	}
+
+	int overBudget = 0;
+	for (const auto& job : jobs)
+	{
+		ShaderStats stats;
+		if (!ReadStats(outDir / (job.name + ".stats"), stats))
+		{
+			fprintf(stderr, "%s: missing statistics\n", job.name.c_str());
+			return -1;
+		}
+
+		auto budget = std::find_if(budgets.begin(), budgets.end(), [&](const std::pair<std::string, ShaderStats>& b) { return b.first == job.name; });
+		if (budget == budgets.end())
+		{
+			fprintf(stderr, "%s: no budget in %s\n", job.name.c_str(), path.c_str());
+			overBudget++;
+			continue;
+		}
+		for (int i = 0; i < StatCount; i++)
+		{
+			if (stats.values[i] > budget->second.values[i])
+			{
+				fprintf(stderr, "%s: %s %u exceeds budget %u\n", job.name.c_str(), kStatNames[i], stats.values[i], budget->second.values[i]);
+				overBudget++;
+			}
+		}
+	}
+	return overBudget;
+}
+
+static bool Compile(IDxcUtils* utils, IDxcCompiler3* compiler, const ShaderJob& job, const fs::path& outDir)
+{
+	CComPtr<IDxcBlobEncoding> source;
+	if (FAILED(utils->LoadFile(Widen(job.source.string()).c_str(), nullptr, &source)))
+	{
+		fprintf(stderr, "%s: cannot read source\n", job.source.string().c_str());
+		return false;
+	}
+	DxcBuffer sourceBuffer = { source->GetBufferPointer(), source->GetBufferSize(), DXC_CP_ACP };
+
+	std::vector<std::wstring> args = BuildArguments(job);
+	std::vector<LPCWSTR> argPtrs;
+	for (const auto& arg : args)
+	{
+		argPtrs.push_back(arg.c_str());
+	}
+
+	DependencyIncludeHandler includeHandler(utils);
+	CComPtr<IDxcResult> result;
+	if (FAILED(compiler->Compile(&sourceBuffer, argPtrs.data(), UINT32(argPtrs.size()), &includeHandler, IID_PPV_ARGS(&result))))
+	{
+		fprintf(stderr, "%s: compiler invocation failed\n", job.name.c_str());
+		return false;
+	}
+
+	CComPtr<IDxcBlobUtf8> errors;
+	result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr);
+	if (errors && errors->GetStringLength() > 0)
+	{
+		fprintf(stderr, "%s", errors->GetStringPointer());
+	}
+
+	HRESULT status;
+	result->GetStatus(&status);
+	if (FAILED(status))
+	{
+		return false;
+	}
+
+	CComPtr<IDxcBlob> object;
+	CComPtr<IDxcBlob> reflection;
+	result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr);
+	result->GetOutput(DXC_OUT_REFLECTION, IID_PPV_ARGS(&reflection), nullptr);
+	if (!object || !reflection)
+	{
+		fprintf(stderr, "%s: compiler produced no object or reflection\n", job.name.c_str());
+		return false;
+	}
+
+	if (!WriteBlob(outDir / (job.name + ".dxil"), object) ||
+		!WriteBlob(outDir / (job.name + ".refl"), reflection) ||
+		!WriteReflectionMetadata(utils, job, reflection, outDir / (job.name + ".reflection.json")) ||
+		!WriteStats(compiler, job, object, outDir / (job.name + ".stats")))
+	{
+		fprintf(stderr, "%s: cannot write outputs\n", job.name.c_str());
+		return false;
+	}
+
+	WriteDependencies(job, outDir, includeHandler.GetIncludes());
+	return true;
+}
+
+static bool Pack(const std::vector<ShaderJob>& jobs, const fs::path& outDir, const std::string& packPath)
+{
+	ShaderArchiveWriter writer;
+	for (const auto& job : jobs)
+	{
+		std::vector<uint8_t> object;
+		std::vector<uint8_t> reflection;
+		if (!ReadWholeFile((outDir / (job.name + ".dxil")).string(), object) ||
+			!ReadWholeFile((outDir / (job.name + ".refl")).string(), reflection))
+		{
+			fprintf(stderr, "%s: missing build outputs\n", job.name.c_str());
+			return false;
+		}
+		if (!writer.Add(job.name, std::move(object)) || !writer.Add(job.name + ".refl", std::move(reflection)))
+		{
+			return false;
+		}
+	}
+	return writer.Write(packPath);
+}
+
+int main(int argc, char** argv)
+{
+	setlocale(LC_ALL, "");
+
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <manifest> <output dir> [--pack <Shaders.pak>] [--budgets <file> | --write-budgets <file>] [--force]\n", argv[0]);
+		return 1;
+	}
+
+	fs::path manifest = argv[1];
+	fs::path outDir = argv[2];
+	std::string packPath;
+	std::string budgetPath;
+	std::string writeBudgetPath;
+	bool force = false;
+	for (int i = 3; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--pack" && i + 1 < argc)
+		{
+			packPath = argv[++i];
+		}
+		else if (arg == "--budgets" && i + 1 < argc)
+		{
+			budgetPath = argv[++i];
+		}
+		else if (arg == "--write-budgets" && i + 1 < argc)
+		{
+			writeBudgetPath = argv[++i];
+		}
+		else if (arg == "--force")
+		{
+			force = true;
+		}
+		else
+		{
+			fprintf(stderr, "unknown option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<ShaderJob> jobs;
+	if (!ParseManifest(manifest, jobs))
+	{
+		return 1;
+	}
+	fs::create_directories(outDir);
+
+	CComPtr<IDxcUtils> utils;
+	CComPtr<IDxcCompiler3> compiler;
+	if (FAILED(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils))) ||
+		FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))))
+	{
+		fprintf(stderr, "cannot load libdxcompiler\n");
+		return 1;
+	}
+
+	int compiled = 0;
+	int failed = 0;
+	for (const auto& job : jobs)
+	{
+		if (!force && IsUpToDate(job, outDir))
+		{
+			continue;
+		}
+		printf("%s (%s)\n", job.name.c_str(), job.profile.c_str());
+		if (Compile(utils, compiler, job, outDir))
+		{
+			compiled++;
+		}
+		else
+		{
+			failed++;
+		}
+	}
+	printf("%d compiled, %d up to date, %d failed\n", compiled, int(jobs.size()) - compiled - failed, failed);
+	if (failed)
+	{
+		return 1;
+	}
+
+	if (!packPath.empty() && (compiled > 0 || FileStamp(packPath) < FileStamp(manifest.string())))
+	{
+		if (!Pack(jobs, outDir, packPath))
+		{
+			return 1;
+		}
+		printf("%s: %d shaders\n", packPath.c_str(), int(jobs.size()));
+	}
+
+	if (!writeBudgetPath.empty() && !WriteBudgets(jobs, outDir, writeBudgetPath))
+	{
+		return 1;
+	}
+	if (!budgetPath.empty())
+	{
+		int overBudget = CheckBudgets(jobs, outDir, budgetPath);
+		if (overBudget < 0)
+		{
+			return 1;
+		}
+		if (overBudget > 0)
+		{
+			fprintf(stderr, "%d shader budget violations\n", overBudget);
+			return 2;
+		}
+		printf("all shaders within budget\n");
+	}
+	return 0;
+}
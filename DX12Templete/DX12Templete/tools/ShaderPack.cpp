@@ -0,0 +1,51 @@
+// Packs compiled shader objects into a single Shaders.pak.
+//
+//   g++ -std=c++17 -O2 ShaderPack.cpp -o ShaderPack
+//   ./ShaderPack Shaders.pak VertexShader.cso PixelShader.cso ...
+//
+// Each blob is stored under its file name without directory or extension,
+// which is the name DX12Renderer::LoadShader looks up.
+#include "ShaderArchiveWriter.h"
+
+static std::string ShaderNameFromPath(const std::string& path)
+{
+	size_t begin = path.find_last_of("/\\");
+	begin = (begin == std::string::npos) ? 0 : begin + 1;
+	size_t end = path.find_last_of('.');
+	if (end == std::string::npos || end < begin)
+	{
+		end = path.size();
+	}
+	return path.substr(begin, end - begin);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <output.pak> <shader.cso>...\n", argv[0]);
+		return 1;
+	}
+
+	ShaderArchiveWriter writer;
+	for (int i = 2; i < argc; i++)
+	{
+		std::vector<uint8_t> blob;
+		if (!ReadWholeFile(argv[i], blob))
+		{
+			fprintf(stderr, "cannot read '%s'\n", argv[i]);
+			return 1;
+		}
+		if (!writer.Add(ShaderNameFromPath(argv[i]), std::move(blob)))
+		{
+			return 1;
+		}
+	}
+
+	if (!writer.Write(argv[1]))
+	{
+		return 1;
+	}
+	printf("%s: %d shaders\n", argv[1], argc - 2);
+	return 0;
+}
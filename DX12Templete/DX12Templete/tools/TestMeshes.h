@@ -0,0 +1,46 @@
+// Meshes and timing shared by the check and bench tools
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct Vertex
+{
+	float position[3];
+	float color[4];
+};
+
+// Ring torus around the y axis, radii 3 and 1, wrapped without seam vertices and clockwise seen from
+// outside. ripple bumps the minor radius twelve times around the ring so simplifiers have detail to lose.
+inline void MakeTorus(int rings, int sides, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float ripple = 0.0f)
+{
+	const float pi = 3.14159265f;
+	for (int r = 0; r < rings; r++)
+	{
+		for (int s = 0; s < sides; s++)
+		{
+			float u = 2.0f * pi * r / rings;
+			float v = 2.0f * pi * s / sides;
+			float minor = 1.0f + ripple * std::sin(u * 12.0f);
+			vertices.push_back({ { (3.0f + minor * std::cos(v)) * std::cos(u), minor * std::sin(v), (3.0f + minor * std::cos(v)) * std::sin(u) }, { 1, 1, 1, 1 } });
+		}
+	}
+	for (int r = 0; r < rings; r++)
+	{
+		for (int s = 0; s < sides; s++)
+		{
+			uint32_t a = r * sides + s;
+			uint32_t b = ((r + 1) % rings) * sides + s;
+			uint32_t c = ((r + 1) % rings) * sides + (s + 1) % sides;
+			uint32_t d = r * sides + (s + 1) % sides;
+			uint32_t quad[6] = { a, b, c, a, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+inline double Milliseconds(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
@@ -0,0 +1,526 @@
+// Compresses synthetic textures to every block format, decodes them again and checks the quality,
+// the mip chain and the .dds container, then times the encoders.
+//
+//   g++ -std=c++17 -O2 -pthread TextureCheck.cpp ../src/TextureData.cpp ../src/BlockCompression.cpp ../src/JobSystem.cpp -o TextureCheck
+//   ./TextureCheck [size=512]
+//
+// Every kernel must write the same bytes, with or without jobs. Decoded images must reach a minimum
+// PSNR per format and content, BC7 must beat BC1, solid blocks must come back within the endpoint
+// precision, and BC1 must keep the punch-through alpha of every texel. Mips must halve down to 1x1,
+// average in linear light for sRGB and ignore the colour of transparent texels. A .dds image must
+// read back to what was written, and every truncated or damaged header must be refused.
+#include "../src/TextureData.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace DdsFormat;
+
+static int failures = 0;
+
+// The generators work in texels, not in fractions of the image, so every size sees the same detail
+// and the quality floors hold for all of them
+static constexpr float FeatureScale = 512.0f;
+
+static double Seconds(Clock::time_point begin)
+{
+	return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+static RgbaImage MakeImage(uint32_t width, uint32_t height)
+{
+	RgbaImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(size_t(width) * height * 4);
+	return image;
+}
+
+// Smooth colour fields with a few hard edges, like albedo
+static RgbaImage MakeAlbedo(uint32_t size)
+{
+	RgbaImage image = MakeImage(size, size);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			float u = x / FeatureScale;
+			float v = y / FeatureScale;
+			uint8_t* texel = &image.pixels[(size_t(y) * size + x) * 4];
+			bool tile = ((x / 64) + (y / 64)) % 2 == 0;
+			texel[0] = uint8_t(127.5f + 127.5f * std::sin(u * 9.0f + v * 2.0f));
+			texel[1] = uint8_t(tile ? 200.0f * (v - std::floor(v)) : 40.0f + 100.0f * (u - std::floor(u)));
+			texel[2] = uint8_t(127.5f + 127.5f * std::cos(v * 7.0f - u * 3.0f));
+			texel[3] = 255;
+		}
+	}
+	return image;
+}
+
+// Noise on top of a gradient, the worst case for a two-endpoint palette
+static RgbaImage MakeNoise(uint32_t size, std::mt19937& random)
+{
+	RgbaImage image = MakeImage(size, size);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			uint8_t* texel = &image.pixels[(size_t(y) * size + x) * 4];
+			for (int c = 0; c < 3; c++)
+			{
+				texel[c] = uint8_t(std::min(255u, x % 512 * 200 / 512 + uint32_t(random() % 56)));
+			}
+			texel[3] = 255;
+		}
+	}
+	return image;
+}
+
+// Leaves with cut-out edges and a soft alpha fade, one every 128 texels
+static RgbaImage MakeFoliage(uint32_t size)
+{
+	RgbaImage image = MakeImage(size, size);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			float u = float(x % 128) / 64.0f - 1.0f;
+			float v = float(y % 128) / 64.0f - 1.0f;
+			float radius = std::sqrt(u * u + v * v);
+			uint8_t* texel = &image.pixels[(size_t(y) * size + x) * 4];
+			texel[0] = uint8_t(40 + 60 * (1.0f - radius * 0.5f));
+			texel[1] = uint8_t(std::min(255.0f, 120 + 120 * std::fabs(std::sin(u * 12.0f))));
+			texel[2] = 30;
+			texel[3] = uint8_t(radius > 0.9f ? 0 : std::min(255.0f, (0.9f - radius) * 2000.0f));
+		}
+	}
+	return image;
+}
+
+// Tangent-space normals of a field of bumps, XY in red and green
+static RgbaImage MakeNormals(uint32_t size)
+{
+	RgbaImage image = MakeImage(size, size);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			float u = x / FeatureScale * 6.2831853f * 4.0f;
+			float v = y / FeatureScale * 6.2831853f * 4.0f;
+			float nx = -0.5f * std::cos(u) * std::sin(v);
+			float ny = -0.5f * std::sin(u) * std::cos(v);
+			float length = std::sqrt(nx * nx + ny * ny + 1.0f);
+			uint8_t* texel = &image.pixels[(size_t(y) * size + x) * 4];
+			texel[0] = uint8_t(std::lround((nx / length * 0.5f + 0.5f) * 255.0f));
+			texel[1] = uint8_t(std::lround((ny / length * 0.5f + 0.5f) * 255.0f));
+			texel[2] = uint8_t(std::lround((1.0f / length * 0.5f + 0.5f) * 255.0f));
+			texel[3] = 255;
+		}
+	}
+	return image;
+}
+
+// PSNR over the given channels; 100 for an exact match
+static double Psnr(const RgbaImage& a, const std::vector<uint8_t>& b, uint32_t channelMask)
+{
+	double error = 0.0;
+	size_t count = 0;
+	for (size_t i = 0; i < a.pixels.size(); i++)
+	{
+		if (channelMask & (1u << (i % 4)))
+		{
+			double d = double(a.pixels[i]) - b[i];
+			error += d * d;
+			count++;
+		}
+	}
+	return error == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / (error / count));
+}
+
+static std::vector<uint8_t> Compress(const BlockCompressor& compressor, BlockFormat format, const RgbaImage& image, JobSystem* jobs = nullptr)
+{
+	std::vector<uint8_t> blocks(size_t(GetBlockCount(image.width)) * GetBlockCount(image.height) * GetBlockBytes(format));
+	compressor.CompressImage(format, image.pixels.data(), image.width, image.height, size_t(image.width) * 4, blocks.data(), jobs);
+	return blocks;
+}
+
+static std::vector<uint8_t> Decompress(BlockFormat format, const std::vector<uint8_t>& blocks, const RgbaImage& image)
+{
+	std::vector<uint8_t> decoded(image.pixels.size());
+	if (!DecompressImage(format, blocks.data(), image.width, image.height, decoded.data(), size_t(image.width) * 4))
+	{
+		printf("%s: a block does not decode\n", GetBlockFormatName(format));
+		failures++;
+	}
+	return decoded;
+}
+
+struct QualityCase
+{
+	const char* name;
+	const RgbaImage* image;
+	BlockFormat format;
+	uint32_t channels;  // bit per channel compared
+	double minimum;     // dB
+};
+
+static void CheckKernelsAgree(const RgbaImage& image, JobSystem& jobs)
+{
+	BlockCompressor scalar;
+	scalar.SetKernel(BlockCompressor::Kernel::Scalar);
+	BlockCompressor simd;
+	for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 })
+	{
+		std::vector<uint8_t> reference = Compress(scalar, format, image);
+		if (Compress(simd, format, image) != reference || Compress(simd, format, image, &jobs) != reference)
+		{
+			printf("%s: the %s kernel or the job split writes different blocks than the scalar kernel\n",
+				GetBlockFormatName(format), BlockCompressor::GetKernelName(simd.GetKernel()));
+			failures++;
+		}
+	}
+}
+
+static void CheckSolidBlocks(const BlockCompressor& compressor, std::mt19937& random)
+{
+	// One colour per block must come back within what the endpoints can hold: 565 for BC1 and BC3,
+	// 7 bits plus a p-bit for BC7, exact for the single-channel blocks
+	int worst[4] = {};
+	const BlockFormat formats[4] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 };
+	const int limits[4] = { 8, 8, 0, 2 };
+	for (int trial = 0; trial < 2000; trial++)
+	{
+		uint8_t texels[BlockTexels * 4];
+		uint8_t color[4] = { uint8_t(random()), uint8_t(random()), uint8_t(random()), uint8_t(random()) };
+		for (size_t i = 0; i < BlockTexels; i++)
+		{
+			memcpy(texels + i * 4, color, 4);
+			texels[i * 4 + 3] = 255;
+		}
+		for (int f = 0; f < 4; f++)
+		{
+			uint8_t block[16];
+			uint8_t decoded[BlockTexels * 4];
+			compressor.EncodeBlock(formats[f], texels, block);
+			DecodeBlock(formats[f], block, decoded);
+			uint32_t channels = formats[f] == BlockFormat::BC5 ? 2 : 4;
+			for (size_t i = 0; i < BlockTexels * 4; i++)
+			{
+				if (i % 4 < channels)
+				{
+					worst[f] = std::max(worst[f], std::abs(int(decoded[i]) - int(texels[i])));
+				}
+			}
+		}
+	}
+	for (int f = 0; f < 4; f++)
+	{
+		if (worst[f] > limits[f])
+		{
+			printf("%s: a solid block comes back %d off, limit %d\n", GetBlockFormatName(formats[f]), worst[f], limits[f]);
+			failures++;
+		}
+	}
+}
+
+static void CheckPunchThrough(const BlockCompressor& compressor, const RgbaImage& foliage)
+{
+	std::vector<uint8_t> decoded = Decompress(BlockFormat::BC1, Compress(compressor, BlockFormat::BC1, foliage), foliage);
+	size_t wrong = 0;
+	for (size_t i = 3; i < decoded.size(); i += 4)
+	{
+		if (decoded[i] != (foliage.pixels[i] < 128 ? 0 : 255))
+		{
+			wrong++;
+		}
+	}
+	if (wrong > 0)
+	{
+		printf("BC1: %zu texels lost their cut-out alpha\n", wrong);
+		failures++;
+	}
+}
+
+static void CheckMips()
+{
+	// An odd size must halve to 1x1 without dropping rows or columns
+	RgbaImage odd = MakeImage(12, 5);
+	std::fill(odd.pixels.begin(), odd.pixels.end(), 255);
+	std::vector<RgbaImage> chain;
+	GenerateMipChain(odd, false, chain);
+	const uint32_t expected[][2] = { { 12, 5 }, { 6, 2 }, { 3, 1 }, { 1, 1 } };
+	bool sizes = chain.size() == 4 && GetMipCount(12, 5) == 4;
+	for (size_t level = 0; sizes && level < chain.size(); level++)
+	{
+		sizes = chain[level].width == expected[level][0] && chain[level].height == expected[level][1] &&
+			std::all_of(chain[level].pixels.begin(), chain[level].pixels.end(), [](uint8_t v) { return v == 255; });
+	}
+	if (!sizes)
+	{
+		printf("mips: a 12x5 white image does not halve to white 6x2, 3x1 and 1x1\n");
+		failures++;
+	}
+
+	// Black and white average to mid grey in linear light, which is 188 in sRGB
+	RgbaImage checker = MakeImage(2, 2);
+	for (size_t i = 0; i < 4; i++)
+	{
+		uint8_t value = (i == 0 || i == 3) ? 255 : 0;
+		memset(&checker.pixels[i * 4], value, 3);
+		checker.pixels[i * 4 + 3] = 255;
+	}
+	GenerateMipChain(checker, true, chain);
+	int srgbGrey = chain[1].pixels[0];
+	GenerateMipChain(checker, false, chain);
+	int linearGrey = chain[1].pixels[0];
+	if (std::abs(srgbGrey - 188) > 1 || std::abs(linearGrey - 128) > 1)
+	{
+		printf("mips: a black and white checker averages to %d in sRGB and %d in linear, expected 188 and 128\n", srgbGrey, linearGrey);
+		failures++;
+	}
+
+	// Transparent red next to opaque green must not turn the edge brown
+	RgbaImage edge = MakeImage(2, 2);
+	for (size_t i = 0; i < 4; i++)
+	{
+		uint8_t* texel = &edge.pixels[i * 4];
+		bool opaque = i % 2 == 0;
+		texel[0] = opaque ? 0 : 255;
+		texel[1] = opaque ? 255 : 0;
+		texel[2] = 0;
+		texel[3] = opaque ? 255 : 0;
+	}
+	GenerateMipChain(edge, false, chain);
+	const uint8_t* mixed = chain[1].pixels.data();
+	if (mixed[0] != 0 || mixed[1] != 255 || std::abs(int(mixed[3]) - 128) > 1)
+	{
+		printf("mips: transparent red beside opaque green averages to %u %u %u %u\n", mixed[0], mixed[1], mixed[2], mixed[3]);
+		failures++;
+	}
+}
+
+static bool SameView(const TextureView& a, const TextureView& b)
+{
+	if (a.format != b.format || a.srgb != b.srgb || a.dxgiFormat != b.dxgiFormat || a.width != b.width ||
+		a.height != b.height || a.mipCount != b.mipCount)
+	{
+		return false;
+	}
+	for (uint32_t level = 0; level < a.mipCount; level++)
+	{
+		const TextureMip& x = a.mips[level];
+		const TextureMip& y = b.mips[level];
+		if (x.width != y.width || x.height != y.height || x.rowPitch != y.rowPitch || x.rowCount != y.rowCount ||
+			x.size != y.size || memcmp(x.data, y.data, size_t(x.size)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void CheckContainer(const BlockCompressor& compressor, const RgbaImage& albedo, JobSystem& jobs)
+{
+	// 36x20 keeps every mip small and has partial blocks from the third level on
+	RgbaImage small = MakeImage(36, 20);
+	for (uint32_t y = 0; y < small.height; y++)
+	{
+		memcpy(&small.pixels[size_t(y) * small.width * 4], &albedo.pixels[size_t(y) * albedo.width * 4], size_t(small.width) * 4);
+	}
+	for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 })
+	{
+		TextureData texture;
+		if (!BuildTextureData(small, format, true, 0, compressor, texture, &jobs))
+		{
+			printf("%s: a 36x20 texture does not build\n", GetBlockFormatName(format));
+			failures++;
+			continue;
+		}
+		TextureView written = texture.GetView();
+		std::vector<uint8_t> image;
+		WriteDdsTexture(written, image);
+		TextureView read;
+		if (written.mipCount != 6 || !ReadDdsTexture(image.data(), image.size(), &read) || !SameView(written, read))
+		{
+			printf("%s: the .dds image does not read back as written\n", GetBlockFormatName(format));
+			failures++;
+			continue;
+		}
+
+		for (size_t size = 0; size < image.size(); size++)
+		{
+			if (ReadDdsTexture(image.data(), size, &read))
+			{
+				printf("%s: a .dds image truncated to %zu of %zu bytes reads\n", GetBlockFormatName(format), size, image.size());
+				failures++;
+				break;
+			}
+		}
+		// Extra bytes after the last mip mean the header describes something else
+		std::vector<uint8_t> longer = image;
+		longer.push_back(0);
+		if (ReadDdsTexture(longer.data(), longer.size(), &read))
+		{
+			printf("%s: a .dds image with a trailing byte reads\n", GetBlockFormatName(format));
+			failures++;
+		}
+
+		// Every damaged header field must be refused, or still describe mips that fill the file exactly
+		size_t headerBytes = sizeof(Magic) + sizeof(Header) + sizeof(HeaderDxt10);
+		for (size_t byte = 0; byte < headerBytes; byte++)
+		{
+			for (uint8_t flip : { uint8_t(0x01), uint8_t(0x10), uint8_t(0x80) })
+			{
+				std::vector<uint8_t> damaged = image;
+				damaged[byte] ^= flip;
+				if (!ReadDdsTexture(damaged.data(), damaged.size(), &read))
+				{
+					continue;
+				}
+				uint64_t end = 0;
+				for (uint32_t level = 0; level < read.mipCount; level++)
+				{
+					const TextureMip& mip = read.mips[level];
+					uint64_t offset = uint64_t(mip.data - damaged.data());
+					if (mip.data < damaged.data() || offset + mip.size > damaged.size() || mip.size != uint64_t(mip.rowPitch) * mip.rowCount)
+					{
+						end = UINT64_MAX;
+						break;
+					}
+					end = offset + mip.size;
+				}
+				if (end != damaged.size())
+				{
+					printf("%s: flipping %02x in header byte %zu gives a view outside the image\n", GetBlockFormatName(format), flip, byte);
+					failures++;
+				}
+			}
+		}
+	}
+
+	// Legacy FourCC headers from other tools, here DXT5 without the DX10 extension
+	TextureData texture;
+	BuildTextureData(small, BlockFormat::BC3, false, 1, compressor, texture);
+	TextureView written = texture.GetView();
+	std::vector<uint8_t> image;
+	WriteDdsTexture(written, image);
+	Header header;
+	memcpy(&header, image.data() + sizeof(Magic), sizeof(header));
+	header.pixelFormat.fourCC = Dxt5;
+	header.flags &= ~uint32_t(MipCountFlag);
+	header.mipCount = 0;
+	size_t mipBytes = image.size() - (sizeof(Magic) + sizeof(Header) + sizeof(HeaderDxt10));
+	std::vector<uint8_t> legacy(sizeof(Magic) + sizeof(Header) + mipBytes);
+	memcpy(legacy.data(), &Magic, sizeof(Magic));
+	memcpy(legacy.data() + sizeof(Magic), &header, sizeof(header));
+	memcpy(legacy.data() + sizeof(Magic) + sizeof(Header), image.data() + image.size() - mipBytes, mipBytes);
+	TextureView read;
+	if (!ReadDdsTexture(legacy.data(), legacy.size(), &read) || !SameView(written, read))
+	{
+		printf("BC3: a DXT5 .dds without the DX10 header does not read\n");
+		failures++;
+	}
+
+	// The GPU needs whole blocks at the top
+	RgbaImage unaligned = MakeImage(30, 16);
+	if (BuildTextureData(unaligned, BlockFormat::BC1, false, 0, compressor, texture))
+	{
+		printf("a 30x16 texture builds though its width is not whole blocks\n");
+		failures++;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t size = argc > 1 ? std::max<uint32_t>(16, uint32_t(strtoul(argv[1], nullptr, 10)) / 4 * 4) : 512;
+	std::mt19937 random(49);
+	JobSystem jobs;
+	BlockCompressor compressor;
+
+	RgbaImage albedo = MakeAlbedo(size);
+	RgbaImage noise = MakeNoise(size, random);
+	RgbaImage foliage = MakeFoliage(size);
+	RgbaImage normals = MakeNormals(size);
+
+	for (const RgbaImage* image : { &albedo, &noise, &foliage, &normals })
+	{
+		CheckKernelsAgree(*image, jobs);
+	}
+	CheckSolidBlocks(compressor, random);
+	CheckPunchThrough(compressor, foliage);
+	CheckMips();
+	CheckContainer(compressor, albedo, jobs);
+
+	// Quality floors, well below what the encoders reach so that tuning them does not trip the check
+	const uint32_t Rgb = 7;
+	const uint32_t Rgba = 15;
+	const uint32_t Alpha = 8;
+	const uint32_t Rg = 3;
+	const QualityCase cases[] =
+	{
+		{ "albedo", &albedo, BlockFormat::BC1, Rgb, 40.0 },
+		{ "albedo", &albedo, BlockFormat::BC7, Rgb, 46.0 },
+		{ "noise", &noise, BlockFormat::BC1, Rgb, 25.0 },
+		{ "noise", &noise, BlockFormat::BC7, Rgb, 25.0 },
+		{ "foliage", &foliage, BlockFormat::BC3, Rgba, 37.0 },
+		{ "foliage alpha", &foliage, BlockFormat::BC3, Alpha, 40.0 },
+		{ "foliage", &foliage, BlockFormat::BC7, Rgba, 36.0 },
+		{ "normals", &normals, BlockFormat::BC5, Rg, 54.0 },
+	};
+	double bc1Albedo = 0.0;
+	double bc7Albedo = 0.0;
+	for (const QualityCase& test : cases)
+	{
+		std::vector<uint8_t> decoded = Decompress(test.format, Compress(compressor, test.format, *test.image, &jobs), *test.image);
+		double psnr = Psnr(*test.image, decoded, test.channels);
+		printf("%-14s %s  %.2f dB\n", test.name, GetBlockFormatName(test.format), psnr);
+		if (psnr < test.minimum)
+		{
+			printf("%s %s: %.2f dB is below %.1f dB\n", test.name, GetBlockFormatName(test.format), psnr, test.minimum);
+			failures++;
+		}
+		if (test.image == &albedo)
+		{
+			(test.format == BlockFormat::BC1 ? bc1Albedo : bc7Albedo) = psnr;
+		}
+	}
+	if (bc7Albedo <= bc1Albedo)
+	{
+		printf("BC7 does not beat BC1 on the albedo\n");
+		failures++;
+	}
+
+	// Throughput in source megapixels per second, one thread per kernel and then on every worker
+	printf("%ux%u, %u workers:\n", size, size, jobs.GetWorkerCount());
+	for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 })
+	{
+		printf("  %s", GetBlockFormatName(format));
+		for (BlockCompressor::Kernel kernel : { BlockCompressor::Kernel::Scalar, BlockCompressor::Kernel::Sse2 })
+		{
+			BlockCompressor timed;
+			timed.SetKernel(kernel);
+			if (timed.GetKernel() != kernel)
+			{
+				continue;
+			}
+			Clock::time_point begin = Clock::now();
+			Compress(timed, format, albedo);
+			double single = Seconds(begin);
+			begin = Clock::now();
+			Compress(timed, format, albedo, &jobs);
+			double parallel = Seconds(begin);
+			double megapixels = double(size) * size / 1e6;
+			printf("  %s %.1f MP/s, %.1f MP/s on jobs", BlockCompressor::GetKernelName(kernel), megapixels / single, megapixels / parallel);
+		}
+		printf("\n");
+	}
+
+	printf(failures ? "FAILED\n" : "texture compression checks out\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+// Turns a TGA, PPM or PAM image into a block-compressed .dds texture with its full mip chain.
+//
+//   g++ -std=c++17 -O2 -pthread TextureCompress.cpp ../src/TextureData.cpp ../src/BlockCompression.cpp ../src/JobSystem.cpp -o TextureCompress
+//   ./TextureCompress [--format bc1|bc3|bc5|bc7] [--srgb] [--mips count] input.tga Texture.dds
+//
+// BC7 is the default. --srgb marks colour textures, so the mips are averaged in linear light and the
+// GPU decodes to linear when sampling; BC5 ignores it, as normal maps are data. TGA may be 24 or 32
+// bits, uncompressed or run-length encoded; PPM is P6 with 8-bit channels and PAM is P7 with RGB or
+// RGB_ALPHA tuples. Width and height must be multiples of 4.
+#include "../src/TextureData.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static bool ReadFile(const char* path, std::vector<uint8_t>& data)
+{
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data.resize(size > 0 ? size_t(size) : 0);
+	bool read = fread(data.data(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+	return read;
+}
+
+static bool EndsWith(const std::string& text, const char* suffix)
+{
+	size_t length = strlen(suffix);
+	return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool LoadTga(const std::vector<uint8_t>& file, RgbaImage& image)
+{
+	if (file.size() < 18)
+	{
+		return false;
+	}
+	const uint8_t* header = file.data();
+	uint8_t idLength = header[0];
+	uint8_t colorMapType = header[1];
+	uint8_t type = header[2];
+	uint32_t width = header[12] | (header[13] << 8);
+	uint32_t height = header[14] | (header[15] << 8);
+	uint32_t bits = header[16];
+	bool topDown = (header[17] & 0x20) != 0;
+	if (colorMapType != 0 || (type != 2 && type != 10) || (bits != 24 && bits != 32) || width == 0 || height == 0)
+	{
+		fprintf(stderr, "only true-colour 24 and 32-bit TGA images are supported\n");
+		return false;
+	}
+
+	uint32_t bytes = bits / 8;
+	size_t texels = size_t(width) * height;
+	std::vector<uint8_t> bgra(texels * 4, 255);
+	size_t position = 18 + idLength;
+	size_t written = 0;
+	auto readTexel = [&](uint8_t* out)
+	{
+		if (position + bytes > file.size())
+		{
+			return false;
+		}
+		memcpy(out, &file[position], bytes);
+		position += bytes;
+		return true;
+	};
+	while (written < texels)
+	{
+		if (type == 2)
+		{
+			if (!readTexel(&bgra[written++ * 4]))
+			{
+				return false;
+			}
+			continue;
+		}
+		// Run-length packets: a count byte, then one texel repeated or count raw texels
+		if (position >= file.size())
+		{
+			return false;
+		}
+		uint8_t packet = file[position++];
+		size_t count = std::min<size_t>((packet & 0x7f) + 1, texels - written);
+		if (packet & 0x80)
+		{
+			uint8_t texel[4] = { 0, 0, 0, 255 };
+			if (!readTexel(texel))
+			{
+				return false;
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				memcpy(&bgra[written++ * 4], texel, 4);
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!readTexel(&bgra[written++ * 4]))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(texels * 4);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const uint8_t* source = &bgra[size_t(topDown ? y : height - 1 - y) * width * 4];
+		uint8_t* row = &image.pixels[size_t(y) * width * 4];
+		for (uint32_t x = 0; x < width; x++)
+		{
+			row[x * 4 + 0] = source[x * 4 + 2];
+			row[x * 4 + 1] = source[x * 4 + 1];
+			row[x * 4 + 2] = source[x * 4 + 0];
+			row[x * 4 + 3] = bytes == 4 ? source[x * 4 + 3] : 255;
+		}
+	}
+	return true;
+}
+
+// PPM (P6) and PAM (P7) headers are whitespace-separated tokens; PPM allows comments
+static bool LoadNetpbm(const std::vector<uint8_t>& file, RgbaImage& image)
+{
+	size_t position = 2;
+	auto token = [&]()
+	{
+		std::string text;
+		while (position < file.size())
+		{
+			char c = char(file[position]);
+			if (c == '#')
+			{
+				while (position < file.size() && file[position] != '\n')
+				{
+					position++;
+				}
+			}
+			else if (isspace(uint8_t(c)))
+			{
+				position++;
+				if (!text.empty())
+				{
+					break;
+				}
+			}
+			else
+			{
+				text += c;
+				position++;
+			}
+		}
+		return text;
+	};
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 3;
+	uint32_t maximum = 0;
+	if (file.size() < 2 || file[0] != 'P' || (file[1] != '6' && file[1] != '7'))
+	{
+		return false;
+	}
+	if (file[1] == '6')
+	{
+		width = uint32_t(strtoul(token().c_str(), nullptr, 10));
+		height = uint32_t(strtoul(token().c_str(), nullptr, 10));
+		maximum = uint32_t(strtoul(token().c_str(), nullptr, 10));
+	}
+	else
+	{
+		for (std::string key = token(); !key.empty() && key != "ENDHDR"; key = token())
+		{
+			std::string value = token();
+			if (key == "WIDTH") width = uint32_t(strtoul(value.c_str(), nullptr, 10));
+			else if (key == "HEIGHT") height = uint32_t(strtoul(value.c_str(), nullptr, 10));
+			else if (key == "DEPTH") channels = uint32_t(strtoul(value.c_str(), nullptr, 10));
+			else if (key == "MAXVAL") maximum = uint32_t(strtoul(value.c_str(), nullptr, 10));
+		}
+	}
+	size_t texels = size_t(width) * height;
+	if (width == 0 || height == 0 || maximum != 255 || (channels != 3 && channels != 4) || file.size() - position < texels * channels)
+	{
+		fprintf(stderr, "only 8-bit RGB and RGBA Netpbm images are supported\n");
+		return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(texels * 4);
+	for (size_t i = 0; i < texels; i++)
+	{
+		const uint8_t* source = &file[position + i * channels];
+		uint8_t* texel = &image.pixels[i * 4];
+		texel[0] = source[0];
+		texel[1] = source[1];
+		texel[2] = source[2];
+		texel[3] = channels == 4 ? source[3] : 255;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BlockFormat format = BlockFormat::BC7;
+	bool srgb = false;
+	uint32_t mipCount = 0;
+	int arg = 1;
+	for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+	{
+		if (strcmp(argv[arg], "--srgb") == 0)
+		{
+			srgb = true;
+		}
+		else if (strcmp(argv[arg], "--format") == 0 && arg + 1 < argc)
+		{
+			std::string name = argv[++arg];
+			if (name == "bc1") format = BlockFormat::BC1;
+			else if (name == "bc3") format = BlockFormat::BC3;
+			else if (name == "bc5") format = BlockFormat::BC5;
+			else if (name == "bc7") format = BlockFormat::BC7;
+			else
+			{
+				fprintf(stderr, "unknown format '%s'\n", name.c_str());
+				return 1;
+			}
+		}
+		else if (strcmp(argv[arg], "--mips") == 0 && arg + 1 < argc)
+		{
+			mipCount = uint32_t(strtoul(argv[++arg], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "unknown option '%s'\n", argv[arg]);
+			return 1;
+		}
+	}
+	if (argc - arg != 2)
+	{
+		fprintf(stderr, "usage: %s [--format bc1|bc3|bc5|bc7] [--srgb] [--mips count] <input.tga|input.ppm|input.pam> <output.dds>\n", argv[0]);
+		return 1;
+	}
+	std::string input = argv[arg];
+	const char* output = argv[arg + 1];
+
+	std::vector<uint8_t> file;
+	if (!ReadFile(input.c_str(), file))
+	{
+		fprintf(stderr, "cannot read '%s'\n", input.c_str());
+		return 1;
+	}
+	RgbaImage source;
+	bool loaded = EndsWith(input, ".tga") ? LoadTga(file, source) :
+		EndsWith(input, ".ppm") || EndsWith(input, ".pam") ? LoadNetpbm(file, source) : false;
+	if (!loaded)
+	{
+		fprintf(stderr, "'%s' is not a readable .tga, .ppm or .pam image\n", input.c_str());
+		return 1;
+	}
+	if (source.width % 4 != 0 || source.height % 4 != 0)
+	{
+		fprintf(stderr, "%s: %ux%u is not whole 4x4 blocks, which the GPU needs for the largest mip\n", input.c_str(), source.width, source.height);
+		return 1;
+	}
+
+	JobSystem jobs;
+	BlockCompressor compressor;
+	TextureData texture;
+	auto begin = std::chrono::steady_clock::now();
+	BuildTextureData(source, format, srgb, mipCount, compressor, texture, &jobs);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	// Quality of the largest mip, the one seen up close
+	TextureView view = texture.GetView();
+	std::vector<uint8_t> decoded(source.pixels.size());
+	DecompressImage(format, view.mips[0].data, source.width, source.height, decoded.data(), size_t(source.width) * 4);
+	uint32_t channels = format == BlockFormat::BC5 ? 2 : 4;
+	double error = 0.0;
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		if (i % 4 < channels)
+		{
+			double d = double(decoded[i]) - source.pixels[i];
+			error += d * d;
+		}
+	}
+	double mse = error / (decoded.size() / 4 * channels);
+	double psnr = mse == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+
+	std::vector<uint8_t> image;
+	WriteDdsTexture(view, image);
+	FILE* fp = fopen(output, "wb");
+	if (!fp || fwrite(image.data(), 1, image.size(), fp) != image.size())
+	{
+		fprintf(stderr, "cannot write '%s'\n", output);
+		if (fp)
+		{
+			fclose(fp);
+		}
+		return 1;
+	}
+	fclose(fp);
+
+	printf("%s: %ux%u %s%s, %u mips, %zu bytes (%.1f%% of RGBA8), %.2f dB, %.0f ms with the %s kernel\n", output,
+		source.width, source.height, GetBlockFormatName(format), texture.srgb ? " sRGB" : "", view.mipCount, image.size(),
+		100.0 * image.size() / (source.pixels.size() * 4.0 / 3.0), psnr, seconds * 1e3, BlockCompressor::GetKernelName(compressor.GetKernel()));
+	return 0;
+}
@@ -0,0 +1,471 @@
+// Flies a camera past a row of textures and streams their mips through TextureStreamer, with loads
+// that finish a few frames later or fail, and checks the residency against a model of its own.
+//
+//   g++ -std=c++17 -O2 TextureStreamCheck.cpp ../src/TextureStreamer.cpp -o TextureStreamCheck
+//   ./TextureStreamCheck [textures=200]
+//
+// Loads must come one mip finer than the resident one, never two at once for a texture, and evictions
+// must take the finest resident mip of a texture with no load in flight. Resident and loading bytes
+// must match the model and never exceed the budget, and the loads in flight their limit. Once the
+// camera stops, every texture must reach the mip its screen size wants; once it leaves, everything
+// but the tails must go after the eviction delay. A lowered budget must be met in one Update, the
+// texture larger on screen must win a tight budget, and removing a texture mid-load must leave no
+// bytes behind. It also times Update over many textures.
+#include "../src/TextureStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static constexpr uint64_t TileBytes = 65536;
+
+// One byte per texel as in BC7, in 64 KiB tiles; mips under a tile share one as the tail
+struct TextureModel
+{
+	SlotHandle handle;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	uint32_t tailMip;
+	uint64_t mipBytes[TextureStreamer::MaxMips];
+	float position;
+	uint32_t resident;
+	bool loading;
+	uint32_t loadingMip;
+};
+
+struct PendingLoad
+{
+	size_t texture;
+	SlotHandle handle;
+	uint32_t mip;
+	int doneFrame;
+	bool succeeds;
+};
+
+static TextureModel MakeTexture(uint32_t width, uint32_t height, float position)
+{
+	TextureModel texture = {};
+	texture.width = width;
+	texture.height = height;
+	texture.position = position;
+	texture.mipCount = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+	{
+		texture.mipCount++;
+	}
+	texture.tailMip = texture.mipCount - 1;
+	for (uint32_t mip = 0; mip < texture.mipCount; mip++)
+	{
+		uint64_t texels = uint64_t(std::max(width >> mip, 1u)) * std::max(height >> mip, 1u);
+		if (texels < TileBytes && mip < texture.tailMip)
+		{
+			texture.tailMip = mip;
+		}
+		texture.mipBytes[mip] = mip < texture.tailMip ? (texels + TileBytes - 1) / TileBytes * TileBytes : 0;
+	}
+	texture.mipBytes[texture.tailMip] = TileBytes;
+	texture.resident = texture.tailMip;
+	return texture;
+}
+
+class Simulation
+{
+public:
+	Simulation(uint64_t budget) : mStreamer(budget) {}
+
+	void Add(const TextureModel& model)
+	{
+		mTextures.push_back(model);
+		TextureModel& texture = mTextures.back();
+		texture.handle = mStreamer.Add(texture.width, texture.height, texture.mipCount, texture.tailMip, texture.mipBytes);
+		texture.resident = texture.tailMip;
+		texture.loading = false;
+	}
+
+	void Remove(size_t index)
+	{
+		mStreamer.Remove(mTextures[index].handle);
+		mTextures[index].handle = SlotMap<int>::InvalidHandle;
+	}
+
+	// Screen size falls off with distance; nothing further than range is drawn
+	void Request(float camera, float range, float pixelsAtUnit)
+	{
+		for (const TextureModel& texture : mTextures)
+		{
+			float distance = std::fabs(texture.position - camera);
+			if (distance < range)
+			{
+				mStreamer.RequestScreenSize(texture.handle, pixelsAtUnit / std::max(distance, 0.25f));
+			}
+		}
+	}
+
+	void Frame(std::mt19937& random, float failRate, int maxDelay)
+	{
+		mFrame++;
+		mLoads.clear();
+		mEvictions.clear();
+		mStreamer.Update(mLoads, mEvictions);
+
+		for (const TextureStreamEvent& eviction : mEvictions)
+		{
+			TextureModel* texture = Find(eviction.texture);
+			if (!texture || texture->loading || eviction.mip != texture->resident || texture->resident >= texture->tailMip)
+			{
+				Fail("frame %d: eviction of mip %u is not the finest resident mip of an idle texture", mFrame, eviction.mip);
+				continue;
+			}
+			texture->resident++;
+		}
+		for (const TextureStreamEvent& load : mLoads)
+		{
+			TextureModel* texture = Find(load.texture);
+			if (!texture || texture->loading || load.mip + 1 != texture->resident)
+			{
+				Fail("frame %d: load of mip %u is not one finer than the resident mip", mFrame, load.mip);
+				continue;
+			}
+			texture->loading = true;
+			texture->loadingMip = load.mip;
+			bool succeeds = std::uniform_real_distribution<float>(0.0f, 1.0f)(random) >= failRate;
+			int delay = maxDelay > 0 ? int(random() % (maxDelay + 1)) : 0;
+			mPending.push_back({ size_t(texture - mTextures.data()), load.texture, load.mip, mFrame + delay, succeeds });
+		}
+
+		// Loads finish in their own order, as the I/O threads and copies would
+		std::shuffle(mPending.begin(), mPending.end(), random);
+		size_t kept = 0;
+		for (const PendingLoad& load : mPending)
+		{
+			if (load.doneFrame > mFrame)
+			{
+				mPending[kept++] = load;
+				continue;
+			}
+			mStreamer.FinishLoad(load.handle, load.mip, load.succeeds);
+			TextureModel& texture = mTextures[load.texture];
+			if (texture.handle == load.handle)
+			{
+				texture.loading = false;
+				if (load.succeeds)
+				{
+					texture.resident = load.mip;
+				}
+			}
+		}
+		mPending.resize(kept);
+
+		CheckState();
+	}
+
+	void CheckState()
+	{
+		uint64_t used = 0;
+		for (const TextureModel& texture : mTextures)
+		{
+			if (texture.handle == SlotMap<int>::InvalidHandle)
+			{
+				continue;
+			}
+			for (uint32_t mip = texture.resident; mip <= texture.tailMip; mip++)
+			{
+				used += texture.mipBytes[mip];
+			}
+			used += texture.loading ? texture.mipBytes[texture.loadingMip] : 0;
+			if (mStreamer.GetResidentMip(texture.handle) != texture.resident || mStreamer.IsLoading(texture.handle) != texture.loading)
+			{
+				Fail("frame %d: streamer has mip %u resident, the model %u", mFrame, mStreamer.GetResidentMip(texture.handle), texture.resident);
+			}
+		}
+		if (used != mStreamer.GetUsedBytes())
+		{
+			Fail("frame %d: streamer counts %llu bytes, the model %llu", mFrame,
+				(unsigned long long)mStreamer.GetUsedBytes(), (unsigned long long)used);
+		}
+		if (used > mStreamer.GetBudget() && used > GetTailBytes())
+		{
+			Fail("frame %d: %llu bytes over the budget of %llu", mFrame, (unsigned long long)used, (unsigned long long)mStreamer.GetBudget());
+		}
+		if (mStreamer.GetLoadsInFlight() > TextureStreamer::DefaultMaxLoadsInFlight)
+		{
+			Fail("frame %d: %u loads in flight", mFrame, mStreamer.GetLoadsInFlight());
+		}
+		mPeakBytes = std::max(mPeakBytes, used);
+	}
+
+	uint64_t GetTailBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const TextureModel& texture : mTextures)
+		{
+			bytes += texture.handle == SlotMap<int>::InvalidHandle ? 0 : texture.mipBytes[texture.tailMip];
+		}
+		return bytes;
+	}
+
+	TextureModel* Find(SlotHandle handle)
+	{
+		for (TextureModel& texture : mTextures)
+		{
+			if (texture.handle == handle)
+			{
+				return &texture;
+			}
+		}
+		return nullptr;
+	}
+
+	template <class... Args>
+	void Fail(const char* format, Args... args)
+	{
+		if (mFailures++ < 10)
+		{
+			printf(format, args...);
+			printf("\n");
+		}
+	}
+
+	TextureStreamer mStreamer;
+	std::vector<TextureModel> mTextures;
+	std::vector<PendingLoad> mPending;
+	std::vector<TextureStreamEvent> mLoads;
+	std::vector<TextureStreamEvent> mEvictions;
+	uint64_t mPeakBytes = 0;
+	int mFrame = 0;
+	int mFailures = 0;
+};
+
+static int CheckSelectMip()
+{
+	struct Case { uint32_t width, height, mipCount; float pixels; uint32_t mip; };
+	const Case cases[] =
+	{
+		{ 1024, 1024, 11, 1024.0f, 0 },
+		{ 1024, 1024, 11, 2000.0f, 0 },
+		{ 1024, 1024, 11, 600.0f, 0 },
+		{ 1024, 1024, 11, 512.0f, 1 },
+		{ 1024, 1024, 11, 300.0f, 1 },
+		{ 1024, 256, 11, 256.0f, 2 },
+		{ 1024, 1024, 11, 1.0f, 10 },
+		{ 1024, 1024, 11, 0.0f, 10 },
+		{ 1024, 1024, 4, 1.0f, 3 },
+	};
+	int failures = 0;
+	for (const Case& c : cases)
+	{
+		uint32_t mip = TextureStreamer::SelectMip(c.width, c.height, c.mipCount, c.pixels);
+		if (mip != c.mip)
+		{
+			printf("SelectMip(%ux%u, %u mips, %.0f pixels) = %u, expected %u\n", c.width, c.height, c.mipCount, c.pixels, mip, c.mip);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+static void AddRow(Simulation& simulation, size_t count, std::mt19937& random)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t width = 256u << (random() % 5);
+		uint32_t height = random() % 3 == 0 ? width / 2 : width;
+		simulation.Add(MakeTexture(width, height, float(i) * 2.0f));
+	}
+}
+
+static int CheckFlyThrough(size_t count, std::mt19937& random)
+{
+	// Room for the tails and a few dozen full chains at most
+	const float range = 24.0f;
+	const float pixelsAtUnit = 2048.0f;
+	Simulation simulation(0);
+	AddRow(simulation, count, random);
+	simulation.mStreamer.SetBudget(simulation.GetTailBytes() + 48ull * 1024 * 1024);
+
+	float camera = 0.0f;
+	float end = float(count) * 2.0f;
+	for (int frame = 0; frame < 2000 && camera < end; frame++)
+	{
+		camera += 0.1f;
+		// Now and then a texture goes away mid-stream and comes back as a new one
+		if (frame % 97 == 0)
+		{
+			size_t index = random() % simulation.mTextures.size();
+			TextureModel model = simulation.mTextures[index];
+			simulation.Remove(index);
+			simulation.Add(MakeTexture(model.width, model.height, model.position));
+		}
+		simulation.Request(camera, range, pixelsAtUnit);
+		simulation.Frame(random, 0.05f, 3);
+	}
+	printf("fly-through: %zu textures, peak %.1f MB of %.1f MB budget (%.1f MB of tails)\n", count,
+		simulation.mPeakBytes / 1048576.0, simulation.mStreamer.GetBudget() / 1048576.0, simulation.GetTailBytes() / 1048576.0);
+
+	// Standing still with room to spare, every texture on screen reaches the mip it wants
+	simulation.mStreamer.SetBudget(UINT64_MAX / 2);
+	camera = 40.0f;
+	for (int frame = 0; frame < 200; frame++)
+	{
+		simulation.Request(camera, range, pixelsAtUnit);
+		simulation.Frame(random, 0.0f, 2);
+	}
+	for (const TextureModel& texture : simulation.mTextures)
+	{
+		if (texture.handle == SlotMap<int>::InvalidHandle)
+		{
+			continue;
+		}
+		float distance = std::fabs(texture.position - camera);
+		uint32_t wanted = distance < range ?
+			std::min(TextureStreamer::SelectMip(texture.width, texture.height, texture.mipCount, pixelsAtUnit / std::max(distance, 0.25f)), texture.tailMip) :
+			texture.tailMip;
+		if (distance < range && texture.resident != wanted)
+		{
+			simulation.Fail("standing still: mip %u resident, %u wanted", texture.resident, wanted);
+		}
+		if (distance >= range && texture.resident != texture.tailMip)
+		{
+			simulation.Fail("standing still: mip %u of a texture off screen is resident", texture.resident);
+		}
+	}
+	uint64_t visibleBytes = simulation.mStreamer.GetUsedBytes();
+
+	// Looking away, everything but the tails goes after the eviction delay, and not before
+	camera = -1000.0f;
+	for (uint32_t frame = 0; frame + 1 < TextureStreamer::DefaultEvictionDelay; frame++)
+	{
+		simulation.Request(camera, range, pixelsAtUnit);
+		simulation.Frame(random, 0.0f, 0);
+	}
+	if (simulation.mStreamer.GetUsedBytes() != visibleBytes)
+	{
+		simulation.Fail("mips went before the eviction delay");
+	}
+	for (int frame = 0; frame < 2; frame++)
+	{
+		simulation.Request(camera, range, pixelsAtUnit);
+		simulation.Frame(random, 0.0f, 0);
+	}
+	if (simulation.mStreamer.GetUsedBytes() != simulation.GetTailBytes())
+	{
+		simulation.Fail("%llu bytes still resident with nothing on screen, the tails take %llu",
+			(unsigned long long)simulation.mStreamer.GetUsedBytes(), (unsigned long long)simulation.GetTailBytes());
+	}
+	printf("on screen %.1f MB, off screen %.1f MB\n", visibleBytes / 1048576.0, simulation.mStreamer.GetUsedBytes() / 1048576.0);
+
+	// A lowered budget is met within one Update, wanted mips or not
+	camera = 40.0f;
+	for (int frame = 0; frame < 100; frame++)
+	{
+		simulation.Request(camera, range, pixelsAtUnit);
+		simulation.Frame(random, 0.0f, 0);
+	}
+	uint64_t lowered = simulation.GetTailBytes() + (simulation.mStreamer.GetUsedBytes() - simulation.GetTailBytes()) / 3;
+	simulation.mStreamer.SetBudget(lowered);
+	simulation.Request(camera, range, pixelsAtUnit);
+	simulation.Frame(random, 0.0f, 0);
+	if (simulation.mStreamer.GetUsedBytes() > lowered)
+	{
+		simulation.Fail("%llu bytes resident after lowering the budget to %llu",
+			(unsigned long long)simulation.mStreamer.GetUsedBytes(), (unsigned long long)lowered);
+	}
+	return simulation.mFailures;
+}
+
+static int CheckPriority(std::mt19937& random)
+{
+	// Two 2048 squares with room for one full chain: the near one gets it, the far one what is left
+	Simulation simulation(0);
+	simulation.Add(MakeTexture(2048, 2048, 0.0f));
+	simulation.Add(MakeTexture(2048, 2048, 10.0f));
+	uint64_t chain = 0;
+	for (uint32_t mip = 0; mip < simulation.mTextures[0].tailMip; mip++)
+	{
+		chain += simulation.mTextures[0].mipBytes[mip];
+	}
+	simulation.mStreamer.SetBudget(simulation.GetTailBytes() + chain + chain / 8);
+	for (int frame = 0; frame < 100; frame++)
+	{
+		simulation.mStreamer.RequestScreenSize(simulation.mTextures[0].handle, 4096.0f);
+		simulation.mStreamer.RequestScreenSize(simulation.mTextures[1].handle, 600.0f);
+		simulation.Frame(random, 0.0f, 1);
+	}
+	if (simulation.mTextures[0].resident != 0 || simulation.mTextures[1].resident != 2)
+	{
+		simulation.Fail("tight budget: near texture at mip %u, far one at mip %u", simulation.mTextures[0].resident, simulation.mTextures[1].resident);
+	}
+
+	// Removed mid-load: the late FinishLoad is ignored and no bytes stay behind
+	simulation.mStreamer.RequestScreenSize(simulation.mTextures[1].handle, 4096.0f);
+	simulation.mStreamer.SetBudget(UINT64_MAX / 2);
+	simulation.mStreamer.RequestScreenSize(simulation.mTextures[0].handle, 4096.0f);
+	simulation.Frame(random, 0.0f, 5);
+	if (!simulation.mStreamer.IsLoading(simulation.mTextures[1].handle))
+	{
+		simulation.Fail("no load for the far texture once the budget allowed it");
+	}
+	simulation.Remove(1);
+	for (int frame = 0; frame < 10; frame++)
+	{
+		simulation.mStreamer.RequestScreenSize(simulation.mTextures[0].handle, 4096.0f);
+		simulation.Frame(random, 0.0f, 0);
+	}
+	if (simulation.mStreamer.GetLoadsInFlight() != 0 || simulation.mStreamer.GetTextureCount() != 1)
+	{
+		simulation.Fail("a removed texture still counts");
+	}
+	return simulation.mFailures;
+}
+
+static void TimeUpdate(std::mt19937& random)
+{
+	const size_t count = 10000;
+	TextureStreamer streamer(512ull * 1024 * 1024);
+	std::vector<SlotHandle> handles;
+	std::vector<TextureModel> models;
+	for (size_t i = 0; i < count; i++)
+	{
+		models.push_back(MakeTexture(256u << (random() % 5), 256u << (random() % 5), 0.0f));
+		handles.push_back(streamer.Add(models[i].width, models[i].height, models[i].mipCount, models[i].tailMip, models[i].mipBytes));
+	}
+	std::vector<TextureStreamEvent> loads;
+	std::vector<TextureStreamEvent> evictions;
+	const int frames = 200;
+	auto begin = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (size_t i = 0; i < count; i += 3)
+		{
+			streamer.RequestScreenSize(handles[i], float(random() % 2048));
+		}
+		loads.clear();
+		evictions.clear();
+		streamer.Update(loads, evictions);
+		for (const TextureStreamEvent& load : loads)
+		{
+			streamer.FinishLoad(load.texture, load.mip, true);
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	printf("Update over %zu textures: %.1f us a frame, %.1f MB resident\n", count, seconds / frames * 1e6, streamer.GetUsedBytes() / 1048576.0);
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? std::max<size_t>(8, strtoull(argv[1], nullptr, 10)) : 200;
+	std::mt19937 random(5);
+	int failures = 0;
+
+	failures += CheckSelectMip();
+	failures += CheckFlyThrough(count, random);
+	failures += CheckPriority(random);
+	TimeUpdate(random);
+
+	printf(failures ? "FAILED\n" : "texture streaming checks out\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+// Times TransformStore::UpdateWorldMatrices against the per-object layout it replaced, where every
+// square owned its transform and world matrix and the renderer gathered the matrices through pointers.
+//
+//   g++ -std=c++17 -O2 -I$DIRECTXMATH/Inc -I$DIRECTX_HEADERS/include/wsl/stubs TransformBench.cpp ../src/TransformStore.cpp -o TransformBench
+//   ./TransformBench [iterations=20]
+//
+// Every object gets a new rotation each frame, so both paths rebuild every matrix. One object in four
+// is parented to an earlier one. Runs 1k, 100k and 1M objects and checks both paths produce the
+// same matrices.
+#include "../src/TransformStore.h"
+#include "TestMeshes.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+// One heap allocation per object, as Square used to keep its own transform
+struct Object
+{
+	XMFLOAT4 translation;
+	XMFLOAT4 rotation;
+	XMFLOAT4 scale;
+	Object* parent;
+	XMMATRIX world;
+};
+
+static XMVECTOR MakeRotation(float angle, uint32_t axis)
+{
+	float s = std::sin(0.5f * angle);
+	float c = std::cos(0.5f * angle);
+	return XMVectorSet(axis == 0 ? s : 0.0f, axis == 1 ? s : 0.0f, axis == 2 ? s : 0.0f, c);
+}
+
+static void UpdateObjects(const std::vector<Object*>& objects, std::vector<XMMATRIX>& worlds)
+{
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		Object* object = objects[i];
+		XMMATRIX local = XMMatrixMultiply(
+			XMMatrixMultiply(XMMatrixScalingFromVector(XMLoadFloat4(&object->scale)), XMMatrixRotationQuaternion(XMLoadFloat4(&object->rotation))),
+			XMMatrixTranslationFromVector(XMLoadFloat4(&object->translation)));
+		object->world = object->parent ? XMMatrixMultiply(local, object->parent->world) : local;
+		worlds[i] = object->world;
+	}
+}
+
+static bool Matches(const XMMATRIX& a, const XMMATRIX& b)
+{
+	for (int row = 0; row < 4; row++)
+	{
+		XMVECTOR difference = XMVectorSubtract(a.r[row], b.r[row]);
+		if (std::fabs(XMVectorGetX(difference)) > 1e-3f || std::fabs(XMVectorGetY(difference)) > 1e-3f ||
+			std::fabs(XMVectorGetZ(difference)) > 1e-3f || std::fabs(XMVectorGetW(difference)) > 1e-3f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 20;
+
+	int result = 0;
+	for (size_t count : { size_t(1000), size_t(100000), size_t(1000000) })
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+		TransformStore store;
+		store.Reserve(count);
+		std::vector<TransformHandle> handles;
+		std::vector<std::unique_ptr<Object>> storage;
+		std::vector<Object*> objects;
+		for (size_t i = 0; i < count; i++)
+		{
+			TransformHandle parent = TransformStore::NoParent;
+			Object* parentObject = nullptr;
+			if (i % 4 == 3)
+			{
+				parent = handles[i - 3];
+				parentObject = objects[i - 3];
+			}
+
+			XMVECTOR translation = XMVectorSet(position(random), position(random), position(random), 0.0f);
+			XMVECTOR scale = XMVectorSet(size(random), size(random), size(random), 0.0f);
+			TransformHandle handle = store.Create(parent);
+			store.SetTranslation(handle, translation);
+			store.SetScale(handle, scale);
+			handles.push_back(handle);
+
+			storage.emplace_back(new Object());
+			Object* object = storage.back().get();
+			object->translation = { XMVectorGetX(translation), XMVectorGetY(translation), XMVectorGetZ(translation), 0.0f };
+			object->rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+			object->scale = { XMVectorGetX(scale), XMVectorGetY(scale), XMVectorGetZ(scale), 0.0f };
+			object->parent = parentObject;
+			objects.push_back(object);
+		}
+
+		std::vector<XMMATRIX> worlds(count);
+		double storeMs = 0.0;
+		double objectMs = 0.0;
+		for (int frame = 0; frame < iterations; frame++)
+		{
+			float angle = 0.01f * float(frame + 1);
+			auto begin = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; i++)
+			{
+				store.SetRotation(handles[i], MakeRotation(angle, uint32_t(i % 3)));
+			}
+			store.UpdateWorldMatrices();
+			storeMs += Milliseconds(begin);
+
+			begin = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; i++)
+			{
+				XMVECTOR rotation = MakeRotation(angle, uint32_t(i % 3));
+				objects[i]->rotation = { XMVectorGetX(rotation), XMVectorGetY(rotation), XMVectorGetZ(rotation), XMVectorGetW(rotation) };
+			}
+			UpdateObjects(objects, worlds);
+			objectMs += Milliseconds(begin);
+		}
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!Matches(store.GetWorldMatrix(handles[i]), worlds[i]))
+			{
+				mismatches++;
+			}
+		}
+		if (mismatches)
+		{
+			printf("%8zu objects  MISMATCH (%zu matrices)\n", count, mismatches);
+			result = 1;
+			continue;
+		}
+
+		storeMs /= iterations;
+		objectMs /= iterations;
+		printf("%8zu objects  store %8.3f ms  per-object %8.3f ms  %5.2fx\n", count, storeMs, objectMs, objectMs / storeMs);
+	}
+	return result;
+}
@@ -0,0 +1,224 @@
+// Churns TransformStore with random creations, destructions and edits under a random hierarchy and
+// checks every world matrix against one rebuilt from scratch.
+//
+//   g++ -std=c++17 -O2 -I$DIRECTXMATH/Inc -I$DIRECTX_HEADERS/include/wsl/stubs TransformCheck.cpp ../src/TransformStore.cpp -o TransformCheck
+//   ./TransformCheck [operations=20000]
+//
+// Destroying a node with live children must be refused and change nothing. A live node's parent must
+// always be live and sit before it, so a reused slot can never be read as someone's stale parent.
+#include "../src/TransformStore.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// What the store should hold for one slot
+struct Node
+{
+	bool live = false;
+	uint32_t parent = TransformStore::NoParent.index;
+	uint32_t children = 0;
+	XMFLOAT4 translation = { 0.0f, 0.0f, 0.0f, 0.0f };
+	XMFLOAT4 rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+	XMFLOAT4 scale = { 1.0f, 1.0f, 1.0f, 0.0f };
+};
+
+static XMMATRIX ReferenceWorld(const std::vector<Node>& nodes, uint32_t index)
+{
+	const Node& node = nodes[index];
+	XMMATRIX local = XMMatrixMultiply(
+		XMMatrixMultiply(XMMatrixScalingFromVector(XMLoadFloat4(&node.scale)), XMMatrixRotationQuaternion(XMLoadFloat4(&node.rotation))),
+		XMMatrixTranslationFromVector(XMLoadFloat4(&node.translation)));
+	return node.parent == TransformStore::NoParent.index ? local : XMMatrixMultiply(local, ReferenceWorld(nodes, node.parent));
+}
+
+static bool Matches(const XMMATRIX& a, const XMMATRIX& b)
+{
+	for (int row = 0; row < 4; row++)
+	{
+		XMVECTOR difference = XMVectorSubtract(a.r[row], b.r[row]);
+		if (std::fabs(XMVectorGetX(difference)) > 1e-3f || std::fabs(XMVectorGetY(difference)) > 1e-3f ||
+			std::fabs(XMVectorGetZ(difference)) > 1e-3f || std::fabs(XMVectorGetW(difference)) > 1e-3f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static XMFLOAT4 RandomRotation(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+	float x = component(random);
+	float y = component(random);
+	float z = component(random);
+	float w = component(random);
+	float length = std::sqrt(x * x + y * y + z * z + w * w) + 1e-6f;
+	return { x / length, y / length, z / length, w / length };
+}
+
+int main(int argc, char** argv)
+{
+	size_t operations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000;
+	int failures = 0;
+
+	// A parent refuses to go while it has a child, and goes once the child is gone
+	{
+		TransformStore store;
+		TransformHandle parent = store.Create();
+		TransformHandle child = store.Create(parent);
+		store.SetTranslation(parent, XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+		store.UpdateWorldMatrices();
+		if (store.Destroy(parent) || store.GetChildCount(parent) != 1 || store.GetParent(child).index != parent.index)
+		{
+			printf("a parent with a live child was destroyed\n");
+			failures++;
+		}
+		// The refused node must still be intact and its slot must not be handed out again
+		TransformHandle other = store.Create();
+		store.SetTranslation(parent, XMVectorSet(2.0f, 0.0f, 0.0f, 0.0f));
+		store.UpdateWorldMatrices();
+		if (other.index == parent.index || XMVectorGetX(store.GetWorldMatrix(child).r[3]) != 2.0f)
+		{
+			printf("a refused destroy changed the parent\n");
+			failures++;
+		}
+		if (!store.Destroy(child) || store.GetChildCount(parent) != 0 || !store.Destroy(parent))
+		{
+			printf("a parent without children could not be destroyed\n");
+			failures++;
+		}
+	}
+
+	// Random churn against a model of the hierarchy
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+	TransformStore store;
+	std::vector<Node> nodes;
+	std::vector<uint32_t> live;
+	size_t refused = 0;
+	size_t destroyed = 0;
+	size_t updated = 0;
+	for (size_t op = 0; op < operations && failures == 0; op++)
+	{
+		uint32_t action = random() % 100;
+		if (live.empty() || action < 35)
+		{
+			TransformHandle parent = TransformStore::NoParent;
+			if (!live.empty() && random() % 3 != 0)
+			{
+				parent = { live[random() % live.size()] };
+			}
+			TransformHandle handle = store.Create(parent);
+			if (handle.index >= nodes.size())
+			{
+				nodes.resize(handle.index + 1);
+			}
+			if (nodes[handle.index].live)
+			{
+				printf("op %zu: slot %u handed out while live\n", op, handle.index);
+				failures++;
+				break;
+			}
+			if (parent.index != TransformStore::NoParent.index && handle.index <= parent.index)
+			{
+				printf("op %zu: child %u created before its parent %u\n", op, handle.index, parent.index);
+				failures++;
+				break;
+			}
+			nodes[handle.index] = Node();
+			nodes[handle.index].live = true;
+			nodes[handle.index].parent = parent.index;
+			if (parent.index != TransformStore::NoParent.index)
+			{
+				nodes[parent.index].children++;
+			}
+			live.push_back(handle.index);
+		}
+		else if (action < 60)
+		{
+			size_t pick = random() % live.size();
+			uint32_t index = live[pick];
+			bool accepted = store.Destroy({ index });
+			if (accepted != (nodes[index].children == 0))
+			{
+				printf("op %zu: destroying %u with %u children returned %s\n", op, index, nodes[index].children, accepted ? "true" : "false");
+				failures++;
+				break;
+			}
+			if (!accepted)
+			{
+				refused++;
+				continue;
+			}
+			if (nodes[index].parent != TransformStore::NoParent.index)
+			{
+				nodes[nodes[index].parent].children--;
+			}
+			nodes[index] = Node();
+			live[pick] = live.back();
+			live.pop_back();
+			destroyed++;
+		}
+		else
+		{
+			// Touch a few nodes the way a frame of gameplay would
+			for (int edit = 0; edit < 4; edit++)
+			{
+				uint32_t index = live[random() % live.size()];
+				Node& node = nodes[index];
+				switch (random() % 3)
+				{
+				case 0:
+					node.translation = { position(random), position(random), position(random), 0.0f };
+					store.SetTranslation({ index }, XMLoadFloat4(&node.translation));
+					break;
+				case 1:
+					node.rotation = RandomRotation(random);
+					store.SetRotation({ index }, XMLoadFloat4(&node.rotation));
+					break;
+				default:
+					node.scale = { size(random), size(random), size(random), 0.0f };
+					store.SetScale({ index }, XMLoadFloat4(&node.scale));
+					break;
+				}
+			}
+		}
+
+		if (op % 13 != 0)
+		{
+			continue;
+		}
+		updated += store.UpdateWorldMatrices();
+		for (uint32_t index : live)
+		{
+			const Node& node = nodes[index];
+			if (store.GetParent({ index }).index != node.parent || store.GetChildCount({ index }) != node.children)
+			{
+				printf("op %zu: node %u has parent %u and %u children, expected %u and %u\n", op, index,
+					store.GetParent({ index }).index, store.GetChildCount({ index }), node.parent, node.children);
+				failures++;
+				break;
+			}
+			if (node.parent != TransformStore::NoParent.index && (!nodes[node.parent].live || node.parent >= index))
+			{
+				printf("op %zu: node %u has a stale or later parent %u\n", op, index, node.parent);
+				failures++;
+				break;
+			}
+			if (!Matches(store.GetWorldMatrix({ index }), ReferenceWorld(nodes, index)))
+			{
+				printf("op %zu: node %u has a stale world matrix\n", op, index);
+				failures++;
+				break;
+			}
+		}
+	}
+	printf("%zu operations: %zu live nodes, %zu destroyed, %zu destroys refused, %zu matrices rebuilt\n",
+		operations, live.size(), destroyed, refused, updated);
+
+	printf(failures ? "FAILED\n" : "transform store checks out\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+// Writes the HLSL side of every vertex layout described in src/ and checks the encoders.
+//
+//   g++ -std=c++17 -O2 VertexLayoutGen.cpp ../src/VertexLayout.cpp -o VertexLayoutGen
+//   ./VertexLayoutGen ../resource [--check]
+//
+// Each layout gets resource/<Name>.hlsli with its input struct, decoded struct and the Decode and Load
+// functions. With --check nothing is written and the tool exits with code 2 when a checked-in file is
+// out of date. Either way every encoding is round-tripped on random vertices and must stay within its
+// quantization step. Offsets and sizes are checked at compile time.
+#include "../src/VertexLayout.h"
+#include "../src/SquareVertex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+// The encodings the shipped layouts do not use
+static constexpr VertexElement WideElements[] =
+{
+	{ VertexSemantic::Position, VertexEncoding::Float3 },
+	{ VertexSemantic::Normal, VertexEncoding::Float3 },
+	{ VertexSemantic::Color, VertexEncoding::Float4 },
+};
+static constexpr VertexElement PackedElements[] =
+{
+	{ VertexSemantic::Position, VertexEncoding::Snorm16x4 },
+	{ VertexSemantic::Normal, VertexEncoding::Oct16 },
+	{ VertexSemantic::Color, VertexEncoding::Unorm8x4 },
+};
+
+// Input elements follow the byte layout, and packing pays off
+static constexpr auto PackedInputElements = MakeInputElements(PackedElements);
+static_assert(PackedInputElements[1].offset == 8 && PackedInputElements[2].offset == 12 && GetVertexStride(PackedElements) == 16,
+	"input elements do not follow the layout");
+static_assert(PackedInputElements[1].format == VertexFormat::R16G16_Snorm, "octahedral normals are two snorm16");
+static_assert(GetVertexStride(PackedElements) * 2 <= GetVertexStride(WideElements), "packed vertices are not half the size");
+static_assert(GetVertexStride(SquareVertexElements) * 2 <= 28, "SquareVertex is not half of a float3 position and float4 colour");
+
+struct GeneratedLayout
+{
+	const char* name;
+	const char* source;
+	VertexLayout layout;
+};
+
+// Shader sources use CRLF like the rest of resource/
+static std::string ToCrlf(const std::string& text)
+{
+	std::string out;
+	for (char c : text)
+	{
+		if (c == '\n')
+		{
+			out += '\r';
+		}
+		out += c;
+	}
+	return out;
+}
+
+static std::string GenerateFile(const GeneratedLayout& generated)
+{
+	std::string text = "// Generated by tools/VertexLayoutGen from " + std::string(generated.source) + "; do not edit.\n";
+	text += generated.layout.GenerateHlsl(generated.name);
+	return ToCrlf(text);
+}
+
+// Largest decode error per attribute over random vertices, against the bound each encoding promises
+static int CheckRoundTrip(const char* name, const VertexLayout& layout, float positionRange)
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<SourceVertex> vertices(10000);
+	for (SourceVertex& v : vertices)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			v.position[a] = unit(random) * positionRange * (a + 1) + 3.0f;
+			v.normal[a] = unit(random);
+		}
+		float length = std::sqrt(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] + v.normal[2] * v.normal[2]);
+		for (int a = 0; a < 3; a++)
+		{
+			v.normal[a] /= length;
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			v.color[c] = unit(random) * 0.5f + 0.5f;
+		}
+	}
+
+	VertexQuantization quantization = layout.ComputeQuantization(vertices.data(), vertices.size());
+	std::vector<uint8_t> encoded(layout.GetStride() * vertices.size());
+	layout.Encode(vertices.data(), vertices.size(), quantization, encoded.data());
+	std::vector<SourceVertex> decoded(vertices.size());
+	layout.Decode(encoded.data(), vertices.size(), quantization, decoded.data());
+
+	float positionError = 0.0f;
+	float normalError = 0.0f;   // radians
+	float colorError = 0.0f;
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const float* a = decoded[v].normal;
+		const float* b = vertices[v].normal;
+		for (int c = 0; c < 3; c++)
+		{
+			// Relative to the quantization step, so 0.5 is exact rounding
+			positionError = std::max(positionError, std::fabs(decoded[v].position[c] - vertices[v].position[c]) / quantization.scale[c] * 32767.0f);
+		}
+		// atan2 keeps its precision for tiny angles where acos of the dot product does not
+		float cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+		float sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+		normalError = std::max(normalError, std::atan2(sine, a[0] * b[0] + a[1] * b[1] + a[2] * b[2]));
+		for (int c = 0; c < 4; c++)
+		{
+			colorError = std::max(colorError, std::fabs(decoded[v].color[c] - vertices[v].color[c]) * 255.0f);
+		}
+	}
+
+	int failures = 0;
+	printf("%-14s %2u bytes ", name, layout.GetStride());
+	for (size_t i = 0; i < layout.GetElementCount(); i++)
+	{
+		const VertexElement& element = layout.GetElement(i);
+		switch (element.semantic)
+		{
+		case VertexSemantic::Position: printf(" position %.3f steps", positionError); break;
+		case VertexSemantic::Normal: printf(" normal %.6f rad", normalError); break;
+		case VertexSemantic::Color: printf(" colour %.3f steps", colorError); break;
+		}
+	}
+	printf("\n");
+	for (size_t i = 0; i < layout.GetElementCount(); i++)
+	{
+		const VertexElement& element = layout.GetElement(i);
+		// Float encodings are exact up to the float rounding of the quantization itself
+		bool bad =
+			(element.semantic == VertexSemantic::Position && element.encoding == VertexEncoding::Snorm16x4 && positionError > 0.51f) ||
+			(element.semantic == VertexSemantic::Normal && element.encoding == VertexEncoding::Oct16 && normalError > 1e-4f) ||
+			(element.semantic == VertexSemantic::Normal && element.encoding == VertexEncoding::Float3 && normalError > 1e-3f) ||
+			(element.semantic == VertexSemantic::Color && element.encoding == VertexEncoding::Unorm8x4 && colorError > 0.5001f) ||
+			(element.semantic == VertexSemantic::Color && element.encoding == VertexEncoding::Float4 && colorError > 0.0f);
+		if (bad)
+		{
+			printf("%s: element %zu decodes outside its quantization step\n", name, i);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: VertexLayoutGen <resource directory> [--check]\n");
+		return 1;
+	}
+	std::string directory = argv[1];
+	bool check = argc > 2 && strcmp(argv[2], "--check") == 0;
+	int failures = 0;
+
+	const GeneratedLayout layouts[] =
+	{
+		{ "SquareVertex", "src/SquareVertex.h", VertexLayout(SquareVertexElements, std::size(SquareVertexElements)) },
+	};
+
+	int stale = 0;
+	for (const GeneratedLayout& generated : layouts)
+	{
+		std::string path = directory + "/" + generated.name + ".hlsli";
+		std::string text = GenerateFile(generated);
+		if (check)
+		{
+			std::ifstream file(path, std::ios::binary);
+			std::stringstream current;
+			current << file.rdbuf();
+			if (current.str() != text)
+			{
+				printf("%s is out of date\n", path.c_str());
+				stale++;
+			}
+			continue;
+		}
+		std::ofstream file(path, std::ios::binary);
+		file << text;
+		if (!file)
+		{
+			printf("cannot write %s\n", path.c_str());
+			return 1;
+		}
+		printf("wrote %s\n", path.c_str());
+	}
+
+	VertexLayout wideLayout(WideElements, std::size(WideElements));
+	VertexLayout packedLayout(PackedElements, std::size(PackedElements));
+	for (const GeneratedLayout& generated : layouts)
+	{
+		failures += CheckRoundTrip(generated.name, generated.layout, 20.0f);
+	}
+	failures += CheckRoundTrip("full floats", wideLayout, 20.0f);
+	failures += CheckRoundTrip("packed normals", packedLayout, 20.0f);
+
+	// The runtime layout agrees with the compile-time one
+	std::vector<VertexInputElement> elements;
+	packedLayout.GetInputElements(elements);
+	for (size_t i = 0; i < elements.size(); i++)
+	{
+		if (elements[i].offset != PackedInputElements[i].offset || elements[i].format != PackedInputElements[i].format ||
+			strcmp(elements[i].semanticName, PackedInputElements[i].semanticName) != 0)
+		{
+			printf("VertexLayout disagrees with MakeInputElements at element %zu\n", i);
+			failures++;
+		}
+	}
+
+	if (failures)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	if (stale)
+	{
+		printf("run VertexLayoutGen without --check to regenerate\n");
+		return 2;
+	}
+	printf("vertex layouts check out\n");
+	return 0;
+}
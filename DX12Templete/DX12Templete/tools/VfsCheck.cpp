@@ -0,0 +1,484 @@
+// Writes a tree of small files, packs it stored and compressed, and reads it back through
+// VirtualFileSystem from the loose directory and from both packs, synchronously and asynchronously,
+// then times them.
+//
+//   g++ -std=c++17 -O2 -pthread VfsCheck.cpp ../src/VirtualFileSystem.cpp ../src/MappedFile.cpp ../src/CompressedStream.cpp ../src/Lz4.cpp ../src/JobSystem.cpp -o VfsCheck
+//   ./VfsCheck [files=2000]
+//
+// Every mount must return the same bytes for every name, however it is spelled, and refuse the same
+// missing or escaping names; ReadInto must agree with Read. Packs must build the same whatever order files were added in, later
+// mounts must shadow earlier ones, and views must outlive the file system. Every truncated pack and
+// every damaged index field must fail to mount, and no mounted pack may hand out a view that leaves
+// the file.
+#include "PackWriter.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct SourceFile
+{
+	std::string name;
+	std::vector<uint8_t> data;
+};
+
+static int failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("%s\n", what);
+		failures++;
+	}
+}
+
+static bool SameBytes(const FileView& view, const std::vector<uint8_t>& data)
+{
+	return view.IsValid() && view.GetSize() == data.size() && (data.empty() || memcmp(view.GetData(), data.data(), data.size()) == 0);
+}
+
+static bool WriteFile(const fs::path& path, const std::vector<uint8_t>& data)
+{
+	fs::create_directories(path.parent_path());
+	FILE* fp = fopen(path.string().c_str(), "wb");
+	if (!fp)
+	{
+		return false;
+	}
+	bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	return (fclose(fp) == 0) && ok;
+}
+
+static void CheckNormalize()
+{
+	struct Case
+	{
+		const char* name;
+		const char* expected; // nullptr when refused
+	};
+	const Case cases[] = {
+		{ "a/b.c", "a/b.c" },
+		{ "a\\b.c", "a/b.c" },
+		{ "./a//b.c", "a/b.c" },
+		{ "/a/./b.c/", "a/b.c" },
+		{ "", "" },
+		{ "..", nullptr },
+		{ "a/../b", nullptr },
+		{ "a/..b/c..", "a/..b/c.." },
+	};
+	for (const Case& c : cases)
+	{
+		std::string normalized;
+		bool ok = VirtualFileSystem::NormalizePath(c.name, &normalized);
+		if (ok != (c.expected != nullptr) || (ok && normalized != c.expected))
+		{
+			printf("NormalizePath(\"%s\") gave %s \"%s\"\n", c.name, ok ? "ok" : "refused", normalized.c_str());
+			failures++;
+		}
+	}
+}
+
+static uint64_t FirstEntrySize(const std::vector<uint8_t>& image)
+{
+	const PackFormat::Header* header = reinterpret_cast<const PackFormat::Header*>(image.data());
+	return reinterpret_cast<const PackFormat::Entry*>(image.data() + header->entryOffset)->size;
+}
+
+// Every truncation, and damage to every index field, must either fail to mount or stay inside the file
+static void CheckDamage(const fs::path& directory, const std::vector<uint8_t>& image)
+{
+	using namespace PackFormat;
+	const fs::path path = directory / "damaged.pak";
+	size_t mounted = 0;
+	size_t tries = 0;
+	auto tryMount = [&](const std::vector<uint8_t>& damaged, bool mustFail, const char* what) {
+		tries++;
+		if (!WriteFile(path, damaged))
+		{
+			Check(false, "cannot write the damaged pack");
+			return;
+		}
+		VirtualFileSystem files(0);
+		if (!files.MountPack("", path.string()))
+		{
+			return;
+		}
+		mounted++;
+		if (mustFail)
+		{
+			printf("%s still mounts\n", what);
+			failures++;
+			return;
+		}
+		// A pack that mounts must keep every view inside the mapping
+		const Header* header = reinterpret_cast<const Header*>(damaged.data());
+		const Entry* entries = reinterpret_cast<const Entry*>(damaged.data() + header->entryOffset);
+		const char* paths = reinterpret_cast<const char*>(damaged.data() + header->pathOffset);
+		for (uint32_t i = 0; i < header->entryCount; i++)
+		{
+			FileView view;
+			std::string name(paths + entries[i].pathOffset, entries[i].pathLength);
+			if (!files.Read(name, &view) || view.GetSize() > damaged.size())
+			{
+				printf("%s: entry %u mounts but does not read\n", what, i);
+				failures++;
+				return;
+			}
+		}
+	};
+
+	for (size_t size = 0; size < image.size(); size++)
+	{
+		tryMount(std::vector<uint8_t>(image.begin(), image.begin() + size), true, "a truncated pack");
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(image.data());
+	auto damage = [&](size_t offset, uint64_t value, size_t width, const char* what) {
+		std::vector<uint8_t> damaged = image;
+		memcpy(damaged.data() + offset, &value, width);
+		tryMount(damaged, true, what);
+	};
+	damage(offsetof(Header, magic), 0, 4, "a wrong magic");
+	damage(offsetof(Header, version), Version + 1, 4, "a newer version");
+	damage(offsetof(Header, dataAlignment), 16, 4, "another alignment");
+	damage(offsetof(Header, entryCount), header->entryCount + 1, 4, "an extra entry");
+	damage(offsetof(Header, entryCount), UINT32_MAX, 4, "a huge entry count");
+	damage(offsetof(Header, entryOffset), header->entryOffset + 4, 8, "a misaligned entry table");
+	damage(offsetof(Header, entryOffset), image.size(), 8, "an entry table past the end");
+	damage(offsetof(Header, pathSize), UINT64_MAX, 8, "a huge path table");
+	damage(offsetof(Header, fileSize), image.size() + 64, 8, "a wrong file size");
+	const size_t first = header->entryOffset;
+	const size_t second = first + sizeof(Entry);
+	damage(first + offsetof(Entry, hash), 1, 8, "a wrong hash");
+	damage(first + offsetof(Entry, offset), 1, 8, "a misaligned file");
+	damage(first + offsetof(Entry, offset), image.size() + DataAlignment, 8, "a file past the end");
+	damage(first + offsetof(Entry, storedSize), image.size(), 8, "a file running past the end");
+	damage(first + offsetof(Entry, storedSize), UINT64_MAX, 8, "a huge file");
+	damage(first + offsetof(Entry, size), FirstEntrySize(image) + 1, 8, "a stored file whose sizes differ");
+	damage(first + offsetof(Entry, flags), 2, 4, "an unknown flag");
+	damage(first + offsetof(Entry, pathOffset), uint32_t(header->pathSize), 4, "a path past the table");
+	damage(first + offsetof(Entry, pathLength), 0, 4, "an empty path");
+	damage(second + offsetof(Entry, hash), 0, 8, "an unsorted index");
+
+	// Random byte flips in the header, index and paths
+	std::mt19937 random(11);
+	const size_t indexEnd = size_t(header->pathOffset + header->pathSize);
+	for (int i = 0; i < 2000; i++)
+	{
+		std::vector<uint8_t> damaged = image;
+		damaged[random() % indexEnd] ^= uint8_t(1 + random() % 255);
+		tryMount(damaged, false, "a flipped byte");
+	}
+	printf("damage: %zu damaged packs, %zu still mounted and stayed in bounds\n", tries, mounted);
+	fs::remove(path);
+}
+
+int main(int argc, char** argv)
+{
+	size_t fileCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000;
+	if (fileCount < 4)
+	{
+		fileCount = 4;
+	}
+	CheckNormalize();
+
+	// Mostly small files a few directories deep, as config, material and shader trees are
+	const fs::path root = fs::temp_directory_path() / ("VfsCheck-" + std::to_string(std::random_device()()));
+	const fs::path looseDirectory = root / "loose";
+	std::mt19937 random(3);
+	std::vector<SourceFile> sources(fileCount);
+	for (size_t i = 0; i < fileCount; i++)
+	{
+		SourceFile& source = sources[i];
+		source.name = "dir" + std::to_string(i % 7) + "/sub" + std::to_string(i % 13) + "/file" + std::to_string(i) + (i % 2 ? ".bin" : ".txt");
+		size_t size = i == 0 ? 0 : (random() % 32 == 0 ? 4096 + random() % 65536 : 1 + random() % 2048);
+		// Large files are either vertex-like records that compress or noise that does not
+		source.data.resize(size);
+		bool records = random() % 2 == 0;
+		for (size_t j = 0; j < size; j++)
+		{
+			source.data[j] = records ? uint8_t((j % 32 < 12) ? (j / 32) >> ((j % 4) * 2) : (j % 32) * 7) : uint8_t(random());
+		}
+		if (!WriteFile(looseDirectory / source.name, source.data))
+		{
+			printf("cannot write '%s'\n", (looseDirectory / source.name).string().c_str());
+			return 1;
+		}
+	}
+
+	// Packs must not depend on the order files were added in
+	std::vector<uint8_t> image;
+	std::vector<uint8_t> shuffledImage;
+	{
+		PackWriter writer;
+		PackWriter shuffled;
+		std::vector<size_t> order(fileCount);
+		for (size_t i = 0; i < fileCount; i++)
+		{
+			order[i] = i;
+			writer.Add(sources[i].name, sources[i].data);
+		}
+		std::shuffle(order.begin(), order.end(), random);
+		for (size_t i : order)
+		{
+			shuffled.Add("./" + sources[i].name, sources[i].data);
+		}
+		Check(!shuffled.Add(sources[0].name, {}), "a duplicate name was packed");
+		Check(!shuffled.Add("a/../b", {}), "an escaping name was packed");
+		writer.Build(image);
+		shuffled.Build(shuffledImage);
+		Check(image == shuffledImage, "the pack depends on the order files were added in");
+	}
+	const fs::path packPath = root / "Assets.pak";
+	const fs::path compressedPath = root / "Compressed.pak";
+	std::vector<uint8_t> compressedImage;
+	{
+		JobSystem jobs;
+		PackWriter writer;
+		writer.EnableCompression(&jobs);
+		for (const SourceFile& source : sources)
+		{
+			writer.Add(source.name, source.data);
+		}
+		writer.Build(compressedImage);
+	}
+	if (!WriteFile(packPath, image) || !WriteFile(compressedPath, compressedImage))
+	{
+		printf("cannot write the packs to '%s'\n", root.string().c_str());
+		return 1;
+	}
+	Check(compressedImage.size() < image.size(), "nothing was compressed");
+
+	{
+		VirtualFileSystem files;
+		Check(files.MountDirectory("loose", looseDirectory.string()), "the loose directory does not mount");
+		Check(files.MountPack("packed/", packPath.string()), "the pack does not mount");
+		Check(files.MountPack("compressed/", compressedPath.string()), "the compressed pack does not mount");
+		Check(!files.MountDirectory("", (root / "missing").string()), "a missing directory mounts");
+		Check(!files.MountPack("", (root / "missing.pak").string()), "a missing pack mounts");
+		Check(!files.MountPack("", (looseDirectory / sources[1].name).string()), "a file that is not a pack mounts");
+		Check(files.GetMountCount() == 3, "failed mounts changed the mount list");
+
+		for (size_t i = 0; i < fileCount; i++)
+		{
+			const SourceFile& source = sources[i];
+			FileView loose;
+			FileView packed;
+			std::string spelled = (i % 3 == 0) ? source.name : "./" + source.name;
+			if (i % 5 == 0)
+			{
+				std::replace(spelled.begin(), spelled.end(), '/', '\\');
+			}
+			if (!files.Read("loose/" + spelled, &loose) || !SameBytes(loose, source.data))
+			{
+				printf("loose '%s' does not read back\n", spelled.c_str());
+				failures++;
+			}
+			if (!files.Read("packed/" + spelled, &packed) || !SameBytes(packed, source.data))
+			{
+				printf("packed '%s' does not read back\n", spelled.c_str());
+				failures++;
+			}
+			if (packed.GetSize() > 0 && reinterpret_cast<uintptr_t>(packed.GetData()) % PackFormat::DataAlignment != 0)
+			{
+				printf("packed '%s' is not aligned\n", spelled.c_str());
+				failures++;
+			}
+			FileView compressed;
+			if (!files.Read("compressed/" + spelled, &compressed) || !SameBytes(compressed, source.data))
+			{
+				printf("compressed '%s' does not read back\n", spelled.c_str());
+				failures++;
+			}
+			if (compressed.GetSize() > 0 && reinterpret_cast<uintptr_t>(compressed.GetData()) % PackFormat::DataAlignment != 0)
+			{
+				printf("compressed '%s' is not aligned\n", spelled.c_str());
+				failures++;
+			}
+			if (!files.Exists("loose/" + spelled) || !files.Exists("packed/" + spelled) || !files.Exists("compressed/" + spelled))
+			{
+				printf("'%s' does not exist in every mount\n", spelled.c_str());
+				failures++;
+			}
+
+			// ReadInto fills caller memory the same way, and refuses a buffer of the wrong size
+			const char* mounts[] = { "loose/", "packed/", "compressed/" };
+			for (const char* mount : mounts)
+			{
+				size_t size = 0;
+				std::vector<uint8_t> into(source.data.size() + 1, 0xcd);
+				bool read = files.GetSize(mount + spelled, &size) && size == source.data.size() &&
+					files.ReadInto(mount + spelled, into.data(), size, i % 2 == 0) && !files.ReadInto(mount + spelled, into.data(), size + 1);
+				if (!read || memcmp(into.data(), source.data.data(), source.data.size()) != 0 || into.back() != 0xcd)
+				{
+					printf("ReadInto '%s%s' does not match Read\n", mount, spelled.c_str());
+					failures++;
+				}
+			}
+		}
+
+		const char* missing[] = { "missing.txt", "dir0", "dir0/sub0", "dir0/../dir0/sub0/file0.txt", "DIR0/sub0/file0.txt", "" };
+		for (const char* name : missing)
+		{
+			FileView view;
+			bool found = files.Read(std::string("loose/") + name, &view) || files.Read(std::string("packed/") + name, &view) ||
+				files.Exists(std::string("loose/") + name) || files.Exists(std::string("packed/") + name);
+			if (found || view.IsValid())
+			{
+				printf("'%s' was found\n", name);
+				failures++;
+			}
+		}
+		FileView outside;
+		Check(!files.Read(sources[1].name, &outside), "a name outside every mount point was found");
+
+		// Asynchronous reads from several threads at once, against the synchronous answers
+		std::vector<std::thread> readers;
+		std::vector<int> readerFailures(4, 0);
+		for (size_t t = 0; t < readerFailures.size(); t++)
+		{
+			readers.emplace_back([&, t] {
+				std::vector<std::future<FileView>> pending;
+				for (size_t i = t; i < fileCount; i += readerFailures.size())
+				{
+					pending.push_back(files.ReadAsync((i % 2 ? "packed/" : "loose/") + sources[i].name));
+				}
+				pending.push_back(files.ReadAsync("packed/missing.txt"));
+				for (size_t j = 0; j + 1 < pending.size(); j++)
+				{
+					size_t i = t + j * readerFailures.size();
+					if (!SameBytes(pending[j].get(), sources[i].data))
+					{
+						readerFailures[t]++;
+					}
+				}
+				if (pending.back().get().IsValid())
+				{
+					readerFailures[t]++;
+				}
+			});
+		}
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+		for (int count : readerFailures)
+		{
+			Check(count == 0, "an asynchronous read returned the wrong bytes");
+		}
+
+		// Timing: every file once through each mount, after one pass to warm the page cache
+		auto timeReads = [&](const char* mountPoint) {
+			double best = 1e30;
+			for (int pass = 0; pass < 3; pass++)
+			{
+				auto begin = Clock::now();
+				size_t sum = 0;
+				for (const SourceFile& source : sources)
+				{
+					FileView view;
+					files.Read(mountPoint + source.name, &view);
+					sum += view.GetSize() > 0 ? static_cast<const uint8_t*>(view.GetData())[0] : 0;
+				}
+				best = std::min(best, std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+				Check(sum != 1, "");
+			}
+			return best / fileCount;
+		};
+		double looseMicroseconds = timeReads("loose/");
+		double packedMicroseconds = timeReads("packed/");
+		files.ResetStatistics();
+		double compressedMicroseconds = timeReads("compressed/");
+		FileReadStatistics statistics = files.GetStatistics();
+		printf("%zu files: %.2f us per loose read, %.2f us per pack read (%.1fx), %.2f us per compressed pack read\n", fileCount,
+			looseMicroseconds, packedMicroseconds, looseMicroseconds / packedMicroseconds, compressedMicroseconds);
+		printf("compressed pack: %zu of %zu reads decompressed, %.1f MB from %.1f MB stored, decompressing at %.0f MB/s\n",
+			statistics.decompressedReads, statistics.reads, statistics.bytes / 1e6, statistics.storedBytes / 1e6,
+			statistics.decompressedBytes / 1e6 / std::max(statistics.decompressSeconds, 1e-9));
+	}
+
+	// Later mounts shadow earlier ones; names the pack lacks still fall through to the directory
+	{
+		PackWriter writer;
+		writer.Add(sources[1].name, { 1, 2, 3 });
+		const fs::path overridePath = root / "Override.pak";
+		std::vector<uint8_t> overrideImage;
+		writer.Build(overrideImage);
+		WriteFile(overridePath, overrideImage);
+
+		FileView kept;
+		{
+			VirtualFileSystem files(1);
+			files.MountDirectory("", looseDirectory.string());
+			files.MountPack("", overridePath.string());
+			FileView shadowed;
+			FileView fallthrough;
+			Check(files.Read(sources[1].name, &shadowed) && SameBytes(shadowed, { 1, 2, 3 }), "the later pack does not shadow the directory");
+			Check(files.Read(sources[2].name, &fallthrough) && SameBytes(fallthrough, sources[2].data), "a name the pack lacks does not fall through");
+			files.UnmountAll();
+			Check(!files.Exists(sources[2].name), "UnmountAll left a mount behind");
+			Check(SameBytes(shadowed, { 1, 2, 3 }), "a view did not survive UnmountAll");
+			kept = fallthrough;
+			std::future<FileView> queued = files.ReadAsync(sources[2].name);
+			Check(!queued.get().IsValid(), "an asynchronous read found a file after UnmountAll");
+		}
+		Check(SameBytes(kept, sources[2].data), "a view did not survive the file system");
+		fs::remove(overridePath);
+	}
+
+	// A damaged chunk table must fail the read; damaged chunk data must fail or at least stay in bounds
+	{
+		using namespace PackFormat;
+		const Header* header = reinterpret_cast<const Header*>(compressedImage.data());
+		const Entry* entries = reinterpret_cast<const Entry*>(compressedImage.data() + header->entryOffset);
+		const Entry* entry = std::find_if(entries, entries + header->entryCount, [](const Entry& e) { return (e.flags & CompressedEntry) != 0; });
+		std::string name = "x/" + std::string(reinterpret_cast<const char*>(compressedImage.data() + header->pathOffset + entry->pathOffset), entry->pathLength);
+		const fs::path damagedPath = root / "DamagedStream.pak";
+		std::mt19937 flips(7);
+		size_t refused = 0;
+		for (int i = 0; i < 300; i++)
+		{
+			std::vector<uint8_t> damaged = compressedImage;
+			bool table = i < 100;
+			size_t span = table ? sizeof(CompressedStreamFormat::Header) + sizeof(CompressedStreamFormat::Chunk) : size_t(entry->storedSize);
+			damaged[size_t(entry->offset) + flips() % span] ^= uint8_t(1 + flips() % 255);
+			WriteFile(damagedPath, damaged);
+			VirtualFileSystem files(0);
+			files.MountPack("x", damagedPath.string());
+			FileView view;
+			if (!files.Read(name, &view))
+			{
+				refused++;
+			}
+			else if (view.GetSize() != entry->size)
+			{
+				printf("a damaged stream read back with the wrong size\n");
+				failures++;
+			}
+		}
+		printf("damaged streams: %zu of 300 reads refused\n", refused);
+		fs::remove(damagedPath);
+	}
+
+	// Damage a small pack, so every truncation can be tried
+	{
+		PackWriter writer;
+		for (size_t i = 0; i < 16; i++)
+		{
+			writer.Add(sources[i].name, std::vector<uint8_t>(sources[i].data.begin(), sources[i].data.begin() + std::min<size_t>(sources[i].data.size(), 100)));
+		}
+		std::vector<uint8_t> small;
+		writer.Build(small);
+		CheckDamage(root, small);
+	}
+
+	std::error_code error;
+	fs::remove_all(root, error);
+	printf(failures ? "FAILED\n" : "virtual file system checks out\n");
+	return failures ? 1 : 0;
+}